@@ -9,6 +9,13 @@
 // objects. These are kept globally so all events get copies of
 // of the pointers. The DBORptrs objects are kept in the
 // JEventSource_EVIOpp object.
+//
+// Once the BOR bank has been parsed, dense lookup tables indexed
+// by rocid and slot are built so the config of a module can be
+// found with a single indexed load rather than a search:
+//
+//    const Df250BORConfig *conf = borptrs->Get<Df250BORConfig>(rocid, slot);
+//
 
 #ifndef _DBORptrs_
 #define _DBORptrs_
@@ -28,6 +35,10 @@
 
 #include <DAQ/LinkAssociations.h>
 
+#include <stdint.h>
+#include <vector>
+using std::vector;
+
 class JEventSource_EVIOpp;
 
 class DBORptrs{
@@ -49,10 +60,12 @@ class DBORptrs{
 		// Method to delete all objects in all vectors. This should
 		// usually only be called from the destructor
 		#define deletevector(A)     for(auto p : v##A) delete p;
-		#define clearvectors(A)     v##A.clear();
+		#define clearvectors(A)     v##A.clear(); t##A.clear();
 		void Delete(void){
 			MyBORTypes(deletevector)
 			MyBORTypes(clearvectors)
+			f250_firmware.clear();
+			f125_firmware.clear();
 		}
 		#undef deletevector
 		#undef clearvectors
@@ -62,6 +75,116 @@ class DBORptrs{
 		#define sortvector(A) if( v##A.size()>1 ) sort(v##A.begin(), v##A.end(), SortByModule<A>);
 		void Sort(void){ MyBORTypes(sortvector) }
 		#undef sortvector
+
+		// Lookup tables for each type in "MyBORTypes". Entry
+		// rocid*kNslots + slot points to the config of that module
+		// or is NULL if there is none. e.g.
+		//
+		//       vector<const Df250BORConfig*> tDf250BORConfig;
+		//
+		// Modules with a rocid of kMaxRocids or more or a slot of
+		// kNslots or more are left out of the tables (and out of the
+		// firmware tables) so a corrupt BOR bank can't make them huge.
+		static const uint32_t kNslots    = 32;
+		static const uint32_t kMaxRocids = 0x1000;
+		#define maketable(A) vector<const A*>  t##A;
+		MyBORTypes(maketable)
+		#undef maketable
+
+		// Firmware generation (see Df250BORConfig::FirmwareGeneration)
+		// of the f250 and f125 modules of each crate, indexed by rocid.
+		// 0 means there are no modules of that type in the crate and
+		// 0xFF that they don't all report the same known generation.
+		vector<uint8_t> f250_firmware;
+		vector<uint8_t> f125_firmware;
+
+		// Build the lookup tables and firmware generation tables from
+		// the vectors. This is called once after the BOR bank has been
+		// parsed (see JEventEVIOBuffer::ParseBORbank).
+		#define filltable(A) FillTable(v##A, t##A);
+		void BuildLookupTables(void){
+			MyBORTypes(filltable)
+			FillFirmware(vDf250BORConfig, f250_firmware);
+			FillFirmware(vDf125BORConfig, f125_firmware);
+		}
+		#undef filltable
+
+		// Return the config object of the given type for the module in
+		// the given crate and slot or NULL if there isn't one.
+		#define gettable(A) const vector<const A*>& GetTable(const A*) const { return t##A; }
+		MyBORTypes(gettable)
+		#undef gettable
+		template<class T> const T* Get(uint32_t rocid, uint32_t slot) const {
+			auto &t = GetTable( (const T*)NULL );
+			if( rocid>=kMaxRocids || slot>=kNslots ) return NULL;
+			uint32_t idx = rocid*kNslots + slot;
+			return (idx<t.size()) ? t[idx]:NULL;
+		}
+
+		// Associate each hit with the config of its module of type C
+		// (see JEventEVIOBuffer::LinkAssociations). Hits whose number
+		// of integral samples was not set from a config bank (still 0)
+		// get the numbers of samples the BOR config gives. e.g.
+		//
+		//    borptrs->LinkSamplesCopy<Df250BORConfig>(pe->vDf250PulseData);
+		//
+		template<class C, class T> void LinkSamplesCopy(vector<T*> &hits) const {
+			for(auto hit : hits){
+				const C *conf = Get<C>(hit->rocid, hit->slot);
+				if( !conf ) continue;
+				hit->AddAssociatedObject(conf);
+				if( hit->nsamples_integral == 0 ){
+					hit->nsamples_integral = conf->NSA + conf->NSB;
+					hit->nsamples_pedestal = conf->NPED;
+				}
+			}
+		}
+
+	protected:
+
+		//----------------
+		// IsGood
+		//----------------
+		template<class T>
+		static bool IsGood(const T *conf){ return conf->rocid<kMaxRocids && conf->slot<kNslots; }
+
+		//----------------
+		// FillTable
+		//----------------
+		template<class T>
+		static void FillTable(const vector<T*> &v, vector<const T*> &t){
+			/// If a module appears more than once the first one
+			/// (after sorting) is used. Modules with a bad rocid or
+			/// slot are left out.
+			uint32_t Nrocids = 0;
+			for(auto p : v) if( IsGood(p) && p->rocid >= Nrocids ) Nrocids = p->rocid+1;
+			t.assign(Nrocids*kNslots, NULL);
+			for(auto p : v){
+				if( !IsGood(p) ) continue;
+				const T* &entry = t[p->rocid*kNslots + p->slot];
+				if( entry == NULL ) entry = p;
+			}
+		}
+
+		//----------------
+		// FillFirmware
+		//----------------
+		template<class T>
+		static void FillFirmware(const vector<T*> &v, vector<uint8_t> &firmware){
+			/// The first module seen in a crate sets its entry. Any module
+			/// that reports something different (or an unknown generation)
+			/// marks the crate as mixed (0xFF) so later ones can't set it
+			/// again. Modules with a bad rocid or slot are left out.
+			firmware.clear();
+			for(auto conf : v){
+				if( !IsGood(conf) ) continue;
+				if( conf->rocid >= firmware.size() ) firmware.resize(conf->rocid+1, 0);
+				uint8_t &g = firmware[conf->rocid];
+				uint8_t  generation = conf->FirmwareGeneration();
+				if( g==0 ) g = generation ? generation:0xFF;
+				else if( g!=generation ) g = 0xFF;
+			}
+		}
 };
 
 #endif // _DBORptrs_
@@ -12,9 +12,12 @@
 #include <string>
 #include <time.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 using std::string;
 
 #include <JANA/JObject.h>
+#include <epics_channels.h>
 
 /// A DEPICSvalue object holds information for a single
 /// EPICS value read from the data stream. Values are
@@ -24,8 +27,12 @@ using std::string;
 /// name via "name" and the value as a sting via "sval".
 /// The "ival", "uval", and "fval" hold the value converted
 /// into a an "int", "uint32_t", and "double" respectively.
-/// This is done using the stringstream class an is done
-/// for convience. The EPICS values are inserted into the
+/// This is done using strtol, strtoul and strtod and is done
+/// for convience. Channel names are not copied into each
+/// object. Instead "id" holds the channel's id in the
+/// process-wide EPICSChannelTable (see epics_channels.h)
+/// and name() and nameval() look it up when needed. The
+/// EPICS values are inserted into the
 /// EVIO file during data taking by the epics2et program
 /// which should be started automatically by the DAQ system.
 /// Source for that can be found here:
@@ -36,43 +43,51 @@ using std::string;
 class DEPICSvalue:public JObject{
 	public:
 		JOBJECT_PUBLIC(DEPICSvalue);
-		DEPICSvalue(time_t timestamp, string &nameval){
-			this->timestamp = timestamp;
-			this->nameval = nameval;
-			size_t pos = nameval.find("=");
-			if(pos != nameval.npos){
-				name = nameval.substr(0, pos);
-				sval = nameval.substr(pos+1);
-				
-				stringstream ss(sval);
-				ss >> ival;
-				ss.str(sval);
-				ss >> uval;
-				ss.str(sval);
-				ss >> fval;
-				
-				// stringstream will set fval to 0.0 if no decimal
-				// point is in the string. Use ival in these cases
-				if( (fval==0.0) && (ival!=0.0) ) fval = (double)ival;
-			}
-		}
+		DEPICSvalue():timestamp(0),id(0),ival(0),uval(0),fval(0.0){}
+		DEPICSvalue(time_t timestamp, const char *nameval){ Set(timestamp, nameval); }
+		DEPICSvalue(time_t timestamp, const string &nameval){ Set(timestamp, nameval.c_str()); }
 		virtual ~DEPICSvalue(){}
 		
 		time_t   timestamp;
-		string   nameval;
-		string   name;
+		uint32_t id;        ///< channel id in EPICSChannelTable
 		string   sval;
 		int      ival;
 		uint32_t uval;
 		double   fval;
 
+		const string& name(void) const { return EPICSChannelTable::Name(id); }
+		string nameval(void) const { return name() + "=" + sval; }
+
+		/// Fill in all members from a "name=value" string. sval keeps
+		/// its memory so an object recycled by DParsedEvent can be given
+		/// a new value without allocating.
+		void Set(time_t timestamp, const char *nameval){
+			this->timestamp = timestamp;
+			ival = 0;
+			uval = 0;
+			fval = 0.0;
+			const char *eq = strchr(nameval, '=');
+			if(eq != NULL){
+				id = EPICSChannelTable::Intern(nameval, eq-nameval);
+				sval.assign(eq+1);
+
+				ival = (int)strtol(eq+1, NULL, 10);
+				uval = (uint32_t)strtoul(eq+1, NULL, 10);
+				fval = strtod(eq+1, NULL);
+			}else{
+				id = EPICSChannelTable::Intern("", 0);
+				sval.clear();
+			}
+		}
+		void Set(time_t timestamp, const string &nameval){ Set(timestamp, nameval.c_str()); }
+
 		// This method is used primarily for pretty printing
 		// the second argument to AddString is printf style format
 		void toStrings(vector<pair<string,string> > &items)const{
 			string timestr = ctime(&timestamp);
 			timestr[timestr.length()-1] = 0;
 			AddString(items, "timestamp", "%d", timestamp);
-			AddString(items, "name", "%s", name.c_str());
+			AddString(items, "name", "%s", name().c_str());
 			AddString(items, "sval", "%s", sval.substr(0, 255).c_str());
 			AddString(items, "ival", "%d", ival);
 			AddString(items, "fval", "%f", (float)fval);
@@ -0,0 +1,112 @@
+//
+//    File: DHitColumns.h
+//
+// Column (structure of arrays) storage for the f125 CDC and FDC pulse
+// hits. When EVIO:HIT_COLUMNS is set the f125 decoder appends each
+// hit's values to these instead of making Df125CDCPulse and
+// Df125FDCPulse objects. Code that loops over all hits of an event can
+// then read e.g. le_time for every hit from one contiguous array:
+//
+//    auto &cdc = pe->GetColumns<Df125CDCPulseColumns>();
+//    const uint32_t *le_time = cdc.le_time.data();
+//    for(size_t i=0; i<cdc.size(); i++) ... le_time[i] ...
+//
+// The objects are only made from the columns (and linked) the first
+// time they are asked for with DParsedEvent::Get or when the event is
+// copied to factories. The columns are in the order the hits were
+// decoded, which is not necessarily the order of the objects.
+//
+// The vectors are cleared but keep their capacity when the event is
+// recycled so filling them does not allocate once the first few events
+// have been seen.
+//
+
+#ifndef _DHitColumns_
+#define _DHitColumns_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// Columns common to both f125 pulse types in the order they appear in
+// the object constructors
+#define Df125PulseColumnList(X) \
+		X(rocid) \
+		X(slot) \
+		X(channel) \
+		X(itrigger) \
+		X(NPK) \
+		X(le_time) \
+		X(time_quality_bit) \
+		X(overflow_count) \
+		X(pedestal)
+
+#define Df125CDCPulseColumnList(X) \
+		Df125PulseColumnList(X) \
+		X(integral) \
+		X(first_max_amp) \
+		X(word1) \
+		X(word2)
+
+#define Df125FDCPulseColumnList(X) \
+		Df125PulseColumnList(X) \
+		X(integral) \
+		X(peak_amp) \
+		X(peak_time) \
+		X(word1) \
+		X(word2)
+
+#define makecolumn(A)    std::vector<uint32_t> A;
+#define clearcolumn(A)   A.clear();
+#define appendcolumn(A)  A.insert(A.end(), src.A.begin(), src.A.end());
+#define pushcolumn(A)    this->A.push_back(A);
+
+//----------------
+// Df125CDCPulseColumns
+//----------------
+class Df125CDCPulseColumns{
+	public:
+		Df125CDCPulseColumnList(makecolumn)
+
+		size_t size(void) const { return rocid.size(); }
+		bool  empty(void) const { return rocid.empty(); }
+		void  clear(void){ Df125CDCPulseColumnList(clearcolumn) }
+		void append(const Df125CDCPulseColumns &src){ Df125CDCPulseColumnList(appendcolumn) }
+
+		void push_back(uint32_t rocid, uint32_t slot, uint32_t channel, uint32_t itrigger
+					, uint32_t NPK, uint32_t le_time, uint32_t time_quality_bit, uint32_t overflow_count
+					, uint32_t pedestal, uint32_t integral, uint32_t first_max_amp
+					, uint32_t word1, uint32_t word2){
+			Df125CDCPulseColumnList(pushcolumn)
+		}
+};
+
+//----------------
+// Df125FDCPulseColumns
+//----------------
+class Df125FDCPulseColumns{
+	public:
+		Df125FDCPulseColumnList(makecolumn)
+
+		size_t size(void) const { return rocid.size(); }
+		bool  empty(void) const { return rocid.empty(); }
+		void  clear(void){ Df125FDCPulseColumnList(clearcolumn) }
+		void append(const Df125FDCPulseColumns &src){ Df125FDCPulseColumnList(appendcolumn) }
+
+		void push_back(uint32_t rocid, uint32_t slot, uint32_t channel, uint32_t itrigger
+					, uint32_t NPK, uint32_t le_time, uint32_t time_quality_bit, uint32_t overflow_count
+					, uint32_t pedestal, uint32_t integral, uint32_t peak_amp, uint32_t peak_time
+					, uint32_t word1, uint32_t word2){
+			Df125FDCPulseColumnList(pushcolumn)
+		}
+};
+
+#undef Df125PulseColumnList
+#undef Df125CDCPulseColumnList
+#undef Df125FDCPulseColumnList
+#undef makecolumn
+#undef clearcolumn
+#undef appendcolumn
+#undef pushcolumn
+
+#endif // _DHitColumns_
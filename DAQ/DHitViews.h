@@ -0,0 +1,196 @@
+//
+//    File: DHitViews.h
+//
+// Light-weight alternatives to the high volume hit objects. These are
+// made instead of Df250PulseData, Df125CDCPulse, Df125FDCPulse,
+// DF1TDCHit, Df250WindowRawData and Df125WindowRawData objects when
+// EVIO:HIT_VIEWS is set. A view only holds the hit's address and a
+// pointer to its data words. Everything else is decoded from the words
+// each time it is asked for so hits that are never looked at cost
+// almost nothing.
+//
+// The words are owned by the event they came from (see DLazyModuleData
+// in DParsedEvent.h) and are in host byte order. A view must not be
+// kept after the event is released. Views are not JObjects so they are
+// not linked to config or other hit objects. Values that are only set
+// when linking (e.g. nsamples_integral) are not available.
+//
+
+#ifndef _DHitViews_
+#define _DHitViews_
+
+#include <stdint.h>
+#include <vector>
+
+#include <DAQ/DModuleType.h>
+#include <window_samples.h>
+
+//----------------
+// Df250PulseDataView
+//----------------
+class Df250PulseDataView{
+	public:
+		Df250PulseDataView(uint32_t rocid, uint32_t slot, uint32_t itrigger, const uint32_t *header, const uint32_t *words, uint32_t pulse_number)
+			:rocid(rocid),slot(slot),itrigger(itrigger),pulse_number(pulse_number),header(header),words(words){}
+
+		uint32_t rocid;
+		uint32_t slot;
+		uint32_t itrigger;
+		uint32_t pulse_number;
+		const uint32_t *header;  ///< Pulse Data word 1 (shared by all pulses of the channel)
+		const uint32_t *words;   ///< Pulse Data words 2 and 3 for this pulse
+
+		// from word 1
+		uint32_t event_within_block(void)      const { return (header[0]>>19) & 0xFF;    }
+		uint32_t channel(void)                 const { return (header[0]>>15) & 0x0F;    }
+		bool     QF_pedestal(void)             const { return (header[0]>>14) & 0x01;    }
+		uint32_t pedestal(void)                const { return (header[0]>>0 ) & 0x3FFF;  }
+
+		// from word 2
+		uint32_t integral(void)                const { return (words[0]>>12) & 0x3FFFF;  }
+		bool     QF_NSA_beyond_PTW(void)       const { return (words[0]>>11) & 0x01;     }
+		bool     QF_overflow(void)             const { return (words[0]>>10) & 0x01;     }
+		bool     QF_underflow(void)            const { return (words[0]>>9 ) & 0x01;     }
+		uint32_t nsamples_over_threshold(void) const { return (words[0]>>0 ) & 0x1FF;    }
+
+		// from word 3
+		uint32_t course_time(void)             const { return (words[1]>>21) & 0x1FF;    }
+		uint32_t fine_time(void)               const { return (words[1]>>15) & 0x3F;     }
+		uint32_t pulse_peak(void)              const { return (words[1]>>3 ) & 0xFFF;    }
+		bool     QF_vpeak_beyond_NSA(void)     const { return (words[1]>>2 ) & 0x01;     }
+		bool     QF_vpeak_not_found(void)      const { return (words[1]>>1 ) & 0x01;     }
+		bool     QF_bad_pedestal(void)         const { return (words[1]>>0 ) & 0x01;     }
+};
+
+//----------------
+// Df125PulseView
+//----------------
+class Df125PulseView{
+
+	/// Common part of the f125 CDC and FDC pulse views. Both are made
+	/// from the data types 5 (CDC pulse), 6 (FDC pulse integral) and
+	/// 9 (FDC pulse peak) which differ only in the second word.
+
+	public:
+		Df125PulseView(uint32_t rocid, uint32_t slot, uint32_t itrigger, const uint32_t *words)
+			:rocid(rocid),slot(slot),itrigger(itrigger),words(words){}
+
+		uint32_t rocid;
+		uint32_t slot;
+		uint32_t itrigger;
+		const uint32_t *words;
+
+		uint32_t data_type(void)        const { return (words[0]>>27) & 0x0F;  }
+		uint32_t word1(void)            const { return words[0];               }
+		uint32_t word2(void)            const { return words[1];               }
+
+		// from word 1
+		uint32_t channel(void)          const { return (words[0]>>20) & 0x7F;  }
+		uint32_t NPK(void)              const { return (words[0]>>15) & 0x1F;  }
+		uint32_t le_time(void)          const { return (words[0]>>4 ) & 0x7FF; }
+		uint32_t time_quality_bit(void) const { return (words[0]>>3 ) & 0x1;   }
+		uint32_t overflow_count(void)   const { return (words[0]>>0 ) & 0x7;   }
+};
+
+//----------------
+// Df125CDCPulseView
+//----------------
+class Df125CDCPulseView:public Df125PulseView{
+	public:
+		Df125CDCPulseView(uint32_t rocid, uint32_t slot, uint32_t itrigger, const uint32_t *words)
+			:Df125PulseView(rocid, slot, itrigger, words){}
+
+		// from word 2
+		uint32_t pedestal(void)      const { return data_type()==5 ? (words[1]>>23) & 0xFF   : (words[1]>>0 ) & 0x7FF; }
+		uint32_t integral(void)      const { return data_type()==5 ? (words[1]>>9 ) & 0x3FFF : 0;                      }
+		uint32_t first_max_amp(void) const { return data_type()==5 ? (words[1]>>0 ) & 0x1FF  : (words[1]>>19) & 0xFFF; }
+};
+
+//----------------
+// Df125FDCPulseView
+//----------------
+class Df125FDCPulseView:public Df125PulseView{
+	public:
+		Df125FDCPulseView(uint32_t rocid, uint32_t slot, uint32_t itrigger, const uint32_t *words)
+			:Df125PulseView(rocid, slot, itrigger, words){}
+
+		// from word 2
+		uint32_t integral(void)  const { return data_type()==6 ? (words[1]>>19) & 0xFFF : 0; }
+		uint32_t peak_amp(void)  const { return data_type()==6 ? 0 : (words[1]>>19) & 0xFFF; }
+		uint32_t peak_time(void) const { return (words[1]>>11) & 0xFF;  }
+		uint32_t pedestal(void)  const { return (words[1]>>0 ) & 0x7FF; }
+};
+
+//----------------
+// DF1TDCHitView
+//----------------
+class DF1TDCHitView{
+	public:
+		DF1TDCHitView(uint32_t rocid, uint32_t slot, uint32_t itrigger, uint32_t trig_time, MODULE_TYPE modtype, const uint32_t *word)
+			:rocid(rocid),slot(slot),itrigger(itrigger),trig_time(trig_time),modtype(modtype),word(word){}
+
+		uint32_t rocid;
+		uint32_t slot;
+		uint32_t itrigger;
+		uint32_t trig_time;  ///< from the F1 chip header
+		MODULE_TYPE modtype;
+		const uint32_t *word;
+
+		uint32_t data_word(void)                   const { return word[0]; }
+		uint32_t time(void)                        const { return (word[0]>>0 ) & 0xFFFF; }
+		bool     res_status(void)                  const { return (word[0]>>26) & 0x1; }
+		bool     output_fifo_overflow_status(void) const { return (word[0]>>25) & 0x1; }
+		bool     hit_fifo_overflow_status(void)    const { return (word[0]>>24) & 0x1; }
+
+		uint32_t channel(void) const {
+			/// Same mapping as JEventEVIOBuffer::F1TDC_channel
+			uint32_t chip         = (word[0]>>19) & 0x07;
+			uint32_t chan_on_chip = (word[0]>>16) & 0x07;
+			if( modtype == DModuleType::F1TDC32 ) return (4 * chip) + (chan_on_chip>>1);
+			return (chip <<3) | chan_on_chip;
+		}
+};
+
+//----------------
+// DWindowRawDataView
+//----------------
+class DWindowRawDataView{
+
+	/// Window Raw Data header word and the sample words that follow it.
+	/// GetSamples decodes the samples the same way as for the
+	/// Df250WindowRawData and Df125WindowRawData objects.
+
+	public:
+		DWindowRawDataView(uint32_t rocid, uint32_t slot, uint32_t itrigger, const uint32_t *header)
+			:rocid(rocid),slot(slot),itrigger(itrigger),header(header){}
+
+		uint32_t rocid;
+		uint32_t slot;
+		uint32_t itrigger;
+		const uint32_t *header;
+
+		uint32_t window_width(void) const { return header[0] & 0x0FFF; }
+
+		void GetSamples(std::vector<uint16_t> &samples, bool &invalid_samples, bool &overflow) const {
+			invalid_samples = overflow = false;
+			UnpackWindowSamples(&header[1], window_width(), false, samples, invalid_samples, overflow);
+		}
+};
+
+class Df250WindowRawDataView:public DWindowRawDataView{
+	public:
+		Df250WindowRawDataView(uint32_t rocid, uint32_t slot, uint32_t itrigger, const uint32_t *header)
+			:DWindowRawDataView(rocid, slot, itrigger, header){}
+
+		uint32_t channel(void) const { return (header[0]>>23) & 0x0F; }
+};
+
+class Df125WindowRawDataView:public DWindowRawDataView{
+	public:
+		Df125WindowRawDataView(uint32_t rocid, uint32_t slot, uint32_t itrigger, const uint32_t *header)
+			:DWindowRawDataView(rocid, slot, itrigger, header){}
+
+		uint32_t channel(void) const { return (header[0]>>20) & 0x7F; }
+};
+
+#endif // _DHitViews_
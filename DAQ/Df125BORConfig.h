@@ -28,7 +28,49 @@ class Df125BORConfig:public JObject, public f125config{
 
 		Df125BORConfig(){}
 		virtual ~Df125BORConfig(){}
+
+		uint32_t NW;             // extracted from fe[0].nw
+		uint32_t PL;             // extracted from fe[0].pl
+		uint32_t threshold[72];  // per channel from fe[ch/6].threshold[ch%6]
+		uint32_t NSA;            // samples integrated from the hit threshold crossing on (IE from fe[0].ie)
+		uint32_t NSB;            // samples integrated before the crossing (none for CDC/FDC pulse firmware)
+		uint32_t NPED;           // samples summed for the local pedestal (NP2 from fe[0].ped_sf)
+
+		// First front end FPGA firmware version that writes the CDC/FDC
+		// pulse words (GlueX-doc-2274) rather than separate pulse
+		// integral, time and pedestal words.
+		static const uint32_t kPulseDataFEVersion = 0x10000;
+
+		/// Return the firmware generation of the module: 2 for CDC/FDC
+		/// pulse firmware, 1 for the older firmware and 0 if it is not
+		/// known. All front end FPGAs must agree.
+		uint32_t FirmwareGeneration(void) const {
+			uint32_t generation = 0;
+			for(uint32_t i=0; i<12; i++){
+				if( fe[i].version == 0 ) continue;
+				uint32_t g = (fe[i].version >= kPulseDataFEVersion) ? 2:1;
+				if( generation && g!=generation ) return 0;
+				generation = g;
+			}
+			return generation;
+		}
 		
+		/// Extract values as read from config registers
+		/// and fill in the derived members defined above.
+		/// This is called from JEventEVIOBuffer::ParseBORbank
+		void FillDerived(void){
+
+			NW = fe[0].nw;
+			PL = fe[0].pl;
+			for(uint32_t ch=0; ch<72; ch++) threshold[ch] = fe[ch/6].threshold[ch%6];
+
+			// Register fields as in fa125Lib.h: ie holds IE in bits
+			// 0-11 and ped_sf holds NP2 in bits 8-15
+			NSA  = (fe[0].ie    >> 0) & 0xFFF;
+			NSB  = 0;
+			NPED = (fe[0].ped_sf>> 8) & 0xFF;
+		}
+
 		// This method is used primarily for pretty printing
 		// the second argument to AddString is printf style format
 		void toStrings(vector<pair<string,string> > &items)const{
@@ -39,6 +81,11 @@ class Df125BORConfig:public JObject, public f125config{
 			AddString(items, "proc_version" , "0x%x", proc_version);
 			AddString(items, "ctrl1" , "0x%x", ctrl1);
 			AddString(items, "proc_blocklevel" , "%d", proc_blocklevel);
+			AddString(items, "NW"      , "%d", NW);
+			AddString(items, "PL"      , "%d", PL);
+			AddString(items, "NSA"     , "%d", NSA);
+			AddString(items, "NSB"     , "%d", NSB);
+			AddString(items, "NPED"    , "%d", NPED);
 		}
 
 };
@@ -36,6 +36,19 @@ class Df250BORConfig:public JObject, public f250config{
 		uint32_t MaxPed;   // extracted from config7
 		uint32_t NSAT;     // extracted from adc_config[0]
 
+		// First processing FPGA firmware version (adc_status[0])
+		// that writes Pulse Data words rather than separate pulse
+		// integral, time and pedestal words.
+		static const uint32_t kPulseDataProcVersion = 0x0C00;
+
+		/// Return the firmware generation of the module: 2 for Pulse Data
+		/// firmware, 1 for the older firmware and 0 if it is not known.
+		uint32_t FirmwareGeneration(void) const {
+			uint32_t proc_version = adc_status[0] & 0xFFFF;
+			if( proc_version == 0 ) return 0;
+			return (proc_version >= kPulseDataProcVersion) ? 2:1;
+		}
+
 		/// Extract values as read from config registers
 		/// and fill in the derived members defined above.
 		/// This is called from DEVIOWorkerThread::ParseBORbank
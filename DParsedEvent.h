@@ -10,8 +10,11 @@
 
 #include <string>
 #include <map>
+#include <memory>
+#include <atomic>
 using std::string;
 using std::map;
+using std::shared_ptr;
 
 #include <JANA/JEvent.h>
 
@@ -58,6 +61,10 @@ using std::map;
 #include <DAQ/DBORptrs.h>
 #include <DAQ/DVertex.h>
 #include <DAQ/DEventRFBunch.h>
+#include <DAQ/DHitViews.h>
+#include <DAQ/DHitColumns.h>
+
+#include <LinkAssociations.h>
 
 // Here is some C++ macro script-fu. For each type of class the DParsedEvent
 // can hold, we want to have a vector of pointers to that type of object. 
@@ -111,13 +118,96 @@ using std::map;
 // memory leak occurs for things like the samples vector in the Window Raw
 // data classes. This is because the in-place constructor re-initializes
 // the samples vector's underlying data pointer to NULL without freeing
-// the memory it points to. The easiest way around this is to just not use
-// a pool for these data types so the destructor is properly called. This
-// means a slight drop in efficiency, but only for data containing WRD which
-// is going to be slow anyway.
-#define MyNoPoolTypes(X) \
-		X(Df250WindowRawData) \
-		X(Df125WindowRawData)
+// the memory it points to. To avoid this, the vector member of these types
+// is moved out of a recycled object before the in-place constructor call
+// and moved back (emptied) after. This also means their vectors are not
+// reallocated for every event once the pools have warmed up (see Reconstruct).
+// DL1Info has several vectors and is handled separately.
+#define MyVectorTypes(X) \
+		X(Df250StreamingRawData, samples) \
+		X(Df250PulseRawData,     samples) \
+		X(Df250WindowRawData,    samples) \
+		X(Df125PulseRawData,     samples) \
+		X(Df125WindowRawData,    samples) \
+		X(DCODAROCInfo,          misc) \
+		X(DCODAControlEvent,     words) \
+		X(Df250Scaler,           fa250_sc)
+
+// Light-weight views made instead of the objects of some high volume
+// types when EVIO:HIT_VIEWS is set (see DAQ/DHitViews.h). These are
+// held by value and the vectors are just cleared for each event.
+#define MyViewTypes(X) \
+		X(Df250PulseDataView) \
+		X(Df250WindowRawDataView) \
+		X(Df125CDCPulseView) \
+		X(Df125FDCPulseView) \
+		X(Df125WindowRawDataView) \
+		X(DF1TDCHitView)
+
+// Types whose hits can be stored in columns instead of objects when
+// EVIO:HIT_COLUMNS is set (see DAQ/DHitColumns.h). The objects are
+// made from the columns when first asked for (see Materialize).
+#define MyColumnTypes(X) \
+		X(Df125CDCPulse) \
+		X(Df125FDCPulse)
+
+// Data types made by the module decoders grouped by the decoder (family)
+// that makes them. With EVIO:LAZY_PARSE these are only decoded the
+// first time one of the types in the family is asked for (see
+// DParsedEvent::Get).
+#define MyLazyTypes(X) \
+		X(Df250TriggerTime,     kF250) \
+		X(Df250WindowSum,       kF250) \
+		X(Df250WindowRawData,   kF250) \
+		X(Df250PulseIntegral,   kF250) \
+		X(Df250PulseTime,       kF250) \
+		X(Df250PulsePedestal,   kF250) \
+		X(Df250PulseData,       kF250) \
+		X(Df125TriggerTime,     kF125) \
+		X(Df125WindowRawData,   kF125) \
+		X(Df125PulseIntegral,   kF125) \
+		X(Df125PulseTime,       kF125) \
+		X(Df125PulsePedestal,   kF125) \
+		X(Df125CDCPulse,        kF125) \
+		X(Df125FDCPulse,        kF125) \
+		X(DF1TDCHit,            kF1TDC) \
+		X(DF1TDCTriggerTime,    kF1TDC) \
+		X(DCAEN1290TDCHit,      kCAEN1290TDC) \
+		X(Df250PulseDataView,     kF250) \
+		X(Df250WindowRawDataView, kF250) \
+		X(Df125CDCPulseView,      kF125) \
+		X(Df125FDCPulseView,      kF125) \
+		X(Df125WindowRawDataView, kF125) \
+		X(DF1TDCHitView,          kF1TDC) \
+		X(Df125CDCPulseColumns,   kF125) \
+		X(Df125FDCPulseColumns,   kF125)
+
+class DParsedEvent;
+
+// Module data of a block of events that has not been decoded yet. One
+// of these is shared by all events in the block since the data of each
+// module bank is for all of them. It is implemented by DLazyModuleBanks
+// in JEventEVIOBuffer.h. pending holds the families not yet decoded.
+// Detach is called when an event is released so later decoding for the
+// others in the block doesn't touch it.
+class DLazyModuleData{
+	public:
+		enum FAMILY{
+			kF250        = 0x1,
+			kF125        = 0x2,
+			kF1TDC       = 0x4,
+			kCAEN1290TDC = 0x8,
+			kALL         = 0xF
+		};
+
+		DLazyModuleData():pending(0){}
+		virtual ~DLazyModuleData(){}
+
+		virtual void Decode(uint32_t families)=0;
+		virtual void Detach(DParsedEvent *pe)=0;
+
+		std::atomic<uint32_t> pending;
+};
 
 class DParsedEvent:public JEvent{
 	public:		
@@ -136,6 +226,10 @@ class DParsedEvent:public JEvent{
 		
 		DBORptrs *borptrs;
 
+		// Set if some module data of this event is still to be decoded
+		// (EVIO:LAZY_PARSE). See Get and DLazyModuleData.
+		shared_ptr<DLazyModuleData> lazy;
+
 		// For each type defined in "MyTypes" above, define a vector of
 		// pointers to it with a name made by prepending a "v" to the classname
 		// The following expands to things like e.g.
@@ -146,6 +240,24 @@ class DParsedEvent:public JEvent{
 		MyTypes(makevector)
 		MyBORTypes(makevector)
 		MyDerivedTypes(makevector)
+
+		// Same for the view types but these hold the views themselves
+		#define makeviewvector(A) vector<A>  v##A;
+		MyViewTypes(makeviewvector)
+
+		// Columns for the types in MyColumnTypes. e.g.
+		//
+		//       Df125CDCPulseColumns cDf125CDCPulse;
+		//
+		#define makecolumns(A) A##Columns  c##A;
+		MyColumnTypes(makecolumns)
+
+		// How objects made from columns should be linked. These are set
+		// by the JEventEVIOBuffer that parsed the event to match how it
+		// links the objects it makes (see JEventEVIOBuffer::LinkAssociations).
+		bool link_columns;
+		bool link_columns_config;
+		bool link_columns_triggertime;
 	
 		// DParsedEvent objects are recycled to save malloc/delete cycles. Do the
 		// same for the objects they provide by creating a pool vector for each
@@ -163,14 +275,16 @@ class DParsedEvent:public JEvent{
 		#define clearvectors(A)     v##A.clear();
 		#define deletepool(A)       for(auto p : v##A##_pool) delete p;
 		#define clearpoolvectors(A) v##A##_pool.clear();
+		#define clearcolumns(A)     c##A.clear();
 		void Clear(void){ 
+			ReleaseLazy();
 			MyTypes(returntopool)
 			MyTypes(clearvectors)
 			MyBORTypes(clearvectors)
 			MyDerivedTypes(returntopool)
 			MyDerivedTypes(clearvectors)
-			MyNoPoolTypes(deletepool)
-			MyNoPoolTypes(clearpoolvectors)
+			MyViewTypes(clearvectors)
+			MyColumnTypes(clearcolumns)
 		}
 
 		// Method to delete all objects in all vectors and all pools. This should
@@ -198,6 +312,162 @@ class DParsedEvent:public JEvent{
 			MyDerivedTypes(clearpoolvectors)
 		}
 		
+		// These are used when the data banks of a large event are parsed
+		// by several subtasks (see JEventEVIOBuffer::ParseDataBanksInSubtasks).
+		// Each subtask fills its own DParsedEvent. SharePools hands one of
+		// nshares equal parts of each of our pools to such an event before
+		// parsing so it doesn't have to allocate new objects. Merge then
+		// appends all of its objects to our vectors (they go back into our
+		// pools on the next Clear) and takes back whatever is left of the
+		// parts it was given so our pools don't drain into it over time.
+		#define sharepool(A) if(v##A##_pool.size()>=nshares){ \
+			auto it = v##A##_pool.end() - v##A##_pool.size()/nshares; \
+			dest->v##A##_pool.insert(dest->v##A##_pool.end(), it, v##A##_pool.end()); \
+			v##A##_pool.erase(it, v##A##_pool.end()); }
+		#define mergevector(A) if(!src->v##A.empty()){ v##A.insert(v##A.end(), src->v##A.begin(), src->v##A.end()); src->v##A.clear(); }
+		#define mergecolumns(A) if(!src->c##A.empty()){ c##A.append(src->c##A); src->c##A.clear(); }
+		#define mergepool(A) if(!src->v##A##_pool.empty()){ v##A##_pool.insert(v##A##_pool.end(), src->v##A##_pool.begin(), src->v##A##_pool.end()); src->v##A##_pool.clear(); }
+		void SharePools(DParsedEvent *dest, uint32_t nshares){
+			MyTypes(sharepool)
+			MyDerivedTypes(sharepool)
+		}
+		void Merge(DParsedEvent *src){
+			MyTypes(mergevector)
+			MyDerivedTypes(mergevector)
+			MyViewTypes(mergevector)
+			MyColumnTypes(mergecolumns)
+			MyTypes(mergepool)
+			MyDerivedTypes(mergepool)
+			event_status_bits |= src->event_status_bits;
+		}
+
+		// Decode any of the given families of module data that were
+		// left for later (EVIO:LAZY_PARSE). This is safe to call from
+		// the threads processing any of the events of the block. Once
+		// it returns, the vectors of those types are complete.
+		void Decode(uint32_t families) const {
+			if( lazy && (lazy->pending & families) ) lazy->Decode(families);
+		}
+
+		// Drop this event's claim on the lazy module data. This must be
+		// called before the event is made available for reuse.
+		void ReleaseLazy(void){
+			if( lazy ){
+				lazy->Detach(this);
+				lazy.reset();
+			}
+		}
+
+		// Return the vector of objects of type T, decoding its family of
+		// module data first if that was left for later. e.g.
+		//
+		//    auto &hits = pe->Get<DF1TDCHit>();
+		//
+		#define lazyfamily(A,F)  static uint32_t LazyFamily(const A*){ return DLazyModuleData::F; }
+		#define getvector(A)     const vector<A*>& GetVector(const A*) const { return v##A; }
+		static uint32_t LazyFamily(const void*){ return 0; }
+		MyLazyTypes(lazyfamily)
+		MyTypes(getvector)
+		MyDerivedTypes(getvector)
+		template<class T> const vector<T*>& Get(void) const {
+			Decode( LazyFamily((const T*)NULL) );
+			Materialize( (const T*)NULL );
+			return GetVector( (const T*)NULL );
+		}
+
+		// Same as Get, but for the view types. e.g.
+		//
+		//    for(auto &hit : pe->GetViews<DF1TDCHitView>()) ... hit.time() ...
+		//
+		#define getviewvector(A) const vector<A>& GetViewVector(const A*) const { return v##A; }
+		MyViewTypes(getviewvector)
+		template<class T> const vector<T>& GetViews(void) const {
+			Decode( LazyFamily((const T*)NULL) );
+			return GetViewVector( (const T*)NULL );
+		}
+
+		// Return the columns of a type in MyColumnTypes. These are only
+		// filled if EVIO:HIT_COLUMNS is set. e.g.
+		//
+		//    auto &cdc = pe->GetColumns<Df125CDCPulseColumns>();
+		//
+		#define getcolumns(A) const A##Columns& GetColumnsOf(const A##Columns*) const { return c##A; }
+		MyColumnTypes(getcolumns)
+		template<class T> const T& GetColumns(void) const {
+			Decode( LazyFamily((const T*)NULL) );
+			return GetColumnsOf( (const T*)NULL );
+		}
+
+		// Make the objects of a type from its columns if that has not been
+		// done yet. The objects act as a cache of the columns so this is
+		// allowed for a const event. Only one thread at a time processes
+		// an event so no lock is needed (unlike for Decode).
+		#define materialize(A) void Materialize(const A*) const { \
+			if( v##A.empty() && !c##A.empty() ) const_cast<DParsedEvent*>(this)->MakeFromColumns(c##A); }
+		void Materialize(const void*) const {}
+		MyColumnTypes(materialize)
+
+		//----------------
+		// MakeFromColumns
+		//----------------
+		void MakeFromColumns(const Df125CDCPulseColumns &c){
+			for(size_t i=0; i<c.size(); i++){
+				NEW_Df125CDCPulse(c.rocid[i], c.slot[i], c.channel[i], c.itrigger[i]
+							, c.NPK[i]
+							, c.le_time[i]
+							, c.time_quality_bit[i]
+							, c.overflow_count[i]
+							, c.pedestal[i]
+							, c.integral[i]
+							, c.first_max_amp[i]
+							, c.word1[i]
+							, c.word2[i]
+							, 1                   // nsamples_pedestal
+							, 0                   // nsamples_integral (set from Df125Config when linked)
+							, false);             // emulated
+			}
+			if( link_columns ) LinkFromColumns(vDf125CDCPulse);
+		}
+
+		//----------------
+		// MakeFromColumns
+		//----------------
+		void MakeFromColumns(const Df125FDCPulseColumns &c){
+			for(size_t i=0; i<c.size(); i++){
+				NEW_Df125FDCPulse(c.rocid[i], c.slot[i], c.channel[i], c.itrigger[i]
+							, c.NPK[i]
+							, c.le_time[i]
+							, c.time_quality_bit[i]
+							, c.overflow_count[i]
+							, c.pedestal[i]
+							, c.integral[i]
+							, c.peak_amp[i]
+							, c.peak_time[i]
+							, c.word1[i]
+							, c.word2[i]
+							, 1                   // nsamples_pedestal
+							, 0                   // nsamples_integral (set from Df125Config when linked)
+							, false);             // emulated
+			}
+			if( link_columns ) LinkFromColumns(vDf125FDCPulse);
+		}
+
+		//----------------
+		// LinkFromColumns
+		//----------------
+		template<class T>
+		void LinkFromColumns(vector<T*> &v){
+			/// Sort and link f125 pulse objects made from columns the same
+			/// way JEventEVIOBuffer::LinkAssociations does for the ones it
+			/// makes. The objects they are linked to were already sorted
+			/// when the event was parsed.
+			if(v.size()>1) sort(v.begin(), v.end(), SortByChannel<T>);
+			if(!vDf125WindowRawData.empty()) LinkChannel(vDf125WindowRawData, v);
+			if(link_columns_config     ) LinkConfigSamplesCopy(vDf125Config, v);
+			if(link_columns_config && borptrs) borptrs->LinkSamplesCopy<Df125BORConfig>(v);
+			if(link_columns_triggertime) LinkModule(vDf125TriggerTime, v);
+		}
+		
 //		// Define a class that has pointers to factories for each data type.
 //		// One of these is instantiated for each JEventLoop encountered.
 //		// See comments below for CopyToFactories for details.
@@ -227,6 +497,13 @@ class DParsedEvent:public JEvent{
 		// for every event. Note that only one processing thread at a time will
 		// ever call this method for this DParsedEvent object so we don't need
 		// to lock access to the factory_pointers map.
+		//
+		// Module data left for later (EVIO:LAZY_PARSE) is not decoded here
+		// and objects are not made from columns (EVIO:HIT_COLUMNS). Types
+		// that are still pending are skipped and left for CopyToFactory
+		// which decodes and copies a single type. It is meant to be called
+		// when the factory of that type is first asked for so only the
+		// data that is actually used gets decoded.
 		#define copytofactory(A)    if(!v##A.empty()){ evt->GetFactory<A>()->Set(v##A); }
 		#define copybortofactory(A) if(!v##A.empty()){ evt->GetFactory<A>()->Set(borptrs->v##A); }
 		#define setevntcalled(A)    evt->GetFactory<A>()->SetCreated(true);
@@ -238,12 +515,11 @@ class DParsedEvent:public JEvent{
 //		#define copytofactorynonempty(A)    if(!v##A.empty()) facptrs.fac_##A->CopyTo(v##A);
 //		#define setevntcallednonempty(A)    if(!v##A.empty()) facptrs.fac_##A->Set_evnt_called();
 //		#define keepownershipnonempty(A)    if(!v##A.empty()) facptrs.fac_##A->SetFactoryFlag(JFactory_base::NOT_OBJECT_OWNER);
+		#define copyready(A) if(!IsPending((const A*)NULL)){ copytofactory(A) setevntcalled(A) keepownership(A) }
 		void CopyToFactories(JEvent *evt){
 
-			// Copy all data vectors to appropriate factories
-			MyTypes(copytofactory)
-			MyTypes(setevntcalled)
-			MyTypes(keepownership)
+			// Copy all data vectors that are ready to appropriate factories
+			MyTypes(copyready)
 			MyDerivedTypes(copytofactory)
 			MyDerivedTypes(setevntcalled)
 			MyDerivedTypes(keepownership)
@@ -254,6 +530,26 @@ class DParsedEvent:public JEvent{
 			}
 			copied_to_factories=true;
 		}
+
+		// Copy one type to its factory, decoding its family of module
+		// data or making its objects from columns first if needed. See
+		// CopyToFactories.
+		template<class T> void CopyToFactory(JEvent *evt){
+			auto &v = Get<T>();
+			if(!v.empty()) evt->GetFactory<T>()->Set(v);
+			evt->GetFactory<T>()->SetCreated(true);
+			evt->GetFactory<T>()->SetFactoryFlag(JFactory::NOT_OBJECT_OWNER);
+		}
+
+		// Return true if the objects of type T have not been made yet
+		// because its family of module data has not been decoded or its
+		// columns have not been turned into objects.
+		#define columnspending(A) bool IsPending(const A*) const { \
+			return (lazy && (lazy->pending & LazyFamily((const A*)NULL))) || (v##A.empty() && !c##A.empty()); }
+		template<class T> bool IsPending(const T*) const {
+			return lazy && (lazy->pending & LazyFamily((const T*)NULL));
+		}
+		MyColumnTypes(columnspending)
 		
 		// Method to check class name against each classname in MyTypes returning
 		// true if found and false if not.
@@ -320,7 +616,7 @@ class DParsedEvent:public JEvent{
 				t = v##A##_pool.back(); \
 				v##A##_pool.pop_back(); \
 				t->ClearAssociatedObjects(); \
-				new(t) A(std::forward<Args>(args)...); \
+				Reconstruct(t, std::forward<Args>(args)...); \
 			} \
 			v##A.push_back(t); \
 			return t; \
@@ -328,11 +624,51 @@ class DParsedEvent:public JEvent{
 		MyTypes(makeallocator);
 		MyDerivedTypes(makeallocator);
 
+		// In-place constructor call used by the NEW_XXX methods for a
+		// recycled object. The types in MyVectorTypes (and DL1Info) keep
+		// the memory of their vectors (see comments for MyVectorTypes).
+		template<class A, typename... Args>
+		static void Reconstruct(A *t, Args&&... args){ new(t) A(std::forward<Args>(args)...); }
+
+		#define reconstruct(A,V) template<typename... Args> \
+		static void Reconstruct(A *t, Args&&... args){ \
+			auto V = std::move(t->V); \
+			new(t) A(std::forward<Args>(args)...); \
+			t->V = std::move(V); \
+			t->V.clear(); \
+		}
+		MyVectorTypes(reconstruct)
+
+		template<typename... Args>
+		static void Reconstruct(DL1Info *t, Args&&... args){
+			auto gtp_sc   = std::move(t->gtp_sc);
+			auto fp_sc    = std::move(t->fp_sc);
+			auto gtp_rate = std::move(t->gtp_rate);
+			auto fp_rate  = std::move(t->fp_rate);
+			new(t) DL1Info(std::forward<Args>(args)...);
+			t->gtp_sc   = std::move(gtp_sc);   t->gtp_sc.clear();
+			t->fp_sc    = std::move(fp_sc);    t->fp_sc.clear();
+			t->gtp_rate = std::move(gtp_rate); t->gtp_rate.clear();
+			t->fp_rate  = std::move(fp_rate);  t->fp_rate.clear();
+		}
+
+		// DEPICSvalue fills in its sval string in the constructor. Keep
+		// the memory of the old one and have Set fill it in instead.
+		template<typename... Args>
+		static void Reconstruct(DEPICSvalue *t, Args&&... args){
+			auto sval = std::move(t->sval);
+			t->~DEPICSvalue();
+			new(t) DEPICSvalue();
+			t->sval = std::move(sval);
+			t->Set(std::forward<Args>(args)...);
+		}
+
 		// Constructor and destructor
-		DParsedEvent(uint64_t MAX_OBJECT_RECYCLES=1000):in_use(false),Nrecycled(0),MAX_RECYCLES(MAX_OBJECT_RECYCLES),borptrs(NULL){}
+		DParsedEvent(uint64_t MAX_OBJECT_RECYCLES=1000):in_use(false),Nrecycled(0),MAX_RECYCLES(MAX_OBJECT_RECYCLES),borptrs(NULL),link_columns(false),link_columns_config(false),link_columns_triggertime(false){}
 		#define printcounts(A) if(!v##A.empty()) cout << v##A.size() << " : " << #A << endl;
 		#define printpoolcounts(A) if(!v##A##_pool.empty()) cout << v##A##_pool.size() << " : " << #A << "_pool" << endl;
 		virtual ~DParsedEvent(){
+			ReleaseLazy();
 //			cout << "----- DParsedEvent (" << this << ") -------" << endl;
 //			MyTypes(printcounts);
 //			MyBORTypes(printcounts);
@@ -349,6 +685,18 @@ class DParsedEvent:public JEvent{
 // clean out #defines to avoid compilation warnings with other classes (e.g. DTranslationTable)
 #undef MyTypes
 #undef MyDerivedTypes
+#undef MyLazyTypes
+#undef MyViewTypes
+#undef MyColumnTypes
+#undef makecolumns
+#undef clearcolumns
+#undef mergecolumns
+#undef getcolumns
+#undef materialize
+#undef copyready
+#undef columnspending
+#undef makeviewvector
+#undef getviewvector
 #undef makevector
 #undef makepoolvector
 #undef returntopool
@@ -356,6 +704,9 @@ class DParsedEvent:public JEvent{
 #undef deletevector
 #undef deletepool
 #undef clearpoolvectors
+#undef sharepool
+#undef mergevector
+#undef mergepool
 #undef makefactoryptr
 #undef copyfactoryptr
 #undef copytofactory
@@ -369,6 +720,10 @@ class DParsedEvent:public JEvent{
 #undef checknonemptyderivedclassname
 #undef addclassname
 #undef makeallocator
+#undef MyVectorTypes
+#undef reconstruct
+#undef lazyfamily
+#undef getvector
 #undef printcounts
 #undef printpoolcounts
 
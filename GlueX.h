@@ -11,6 +11,12 @@
 #define _GlueX_
 
 #include <string.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <fstream>
+#include <sstream>
 
 enum DetectorSystem_t{
      SYS_NULL       = 0x0000,
@@ -144,4 +150,26 @@ inline DetectorSystem_t NameToSystem(const char* locSystemName)
 		return SYS_NULL;
 }
 
+// Read a table of the detector system each readout crate belongs to.
+// Each line of the file holds a rocid followed by a system name as
+// understood by NameToSystem (e.g. "31 FCAL"). Anything following a
+// "#" is ignored. Returns false if the file could not be opened.
+inline bool ReadROCSystemMap(const std::string &fname, std::map<uint32_t, DetectorSystem_t> &rocid_systems)
+{
+	std::ifstream ifs(fname.c_str());
+	if( !ifs.is_open() ) return false;
+
+	std::string line;
+	while( std::getline(ifs, line) ){
+		size_t pos = line.find('#');
+		if( pos != std::string::npos ) line.erase(pos);
+		std::stringstream ss(line);
+		uint32_t rocid;
+		std::string name;
+		if( ss >> rocid >> name ) rocid_systems[rocid] = NameToSystem(name.c_str());
+	}
+
+	return true;
+}
+
 #endif // _GlueX_
@@ -10,9 +10,19 @@
 #include <libgen.h>
 #include <unistd.h>
 #include <cinttypes>
+#include <chrono>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
 using namespace std;
 
 #include "HDEVIO.h"
+#include "swap_bank.h"
 
 //---------------------------------
 // HDEVIO    (Constructor)
@@ -24,6 +34,20 @@ HDEVIO::HDEVIO(string filename, bool read_map_file, int verbose):filename(filena
 	// were never allocated.
 	fbuff = NULL;
 	buff  = NULL;
+	mm_buff = mm_end = mm_next_block = NULL;
+	mm_block_start = mm_next_event = mm_block_end = NULL;
+	mm_block_pos = 0;
+	mm_events_left = 0;
+	mm_swap_needed = false;
+	swap_needed = false;
+	pf_fd = -1;
+	hint_fd = -1;
+	read_mode = kREAD_EVENT;
+	pf_next_idx = pf_next_consume = pf_next_pos = 0;
+	pf_quit = pf_scan_done = false;
+	pf_final_err_code = HDEVIO_OK;
+	PREFETCH_NTHREADS = 2;
+	PREFETCH_DEPTH    = 16;
 
 	is_open = false;
 	ifs.open(filename.c_str());
@@ -33,8 +57,7 @@ HDEVIO::HDEVIO(string filename, bool read_map_file, int verbose):filename(filena
 		return;
 	}
 	
-	fbuff_size = 10000000; // 40MB input buffer
-	fbuff = new uint32_t[fbuff_size];;
+	fbuff_size = 10000000; // 40MB input buffer (allocated on first use in buff_read)
 	fnext = fbuff;
 	fbuff_end = fbuff;
 	fbuff_len = 0;
@@ -59,16 +82,34 @@ HDEVIO::HDEVIO(string filename, bool read_map_file, int verbose):filename(filena
 	is_mapped = false;
 	
 	NB_next_pos = 0;
+	building_map = false;
+	building_map_next_pos = 0;
+	stream_next_pos = 0;
+	last_event_type  = kBT_UNKNOWN;
+	last_first_event = 0;
+	last_last_event  = 0;
+	seek_pending_read = seek_pending_mapped = seek_pending_prefetch = false;
+	seek_block = seek_nskip = 0;
+	range_first_block = 0;
+	range_end_block   = UINT64_MAX;
+	range_end_pos     = UINT64_MAX;
+	pf_skip_events = 0;
+	index_Nevents = 0;
+	sparse_block_idx = 0;
+	sparse_event_idx = 0;
 	
-	if(read_map_file) ReadFileMap(); // check if a map file exists and read it if it does
-	
-	IGNORE_EMPTY_BOR   = false;
-	SKIP_EVENT_MAPPING = false;
+	IGNORE_EMPTY_BOR    = false;
+	SKIP_EVENT_MAPPING  = false;
+	VERIFY_MAP_CHECKSUM = false;
+	MAP_BUFFER_SIZE     = 32*1024*1024;
 	
+	// n.b. file size is needed to validate binary map files
 	ifs.seekg(0, ios_base::end);
 	total_size_bytes = ifs.tellg();
 	ifs.seekg(0, ios_base::beg);
 	
+	if(read_map_file) ReadFileMap(); // check if a map file exists and read it if it does
+	
 	is_open = true;
 }
 
@@ -77,6 +118,8 @@ HDEVIO::HDEVIO(string filename, bool read_map_file, int verbose):filename(filena
 //---------------------------------
 HDEVIO::~HDEVIO()
 {
+	StopPrefetch();
+	if(hint_fd >= 0) close(hint_fd);
 	if(ifs.is_open()) ifs.close();
 	if(buff ) delete[] buff;
 	if(fbuff) delete[] fbuff;
@@ -99,6 +142,14 @@ void HDEVIO::buff_read(char* s, streamsize nwords)
 	/// ifstream::read is that this does not return an istream&
 	/// reference.
 	
+	// The large buffer is only needed by read() so
+	// don't allocate it until then.
+	if(!fbuff){
+		fbuff = new uint32_t[fbuff_size];
+		fnext = fbuff_end = fbuff;
+		fbuff_len = 0;
+	}
+
 	// Number of words left in fbuff	
 	uint64_t left = ((uint64_t)fbuff_end - (uint64_t)fnext)/sizeof(uint32_t);
 	
@@ -132,6 +183,12 @@ void HDEVIO::buff_read(char* s, streamsize nwords)
 		// Read in chunk from file
 		ifs.read((char*)myfbuff, myfbuff_size*sizeof(uint32_t));
 		fbuff_len += (uint64_t)(ifs.gcount()/sizeof(uint32_t));
+		
+		// Ask the kernel to start reading the following chunk
+		// while we work on this one (see SetReadMode).
+#ifdef POSIX_FADV_WILLNEED
+		if(hint_fd>=0 && ifs.good()) posix_fadvise(hint_fd, (off_t)ifs.tellg(), (off_t)(fbuff_size*sizeof(uint32_t)), POSIX_FADV_WILLNEED);
+#endif
 		fnext = myfbuff;
 		fbuff_end = &fbuff[fbuff_len];
 
@@ -207,6 +264,7 @@ bool HDEVIO::ReadBlock(void)
 
 	buff_read((char*)buff, 8);
 	uint32_t valid_words = buff_gcount()/sizeof(uint32_t);
+	if(valid_words == 0) return EndOfFile(); // (file ends without a trailer block)
 	if(valid_words != 8){
 		SetErrorMessage("Could not read in 8 word EVIO block header!");
 		err_code = HDEVIO_FILE_TRUNCATED;
@@ -256,9 +314,7 @@ bool HDEVIO::ReadBlock(void)
 	
 	if(block_length == 8){
 		// block_length =8 indicates end of file.
-		SetErrorMessage("end of file");
-		err_code = HDEVIO_EOF;
-		return false;
+		return EndOfFile();
 	}
 
 	// Read payload of block
@@ -279,6 +335,9 @@ bool HDEVIO::ReadBlock(void)
 	next = &buff[8];
 	bh = (BLOCKHEADER_t*)buff;
 	
+	MapBlockInMemory(buff, stream_next_pos, swap_needed);
+	stream_next_pos += (uint64_t)block_length*sizeof(uint32_t);
+
 	Nblocks++;
 	return true;
 }
@@ -300,6 +359,21 @@ bool HDEVIO::read(uint32_t *user_buff, uint32_t user_buff_len, bool allow_swap)
 
 	err_code = HDEVIO_OK;
 	
+	// Apply any SeekToEvent call made since the last read
+	if(seek_pending_read){
+		seek_pending_read = false;
+		ifs.clear();
+		ifs.seekg(filemap.block_pos[seek_block], ios_base::beg);
+		stream_next_pos = filemap.block_pos[seek_block];
+		fnext = fbuff_end = fbuff;
+		fbuff_len = 0;
+		if(!ReadBlock()) return false;
+		for(uint64_t i=0; i<seek_nskip && next<buff_end; i++){
+			uint32_t len = swap_needed ? swap32(next[0]):next[0];
+			next = &next[len+1];
+		}
+	}
+	
 	// calculate remaining valid words in buffer
 	uint32_t left = buff_len - (uint32_t)(((unsigned long)next - (unsigned long)buff)/sizeof(uint32_t));
 
@@ -341,6 +415,8 @@ bool HDEVIO::read(uint32_t *user_buff, uint32_t user_buff_len, bool allow_swap)
 		return false;
 	}
 	
+	SetLastEventInfo(next, event_len, swap_needed);
+
 	// Copy entire event into user buffer, swapping if needed during copy
 	bool isgood = true;
 	if(swap_needed && allow_swap){
@@ -379,70 +455,28 @@ bool HDEVIO::readSparse(uint32_t *user_buff, uint32_t user_buff_len, bool allow_
 	
 	// Loop over all events of all blocks looking for the next
 	// event matching the currently set type mask. 
-	for(; sparse_block_iter!=evio_blocks.end(); sparse_block_iter++, sparse_event_idx = 0){
+	uint64_t end_block = min(filemap.Nblocks, range_end_block);
+	for(; sparse_block_idx<end_block; sparse_block_idx++, sparse_event_idx = 0){
 
 		// Filter out blocks of the wrong type
-		EVIOBlockRecord &br = *sparse_block_iter;
-		//		uint32_t type = (1 << br.block_type);
+		uint64_t ievent_start = filemap.block_event_start[sparse_block_idx];
+		uint64_t Nevents_in_block = filemap.BlockNevents(sparse_block_idx);
 
-		for(; sparse_event_idx < br.evio_events.size(); sparse_event_idx++){
-			EVIOEventRecord &er = sparse_block_iter->evio_events[sparse_event_idx];
-
-			uint32_t etype = (1 << er.event_type);
+		for(; sparse_event_idx < Nevents_in_block; sparse_event_idx++){
+			uint32_t etype = (1 << filemap.event_type[ievent_start + sparse_event_idx]);
 			if( etype & event_type_mask ) break;
 		}
-		if(sparse_event_idx >= br.evio_events.size()) continue;
+		if(sparse_event_idx >= Nevents_in_block) continue;
 		
-		EVIOEventRecord &er = sparse_block_iter->evio_events[sparse_event_idx];
-
-		uint32_t event_len = er.event_len;
-		last_event_len = event_len;
-	
-		// Check if user buffer is big enough to hold block
-		if( event_len > user_buff_len ){
-			ClearErrorMessage();
-			err_mess << "user buffer too small for event (" << user_buff_len << " < " << event_len << ")";
-			err_code = HDEVIO_USER_BUFFER_TOO_SMALL;
-			return false;
-		}
+		uint64_t ievent = ievent_start + sparse_event_idx;
+		bool isgood = readEvent(ievent, user_buff, user_buff_len, allow_swap);
+		if( err_code == HDEVIO_USER_BUFFER_TOO_SMALL ) return false;
 
 		// At this point we're committed to reading this event so go
 		// ahead and increment pointer to next event so no matter
-		// what happens below, we don't try reading it again.
+		// what happens, we don't try reading it again.
 		sparse_event_idx++;
 
-		// Set file pointer to start of EVIO event (NOT block header!)
-		last_event_pos = er.pos;
-		ifs.seekg(last_event_pos, ios_base::beg);
-		
-		// Read data directly into user buffer
-		ifs.read((char*)user_buff, event_len*sizeof(uint32_t));
-
-		// Swap entire bank if needed
-		swap_needed = br.swap_needed; // set flag in HDEVIO
-		bool isgood = true;
-		if(br.swap_needed && allow_swap){
-			uint32_t Nswapped = swap_bank(user_buff, user_buff, event_len);
-			isgood = (Nswapped == event_len);
-		}
-		
-		// Double check that event length matches EVIO block header
-		// but only if we either don't need to swap or need to and
-		// were allowed to (otherwise, the test will almost certainly
-		// fail!)
-		if( (!br.swap_needed) || (br.swap_needed && allow_swap) ){
-			if( (user_buff[0]+1) != event_len ){
-				ClearErrorMessage();
-				err_mess << "WARNING: EVIO bank indicates a different size than block header (" << event_len << " != " << (user_buff[0]+1) << ")";
-				err_code = HDEVIO_EVENT_BIGGER_THAN_BLOCK;
-				Nerrors++;
-				Nbad_blocks++;
-				return false;
-			}
-		}
-
-		if(isgood) Nevents++;
-
 		return isgood;
 	}
 
@@ -453,6 +487,91 @@ bool HDEVIO::readSparse(uint32_t *user_buff, uint32_t user_buff_len, bool allow_
 	return false; // isgood=false
 }
 
+//---------------------------------
+// readEvent
+//---------------------------------
+bool HDEVIO::readEvent(uint64_t ievent, uint32_t *user_buff, uint32_t user_buff_len, bool allow_swap)
+{
+	/// Read a single event given its index in the file map's event
+	/// table. This seeks directly to the event in the file and does
+	/// not affect the position of any of the sequential readers. It
+	/// is used by readSparse and to read state events (BOR, EPICS)
+	/// skipped over by SeekToEvent.
+
+	err_code = HDEVIO_OK;
+	ClearErrorMessage();
+
+	if( ievent >= filemap.Nevents ){
+		SetErrorMessage("Event index beyond end of file map");
+		err_code = HDEVIO_EOF;
+		return false;
+	}
+	
+	uint64_t iblock = upper_bound(filemap.block_event_start, filemap.block_event_start+filemap.Nblocks+1, ievent) - filemap.block_event_start - 1;
+	bool block_swap_needed = filemap.block_swap_needed[iblock];
+
+	uint32_t event_len = filemap.event_len[ievent];
+	last_event_len = event_len;
+
+	// Check if user buffer is big enough to hold block
+	if( event_len > user_buff_len ){
+		ClearErrorMessage();
+		err_mess << "user buffer too small for event (" << user_buff_len << " < " << event_len << ")";
+		err_code = HDEVIO_USER_BUFFER_TOO_SMALL;
+		return false;
+	}
+
+	// Set file pointer to start of EVIO event (NOT block header!)
+	last_event_pos   = filemap.event_pos[ievent];
+	last_event_type  = (BLOCKTYPE)filemap.event_type[ievent];
+	last_first_event = filemap.event_first_event[ievent];
+	last_last_event  = filemap.event_last_event[ievent];
+	
+	// Read data directly into user buffer. For kREAD_SPARSE this is
+	// done through hint_fd so its POSIX_FADV_RANDOM hint applies and
+	// the kernel doesn't read ahead around every event (see SetReadMode).
+	if( read_mode==kREAD_SPARSE && hint_fd>=0 ){
+		ssize_t nbytes = (ssize_t)event_len*sizeof(uint32_t);
+		if( pread(hint_fd, user_buff, nbytes, (off_t)last_event_pos) != nbytes ){
+			SetErrorMessage("Error reading EVIO event (truncated?)");
+			err_code = HDEVIO_FILE_TRUNCATED;
+			Nerrors++;
+			return false;
+		}
+	}else{
+		ifs.clear();
+		ifs.seekg(last_event_pos, ios_base::beg);
+		ifs.read((char*)user_buff, event_len*sizeof(uint32_t));
+	}
+
+	// Swap entire bank if needed
+	swap_needed = block_swap_needed; // set flag in HDEVIO
+	bool isgood = true;
+	if(block_swap_needed && allow_swap){
+		uint32_t Nswapped = swap_bank(user_buff, user_buff, event_len);
+		isgood = (Nswapped == event_len);
+	}
+	
+	// Double check that event length matches EVIO block header
+	// but only if we either don't need to swap or need to and
+	// were allowed to (otherwise, the test will almost certainly
+	// fail!)
+	if( (!block_swap_needed) || (block_swap_needed && allow_swap) ){
+		if( (user_buff[0]+1) != event_len ){
+			ClearErrorMessage();
+			err_mess << "WARNING: EVIO bank indicates a different size than block header (" << event_len << " != " << (user_buff[0]+1) << ")";
+			err_code = HDEVIO_EVENT_BIGGER_THAN_BLOCK;
+			Nerrors++;
+			Nbad_blocks++;
+			return false;
+		}
+	}
+
+	if(isgood) Nevents++;
+
+	return isgood;
+}
+
 //---------------------------------
 // readNoFileBuff
 //---------------------------------
@@ -477,12 +596,12 @@ bool HDEVIO::readNoFileBuff(uint32_t *user_buff, uint32_t user_buff_len, bool al
 	EVIOBlockRecord &br = NB_block_record;
 	if(br.evio_events.empty()){
 
-		// Check if we are at end of file
+		// Check if we are at end of file (or of range set by SetBlockRange).
+		// Only the trailer block or nothing at all may be left at the end.
+		// (if <8 then let read below fail and return HDEVIO_FILE_TRUNCATED)
 		uint64_t words_left_in_file = (total_size_bytes-NB_next_pos)/4;
-		if( words_left_in_file == 8 ){ // (if <8 then let read below fail and return HDEVIO_FILE_TRUNCATED)
-			SetErrorMessage("No more events");
-			err_code = HDEVIO_EOF;
-			return false;			
+		if( (uint64_t)NB_next_pos >= range_end_pos || words_left_in_file == 8 || words_left_in_file == 0 ){
+			return EndOfFile();
 		}
 
 		// read EVIO block header
@@ -525,12 +644,17 @@ bool HDEVIO::readNoFileBuff(uint32_t *user_buff, uint32_t user_buff_len, bool al
 		br.pos = pos;
 		br.block_len = bh.length;
 		br.swap_needed = swap_needed;
-		br.first_event = 0;
-		br.last_event = 0;
+		CategorizeBlock(bh, br);
 		
 		MapEvents(bh, br);
+		AddToBuiltMap(br);
 		
 		NB_next_pos = pos + (streampos)(bh.length<<2);
+		
+		// Hint that the next block (assumed similar in size) will be needed soon
+#ifdef POSIX_FADV_WILLNEED
+		if(hint_fd>=0) posix_fadvise(hint_fd, (off_t)NB_next_pos, (off_t)(bh.length<<2), POSIX_FADV_WILLNEED);
+#endif
 	}
 	
 	// Check if we did not find an event of interest above. 
@@ -556,7 +680,10 @@ bool HDEVIO::readNoFileBuff(uint32_t *user_buff, uint32_t user_buff_len, bool al
 	}
 
 	// Set file pointer to start of EVIO event (NOT block header!)
-	last_event_pos = er.pos;
+	last_event_pos   = er.pos;
+	last_event_type  = er.event_type;
+	last_first_event = er.first_event;
+	last_last_event  = er.last_event;
 	ifs.seekg(last_event_pos, ios_base::beg);
 	
 	// Read data directly into user buffer
@@ -571,32 +698,1176 @@ bool HDEVIO::readNoFileBuff(uint32_t *user_buff, uint32_t user_buff_len, bool al
 	// next event for the next time we're called
 	br.evio_events.erase(NB_block_record.evio_events.begin());
 
-	// Swap entire bank if needed
-	swap_needed = br.swap_needed; // set flag in HDEVIO
-	bool isgood = true;
-	if(br.swap_needed && allow_swap){
-		uint32_t Nswapped = swap_bank(user_buff, user_buff, event_len);
-		isgood = (Nswapped == event_len);
+	// Swap entire bank if needed
+	swap_needed = br.swap_needed; // set flag in HDEVIO
+	bool isgood = true;
+	if(br.swap_needed && allow_swap){
+		uint32_t Nswapped = swap_bank(user_buff, user_buff, event_len);
+		isgood = (Nswapped == event_len);
+	}
+	
+	// Double check that event length matches EVIO block header
+	// but only if we either don't need to swap or need to and
+	// were allowed to (otherwise, the test will almost certainly
+	// fail!)
+	if( (!br.swap_needed) || (br.swap_needed && allow_swap) ){
+		if( (user_buff[0]+1) != event_len ){
+			ClearErrorMessage();
+			err_mess << "WARNING: EVIO bank indicates a different size than block header (" << event_len << " != " << (user_buff[0]+1) << ")";
+			err_code = HDEVIO_EVENT_BIGGER_THAN_BLOCK;
+			Nerrors++;
+			Nbad_blocks++;
+			return false;
+		}
+	}
+
+	if(isgood) Nevents++;
+
+	return isgood;
+}
+
+//---------------------------------
+// EndOfFile
+//---------------------------------
+bool HDEVIO::EndOfFile(void)
+{
+	/// Called by the readers when they reach the end of the file or
+	/// of the range set by SetBlockRange without an error. If the map
+	/// was being built while reading (see AddToBuiltMap) then it is
+	/// now complete and is written to SAVE_MAP_FILE. This always
+	/// returns false so the reader can return its result directly.
+
+	if(building_map && !is_mapped){
+		building_map = false;
+		sparse_block_idx = 0;
+		sparse_event_idx = 0;
+		is_mapped = true;
+		SaveFileMap(SAVE_MAP_FILE);
+	}
+
+	SetErrorMessage("No more events");
+	err_code = HDEVIO_EOF;
+	return false;
+}
+
+//---------------------------------
+// MapBlockInMemory
+//---------------------------------
+void HDEVIO::MapBlockInMemory(const uint32_t *block, uint64_t pos, bool swap_needed)
+{
+	/// Add a block one of the readers holds in memory to the map being
+	/// built for SAVE_MAP_FILE (see AddToBuiltMap). This records the
+	/// same as MapBlocks does for the block without reading anything
+	/// from the file. block points to the block as it is in the file
+	/// except that its header may already have been swapped in place
+	/// (as ReadBlock does). pos is the block's position in the file.
+
+	if( is_mapped || SAVE_MAP_FILE.empty() ) return;
+
+	BLOCKHEADER_t bh;
+	memcpy(&bh, block, sizeof(bh));
+	if(bh.magic==0x0001dac0) swap_block((uint32_t*)&bh, sizeof(bh)>>2, (uint32_t*)&bh);
+
+	EVIOBlockRecord br;
+	br.pos = (streamoff)pos;
+	br.block_len = bh.length;
+	br.swap_needed = swap_needed;
+	CategorizeBlock(bh, br);
+
+	if( !SKIP_EVENT_MAPPING ){
+		const uint32_t nwords = sizeof(EVENTHEADER_t)/sizeof(uint32_t);
+		uint64_t iword = 8;
+		for(uint32_t i=0; i<bh.eventcnt && iword<bh.length; i++){
+			// An event at the end of the block may be shorter than EVENTHEADER_t
+			EVENTHEADER_t eh;
+			memset(&eh, 0, sizeof(eh));
+			memcpy(&eh, &block[iword], min((uint64_t)nwords, bh.length-iword)*sizeof(uint32_t));
+			if(swap_needed) swap_block((uint32_t*)&eh, nwords, (uint32_t*)&eh);
+			MapEvent(eh, (streamoff)(pos + iword*sizeof(uint32_t)), br);
+			iword += (uint64_t)eh.event_len + 1;
+		}
+	}
+
+	AddToBuiltMap(br);
+}
+
+//---------------------------------
+// AddToBuiltMap
+//---------------------------------
+void HDEVIO::AddToBuiltMap(const EVIOBlockRecord &br)
+{
+	/// If SAVE_MAP_FILE is set and the file has not already been
+	/// mapped, the readers build the map from the blocks as they read
+	/// them so it can be written at the end (see EndOfFile) without a
+	/// separate pass. Building starts when the first block of the file
+	/// is read and is given up if a block is skipped since the map
+	/// would then be incomplete.
+
+	if( is_mapped || SAVE_MAP_FILE.empty() ) return;
+
+	if( (uint64_t)br.pos == 0 ){
+		filemap.Clear();
+		building_map = true;
+	}else if( !building_map || (uint64_t)br.pos!=building_map_next_pos ){
+		building_map = false;
+		return;
+	}
+
+	filemap.AddBlock(br);
+	building_map_next_pos = (uint64_t)br.pos + (uint64_t)br.block_len*sizeof(uint32_t);
+}
+
+//---------------------------------
+// OpenMapped
+//---------------------------------
+bool HDEVIO::OpenMapped(void)
+{
+	/// Map the entire file into memory (read-only) for use by
+	/// readMapped. The region is unmapped automatically when the
+	/// last shared_ptr referencing it (held either here or by an
+	/// event buffer downstream) goes away.
+
+	int fd = open(filename.c_str(), O_RDONLY);
+	if(fd < 0){
+		ClearErrorMessage();
+		err_mess << "Unable to open EVIO file for mapping: " << filename;
+		err_code = HDEVIO_FILE_NOT_OPEN;
+		return false;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st)!=0 || st.st_size < (off_t)(8*sizeof(uint32_t))){
+		close(fd);
+		ClearErrorMessage();
+		err_mess << "EVIO file too small to map: " << filename;
+		err_code = HDEVIO_FILE_TRUNCATED;
+		return false;
+	}
+
+	size_t len = (size_t)st.st_size;
+	void *addr = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // mapping remains valid after descriptor is closed
+	if(addr == MAP_FAILED){
+		ClearErrorMessage();
+		err_mess << "Unable to mmap EVIO file: " << filename << " (" << strerror(errno) << ")";
+		err_code = HDEVIO_MEMORY_ALLOCATION_ERROR;
+		return false;
+	}
+
+	madvise(addr, len, MADV_SEQUENTIAL); // (aggressive read-ahead, drop pages behind)
+	mm_region = shared_ptr<const void>(addr, [len](const void *p){ munmap((void*)p, len); });
+	mm_buff        = (const uint32_t*)addr;
+	mm_end         = &mm_buff[len/sizeof(uint32_t)];
+	mm_next_block  = mm_buff;
+	mm_events_left = 0;
+
+	return true;
+}
+
+//---------------------------------
+// readMapped
+//---------------------------------
+bool HDEVIO::readMapped(const uint32_t* &event_ptr, uint32_t &event_len, shared_ptr<const void> &region)
+{
+	/// This is an alternative to readNoFileBuff that does not copy
+	/// any data at all. The file is memory mapped on the first call
+	/// and on success event_ptr is set to point to the start of the
+	/// next EVIO event inside the mapping and event_len to its length
+	/// in words (including the length word). The caller is given
+	/// a reference to the mapping via region and must hold it for
+	/// as long as event_ptr is in use.
+	///
+	/// The data is NOT swapped since the mapping is read-only. Callers
+	/// should check swap_needed and swap into their own buffer if
+	/// it is set.
+
+	err_code = HDEVIO_OK;
+	ClearErrorMessage();
+
+	if(!mm_region){
+		if(!OpenMapped()) return false;
+	}
+
+	// Apply any SeekToEvent call made since the last read
+	if(seek_pending_mapped){
+		seek_pending_mapped = false;
+		uint64_t pos = filemap.block_pos[seek_block];
+		uint32_t len = filemap.block_len[seek_block];
+		if( (pos+(uint64_t)len*sizeof(uint32_t)) <= (uint64_t)(mm_end-mm_buff)*sizeof(uint32_t) && len>8 ){
+			mm_next_block = &mm_buff[pos/sizeof(uint32_t)];
+			mm_events_left = 0;
+			mm_swap_needed = (mm_next_block[7]==0x0001dac0);
+			Nblocks++;
+			mm_block_region = mm_region;
+			mm_block_start  = mm_next_block;
+			mm_block_pos    = pos;
+			mm_next_event   = &mm_next_block[8];
+			mm_block_end    = &mm_next_block[len];
+			mm_events_left  = mm_swap_needed ? swap32(mm_next_block[3]):mm_next_block[3];
+			mm_next_block   = mm_block_end;
+			SkipBlockEvents(seek_nskip);
+		}
+	}
+
+	// Advance to next block with events in it if needed
+	SkipUnmappedEvents();
+	while(mm_events_left == 0){
+
+		uint64_t words_left_in_file = (uint64_t)(mm_end - mm_next_block);
+		if( (uint64_t)(mm_next_block - mm_buff)*sizeof(uint32_t) >= range_end_pos ) words_left_in_file = 0; // end of range set by SetBlockRange
+		if( words_left_in_file <= 8 ){
+			if(words_left_in_file == 8 || words_left_in_file == 0){
+				return EndOfFile();
+			}else{
+				ClearErrorMessage();
+				err_mess << "Error reading EVIO block header (truncated?) words_left_in_file: " << words_left_in_file;
+				err_code = HDEVIO_FILE_TRUNCATED;
+			}
+			return false;
+		}
+
+		// Check if we need to byte swap and simultaneously
+		// verify header is good by checking magic word
+		uint32_t magic = mm_next_block[7];
+		if(magic==0x0001dac0){
+			mm_swap_needed = true;
+		}else if(magic==0xc0da0100){
+			mm_swap_needed = false;
+		}else{
+			err_mess.str("Bad magic word");
+			err_code = HDEVIO_BAD_BLOCK_HEADER;
+			return false;
+		}
+
+		uint32_t block_len = mm_swap_needed ? swap32(mm_next_block[0]):mm_next_block[0];
+		uint32_t eventcnt  = mm_swap_needed ? swap32(mm_next_block[3]):mm_next_block[3];
+		if( block_len == 8 ){
+			// block_length =8 indicates end of file.
+			return EndOfFile();
+		}
+		if( block_len < 8 || (uint64_t)block_len > words_left_in_file ){
+			ClearErrorMessage();
+			err_mess << "EVIO block extends past end of file! (" << block_len << " > " << words_left_in_file << " words)";
+			err_code = HDEVIO_FILE_TRUNCATED;
+			return false;
+		}
+
+		Nblocks++;
+		mm_block_region = mm_region;
+		mm_block_start  = mm_next_block;
+		mm_block_pos    = (uint64_t)(mm_next_block - mm_buff)*sizeof(uint32_t);
+		MapBlockInMemory(mm_block_start, mm_block_pos, mm_swap_needed);
+		mm_next_event   = &mm_next_block[8];
+		mm_block_end    = &mm_next_block[block_len];
+		mm_events_left  = eventcnt;
+		mm_next_block   = mm_block_end;
+		SkipUnmappedEvents();
+	}
+
+	return NextBlockEvent(event_ptr, event_len, region);
+}
+
+//---------------------------------
+// NextBlockEvent
+//---------------------------------
+bool HDEVIO::NextBlockEvent(const uint32_t* &event_ptr, uint32_t &event_len, shared_ptr<const void> &region)
+{
+	/// Hand out the next event from the current in-memory block
+	/// set up by either readMapped or readPrefetched. Caller must
+	/// ensure mm_events_left is not zero.
+
+	event_len = mm_swap_needed ? swap32(mm_next_event[0]):mm_next_event[0];
+	event_len++; // include length word for EVIO bank
+	last_event_len = event_len;
+
+	// Check that event isn't claiming to be larger than EVIO block
+	uint32_t left = (uint32_t)(mm_block_end - mm_next_event);
+	if( event_len > left ){
+		ClearErrorMessage();
+		err_mess << "WARNING: EVIO bank indicates a bigger size than block header (" << event_len << " > " << left << ")";
+		mm_events_left = 0; // setup so subsequent call will go to next block
+		err_code = HDEVIO_EVENT_BIGGER_THAN_BLOCK;
+		Nerrors++;
+		Nbad_blocks++;
+		return false;
+	}
+
+	event_ptr      = mm_next_event;
+	last_event_pos = (streampos)(mm_block_pos + (uint64_t)(mm_next_event - mm_block_start)*sizeof(uint32_t));
+	swap_needed    = mm_swap_needed; // set flag in HDEVIO
+	region         = mm_block_region;
+	SetLastEventInfo(event_ptr, event_len, mm_swap_needed);
+
+	mm_next_event += event_len;
+	mm_events_left--;
+	Nevents++;
+
+	return true;
+}
+
+//---------------------------------
+// SkipBlockEvents
+//---------------------------------
+void HDEVIO::SkipBlockEvents(uint64_t nskip)
+{
+	/// Advance the in-memory block cursor used by readMapped
+	/// and readPrefetched past nskip events. Like nskip, this
+	/// only counts events that are in the file map.
+
+	for(uint64_t i=0; i<nskip && mm_events_left>0; i++){
+		SkipUnmappedEvents();
+		if(mm_events_left == 0) break;
+		uint32_t len = (mm_swap_needed ? swap32(mm_next_event[0]):mm_next_event[0]) + 1;
+		if( len > (uint64_t)(mm_block_end - mm_next_event) ){
+			mm_events_left = 0;
+			break;
+		}
+		mm_next_event += len;
+		mm_events_left--;
+	}
+}
+
+//---------------------------------
+// SkipUnmappedEvents
+//---------------------------------
+void HDEVIO::SkipUnmappedEvents(void)
+{
+	/// Advance the in-memory block cursor used by readMapped and
+	/// readPrefetched past any events that MapEvent leaves out of
+	/// the file map (see IsMappedEvent). readNoFileBuff never returns
+	/// those either so all readers give the same events and an event's
+	/// index in the map is also its position in what is read.
+
+	while(mm_events_left > 0){
+		uint32_t left = (uint32_t)(mm_block_end - mm_next_event);
+		if(left == 0) return;
+		uint32_t len    = mm_swap_needed ? swap32(mm_next_event[0]):mm_next_event[0];
+		uint32_t header = left>1 ? (mm_swap_needed ? swap32(mm_next_event[1]):mm_next_event[1]):0;
+		if( IsMappedEvent(len, header) || len+1>left ) return; // (NextBlockEvent reports events too big for the block)
+		mm_next_event += len+1;
+		mm_events_left--;
+		Nbad_events++;
+		Nerrors++;
+	}
+}
+
+//---------------------------------
+// StartPrefetch
+//---------------------------------
+void HDEVIO::StartPrefetch(void)
+{
+	/// Launch PREFETCH_NTHREADS threads that read whole EVIO blocks
+	/// ahead of the consumer so that readPrefetched only has to pop
+	/// a completed block off of a queue. Up to PREFETCH_DEPTH blocks
+	/// may be in flight or waiting at any time. This is called
+	/// automatically on the first call to readPrefetched.
+	///
+	/// If the file has been mapped (e.g. a map file was found)
+	/// then block positions are taken from the map. Otherwise,
+	/// each worker reads the 8 word block header at the current
+	/// scan position to find the next one.
+
+	if( !pf_threads.empty() ) return;
+
+	pf_fd = open(filename.c_str(), O_RDONLY);
+	if(pf_fd < 0){
+		pf_final_err_code = HDEVIO_FILE_NOT_OPEN;
+		pf_final_err_mess = "Unable to open EVIO file for prefetching: " + filename;
+		pf_scan_done = true;
+		return;
+	}
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise(pf_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	pf_ready.clear();
+	pf_next_idx       = 0;
+	pf_next_consume   = 0;
+	pf_next_pos       = 0;
+	pf_skip_events    = 0;
+	if(seek_pending_prefetch){
+		// Start from block given in last call to SeekToEvent
+		seek_pending_prefetch = false;
+		pf_next_idx     = seek_block;
+		pf_next_consume = seek_block;
+		pf_next_pos     = filemap.block_pos[seek_block];
+		pf_skip_events  = seek_nskip;
+	}
+	pf_quit           = false;
+	pf_scan_done      = false;
+	pf_final_err_code = HDEVIO_OK;
+	pf_final_err_mess = "";
+	mm_events_left    = 0;
+
+	if(PREFETCH_NTHREADS < 1) PREFETCH_NTHREADS = 1;
+	if(PREFETCH_DEPTH < PREFETCH_NTHREADS) PREFETCH_DEPTH = PREFETCH_NTHREADS;
+	for(uint32_t i=0; i<PREFETCH_NTHREADS; i++) pf_threads.push_back( thread(&HDEVIO::PrefetchThread, this) );
+}
+
+//---------------------------------
+// ChooseReadMode
+//---------------------------------
+HDEVIO::READMODE HDEVIO::ChooseReadMode(void)
+{
+	/// Pick a read mode appropriate for the filesystem the file
+	/// is on and its size. This is used for kREAD_AUTO.
+	///
+	///  Lustre, GPFS   : kREAD_STREAM since these are optimized for
+	///                   large reads and degrade with small ones and
+	///                   backwards seeks (which is what fbuff is for).
+	///  NFS, CIFS, FUSE: kREAD_ASYNC so several reads are in flight
+	///                   to hide network latency (kREAD_EVENT for
+	///                   small files where thread startup dominates).
+	///  local disk     : kREAD_MMAP (kREAD_EVENT for small files).
+
+	const uint64_t kSmallFile = 16*1024*1024;
+	bool small_file = total_size_bytes < kSmallFile;
+	string fstype = "local";
+	READMODE mode = small_file ? kREAD_EVENT:kREAD_MMAP;
+
+#ifdef __linux__
+	struct statfs sfs;
+	if( statfs(filename.c_str(), &sfs) == 0 ){
+		switch( (uint32_t)sfs.f_type ){
+			case 0x0BD00BD0: // Lustre
+			case 0x47504653: // GPFS
+				fstype = "Lustre/GPFS";
+				mode = kREAD_STREAM;
+				break;
+			case 0x00006969: // NFS
+			case 0xFF534D42: // CIFS
+			case 0xFE534D42: // SMB2
+			case 0x65735546: // FUSE
+				fstype = "network";
+				mode = small_file ? kREAD_EVENT:kREAD_ASYNC;
+				break;
+		}
+	}
+#endif
+
+	if(VERBOSE>0) cout << "EVIO file on " << fstype << " filesystem. Using read mode: " << ReadModeName(mode) << endl;
+
+	return mode;
+}
+
+//---------------------------------
+// SetReadMode
+//---------------------------------
+void HDEVIO::SetReadMode(READMODE mode)
+{
+	/// Record which read method will be used and give the kernel
+	/// read-ahead hints suited to it. kREAD_AUTO is replaced with
+	/// the result of ChooseReadMode. This does not prevent any
+	/// of the read methods from being called.
+	///
+	/// posix_fadvise read-ahead hints apply to the open file so a
+	/// separate descriptor is used for them since ifs doesn't expose
+	/// its own. The kREAD_MMAP and kREAD_ASYNC modes give their hints
+	/// when the file is mapped or the prefetch threads are started.
+	/// POSIX_FADV_RANDOM only applies to reads made through the
+	/// descriptor it was given for so readEvent reads through hint_fd
+	/// in kREAD_SPARSE mode.
+
+	if( mode == kREAD_AUTO ) mode = ChooseReadMode();
+	read_mode = mode;
+
+	if(hint_fd >= 0) close(hint_fd);
+	hint_fd = -1;
+
+	switch(mode){
+		case kREAD_STREAM:
+		case kREAD_EVENT:
+			// Sequential reads. Issue WILLNEED for data just ahead.
+			hint_fd = open(filename.c_str(), O_RDONLY);
+			break;
+		case kREAD_SPARSE:
+			// Small reads scattered through the file. Turn off read-ahead.
+			hint_fd = open(filename.c_str(), O_RDONLY);
+#ifdef POSIX_FADV_RANDOM
+			if(hint_fd>=0) posix_fadvise(hint_fd, 0, 0, POSIX_FADV_RANDOM);
+#endif
+			break;
+		default:
+			break;
+	}
+}
+
+//---------------------------------
+// ReadModeFromString
+//---------------------------------
+HDEVIO::READMODE HDEVIO::ReadModeFromString(string mode_str)
+{
+	/// Convert name of read mode (e.g. from a config. parameter)
+	/// to a READMODE value. Unknown names give kREAD_AUTO.
+
+	std::transform(mode_str.begin(), mode_str.end(), mode_str.begin(), ::tolower);
+	if( mode_str == "stream" ) return kREAD_STREAM;
+	if( mode_str == "event"  ) return kREAD_EVENT;
+	if( mode_str == "sparse" ) return kREAD_SPARSE;
+	if( mode_str == "mmap"   ) return kREAD_MMAP;
+	if( mode_str == "async"  ) return kREAD_ASYNC;
+	return kREAD_AUTO;
+}
+
+//---------------------------------
+// ReadModeName
+//---------------------------------
+string HDEVIO::ReadModeName(READMODE mode)
+{
+	switch(mode){
+		case kREAD_AUTO:   return "auto";
+		case kREAD_STREAM: return "stream";
+		case kREAD_EVENT:  return "event";
+		case kREAD_SPARSE: return "sparse";
+		case kREAD_MMAP:   return "mmap";
+		case kREAD_ASYNC:  return "async";
+	}
+	return "unknown";
+}
+
+//---------------------------------
+// StopPrefetch
+//---------------------------------
+void HDEVIO::StopPrefetch(void)
+{
+	/// Stop and join all prefetch threads and discard any
+	/// blocks not yet consumed. Blocks already handed out by
+	/// readPrefetched remain valid until their owners release them.
+
+	{
+		lock_guard<mutex> lck(pf_mutex);
+		pf_quit = true;
+	}
+	pf_cv_space.notify_all();
+	for(auto &t : pf_threads) t.join();
+	pf_threads.clear();
+	pf_ready.clear();
+	if(pf_fd >= 0) close(pf_fd);
+	pf_fd = -1;
+}
+
+//---------------------------------
+// PrefetchLocateBlock
+//---------------------------------
+bool HDEVIO::PrefetchLocateBlock(PrefetchBlock &pb)
+{
+	/// Determine the position and length of the next block to be
+	/// read. Must be called with pf_mutex held. Returns false and
+	/// fills in pb.err_code if there are no more blocks.
+
+	pb.err_code = HDEVIO_OK;
+
+	if(is_mapped){
+		if( pf_next_idx >= filemap.Nblocks || pf_next_idx >= range_end_block ){
+			pb.err_code = HDEVIO_EOF;
+			pb.err_mess = "No more events";
+			return false;
+		}
+		pb.pos = filemap.block_pos[pf_next_idx];
+		pb.len = filemap.block_len[pf_next_idx];
+	}else{
+		uint64_t words_left_in_file = (total_size_bytes-pf_next_pos)/4;
+		if( words_left_in_file <= 8 ){
+			pb.err_code = words_left_in_file==8 || words_left_in_file==0 ? HDEVIO_EOF:HDEVIO_FILE_TRUNCATED;
+			pb.err_mess = words_left_in_file==8 || words_left_in_file==0 ? "No more events":"Error reading EVIO block header (truncated?)";
+			return false;
+		}
+		uint32_t header[8];
+		if( pread(pf_fd, header, sizeof(header), pf_next_pos) != (ssize_t)sizeof(header) ){
+			pb.err_code = HDEVIO_FILE_TRUNCATED;
+			pb.err_mess = "Error reading EVIO block header (truncated?)";
+			return false;
+		}
+		if( header[7]!=0xc0da0100 && header[7]!=0x0001dac0 ){
+			pb.err_code = HDEVIO_BAD_BLOCK_HEADER;
+			pb.err_mess = "Bad magic word";
+			return false;
+		}
+		pb.pos = pf_next_pos;
+		pb.len = header[7]==0x0001dac0 ? swap32(header[0]):header[0];
+	}
+
+	if( pb.len <= 8 ){
+		// block_length =8 indicates end of file.
+		pb.err_code = pb.len==8 ? HDEVIO_EOF:HDEVIO_BAD_BLOCK_HEADER;
+		pb.err_mess = pb.len==8 ? "No more events":"Bad block length";
+		return false;
+	}
+	if( pb.pos + (uint64_t)pb.len*4 > total_size_bytes ){
+		stringstream ss;
+		ss << "EVIO block extends past end of file! (" << (pb.pos + (uint64_t)pb.len*4) << " > " << total_size_bytes << ")";
+		pb.err_code = HDEVIO_FILE_TRUNCATED;
+		pb.err_mess = ss.str();
+		return false;
+	}
+
+	pf_next_pos = pb.pos + (uint64_t)pb.len*4;
+
+	return true;
+}
+
+//---------------------------------
+// PrefetchThread
+//---------------------------------
+void HDEVIO::PrefetchThread(void)
+{
+	/// Worker loop for block prefetching. Each iteration claims the
+	/// next block index (under lock), then reads the whole block
+	/// with pread (without lock) so several reads can be in flight
+	/// at once.
+
+	while(true){
+
+		PrefetchBlock pb;
+		uint64_t idx;
+		{
+			unique_lock<mutex> lck(pf_mutex);
+			pf_cv_space.wait(lck, [this]{ return pf_quit || pf_scan_done || (pf_next_idx-pf_next_consume)<PREFETCH_DEPTH; });
+			if(pf_quit || pf_scan_done) return;
+			if( !PrefetchLocateBlock(pb) ) pf_scan_done = true;
+			idx = pf_next_idx++;
+		}
+
+		if( pb.err_code == HDEVIO_OK ){
+			pb.data = shared_ptr<uint32_t>(new uint32_t[pb.len], default_delete<uint32_t[]>());
+			char *ptr = (char*)pb.data.get();
+			uint64_t bytes_left = (uint64_t)pb.len*4;
+			uint64_t pos = pb.pos;
+			while( bytes_left > 0 ){
+				ssize_t n = pread(pf_fd, ptr, bytes_left, pos);
+				if( n <= 0 ) break;
+				ptr += n;
+				pos += n;
+				bytes_left -= n;
+			}
+			uint32_t magic = pb.data.get()[7];
+			if( bytes_left > 0 ){
+				pb.err_code = HDEVIO_FILE_TRUNCATED;
+				pb.err_mess = "Error reading in EVIO entire block!";
+			}else if( magic!=0xc0da0100 && magic!=0x0001dac0 ){
+				pb.err_code = HDEVIO_BAD_BLOCK_HEADER;
+				pb.err_mess = "Bad magic word";
+			}
+			if( pb.err_code != HDEVIO_OK ){
+				lock_guard<mutex> lck(pf_mutex);
+				pf_scan_done = true;
+			}
+		}
+
+		{
+			lock_guard<mutex> lck(pf_mutex);
+			pf_ready[idx] = pb;
+		}
+		pf_cv_ready.notify_all();
+	}
+}
+
+//---------------------------------
+// readPrefetched
+//---------------------------------
+bool HDEVIO::readPrefetched(const uint32_t* &event_ptr, uint32_t &event_len, shared_ptr<const void> &region)
+{
+	/// This is an alternative to readMapped that gets its blocks
+	/// from the prefetch threads (see StartPrefetch) rather than
+	/// from a memory mapping. The interface is the same: event_ptr
+	/// points into a block buffer that stays valid for as long as
+	/// the caller holds region. Data is NOT swapped.
+
+	err_code = HDEVIO_OK;
+	ClearErrorMessage();
+
+	if( pf_threads.empty() && pf_final_err_code==HDEVIO_OK ) StartPrefetch();
+
+	SkipUnmappedEvents();
+	while(mm_events_left == 0){
+
+		// Once the end of the stream has been reached, keep reporting it
+		if( pf_final_err_code != HDEVIO_OK ){
+			SetErrorMessage(pf_final_err_mess);
+			err_code = pf_final_err_code;
+			return false;
+		}
+
+		PrefetchBlock pb;
+		{
+			unique_lock<mutex> lck(pf_mutex);
+			pf_cv_ready.wait(lck, [this]{ return pf_ready.count(pf_next_consume)>0; });
+			auto it = pf_ready.find(pf_next_consume);
+			pb = it->second;
+			pf_ready.erase(it);
+			pf_next_consume++;
+		}
+		pf_cv_space.notify_one();
+
+		if( pb.err_code != HDEVIO_OK ){
+			pf_final_err_code = pb.err_code;
+			pf_final_err_mess = pb.err_mess;
+			if( pb.err_code == HDEVIO_EOF ){
+				EndOfFile();
+			}else{
+				Nerrors++;
+			}
+			continue;
+		}
+
+		const uint32_t *bptr = pb.data.get();
+		mm_swap_needed  = (bptr[7]==0x0001dac0);
+		mm_block_region = pb.data;
+		mm_block_start  = bptr;
+		mm_block_pos    = pb.pos;
+		mm_next_event   = &bptr[8];
+		mm_block_end    = &bptr[pb.len];
+		mm_events_left  = mm_swap_needed ? swap32(bptr[3]):bptr[3];
+		Nblocks++;
+		MapBlockInMemory(bptr, pb.pos, mm_swap_needed);
+		if(pf_skip_events){
+			SkipBlockEvents(pf_skip_events);
+			pf_skip_events = 0;
+		}
+		SkipUnmappedEvents();
+	}
+
+	return NextBlockEvent(event_ptr, event_len, region);
+}
+
+//------------------------
+// ShareFileMap
+//------------------------
+void HDEVIO::ShareFileMap(HDEVIO &src)
+{
+	/// Use the file map of another HDEVIO object reading the same
+	/// file rather than building or reading our own. If src's map
+	/// came from a binary map file then the mapping is shared and
+	/// kept alive by both. Otherwise, the columns point directly at
+	/// src's vectors so src must not be deleted or modify its map
+	/// while this object is in use.
+
+	filemap.Share( src.GetFileMap() );
+	is_mapped = true;
+	index_Nevents = UINT64_MAX; // force rebuild of event index
+	evio_blocks.clear();
+}
+
+//------------------------
+// SetBlockRange
+//------------------------
+void HDEVIO::SetBlockRange(uint64_t first_block, uint64_t end_block)
+{
+	/// Limit all readers (except read) to blocks first_block up to,
+	/// but not including, end_block of the file map. The readers are
+	/// positioned at first_block and report HDEVIO_EOF once they
+	/// reach end_block. rewind() returns to first_block. This allows
+	/// several HDEVIO objects to read separate parts of one file
+	/// in parallel (see ShareFileMap).
+
+	if(!is_mapped) MapBlocks();
+
+	if( end_block > filemap.Nblocks ) end_block = filemap.Nblocks;
+	range_first_block = first_block;
+	range_end_block   = end_block;
+	range_end_pos     = end_block<filemap.Nblocks ? filemap.block_pos[end_block]:UINT64_MAX;
+	if( first_block >= end_block ){
+		// Empty range. Make all readers report EOF immediately.
+		range_end_block = 0;
+		range_end_pos   = 0;
+	}
+
+	rewind();
+}
+
+//------------------------
+// SplitBlocks
+//------------------------
+void HDEVIO::SplitBlocks(uint64_t first_block, uint64_t end_block, uint32_t N, vector<uint64_t> &boundaries)
+{
+	/// Split blocks first_block up to (not including) end_block
+	/// of the file map into N contiguous ranges of about the same
+	/// size in bytes. On return, boundaries holds N+1 block indices
+	/// so range i is boundaries[i] up to boundaries[i+1]. Some
+	/// ranges may be empty if there are fewer blocks than N.
+
+	if(!is_mapped) MapBlocks();
+	if( end_block > filemap.Nblocks ) end_block = filemap.Nblocks;
+	if( first_block > end_block ) first_block = end_block;
+	if( N < 1 ) N = 1;
+
+	boundaries.assign(1, first_block);
+	if( first_block == end_block ){
+		boundaries.resize(N+1, end_block);
+		return;
+	}
+
+	const uint64_t *block_pos = filemap.block_pos;
+	uint64_t start_pos = block_pos[first_block];
+	uint64_t end_pos   = block_pos[end_block-1] + (uint64_t)filemap.block_len[end_block-1]*sizeof(uint32_t);
+	for(uint32_t i=1; i<N; i++){
+		uint64_t split_pos = start_pos + (end_pos-start_pos)/N*i;
+		uint64_t iblock = lower_bound(block_pos+first_block, block_pos+end_block, split_pos) - block_pos;
+		boundaries.push_back( max(iblock, boundaries.back()) );
+	}
+	boundaries.push_back(end_block);
+}
+
+//------------------------
+// MakeShards
+//------------------------
+void HDEVIO::MakeShards(uint32_t Nshards, vector<ShardInfo> &shards)
+{
+	/// Split the whole file into Nshards contiguous pieces that can
+	/// be processed independently (see SetShard). Together they cover
+	/// every block exactly once. Each records the range of L1 event
+	/// numbers it contains and the BOR event it needs.
+
+	if(!is_mapped) MapBlocks();
+	BuildEventIndex();
+
+	vector<uint64_t> boundaries;
+	SplitBlocks(0, filemap.Nblocks, Nshards, boundaries);
+
+	shards.clear();
+	for(uint32_t i=0; i<Nshards; i++){
+		ShardInfo shard;
+		shard.index       = i;
+		shard.Nshards     = Nshards;
+		shard.first_block = boundaries[i];
+		shard.end_block   = boundaries[i+1];
+		shard.first_pos   = shard.first_block<filemap.Nblocks ? filemap.block_pos[shard.first_block]:total_size_bytes;
+		shard.end_pos     = shard.end_block<filemap.Nblocks   ? filemap.block_pos[shard.end_block]:total_size_bytes;
+		shard.first_event = 0;
+		shard.last_event  = 0;
+		shard.bor_event   = -1;
+		shard.bor_pos     = 0;
+
+		uint64_t ievent_start = filemap.block_event_start[shard.first_block];
+		uint64_t ievent_end   = filemap.block_event_start[shard.end_block];
+		for(uint64_t j=ievent_start; j<ievent_end; j++){
+			if( filemap.event_type[j] != kBT_PHYSICS ) continue;
+			if( shard.first_event==0 || filemap.event_first_event[j]<shard.first_event ) shard.first_event = filemap.event_first_event[j];
+			if( filemap.event_last_event[j]>shard.last_event ) shard.last_event = filemap.event_last_event[j];
+		}
+
+		// Most recent BOR event before the shard (if any)
+		auto it = lower_bound(state_index.begin(), state_index.end(), ievent_start);
+		while( it != state_index.begin() ){
+			if( filemap.event_type[*(--it)] != kBT_BOR ) continue;
+			shard.bor_event = *it;
+			shard.bor_pos   = filemap.event_pos[*it];
+			break;
+		}
+
+		shards.push_back(shard);
+	}
+}
+
+//------------------------
+// WriteShardFile
+//------------------------
+bool HDEVIO::WriteShardFile(string fname, uint32_t Nshards)
+{
+	/// Write descriptors for Nshards pieces of this file (see MakeShards)
+	/// to a text file. Each job can then process one of them by reading
+	/// it back with ReadShardFile and passing it to SetShard.
+
+	vector<ShardInfo> shards;
+	MakeShards(Nshards, shards);
+
+	ofstream ofs(fname.c_str());
+	if(!ofs.is_open()){
+		cerr << "Unable to open \""<<fname<<"\" for writing!" << endl;
+		return false;
+	}
+
+	cout << "Writing " << Nshards << " EVIO shard descriptors to: " << fname << endl;
+
+	char str[256];
+	time_t t = time(NULL);
+	struct tm *tmp = localtime(&t);
+	strftime(str, 255, "%c", tmp);
+
+	ofs << "#" << endl;
+	ofs << "# HDEVIO shard descriptors for " << filename << endl;
+	ofs << "#" << endl;
+	ofs << "# generated " << str << endl;
+	ofs << "#" << endl;
+	ofs << "file_size: " << total_size_bytes << endl;
+	ofs << "Nshards: " << Nshards << endl;
+	ofs << "# shard first_block end_block  first_pos  end_pos  first_evt last_evt bor_event bor_pos" << endl;
+	for(auto &s : shards){
+		char line[512];
+		sprintf(line, "%4u %8" PRIu64 " %8" PRIu64 " 0x%08" PRIx64 " 0x%08" PRIx64 " %8" PRIu64 " %8" PRIu64 " %8" PRId64 " 0x%08" PRIx64, s.index, s.first_block, s.end_block, s.first_pos, s.end_pos, s.first_event, s.last_event, s.bor_event, s.bor_pos);
+		ofs << line << endl;
+	}
+	ofs << "# --- End of shards ---" << endl;
+	ofs.close();
+
+	cout << "Done" << endl;
+	return true;
+}
+
+//------------------------
+// ReadShardFile
+//------------------------
+bool HDEVIO::ReadShardFile(string fname, uint32_t ishard, ShardInfo &shard)
+{
+	/// Read the descriptor for shard ishard from a file written by
+	/// WriteShardFile. Returns false with the reason in err_mess
+	/// if it can't be found or the file was made for a different
+	/// size EVIO file.
+
+	ClearErrorMessage();
+	ifstream ifs_shards(fname.c_str());
+	if(!ifs_shards.is_open()){
+		err_mess << "Unable to open EVIO shard file \"" << fname << "\"";
+		return false;
+	}
+
+	uint64_t file_size = 0;
+	uint32_t Nshards = 0;
+	string line;
+	while( getline(ifs_shards, line) ){
+		if( line.empty() || line[0]=='#' ) continue;
+		if( line.find("file_size:")==0 ){ file_size = strtoull(line.substr(10).c_str(), NULL, 0); continue; }
+		if( line.find("Nshards:")==0   ){ Nshards   = strtoul(line.substr(8).c_str(), NULL, 0);    continue; }
+
+		stringstream ss(line);
+		string first_pos, end_pos, bor_pos;
+		ss >> shard.index >> shard.first_block >> shard.end_block >> first_pos >> end_pos >> shard.first_event >> shard.last_event >> shard.bor_event >> bor_pos;
+		if( ss.fail() ){
+			err_mess << "Bad line in EVIO shard file \"" << fname << "\": " << line;
+			return false;
+		}
+		if( shard.index != ishard ) continue;
+		shard.Nshards   = Nshards;
+		shard.first_pos = strtoull(first_pos.c_str(), NULL, 0);
+		shard.end_pos   = strtoull(end_pos.c_str(), NULL, 0);
+		shard.bor_pos   = strtoull(bor_pos.c_str(), NULL, 0);
+
+		if( file_size != total_size_bytes ){
+			err_mess << "EVIO shard file \"" << fname << "\" is for a file of " << file_size << " bytes but " << filename << " is " << total_size_bytes << " bytes";
+			return false;
+		}
+		return true;
+	}
+
+	err_mess << "Shard " << ishard << " not found in EVIO shard file \"" << fname << "\"";
+	return false;
+}
+
+//------------------------
+// SetShard
+//------------------------
+bool HDEVIO::SetShard(const ShardInfo &shard, vector<uint64_t> *state_events)
+{
+	/// Limit reading to the blocks in the given shard (see
+	/// SetBlockRange). The shard is checked against the file map
+	/// to ensure it was made from the same file. If state_events
+	/// is given, it is filled with the event table indices of the
+	/// BOR event and any EPICS events preceding the shard so they
+	/// can be read (see readEvent) before the first event of the
+	/// shard. Returns false with the reason in err_mess if the
+	/// shard doesn't match this file.
+
+	if(!is_mapped) MapBlocks();
+	BuildEventIndex();
+
+	ClearErrorMessage();
+	bool ok = shard.first_block<=shard.end_block && shard.end_block<=filemap.Nblocks;
+	if( ok && shard.first_block<filemap.Nblocks ) ok = filemap.block_pos[shard.first_block]==shard.first_pos;
+	if( ok && shard.end_block<filemap.Nblocks   ) ok = filemap.block_pos[shard.end_block]==shard.end_pos;
+	if( ok && shard.bor_event>=0 ) ok = (uint64_t)shard.bor_event<filemap.Nevents && filemap.event_pos[shard.bor_event]==shard.bor_pos;
+	if( !ok ){
+		err_mess << "EVIO shard " << shard.index << " does not match the file map of " << filename;
+		return false;
+	}
+
+	SetBlockRange(shard.first_block, shard.end_block);
+
+	if( state_events ){
+		state_events->clear();
+		if( shard.first_block < shard.end_block ) FindStateEvents(0, filemap.block_event_start[shard.first_block], *state_events);
+	}
+
+	return true;
+}
+
+//------------------------
+// BuildEventIndex
+//------------------------
+void HDEVIO::BuildEventIndex(void)
+{
+	/// Fill phys_index with the event table indices of all physics
+	/// events in the file map, ordered by event number so they can
+	/// be binary searched. Also fill state_index with the indices
+	/// of all BOR and EPICS events in file order. These are rebuilt
+	/// only if the map changes.
+
+	if( index_Nevents==filemap.Nevents ) return;
+
+	phys_index.clear();
+	state_index.clear();
+	bool sorted = true;
+	for(uint64_t i=0; i<filemap.Nevents; i++){
+		if( filemap.event_type[i]==kBT_BOR || filemap.event_type[i]==kBT_EPICS ) state_index.push_back(i);
+		if( filemap.event_type[i] != kBT_PHYSICS ) continue;
+		if( !phys_index.empty() && filemap.event_first_event[i] < filemap.event_first_event[phys_index.back()] ) sorted = false;
+		phys_index.push_back(i);
+	}
+	if( !sorted ){
+		const uint64_t *first_event = filemap.event_first_event;
+		stable_sort(phys_index.begin(), phys_index.end(), [first_event](uint64_t a, uint64_t b){ return first_event[a] < first_event[b]; });
+	}
+	index_Nevents = filemap.Nevents;
+}
+
+//------------------------
+// FindEventNumber
+//------------------------
+uint64_t HDEVIO::FindEventNumber(uint64_t start_event, uint64_t nskip)
+{
+	/// Return the event number of the L1 trigger event that is nskip
+	/// events after start_event (or after the first event in the file
+	/// if start_event is 0). Returns 0 if there is no such event.
+	/// This maps the file if it has not already been mapped.
+
+	if(!is_mapped) MapBlocks();
+	BuildEventIndex();
+
+	const uint64_t *first_event = filemap.event_first_event;
+	const uint64_t *last_event  = filemap.event_last_event;
+	auto it = phys_index.begin();
+	if( start_event != 0 ){
+		it = lower_bound(phys_index.begin(), phys_index.end(), start_event, [last_event](uint64_t i, uint64_t evtnum){ return last_event[i] < evtnum; });
+	}
+	if( it == phys_index.end() ) return 0;
+
+	uint64_t evtnum = max(start_event, first_event[*it]);
+	for(; it!=phys_index.end(); it++){
+		if( evtnum < first_event[*it] ) evtnum = first_event[*it];
+		uint64_t Nleft = last_event[*it] - evtnum + 1; // events left in this EVIO event
+		if( nskip < Nleft ) return evtnum + nskip;
+		nskip -= Nleft;
+		evtnum = last_event[*it] + 1;
+	}
+
+	return 0;
+}
+
+//------------------------
+// SeekToEvent
+//------------------------
+bool HDEVIO::SeekToEvent(uint64_t event_number, vector<uint64_t> *state_events)
+{
+	/// Position the file so that the next event read (by any of the
+	/// read methods) is the EVIO event containing the L1 trigger
+	/// event with the given number. The block map is binary searched
+	/// so this does not require reading any intervening events.
+	/// This maps the file first if it has not already been mapped.
+	/// Note that EVIO events may contain several L1 events so the
+	/// caller may need to discard those preceding event_number.
+	/// Returns false if the event is not in the file.
+	///
+	/// If state_events is given, it is filled with the event table
+	/// indices (see readEvent) of the BOR and EPICS events that were
+	/// jumped over and are needed to bring the run state up to date
+	/// at the target. This is the most recent BOR event and all EPICS
+	/// events since the last event read (or since the start of the
+	/// file if nothing has been read or the seek is backwards).
+
+	if(!is_mapped) MapBlocks();
+	BuildEventIndex();
+
+	const uint64_t *first_event = filemap.event_first_event;
+	const uint64_t *last_event  = filemap.event_last_event;
+	auto it = lower_bound(phys_index.begin(), phys_index.end(), event_number, [last_event](uint64_t i, uint64_t evtnum){ return last_event[i] < evtnum; });
+	if( it==phys_index.end() || first_event[*it]>event_number ){
+		ClearErrorMessage();
+		err_mess << "Event " << event_number << " not found in file";
+		return false;
+	}
+
+	uint64_t ievent = *it;
+
+	if( state_events ){
+		// Find first event not yet read. Events before this have
+		// already been seen by the caller, including state events.
+		uint64_t ievent_start = 0;
+		if( last_event_pos > 0 ){
+			const uint64_t *event_pos = filemap.event_pos;
+			ievent_start = upper_bound(event_pos, event_pos+filemap.Nevents, (uint64_t)last_event_pos) - event_pos;
+			if( ievent_start > ievent ) ievent_start = 0; // backwards seek
+		}
+		FindStateEvents(ievent_start, ievent, *state_events);
+	}
+
+	uint64_t iblock = upper_bound(filemap.block_event_start, filemap.block_event_start+filemap.Nblocks+1, ievent) - filemap.block_event_start - 1;
+	SeekToBlockEvent(iblock, ievent - filemap.block_event_start[iblock]);
+
+	return true;
+}
+
+//------------------------
+// FindStateEvents
+//------------------------
+void HDEVIO::FindStateEvents(uint64_t ievent_start, uint64_t ievent_end, vector<uint64_t> &ievents)
+{
+	/// Fill ievents with the event table indices of the state events
+	/// that must be processed in order to skip from ievent_start to
+	/// ievent_end. This is the last BOR event before ievent_end (if
+	/// it is not before ievent_start) and all EPICS events in between.
+	/// Only the state index is searched so this is independent of the
+	/// number of physics events skipped.
+
+	ievents.clear();
+	auto it_start = lower_bound(state_index.begin(), state_index.end(), ievent_start);
+	auto it_end   = lower_bound(state_index.begin(), state_index.end(), ievent_end);
+
+	for(auto it=it_end; it!=state_index.begin(); ){
+		if( filemap.event_type[*(--it)] != kBT_BOR ) continue;
+		if( *it < ievent_start ) break; // already seen
+		ievents.push_back(*it);
+		break;
 	}
 	
-	// Double check that event length matches EVIO block header
-	// but only if we either don't need to swap or need to and
-	// were allowed to (otherwise, the test will almost certainly
-	// fail!)
-	if( (!br.swap_needed) || (br.swap_needed && allow_swap) ){
-		if( (user_buff[0]+1) != event_len ){
-			ClearErrorMessage();
-			err_mess << "WARNING: EVIO bank indicates a different size than block header (" << event_len << " != " << (user_buff[0]+1) << ")";
-			err_code = HDEVIO_EVENT_BIGGER_THAN_BLOCK;
-			Nerrors++;
-			Nbad_blocks++;
-			return false;
-		}
+	for(auto it=it_start; it!=it_end; it++){
+		if( filemap.event_type[*it] == kBT_EPICS ) ievents.push_back(*it);
 	}
+	
+	sort(ievents.begin(), ievents.end());
+}
 
-	if(isgood) Nevents++;
+//------------------------
+// SeekToBlockEvent
+//------------------------
+void HDEVIO::SeekToBlockEvent(uint64_t iblock, uint64_t ievent_in_block)
+{
+	/// Position all readers at the given event in the given block
+	/// of the file map. The readNoFileBuff and readSparse positions
+	/// are set directly. The others are applied on their next call
+	/// since they may need to allocate resources (mmap, threads, ...)
+
+	// readNoFileBuff
+	filemap.GetBlockRecord(iblock, NB_block_record);
+	auto &events = NB_block_record.evio_events;
+	events.erase(events.begin(), events.begin() + min((uint64_t)events.size(), ievent_in_block));
+	NB_next_pos = (streamoff)(filemap.block_pos[iblock] + (uint64_t)filemap.block_len[iblock]*sizeof(uint32_t));
+	ifs.clear();
 
-	return isgood;
+	// readSparse
+	sparse_block_idx = iblock;
+	sparse_event_idx = ievent_in_block;
+
+	// read, readMapped, readPrefetched
+	seek_block  = iblock;
+	seek_nskip  = ievent_in_block;
+	seek_pending_read     = true;
+	seek_pending_mapped   = true;
+	seek_pending_prefetch = true;
+	mm_events_left = 0;
+	if( !pf_threads.empty() ) StopPrefetch();
+	pf_final_err_code = HDEVIO_OK;
+
+	ClearErrorMessage();
+	err_code = HDEVIO_OK;
 }
 
 //------------------------
@@ -615,11 +1886,30 @@ void HDEVIO::rewind(void)
 	ifs.seekg(0, ios_base::beg);
 	ifs.clear();
 	
-	sparse_block_iter = evio_blocks.begin();
-	sparse_event_idx  = 0;
+	sparse_block_idx = 0;
+	sparse_event_idx = 0;
 	
 	NB_block_record.evio_events.clear();
 	NB_next_pos = 0;
+	stream_next_pos = 0;
+	
+	mm_next_block  = mm_buff;
+	mm_events_left = 0;
+	mm_block_region.reset();
+	
+	// Prefetching will restart from the beginning on next readPrefetched
+	if( !pf_threads.empty() ) StopPrefetch();
+	pf_final_err_code = HDEVIO_OK;
+	
+	seek_pending_read = seek_pending_mapped = seek_pending_prefetch = false;
+	last_event_pos = 0;
+	fnext = fbuff_end = fbuff;
+	fbuff_len = 0;
+	buff_len = 0;
+	next = buff; // makes read() think current block is exhausted
+	
+	// Restart at beginning of range if SetBlockRange was called
+	if( range_first_block>0 && range_first_block<range_end_block ) SeekToBlockEvent(range_first_block, 0);
 	
 	ClearErrorMessage();
 	err_code = HDEVIO_OK;
@@ -664,16 +1954,43 @@ uint32_t HDEVIO::AddToEventMask(string type_str)
 //------------------------
 vector<HDEVIO::EVIOBlockRecord>& HDEVIO::GetEVIOBlockRecords(void)
 {
+	/// Return the file map in the form of EVIOBlockRecord objects.
+	/// The map is kept internally in a flat form (see GetFileMap)
+	/// so this makes a copy the first time it is called.
+
 	if(!is_mapped) MapBlocks();
 	
+	if(evio_blocks.size() != filemap.Nblocks){
+		evio_blocks.resize(filemap.Nblocks);
+		for(uint64_t i=0; i<filemap.Nblocks; i++) filemap.GetBlockRecord(i, evio_blocks[i]);
+	}
+	
 	return evio_blocks;
 }
 
+//------------------------
+// GetFileMap
+//------------------------
+const HDEVIO::EVIOFileMap& HDEVIO::GetFileMap(void)
+{
+	if(!is_mapped) MapBlocks();
+	
+	return filemap;
+}
+
 //------------------------
 // MapBlocks
 //------------------------
 void HDEVIO::MapBlocks(bool print_ticker)
 {
+	/// Scan the entire file and record the position, size, and type
+	/// of every block and every event in it. The file is read
+	/// sequentially in large chunks (MAP_BUFFER_SIZE bytes) and all
+	/// headers are pulled out of memory. There are no seeks except
+	/// for restoring the file position at the end. This avoids the
+	/// small-read, backwards-seek pattern that performs poorly on
+	/// Lustre (see buff_read).
+
 	if(!is_open){
 		err_mess.str("File is not open");
 		err_code = HDEVIO_FILE_NOT_OPEN;
@@ -684,14 +2001,46 @@ void HDEVIO::MapBlocks(bool print_ticker)
 	streampos start_pos = ifs.tellg();
 	
 	if(print_ticker) cout << "Mapping EVIO file ..." << endl;
+	auto t_start = std::chrono::steady_clock::now();
+	
+	// Sliding window onto the file. need(pos, nwords) returns a pointer
+	// to nwords words starting at file position pos (bytes), reading
+	// more of the file if needed. Requests must be made in increasing
+	// file position order. Returns NULL if the file ends first.
+	uint64_t win_words = MAP_BUFFER_SIZE/sizeof(uint32_t);
+	if(win_words < 1024) win_words = 1024;
+	unique_ptr<uint32_t[]> wbuff(new uint32_t[win_words]); // (not zeroed)
+	uint64_t win_pos = 0; // file position of wbuff[0] in bytes
+	uint64_t win_len = 0; // valid words in wbuff
+	auto need = [&](uint64_t pos, uint64_t nwords) -> const uint32_t* {
+		uint64_t win_end = win_pos + win_len*sizeof(uint32_t);
+		if( pos>=win_pos && pos+nwords*sizeof(uint32_t)<=win_end ) return &wbuff[(pos-win_pos)/sizeof(uint32_t)];
+		if( pos < win_end ){
+			// Keep the part of the window we still need
+			win_len = (win_end - pos)/sizeof(uint32_t);
+			memmove(wbuff.get(), &wbuff[(pos-win_pos)/sizeof(uint32_t)], win_len*sizeof(uint32_t));
+		}else{
+			// Skip forward without seeking
+			if( pos > win_end ) ifs.ignore(pos - win_end);
+			win_len = 0;
+		}
+		win_pos = pos;
+		ifs.read((char*)&wbuff[win_len], (win_words - win_len)*sizeof(uint32_t));
+		win_len += ifs.gcount()/sizeof(uint32_t);
+		return nwords<=win_len ? wbuff.get():NULL;
+	};
 	
 	// Rewind to beginning of file and loop over all blocks
+	filemap.Clear();
+	ifs.clear();
 	ifs.seekg(0, ios_base::beg);
-	BLOCKHEADER_t bh;
+	uint64_t pos = 0;
 	uint64_t Nblocks = 0;
-	while(ifs.good()){
-		ifs.read((char*)&bh, sizeof(bh));
-		if(!ifs.good()) break;
+	while(true){
+		const uint32_t *bhptr = need(pos, sizeof(BLOCKHEADER_t)/sizeof(uint32_t));
+		if(bhptr == NULL) break;
+		BLOCKHEADER_t bh;
+		memcpy(&bh, bhptr, sizeof(bh));
 		
 		// Check if we need to byte swap and simultaneously
 		// verify header is good by checking magic word
@@ -703,9 +2052,13 @@ void HDEVIO::MapBlocks(bool print_ticker)
 				err_mess.str("Bad magic word");
 				err_code = HDEVIO_BAD_BLOCK_HEADER;
 				EVIOBlockRecord br;
-				br.pos = ifs.tellg() - (streampos)sizeof(bh);
+				br.pos = (streamoff)pos;
+				br.block_len = 0;
+				br.swap_needed = false;
+				br.first_event = 0;
+				br.last_event = 0;
 				br.block_type = kBT_UNKNOWN;
-				evio_blocks.push_back(br);
+				filemap.AddBlock(br);
 				break;
 			}
 		}
@@ -713,72 +2066,103 @@ void HDEVIO::MapBlocks(bool print_ticker)
 		if(swap_needed)swap_block((uint32_t*)&bh, sizeof(bh)>>2, (uint32_t*)&bh);
 		
 		Nblocks++;
-		streampos block_len_bytes = (bh.length<<2)-sizeof(bh); // <<2 is for *4
-		streampos pos = ifs.tellg() - (streampos)sizeof(bh);
 		
 		EVIOBlockRecord br;
-		br.pos = pos;
+		br.pos = (streamoff)pos;
 		br.block_len = bh.length;
 		br.swap_needed = swap_needed;
-		br.first_event = 0;
-		br.last_event = 0;
-
-		// Categorize this block		
-		uint32_t tag = bh.header>>16;
-		uint32_t M   = bh.header&0xFF;
-		
-		switch(tag){
-			case 0xFFD0: br.block_type = kBT_SYNC;      break;
-			case 0xFFD1: br.block_type = kBT_PRESTART;  break;
-			case 0xFFD2: br.block_type = kBT_GO;        break;
-			case 0xFFD3: br.block_type = kBT_PAUSE;     break;
-			case 0xFFD4: br.block_type = kBT_END;       break;
-			case 0x0060: br.block_type = kBT_EPICS;     break;
-			case 0x0070: br.block_type = kBT_BOR;       break;
-			case 0xFF50:
-			case 0xFF51:
-			case 0xFF70:
-				br.block_type   = kBT_PHYSICS;
-				br.first_event  = bh.physics.first_event_lo;
-				br.first_event += ((uint64_t)bh.physics.first_event_hi)<<32;
-				br.last_event   = br.first_event + (uint64_t)M - 1;
-				break;
-			default:
-				br.block_type   = kBT_UNKNOWN;
-				_DBG_ << "Uknown tag: " << hex << tag << dec << endl;
-		}
+		CategorizeBlock(bh, br);
 		
 		// Scan through and map all events within this block
-		if( !SKIP_EVENT_MAPPING ) MapEvents(bh, br);
+		if( !SKIP_EVENT_MAPPING ){
+			uint64_t epos = pos + (8<<2); // (8<<2) is 8 word EVIO block header times 4bytes/word
+			for(uint32_t i=0; i<bh.eventcnt; i++){
+				const uint32_t *ehptr = need(epos, sizeof(EVENTHEADER_t)/sizeof(uint32_t));
+				if(ehptr == NULL) break;
+				EVENTHEADER_t eh;
+				memcpy(&eh, ehptr, sizeof(eh));
+				if(swap_needed)swap_block((uint32_t*)&eh, sizeof(EVENTHEADER_t)>>2, (uint32_t*)&eh);
+				MapEvent(eh, (streamoff)epos, br);
+				epos += (uint64_t)(eh.event_len+1)<<2;
+			}
+		}
 
 		// Add block to list
-		evio_blocks.push_back(br);
+		filemap.AddBlock(br);
+		
+		// Advance to start of next EVIO block header
+		pos += (uint64_t)bh.length<<2; // <<2 is for *4
 		
 		// Update ticker
 		if(print_ticker){
 			if((Nblocks%500) == 0){
 				uint64_t total_MB = total_size_bytes>>20;
-				uint64_t read_MB  = ifs.tellg()>>20;
-				if(Nblocks==0) cout << endl;
-				cout << Nblocks << " blocks scanned (" << read_MB << "/" << total_MB << " MB " << (100*read_MB/total_MB) << "%)     \r";
+				uint64_t read_MB  = pos>>20;
+				cout << Nblocks << " blocks scanned (" << read_MB << "/" << total_MB << " MB " << (total_MB ? 100*read_MB/total_MB:100) << "%)     \r";
 				cout.flush();
 			}
 		}
-
-		// Advance file pointer to start of next EVIO block header
-		ifs.seekg(block_len_bytes, ios_base::cur);
+		
+		// Guard against zero-length blocks which would loop forever
+		if(bh.length == 0) break;
 	}
 	
-	if(print_ticker) cout << endl;
+	if(print_ticker){
+		double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+		double MB = (double)(pos<total_size_bytes ? pos:total_size_bytes)/1.0E6;
+		cout << endl;
+		cout << "Mapped " << Nblocks << " blocks (" << MB << " MB) in " << t << " s (" << (t>0.0 ? MB/t:0.0) << " MB/s)" << endl;
+	}
 	
 	// Setup iterators for sparse reading
-	sparse_block_iter = evio_blocks.begin();
+	sparse_block_idx = 0;
 	sparse_event_idx = 0;
 
 	// Restore file pos and set flag that file has been mapped
 	ifs.clear();
 	ifs.seekg(start_pos, ios_base::beg);
 	is_mapped = true;
+	building_map = false;
+
+	// The map was needed before the file was read through (e.g. for
+	// readSparse, SeekToEvent or SetBlockRange) so save it now.
+	if( !SAVE_MAP_FILE.empty() ) SaveFileMap(SAVE_MAP_FILE);
+}
+
+//---------------------------------
+// CategorizeBlock
+//---------------------------------
+void HDEVIO::CategorizeBlock(BLOCKHEADER_t &bh, EVIOBlockRecord &br)
+{
+	/// Set the block type and event range of br using the
+	/// (already swapped) block header.
+
+	br.first_event = 0;
+	br.last_event = 0;
+
+	uint32_t tag = bh.header>>16;
+	uint32_t M   = bh.header&0xFF;
+	
+	switch(tag){
+		case 0xFFD0: br.block_type = kBT_SYNC;      break;
+		case 0xFFD1: br.block_type = kBT_PRESTART;  break;
+		case 0xFFD2: br.block_type = kBT_GO;        break;
+		case 0xFFD3: br.block_type = kBT_PAUSE;     break;
+		case 0xFFD4: br.block_type = kBT_END;       break;
+		case 0x0060: br.block_type = kBT_EPICS;     break;
+		case 0x0070: br.block_type = kBT_BOR;       break;
+		case 0xFF50:
+		case 0xFF51:
+		case 0xFF70:
+			br.block_type   = kBT_PHYSICS;
+			br.first_event  = bh.physics.first_event_lo;
+			br.first_event += ((uint64_t)bh.physics.first_event_hi)<<32;
+			br.last_event   = br.first_event + (uint64_t)M - 1;
+			break;
+		default:
+			br.block_type   = kBT_UNKNOWN;
+			_DBG_ << "Uknown tag: " << hex << tag << dec << endl;
+	}
 }
 
 //---------------------------------
@@ -815,80 +2199,7 @@ void HDEVIO::MapEvents(BLOCKHEADER_t &bh, EVIOBlockRecord &br)
 			ifs.seekg(sizeof(EVENTHEADER_t), ios_base::cur);
 		}
 
-		if (eh->event_len < 2) {
-			// Before disabling this warning (or hiding it behind a VERBOSE flag)
-			// you should ask yourself the question, "Is this something that we
-			// should simply be ignoring, garbage bytes in the input evio file?"
-			std::cout << "HDEVIO::MapEvents warning - " << "Attempt to swap bank with len<2 (len="<<eh->event_len<<" header="<<hex<<eh->header<<dec<<" pos=" << pos << " tellg=" << ifs.tellg() << " i=" << i << ")" << std::endl;
-			
-			// Reference run 20495: Seems ROL is putting BOR bank header, but
-			// the bank has no data in it. For this case we can go forward, but
-			// this is really a problem for production data. Detect this and warn
-			// user.
-			if(eh->event_len==1 && (eh->header&0xFFFF00FF)==0x00700001){
-				_DBG__;
-				_DBG_ << "WARNING: This looks like an empty BOR event. BOR configuration" << endl;
-				_DBG_ << "         data will not be available and it is unlikely you will" << endl;
-				_DBG_ << "         be able to do anything beyond the digihit level. " << endl;
-				_DBG__;
-				
-				if(IGNORE_EMPTY_BOR){
-					EVIOEventRecord er;
-					er.pos = pos;
-					er.event_len   = eh->event_len + 1; // +1 to include length word
-					er.event_type  = kBT_UNKNOWN;
-					er.first_event = 0;
-					er.last_event  = 0;
-					br.evio_events.push_back(er);
-				}else{
-					_DBG_ << "         The program will (probably) stop now." << endl;
-					_DBG_ << "         To avoid stopping, re-run with EVIO:IGNORE_EMPTY_BOR=1 ." << endl;				}
-			}
-			
-			Nbad_events++;
-			Nerrors++;
-			// --i;  // This caused an infinite loop when reading hd_rawdata_020058_000.evio DL
-			streampos delta = (streampos)((eh->event_len+1)<<2) - 
-                              (streampos)sizeof(EVENTHEADER_t);
-			ifs.seekg(delta, ios_base::cur);
-			pos += (streampos)((eh->event_len+1)<<2);
-			continue;
-		}
-
-		EVIOEventRecord er;
-		er.pos = pos;
-		er.event_len   = eh->event_len + 1; // +1 to include length word
-		er.event_header= eh->header;
-		er.event_type  = kBT_UNKNOWN;
-		er.first_event = 0;
-		er.last_event  = 0;
-
-		uint32_t tag = eh->header>>16;
-		uint32_t M   = eh->header&0xFF;
-		
-		switch(tag){
-			case 0xFFD0: er.event_type = kBT_SYNC;       break;
-			case 0xFFD1: er.event_type = kBT_PRESTART;   break;
-			case 0xFFD2: er.event_type = kBT_GO;         break;
-			case 0xFFD3: er.event_type = kBT_PAUSE;      break;
-			case 0xFFD4: er.event_type = kBT_END;        break;
-			case 0x0060: er.event_type = kBT_EPICS;      break;
-			case 0x0070: er.event_type = kBT_BOR;        break;
-			case 0xFF50:
-			case 0xFF51:
-			case 0xFF70:
-				er.event_type = kBT_PHYSICS;
-				er.first_event  = eh->physics.first_event_lo;
-				er.first_event += ((uint64_t)eh->physics.first_event_hi)<<32;
-				er.last_event   = er.first_event + (uint64_t)M - 1;
-				if(er.first_event < br.first_event) br.first_event = er.first_event;
-				if(er.last_event  > br.last_event ) br.last_event  = er.last_event;
-				break;
-			default:
-				if(VERBOSE>1) _DBG_ << "Uknown tag: " << hex << tag << dec << endl;
-		}
-		
-		br.evio_events.push_back(er);
+		MapEvent(*eh, pos, br);
 		
 		// Move file position to start of next event
 		streampos delta = (streampos)((eh->event_len+1)<<2) - (streampos)sizeof(EVENTHEADER_t);
@@ -901,213 +2212,156 @@ void HDEVIO::MapEvents(BLOCKHEADER_t &bh, EVIOBlockRecord &br)
 }
 
 //---------------------------------
-// swap_bank
+// MapEvent
 //---------------------------------
-uint32_t HDEVIO::swap_bank(uint32_t *outbuff, uint32_t *inbuff, uint32_t len)
+void HDEVIO::MapEvent(EVENTHEADER_t &eh, streampos pos, EVIOBlockRecord &br)
 {
-	/// Swap an EVIO bank. If the bank contains data, it is automatically
-	/// swapped according to it's type. If the bank is a container of other
-	/// containers, then this repeatedly calls the swapper methods for the
-	/// appropriate container type (bank, tagsegment, segment). This means
-	/// that this method will be recursive in the cases where it is a bank
-	/// of banks.
-
-	if(len < 2){
-		SetErrorMessage("Attempt to swap bank with len<2");
-		err_code = HDEVIO_BANK_TRUNCATED;
-		Nerrors++;
+	/// Categorize a single EVIO event whose (already swapped)
+	/// header is given and add a record of it to br.
+
+	if (eh.event_len < 2) {
+		// Before disabling this warning (or hiding it behind a VERBOSE flag)
+		// you should ask yourself the question, "Is this something that we
+		// should simply be ignoring, garbage bytes in the input evio file?"
+		std::cout << "HDEVIO::MapEvents warning - " << "Attempt to swap bank with len<2 (len="<<eh.event_len<<" header="<<hex<<eh.header<<dec<<" pos=" << pos << " i=" << br.evio_events.size() << ")" << std::endl;
+		
+		// Reference run 20495: Seems ROL is putting BOR bank header, but
+		// the bank has no data in it. For this case we can go forward, but
+		// this is really a problem for production data. Detect this and warn
+		// user.
+		if(eh.event_len==1 && (eh.header&0xFFFF00FF)==0x00700001){
+			_DBG__;
+			_DBG_ << "WARNING: This looks like an empty BOR event. BOR configuration" << endl;
+			_DBG_ << "         data will not be available and it is unlikely you will" << endl;
+			_DBG_ << "         be able to do anything beyond the digihit level. " << endl;
+			_DBG__;
+			
+			if(IGNORE_EMPTY_BOR){
+				EVIOEventRecord er;
+				er.pos = pos;
+				er.event_len   = eh.event_len + 1; // +1 to include length word
+				er.event_header= eh.header;
+				er.event_type  = kBT_UNKNOWN;
+				er.first_event = 0;
+				er.last_event  = 0;
+				br.evio_events.push_back(er);
+			}else{
+				_DBG_ << "         The program will (probably) stop now." << endl;
+				_DBG_ << "         To avoid stopping, re-run with EVIO:IGNORE_EMPTY_BOR=1 ." << endl;				}
+		}
+		
 		Nbad_events++;
-		return 0;
-	}
-	
-	// Swap length and header words
-	swap_block(inbuff, 2, outbuff);
-	uint32_t bank_len = outbuff[0];
-	if((bank_len+1) > len){
-		ClearErrorMessage();
-		err_mess << "WARNING: Bank length word exceeds valid words in buffer (" << bank_len+1 << " > " << len << ")";
-		err_code = HDEVIO_BANK_TRUNCATED;
 		Nerrors++;
-		Nbad_events++;
-		return 0;
-	}
-	
-	uint32_t type = (outbuff[1]>>8) & 0xFF;
-	uint32_t Nwords = bank_len - 1;
-	uint32_t Nswapped = 2;
-	switch(type){
-		case 0x0a:  // 64 bit unsigned int
-		case 0x08:  // 64 bit double
-		case 0x09:  // 64 bit signed int
-			swap_block((uint64_t*)&inbuff[2], Nwords/2, (uint64_t*)&outbuff[2]);
-			Nswapped += Nwords;
-			break;
-		case 0x01:  // 32 bit unsigned int
-		case 0x02:  // 32 bit float
-		case 0x0b:  // 32 bit signed int
-			swap_block(&inbuff[2], Nwords, &outbuff[2]);
-			Nswapped += Nwords;
-			break;
-		case 0x05:  // 16 bit unsigned int
-		case 0x04:  // 16 bit signed int
-			swap_block((uint16_t*)&inbuff[2], Nwords*2, (uint16_t*)&outbuff[2]);
-			Nswapped += Nwords;
-			break;
-		case 0x00:  // 32 bit unknown (not swapped)
-		case 0x07:  // 8 bit unsigned int
-		case 0x06:  // 8 bit signed int
-			if( inbuff!=outbuff ) memcpy((uint8_t*)&outbuff[2], (uint8_t*)&inbuff[2], Nwords*sizeof(uint32_t));
-			Nswapped += Nwords;
-			break;
-		case 0x0c:
-			while(Nswapped < (Nwords+2)){
-				uint32_t N = swap_tagsegment(&outbuff[Nswapped], &inbuff[Nswapped], (Nwords+2)-Nswapped);
-				if(N == 0) return Nswapped;
-				Nswapped += N;
-			}
-			break;
-		case 0x0d:
-		case 0x20:
-			while(Nswapped < (Nwords+2)){
-				uint32_t N = swap_segment(&outbuff[Nswapped], &inbuff[Nswapped], (Nwords+2)-Nswapped);
-				if(N == 0) return Nswapped;
-				Nswapped += N;
-			}
-			break;
-		case 0x0e:
-		case 0x10:
-			while(Nswapped < (Nwords+2)){
-				uint32_t N = swap_bank(&outbuff[Nswapped], &inbuff[Nswapped], (Nwords+2)-Nswapped);
-				if(N == 0) return Nswapped;
-				Nswapped += N;
-			}
-			break;
-		default:
-			ClearErrorMessage();
-			err_mess << "WARNING: unknown bank type (0x" << hex << type << dec << ")";
-			err_code = HDEVIO_UNKNOWN_BANK_TYPE;
-			Nerrors++;
-			Nbad_events++;
-			return 0;
-			break;
+		// --i;  // This caused an infinite loop when reading hd_rawdata_020058_000.evio DL
+		return;
 	}
 
-	return Nswapped;
+	EVIOEventRecord er;
+	er.pos = pos;
+	CategorizeEvent(eh, er);
+	if(er.event_type == kBT_PHYSICS){
+		if(er.first_event < br.first_event) br.first_event = er.first_event;
+		if(er.last_event  > br.last_event ) br.last_event  = er.last_event;
+	}
+	
+	br.evio_events.push_back(er);
 }
 
 //---------------------------------
-// swap_tagsegment
+// IsMappedEvent
 //---------------------------------
-uint32_t HDEVIO::swap_tagsegment(uint32_t *outbuff, uint32_t *inbuff, uint32_t len)
+bool HDEVIO::IsMappedEvent(uint32_t event_len, uint32_t header)
 {
-	/// Swap an EVIO tagsegment. 
+	/// Return true if MapEvent would add a record to the file map
+	/// for an event with the given (already swapped) length and
+	/// header words. Events with fewer than 2 words after the length
+	/// word are left out unless they look like an empty BOR event and
+	/// IGNORE_EMPTY_BOR is set.
+
+	if(event_len >= 2) return true;
+	return IGNORE_EMPTY_BOR && event_len==1 && (header&0xFFFF00FF)==0x00700001;
+}
 
-	if(len < 1){
-		SetErrorMessage("Attempt to swap segment with len<1");
-		err_code = HDEVIO_BANK_TRUNCATED;
-		Nerrors++;
-		Nbad_events++;
-		return 0;
-	}
-	
-	// Swap header/length word
-	swap_block(inbuff, 1, outbuff);
-	uint32_t bank_len = outbuff[0] & 0xFFFF;
-	if((bank_len) > len){
-		ClearErrorMessage();
-		err_mess << "Segment length word exceeds valid words in buffer (" << bank_len << " > " << len << ")";
-		err_code = HDEVIO_BANK_TRUNCATED;
-		Nerrors++;
-		Nbad_events++;
-		return 0;
-	}
-	
-	uint32_t type = (outbuff[0]>>16) & 0x0F;
-	uint32_t Nwords = bank_len;
-	uint32_t Nswapped = 1;
-	switch(type){
-		case 0x0a:  // 64 bit unsigned int
-		case 0x08:  // 64 bit double
-		case 0x09:  // 64 bit signed int
-			swap_block((uint64_t*)&inbuff[1], Nwords/2, (uint64_t*)&outbuff[1]);
-			Nswapped += Nwords;
-			break;
-		case 0x01:  // 32 bit unsigned int
-		case 0x02:  // 32 bit float
-		case 0x0b:  // 32 bit signed int
-			swap_block(&inbuff[1], Nwords, &outbuff[1]);
-			Nswapped += Nwords;
-			break;
-		case 0x05:  // 16 bit unsigned int
-		case 0x04:  // 16 bit signed int
-			swap_block((uint16_t*)&inbuff[1], Nwords*2, (uint16_t*)&outbuff[1]);
-			Nswapped += Nwords;
-			break;
-		case 0x00:  // 32 bit unknown (not swapped)
-		case 0x07:  // 8 bit unsigned int
-		case 0x06:  // 8 bit signed int
-			memcpy((uint8_t*)&outbuff[1], (uint8_t*)&inbuff[1], Nwords*sizeof(uint32_t));
-			Nswapped += Nwords;
+//---------------------------------
+// CategorizeEvent
+//---------------------------------
+void HDEVIO::CategorizeEvent(EVENTHEADER_t &eh, EVIOEventRecord &er)
+{
+	/// Set the length, type, and event range of er using the
+	/// (already swapped) event header.
+
+	er.event_len   = eh.event_len + 1; // +1 to include length word
+	er.event_header= eh.header;
+	er.event_type  = kBT_UNKNOWN;
+	er.first_event = 0;
+	er.last_event  = 0;
+
+	uint32_t tag = eh.header>>16;
+	uint32_t M   = eh.header&0xFF;
+	
+	switch(tag){
+		case 0xFFD0: er.event_type = kBT_SYNC;       break;
+		case 0xFFD1: er.event_type = kBT_PRESTART;   break;
+		case 0xFFD2: er.event_type = kBT_GO;         break;
+		case 0xFFD3: er.event_type = kBT_PAUSE;      break;
+		case 0xFFD4: er.event_type = kBT_END;        break;
+		case 0x0060: er.event_type = kBT_EPICS;      break;
+		case 0x0070: er.event_type = kBT_BOR;        break;
+		case 0xFF50:
+		case 0xFF51:
+		case 0xFF70:
+			er.event_type = kBT_PHYSICS;
+			er.first_event  = eh.physics.first_event_lo;
+			er.first_event += ((uint64_t)eh.physics.first_event_hi)<<32;
+			er.last_event   = er.first_event + (uint64_t)M - 1;
 			break;
+		default:
+			if(VERBOSE>1) _DBG_ << "Uknown tag: " << hex << tag << dec << endl;
 	}
-
-	return Nswapped;
 }
 
 //---------------------------------
-// swap_segment
+// SetLastEventInfo
 //---------------------------------
-uint32_t HDEVIO::swap_segment(uint32_t *outbuff, uint32_t *inbuff, uint32_t len)
+void HDEVIO::SetLastEventInfo(const uint32_t *event, uint32_t len, bool swap)
 {
-	/// Swap an EVIO segment. 
+	/// Set last_event_type, last_first_event, and last_last_event
+	/// from the first few words of an event that has just been
+	/// read (and possibly not yet swapped).
+
+	EVENTHEADER_t eh;
+	memset(&eh, 0, sizeof(eh));
+	uint32_t nwords = sizeof(EVENTHEADER_t)/sizeof(uint32_t);
+	if(len < nwords) nwords = len;
+	memcpy(&eh, event, nwords*sizeof(uint32_t));
+	if(swap) swap_block((uint32_t*)&eh, nwords, (uint32_t*)&eh);
+
+	EVIOEventRecord er;
+	CategorizeEvent(eh, er);
+	last_event_type  = er.event_type;
+	last_first_event = er.first_event;
+	last_last_event  = er.last_event;
+}
 
-	if(len < 1){
-		SetErrorMessage("Attempt to swap segment with len<1");
-		err_code = HDEVIO_BANK_TRUNCATED;
-		Nerrors++;
-		Nbad_events++;
-		return 0;
-	}
-	
-	// Swap header/length word
-	swap_block(inbuff, 1, outbuff);
-	uint32_t bank_len = outbuff[0] & 0xFFFF;
-	if((bank_len) > len){
+//---------------------------------
+// swap_bank
+//---------------------------------
+uint32_t HDEVIO::swap_bank(uint32_t *outbuff, uint32_t *inbuff, uint32_t len)
+{
+	/// Swap an EVIO bank, including any banks, segments or tagsegments
+	/// it contains. The work is done by the bank walker in swap_bank.cc
+	/// which is shared with the event source. This just converts any
+	/// problem it reports into the HDEVIO error code/message.
+
+	int code;
+	string mess;
+	uint32_t Nswapped = ::swap_bank(outbuff, inbuff, len, code, mess);
+	if(code != SWAP_BANK_OK){
 		ClearErrorMessage();
-		err_mess << "Segment length word exceeds valid words in buffer (" << bank_len << " > " << len << ")";
-		err_code = HDEVIO_BANK_TRUNCATED;
+		err_mess << mess;
+		err_code = (code==SWAP_BANK_TRUNCATED) ? HDEVIO_BANK_TRUNCATED:HDEVIO_UNKNOWN_BANK_TYPE;
 		Nerrors++;
 		Nbad_events++;
-		return 0;
-	}
-	
-	uint32_t type = (outbuff[0]>>16) & 0x3F;
-	uint32_t Nwords = bank_len;
-	uint32_t Nswapped = 1;
-	switch(type){
-		case 0x0a:  // 64 bit unsigned int
-		case 0x08:  // 64 bit double
-		case 0x09:  // 64 bit signed int
-			swap_block((uint64_t*)&inbuff[1], Nwords/2, (uint64_t*)&outbuff[1]);
-			Nswapped += Nwords;
-			break;
-		case 0x01:  // 32 bit unsigned int
-		case 0x02:  // 32 bit float
-		case 0x0b:  // 32 bit signed int
-			swap_block(&inbuff[1], Nwords, &outbuff[1]);
-			Nswapped += Nwords;
-			break;
-		case 0x05:  // 16 bit unsigned int
-		case 0x04:  // 16 bit signed int
-			swap_block((uint16_t*)&inbuff[1], Nwords*2, (uint16_t*)&outbuff[1]);
-			Nswapped += Nwords;
-			break;
-		case 0x00:  // 32 bit unknown (not swapped)
-		case 0x07:  // 8 bit unsigned int
-		case 0x06:  // 8 bit signed int
-			if( inbuff!=outbuff ) memcpy((uint8_t*)&outbuff[1], (uint8_t*)&inbuff[1], Nwords*sizeof(uint32_t));
-			Nswapped += Nwords;
-			break;
 	}
 
 	return Nswapped;
@@ -1157,9 +2411,8 @@ void HDEVIO::PrintStats(void)
 	uint64_t Nevents = this->Nevents;
 	
 	if(is_mapped){
-		Nblocks = evio_blocks.size();
-		Nevents = 0;
-		for(auto b : evio_blocks) Nevents += b.evio_events.size();
+		Nblocks = filemap.Nblocks;
+		Nevents = filemap.Nevents;
 	}
 
 	cout << endl;
@@ -1194,23 +2447,25 @@ void HDEVIO::PrintFileSummary(void)
 	uint64_t first_event = 0;
 	uint64_t last_event  = 0;
 
-	uint32_t map_size = evio_blocks.size()*sizeof(EVIOBlockRecord);
+	// n.b. this is the size of the flat in-memory map
+	uint64_t map_size = sizeof(EVIOFileMap::BMAPHEADER_t);
+	map_size += filemap.Nblocks*(4*sizeof(uint64_t) + sizeof(uint32_t) + 2*sizeof(uint8_t));
+	map_size += filemap.Nevents*(3*sizeof(uint64_t) + 2*sizeof(uint32_t) + sizeof(uint8_t));
 	
 	set<uint32_t> block_levels;
 	set<uint32_t> events_in_block;
 
 	// Loop over all EVIO block records
-	for(uint32_t i=0; i<evio_blocks.size(); i++){
-		EVIOBlockRecord &br = evio_blocks[i];
-		events_in_block.insert(br.evio_events.size());
-		map_size += br.evio_events.size()*sizeof(EVIOEventRecord);
+	for(uint64_t i=0; i<filemap.Nblocks; i++){
+		events_in_block.insert(filemap.BlockNevents(i));
 
 		uint32_t Nunknown_prev = Nunknown;
-		for(uint32_t j=0; j<br.evio_events.size(); j++){
-			EVIOEventRecord &er = br.evio_events[j];
+		for(uint64_t j=filemap.block_event_start[i]; j<filemap.block_event_start[i+1]; j++){
+			uint64_t er_first_event = filemap.event_first_event[j];
+			uint64_t er_last_event  = filemap.event_last_event[j];
 			
 			uint32_t block_level;
-			switch(er.event_type){
+			switch(filemap.event_type[j]){
 				case kBT_UNKNOWN:    Nunknown++;     break;
 				case kBT_SYNC:       Nsync++;        break;
 				case kBT_PRESTART:   Nprestart++;    break;
@@ -1220,11 +2475,11 @@ void HDEVIO::PrintFileSummary(void)
 				case kBT_EPICS:      Nepics++;       break;
 				case kBT_BOR:        Nbor++;         break;
 				case kBT_PHYSICS:
-					block_level = (uint32_t)((er.last_event - er.first_event) + 1);
+					block_level = (uint32_t)((er_last_event - er_first_event) + 1);
 					block_levels.insert(block_level);
 					Nphysics += block_level;
-					if(er.first_event<first_event || first_event==0) first_event = er.first_event;
-					if(er.last_event>last_event) last_event = er.last_event;
+					if(er_first_event<first_event || first_event==0) first_event = er_first_event;
+					if(er_last_event>last_event) last_event = er_last_event;
 					break;
 				default:
 					break;
@@ -1294,11 +2549,26 @@ void HDEVIO::PrintFileSummary(void)
 //------------------------
 void HDEVIO::SaveFileMap(string fname)
 {
+	/// Write the file map. By default, this is written in binary
+	/// format to filename + ".bmap". If fname ends in ".map" then
+	/// the older text format is written instead.
+
 	// Make sure file has been mapped
 	if(!is_mapped) MapBlocks();
 	
+	// Binary map
+	if(fname=="") fname = filename + ".bmap";
+	if(fname.length()<4 || fname.substr(fname.length()-4)!=".map"){
+		cout << "Writing EVIO file map to: " << fname << endl;
+		if( !filemap.WriteBinary(fname, total_size_bytes, swap_needed) ){
+			cerr << "Unable to write \""<<fname<<"\"!" << endl;
+			return;
+		}
+		cout << "Done" << endl;
+		return;
+	}
+	
 	// Open output file
-	if(fname=="") fname = filename + ".map";
 	ofstream ofs(fname.c_str());
 	if(!ofs.is_open()){
 		cerr << "Unable to open \""<<fname<<"\" for writing!" << endl;
@@ -1323,13 +2593,13 @@ void HDEVIO::SaveFileMap(string fname)
 	ofs << "#  pos    block_len  first_evt last_evt block_type" << endl;
 	ofs << "#  + pos    evt_len  evt_header first_evt last_evt event_type" << endl;
 
-	for(auto br : evio_blocks){
+	for(uint64_t i=0; i<filemap.Nblocks; i++){
 		char line[512];
-		sprintf(line, "0x%08x 0x%06x  %8" PRIu64 "  %8" PRIu64 "     %d", (uint32_t)br.pos, br.block_len, br.first_event, br.last_event, br.block_type);
+		sprintf(line, "0x%08" PRIx64 " 0x%06x  %8" PRIu64 "  %8" PRIu64 "     %d", filemap.block_pos[i], filemap.block_len[i], filemap.block_first_event[i], filemap.block_last_event[i], filemap.block_type[i]);
 		ofs << line << endl;
 		
-		for(auto er : br.evio_events){
-			sprintf(line, "+ 0x%08x 0x%06x 0x%08x %8" PRIu64 " %8" PRIu64 " %d", (uint32_t)er.pos, er.event_len, er.event_header, er.first_event, er.last_event, er.event_type);
+		for(uint64_t j=filemap.block_event_start[i]; j<filemap.block_event_start[i+1]; j++){
+			sprintf(line, "+ 0x%08" PRIx64 " 0x%06x 0x%08x %8" PRIu64 " %8" PRIu64 " %d", filemap.event_pos[j], filemap.event_len[j], filemap.event_header[j], filemap.event_first_event[j], filemap.event_last_event[j], filemap.event_type[j]);
 			ofs << line << endl;
 		}
 	}
@@ -1359,13 +2629,14 @@ void HDEVIO::ReadFileMap(string fname, bool warn_if_not_found)
 			bname = filename.substr(pos+1, filename.size()-pos);
 		}
 
+		// n.b. binary maps are preferred since they load much faster
 		vector<string> fnames;
-		fnames.push_back(filename + ".map");
-		fnames.push_back(dname + "/filemaps/" + bname + ".map");
-		fnames.push_back(bname + ".map");
 		fnames.push_back(filename + ".bmap");
 		fnames.push_back(dname + "/filemaps/" + bname + ".bmap");
 		fnames.push_back(bname + ".bmap");
+		fnames.push_back(filename + ".map");
+		fnames.push_back(dname + "/filemaps/" + bname + ".map");
+		fnames.push_back(bname + ".map");
 		
 		// Loop over possible names until we find one that is readable
 		for(string f : fnames){
@@ -1382,6 +2653,20 @@ void HDEVIO::ReadFileMap(string fname, bool warn_if_not_found)
 	
 	if(fname=="") return;
 	
+	// Binary map files are used in place via mmap
+	if( EVIOFileMap::IsBinaryMapFile(fname) ){
+		string err;
+		if( !filemap.ReadBinary(fname, total_size_bytes, VERIFY_MAP_CHECKSUM, err) ){
+			cerr << "Found map file \"" << fname << "\" but " << err << ". Ignoring." << endl;
+			return;
+		}
+		sparse_block_idx = 0;
+		sparse_event_idx = 0;
+		is_mapped = true;
+		cout << "Read EVIO file map from: " << fname << endl;
+		return;
+	}
+	
 	// Open map file
 	ifstream ifs(fname.c_str());
 	if(!ifs.is_open()){
@@ -1416,6 +2701,7 @@ void HDEVIO::ReadFileMap(string fname, bool warn_if_not_found)
 	}
 	
 	// Loop over body
+	filemap.Clear();
 	EVIOBlockRecord br;
 	bool first_block_found = false;
 	string s;
@@ -1442,7 +2728,7 @@ void HDEVIO::ReadFileMap(string fname, bool warn_if_not_found)
 		}else{
 			// EVIO Block Record
 			if(first_block_found){
-				evio_blocks.push_back(br);
+				filemap.AddBlock(br);
 			}else{
 				first_block_found = true;
 			}
@@ -1457,9 +2743,372 @@ void HDEVIO::ReadFileMap(string fname, bool warn_if_not_found)
 			ss >> tmp64; br.block_type = (BLOCKTYPE)tmp64; // operator>> won't stream directly to BLOCKTYPE
 		}
 	}
-	if(!br.evio_events.empty()) evio_blocks.push_back(br);
+	if(!br.evio_events.empty()) filemap.AddBlock(br);
 	
+	sparse_block_idx = 0;
+	sparse_event_idx = 0;
 	is_mapped = true;
 	cout << "Read EVIO file map from: " << fname << endl;
 }
 
+//------------------------
+// EVIOFileMap::Clear
+//------------------------
+void HDEVIO::EVIOFileMap::Clear(void)
+{
+	region.reset();
+	v_block_pos.clear();
+	v_block_first_event.clear();
+	v_block_last_event.clear();
+	v_block_event_start.assign(1, 0);
+	v_event_pos.clear();
+	v_event_first_event.clear();
+	v_event_last_event.clear();
+	v_block_len.clear();
+	v_event_len.clear();
+	v_event_header.clear();
+	v_block_type.clear();
+	v_block_swap_needed.clear();
+	v_event_type.clear();
+	SetPointersToVectors();
+}
+
+//------------------------
+// EVIOFileMap::SetPointersToVectors
+//------------------------
+void HDEVIO::EVIOFileMap::SetPointersToVectors(void)
+{
+	Nblocks           = v_block_pos.size();
+	Nevents           = v_event_pos.size();
+	block_pos         = v_block_pos.data();
+	block_first_event = v_block_first_event.data();
+	block_last_event  = v_block_last_event.data();
+	block_event_start = v_block_event_start.data();
+	event_pos         = v_event_pos.data();
+	event_first_event = v_event_first_event.data();
+	event_last_event  = v_event_last_event.data();
+	block_len         = v_block_len.data();
+	event_len         = v_event_len.data();
+	event_header      = v_event_header.data();
+	block_type        = v_block_type.data();
+	block_swap_needed = v_block_swap_needed.data();
+	event_type        = v_event_type.data();
+}
+
+//------------------------
+// EVIOFileMap::Detach
+//------------------------
+void HDEVIO::EVIOFileMap::Detach(void)
+{
+	/// Copy columns out of a memory mapped map file into our
+	/// own vectors so they can be modified.
+
+	if(!region) return;
+	
+	v_block_pos.assign(block_pos, block_pos+Nblocks);
+	v_block_first_event.assign(block_first_event, block_first_event+Nblocks);
+	v_block_last_event.assign(block_last_event, block_last_event+Nblocks);
+	v_block_event_start.assign(block_event_start, block_event_start+Nblocks+1);
+	v_event_pos.assign(event_pos, event_pos+Nevents);
+	v_event_first_event.assign(event_first_event, event_first_event+Nevents);
+	v_event_last_event.assign(event_last_event, event_last_event+Nevents);
+	v_block_len.assign(block_len, block_len+Nblocks);
+	v_event_len.assign(event_len, event_len+Nevents);
+	v_event_header.assign(event_header, event_header+Nevents);
+	v_block_type.assign(block_type, block_type+Nblocks);
+	v_block_swap_needed.assign(block_swap_needed, block_swap_needed+Nblocks);
+	v_event_type.assign(event_type, event_type+Nevents);
+	region.reset();
+	SetPointersToVectors();
+}
+
+//------------------------
+// EVIOFileMap::Share
+//------------------------
+void HDEVIO::EVIOFileMap::Share(const EVIOFileMap &src)
+{
+	/// Point our columns at those of src without copying them. If
+	/// src owns its columns then region is set to a non-owning
+	/// handle so that we are still treated as read-only (i.e.
+	/// AddBlock will copy the columns first).
+
+	Clear();
+	Nblocks           = src.Nblocks;
+	Nevents           = src.Nevents;
+	block_pos         = src.block_pos;
+	block_first_event = src.block_first_event;
+	block_last_event  = src.block_last_event;
+	block_event_start = src.block_event_start;
+	event_pos         = src.event_pos;
+	event_first_event = src.event_first_event;
+	event_last_event  = src.event_last_event;
+	block_len         = src.block_len;
+	event_len         = src.event_len;
+	event_header      = src.event_header;
+	block_type        = src.block_type;
+	block_swap_needed = src.block_swap_needed;
+	event_type        = src.event_type;
+	region = src.region ? src.region:shared_ptr<const void>(src.block_event_start, [](const void*){});
+}
+
+//------------------------
+// EVIOFileMap::AddBlock
+//------------------------
+void HDEVIO::EVIOFileMap::AddBlock(const EVIOBlockRecord &br)
+{
+	if(region) Detach();
+
+	v_block_pos.push_back((uint64_t)br.pos);
+	v_block_first_event.push_back(br.first_event);
+	v_block_last_event.push_back(br.last_event);
+	v_block_len.push_back(br.block_len);
+	v_block_type.push_back((uint8_t)br.block_type);
+	v_block_swap_needed.push_back(br.swap_needed ? 1:0);
+	
+	for(auto &er : br.evio_events){
+		v_event_pos.push_back((uint64_t)er.pos);
+		v_event_first_event.push_back(er.first_event);
+		v_event_last_event.push_back(er.last_event);
+		v_event_len.push_back(er.event_len);
+		v_event_header.push_back(er.event_header);
+		v_event_type.push_back((uint8_t)er.event_type);
+	}
+	v_block_event_start.push_back(v_event_pos.size());
+
+	SetPointersToVectors();
+}
+
+//------------------------
+// EVIOFileMap::GetBlockRecord
+//------------------------
+void HDEVIO::EVIOFileMap::GetBlockRecord(uint64_t iblock, EVIOBlockRecord &br) const
+{
+	br.pos         = (streamoff)block_pos[iblock];
+	br.block_len   = block_len[iblock];
+	br.swap_needed = block_swap_needed[iblock]!=0;
+	br.first_event = block_first_event[iblock];
+	br.last_event  = block_last_event[iblock];
+	br.block_type  = (BLOCKTYPE)block_type[iblock];
+	
+	br.evio_events.resize(BlockNevents(iblock));
+	uint64_t j = block_event_start[iblock];
+	for(auto &er : br.evio_events){
+		er.pos          = (streamoff)event_pos[j];
+		er.event_len    = event_len[j];
+		er.event_header = event_header[j];
+		er.first_event  = event_first_event[j];
+		er.last_event   = event_last_event[j];
+		er.event_type   = (BLOCKTYPE)event_type[j];
+		j++;
+	}
+}
+
+//------------------------
+// EVIOFileMap::Checksum
+//------------------------
+uint64_t HDEVIO::EVIOFileMap::Checksum(const void *ptr, uint64_t nbytes)
+{
+	/// FNV-1a style hash taken 8 bytes at a time (plus any
+	/// trailing bytes). This is only used to detect corrupt
+	/// or truncated binary map files.
+
+	const uint8_t *p = (const uint8_t*)ptr;
+	uint64_t h = 0xcbf29ce484222325ULL;
+	uint64_t Nwords = nbytes/8;
+	for(uint64_t i=0; i<Nwords; i++, p+=8){
+		uint64_t w;
+		memcpy(&w, p, 8);
+		h = (h ^ w) * 0x100000001b3ULL;
+	}
+	for(uint64_t i=Nwords*8; i<nbytes; i++, p++) h = (h ^ *p) * 0x100000001b3ULL;
+	
+	return h;
+}
+
+//------------------------
+// EVIOFileMap::IsBinaryMapFile
+//------------------------
+bool HDEVIO::EVIOFileMap::IsBinaryMapFile(string fname)
+{
+	ifstream ifs(fname.c_str(), ios::binary);
+	char magic[8] = {0};
+	ifs.read(magic, 8);
+	return ifs.good() && memcmp(magic, "HDEVMAP", 8)==0;
+}
+
+//------------------------
+// EVIOFileMap::WriteBinary
+//------------------------
+bool HDEVIO::EVIOFileMap::WriteBinary(string fname, uint64_t evio_file_size, bool swap_needed) const
+{
+	/// Write map in binary format. The file is written under a
+	/// temporary name and then renamed so a partially written map
+	/// is never picked up by ReadFileMap.
+
+	// Columns in the order they appear in the file
+	vector< pair<const void*, uint64_t> > cols = {
+		{block_pos,         Nblocks*sizeof(uint64_t)},
+		{block_first_event, Nblocks*sizeof(uint64_t)},
+		{block_last_event,  Nblocks*sizeof(uint64_t)},
+		{block_event_start, (Nblocks+1)*sizeof(uint64_t)},
+		{event_pos,         Nevents*sizeof(uint64_t)},
+		{event_first_event, Nevents*sizeof(uint64_t)},
+		{event_last_event,  Nevents*sizeof(uint64_t)},
+		{block_len,         Nblocks*sizeof(uint32_t)},
+		{event_len,         Nevents*sizeof(uint32_t)},
+		{event_header,      Nevents*sizeof(uint32_t)},
+		{block_type,        Nblocks*sizeof(uint8_t)},
+		{block_swap_needed, Nblocks*sizeof(uint8_t)},
+		{event_type,        Nevents*sizeof(uint8_t)}
+	};
+	
+	vector<uint64_t> col_checksums;
+	for(auto &c : cols) col_checksums.push_back( Checksum(c.first, c.second) );
+
+	BMAPHEADER_t hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, "HDEVMAP", 8);
+	hdr.version         = BMAP_VERSION;
+	hdr.header_len      = sizeof(hdr);
+	hdr.byte_order      = 0x01020304;
+	hdr.swap_needed     = swap_needed ? 1:0;
+	hdr.Nblocks         = Nblocks;
+	hdr.Nevents         = Nevents;
+	hdr.evio_file_size  = evio_file_size;
+	hdr.table_checksum  = Checksum(col_checksums.data(), col_checksums.size()*sizeof(uint64_t));
+	hdr.header_checksum = Checksum(&hdr, (uint64_t)((char*)&hdr.header_checksum - (char*)&hdr));
+	
+	string tmpname = fname + ".tmp";
+	ofstream ofs(tmpname.c_str(), ios::binary);
+	if(!ofs.is_open()) return false;
+	ofs.write((const char*)&hdr, sizeof(hdr));
+	for(auto &c : cols) if(c.second) ofs.write((const char*)c.first, c.second);
+	ofs.close();
+	if(!ofs.good() || rename(tmpname.c_str(), fname.c_str())!=0){
+		unlink(tmpname.c_str());
+		return false;
+	}
+	
+	return true;
+}
+
+//------------------------
+// EVIOFileMap::ReadBinary
+//------------------------
+bool HDEVIO::EVIOFileMap::ReadBinary(string fname, uint64_t evio_file_size, bool verify_checksum, string &err)
+{
+	/// Memory map a binary map file and point the columns directly
+	/// into it. Only the header is checked unless verify_checksum
+	/// is true so this takes the same time regardless of map size.
+	/// The file size must match exactly what the header says it
+	/// should be which catches truncated files. If evio_file_size is
+	/// non-zero it must also match what was recorded in the header.
+	/// On failure, err is set and false is returned.
+
+	int fd = open(fname.c_str(), O_RDONLY);
+	if(fd < 0){
+		err = "it could not be opened";
+		return false;
+	}
+	struct stat st;
+	if(fstat(fd, &st)!=0 || st.st_size < (off_t)sizeof(BMAPHEADER_t)){
+		close(fd);
+		err = "it is too small";
+		return false;
+	}
+	size_t len = (size_t)st.st_size;
+	void *addr = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(addr == MAP_FAILED){
+		err = "it could not be mapped";
+		return false;
+	}
+	shared_ptr<const void> myregion(addr, [len](const void *p){ munmap((void*)p, len); });
+	
+	const BMAPHEADER_t *hdr = (const BMAPHEADER_t*)addr;
+	if( memcmp(hdr->magic, "HDEVMAP", 8)!=0 ){ err = "it has a bad magic word"; return false; }
+	if( hdr->byte_order != 0x01020304 ){ err = "it was written with a different byte order"; return false; }
+	if( hdr->version != BMAP_VERSION ){ err = "it has an unsupported version"; return false; }
+	if( hdr->header_len != sizeof(BMAPHEADER_t) ){ err = "it has a bad header length"; return false; }
+	if( hdr->header_checksum != Checksum(hdr, (uint64_t)((char*)&hdr->header_checksum - (char*)hdr)) ){
+		err = "its header checksum is bad";
+		return false;
+	}
+	if( evio_file_size!=0 && hdr->evio_file_size!=evio_file_size ){
+		err = "it was made for a file of a different size";
+		return false;
+	}
+	
+	uint64_t nb = hdr->Nblocks;
+	uint64_t ne = hdr->Nevents;
+	uint64_t expected_len = sizeof(BMAPHEADER_t) + (4*nb + 1 + 3*ne)*sizeof(uint64_t) + (nb + 2*ne)*sizeof(uint32_t) + (2*nb + ne)*sizeof(uint8_t);
+	if( expected_len != (uint64_t)len ){
+		err = "it is the wrong size (truncated?)";
+		return false;
+	}
+	
+	// Point columns into mapped file
+	const uint8_t *p = (const uint8_t*)addr + sizeof(BMAPHEADER_t);
+	auto next = [&p](uint64_t nbytes){ const uint8_t *q = p; p += nbytes; return q; };
+	const uint64_t *my_block_pos         = (const uint64_t*)next(nb*sizeof(uint64_t));
+	const uint64_t *my_block_first_event = (const uint64_t*)next(nb*sizeof(uint64_t));
+	const uint64_t *my_block_last_event  = (const uint64_t*)next(nb*sizeof(uint64_t));
+	const uint64_t *my_block_event_start = (const uint64_t*)next((nb+1)*sizeof(uint64_t));
+	const uint64_t *my_event_pos         = (const uint64_t*)next(ne*sizeof(uint64_t));
+	const uint64_t *my_event_first_event = (const uint64_t*)next(ne*sizeof(uint64_t));
+	const uint64_t *my_event_last_event  = (const uint64_t*)next(ne*sizeof(uint64_t));
+	const uint32_t *my_block_len         = (const uint32_t*)next(nb*sizeof(uint32_t));
+	const uint32_t *my_event_len         = (const uint32_t*)next(ne*sizeof(uint32_t));
+	const uint32_t *my_event_header      = (const uint32_t*)next(ne*sizeof(uint32_t));
+	const uint8_t  *my_block_type        = next(nb*sizeof(uint8_t));
+	const uint8_t  *my_block_swap_needed = next(nb*sizeof(uint8_t));
+	const uint8_t  *my_event_type        = next(ne*sizeof(uint8_t));
+	
+	if( my_block_event_start[0]!=0 || my_block_event_start[nb]!=ne ){
+		err = "its block table is inconsistent";
+		return false;
+	}
+	
+	if(verify_checksum){
+		vector<uint64_t> col_checksums = {
+			Checksum(my_block_pos,         nb*sizeof(uint64_t)),
+			Checksum(my_block_first_event, nb*sizeof(uint64_t)),
+			Checksum(my_block_last_event,  nb*sizeof(uint64_t)),
+			Checksum(my_block_event_start, (nb+1)*sizeof(uint64_t)),
+			Checksum(my_event_pos,         ne*sizeof(uint64_t)),
+			Checksum(my_event_first_event, ne*sizeof(uint64_t)),
+			Checksum(my_event_last_event,  ne*sizeof(uint64_t)),
+			Checksum(my_block_len,         nb*sizeof(uint32_t)),
+			Checksum(my_event_len,         ne*sizeof(uint32_t)),
+			Checksum(my_event_header,      ne*sizeof(uint32_t)),
+			Checksum(my_block_type,        nb*sizeof(uint8_t)),
+			Checksum(my_block_swap_needed, nb*sizeof(uint8_t)),
+			Checksum(my_event_type,        ne*sizeof(uint8_t))
+		};
+		if( hdr->table_checksum != Checksum(col_checksums.data(), col_checksums.size()*sizeof(uint64_t)) ){
+			err = "its table checksum is bad";
+			return false;
+		}
+	}
+	
+	// Everything checks out. Replace current contents with mapped file.
+	Clear();
+	region            = myregion;
+	Nblocks           = nb;
+	Nevents           = ne;
+	block_pos         = my_block_pos;
+	block_first_event = my_block_first_event;
+	block_last_event  = my_block_last_event;
+	block_event_start = my_block_event_start;
+	event_pos         = my_event_pos;
+	event_first_event = my_event_first_event;
+	event_last_event  = my_event_last_event;
+	block_len         = my_block_len;
+	event_len         = my_event_len;
+	event_header      = my_event_header;
+	block_type        = my_block_type;
+	block_swap_needed = my_block_swap_needed;
+	event_type        = my_event_type;
+	
+	return true;
+}
@@ -21,6 +21,13 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <memory>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <swap_block.h>
 using namespace std;
 
 // ----- Stolen from evio.h -----------
@@ -62,6 +69,22 @@ class HDEVIO{
 			HDEVIO_UNKNOWN_BANK_TYPE
 		}ERRORCODE_t;
 		
+		// Ways of reading a file. See ChooseReadMode for how kREAD_AUTO
+		// picks one of the others.
+		//  kREAD_STREAM - read (large buffered reads, no backward seeks)
+		//  kREAD_EVENT  - readNoFileBuff (one block at a time)
+		//  kREAD_SPARSE - readSparse (seek to each event using the map)
+		//  kREAD_MMAP   - readMapped (zero-copy from memory mapped file)
+		//  kREAD_ASYNC  - readPrefetched (zero-copy from prefetched blocks)
+		enum READMODE{
+			kREAD_AUTO,
+			kREAD_STREAM,
+			kREAD_EVENT,
+			kREAD_SPARSE,
+			kREAD_MMAP,
+			kREAD_ASYNC
+		};
+
 		enum BLOCKTYPE{
 			kBT_UNKNOWN,
 			kBT_BOR,
@@ -152,6 +175,100 @@ class HDEVIO{
 				BLOCKTYPE block_type;
 		};
 
+		// Descriptor for one piece of a file to be processed by a separate
+		// job (see MakeShards). Blocks first_block up to, but not including,
+		// end_block of the file map. bor_event is the index in the event
+		// table of the BOR event that must be read first (or -1 if none).
+		class ShardInfo{
+			public:
+				uint32_t index;
+				uint32_t Nshards;
+				uint64_t first_block;
+				uint64_t end_block;
+				uint64_t first_pos;
+				uint64_t end_pos;
+				uint64_t first_event;
+				uint64_t last_event;
+				int64_t  bor_event;
+				uint64_t bor_pos;
+		};
+
+		// Flat (structure-of-arrays) map of all blocks and events in
+		// a file. The columns are either owned by this object or point
+		// directly into a memory mapped binary map file (.bmap) so that
+		// large maps can be used in place without parsing them.
+		// Events of block i are at indices block_event_start[i] up to,
+		// but not including, block_event_start[i+1].
+		class EVIOFileMap{
+			public:
+				EVIOFileMap(){ Clear(); }
+				
+				// Binary map file header. Columns follow this directly
+				// in the order they are declared below, 64 bit columns
+				// first so everything stays naturally aligned.
+				typedef struct{
+					char     magic[8];         // "HDEVMAP" (including terminating null)
+					uint32_t version;          // BMAP_VERSION
+					uint32_t header_len;       // sizeof(BMAPHEADER_t) in bytes
+					uint32_t byte_order;       // 0x01020304 in writer's byte order
+					uint32_t swap_needed;      // swap_needed of EVIO file when map was written
+					uint64_t Nblocks;
+					uint64_t Nevents;
+					uint64_t evio_file_size;   // size in bytes of EVIO file this map describes
+					uint64_t table_checksum;   // checksum of all column data
+					uint64_t header_checksum;  // checksum of all preceding header words
+				}BMAPHEADER_t;
+				enum{ BMAP_VERSION = 1 };
+				
+				uint64_t Nblocks;
+				uint64_t Nevents;
+				
+				const uint64_t *block_pos;
+				const uint64_t *block_first_event;
+				const uint64_t *block_last_event;
+				const uint64_t *block_event_start; // Nblocks+1 entries
+				const uint64_t *event_pos;
+				const uint64_t *event_first_event;
+				const uint64_t *event_last_event;
+				const uint32_t *block_len;
+				const uint32_t *event_len;
+				const uint32_t *event_header;
+				const uint8_t  *block_type;
+				const uint8_t  *block_swap_needed;
+				const uint8_t  *event_type;
+				
+				void Clear(void);
+				void Share(const EVIOFileMap &src);
+				void AddBlock(const EVIOBlockRecord &br);
+				void GetBlockRecord(uint64_t iblock, EVIOBlockRecord &br) const;
+				uint64_t BlockNevents(uint64_t iblock) const { return block_event_start[iblock+1] - block_event_start[iblock]; }
+				bool IsFileBacked(void) const { return region != nullptr; }
+				
+				bool WriteBinary(string fname, uint64_t evio_file_size, bool swap_needed) const;
+				bool ReadBinary(string fname, uint64_t evio_file_size, bool verify_checksum, string &err);
+				static bool IsBinaryMapFile(string fname);
+				static uint64_t Checksum(const void *ptr, uint64_t nbytes);
+			
+			protected:
+				shared_ptr<const void> region; // set if columns point into a mapped .bmap file
+				vector<uint64_t> v_block_pos;
+				vector<uint64_t> v_block_first_event;
+				vector<uint64_t> v_block_last_event;
+				vector<uint64_t> v_block_event_start;
+				vector<uint64_t> v_event_pos;
+				vector<uint64_t> v_event_first_event;
+				vector<uint64_t> v_event_last_event;
+				vector<uint32_t> v_block_len;
+				vector<uint32_t> v_event_len;
+				vector<uint32_t> v_event_header;
+				vector<uint8_t>  v_block_type;
+				vector<uint8_t>  v_block_swap_needed;
+				vector<uint8_t>  v_event_type;
+				
+				void Detach(void);
+				void SetPointersToVectors(void);
+		};
+
 		string filename;
 		ifstream ifs;
 		bool is_open;
@@ -174,10 +291,19 @@ class HDEVIO{
 		streampos last_event_pos; // used to hold file position at last event read in
 		uint32_t last_event_len;  // used to hold last event length in words if user buffer was
 		                          // too small, this is how big is should be allocated
+		BLOCKTYPE last_event_type;  // type of last event read
+		uint64_t last_first_event;  // first L1 event number in last event read (physics events only)
+		uint64_t last_last_event;   // last L1 event number in last event read (physics events only)
 		
 		int  VERBOSE;
 		bool IGNORE_EMPTY_BOR;
 		bool SKIP_EVENT_MAPPING;
+		bool VERIFY_MAP_CHECKSUM; // check table checksum when reading a binary map (O(map size))
+		uint64_t MAP_BUFFER_SIZE; // size in bytes of chunks read when mapping the file in MapBlocks
+		string SAVE_MAP_FILE;     // if set, the map built while reading (or by MapBlocks) is written here (see AddToBuiltMap)
+		uint32_t PREFETCH_NTHREADS; // number of threads reading blocks for readPrefetched
+		uint32_t PREFETCH_DEPTH;    // max. number of blocks in flight or waiting for readPrefetched
+		READMODE read_mode;         // set by SetReadMode
 		
 		stringstream err_mess;  // last error message
 		uint32_t err_code;    // last error code
@@ -192,11 +318,27 @@ class HDEVIO{
 		bool read(uint32_t *user_buff, uint32_t user_buff_len, bool allow_swap=true);
 		bool readSparse(uint32_t *user_buff, uint32_t user_buff_len, bool allow_swap=true);
 		bool readNoFileBuff(uint32_t *user_buff, uint32_t user_buff_len, bool allow_swap=true);
+		bool readEvent(uint64_t ievent, uint32_t *user_buff, uint32_t user_buff_len, bool allow_swap=true);
+		bool readMapped(const uint32_t* &event_ptr, uint32_t &event_len, shared_ptr<const void> &region);
+		bool readPrefetched(const uint32_t* &event_ptr, uint32_t &event_len, shared_ptr<const void> &region);
+		void StartPrefetch(void);
+		void StopPrefetch(void);
+		READMODE ChooseReadMode(void);
+		void SetReadMode(READMODE mode);
+		static READMODE ReadModeFromString(string mode_str);
+		static string ReadModeName(READMODE mode);
 		void rewind(void);
+		bool SeekToEvent(uint64_t event_number, vector<uint64_t> *state_events=NULL);
+		void ShareFileMap(HDEVIO &src);
+		void SetBlockRange(uint64_t first_block, uint64_t end_block);
+		void SplitBlocks(uint64_t first_block, uint64_t end_block, uint32_t N, vector<uint64_t> &boundaries);
+		void MakeShards(uint32_t Nshards, vector<ShardInfo> &shards);
+		bool WriteShardFile(string fname, uint32_t Nshards);
+		bool ReadShardFile(string fname, uint32_t ishard, ShardInfo &shard);
+		bool SetShard(const ShardInfo &shard, vector<uint64_t> *state_events=NULL);
+		uint64_t FindEventNumber(uint64_t start_event, uint64_t nskip);
 
 		uint32_t swap_bank(uint32_t *outbuff, uint32_t *inbuff, uint32_t len);
-		uint32_t swap_tagsegment(uint32_t *outbuff, uint32_t *inbuff, uint32_t len);
-		uint32_t swap_segment(uint32_t *outbuff, uint32_t *inbuff, uint32_t len);
 		void Print_fbuff(void);
 		void PrintEVIOBlockHeader(void);
 		void PrintStats(void);
@@ -209,6 +351,7 @@ class HDEVIO{
 		uint32_t SetEventMask(string types_str);
 		uint32_t AddToEventMask(string type_str);
 		vector<EVIOBlockRecord>& GetEVIOBlockRecords(void);
+		const EVIOFileMap& GetFileMap(void);
 		
 	protected:
 	
@@ -216,13 +359,98 @@ class HDEVIO{
 
 		bool is_mapped;
 		uint64_t total_size_bytes;
-		vector<EVIOBlockRecord> evio_blocks;
+		EVIOFileMap filemap;
+		vector<EVIOBlockRecord> evio_blocks; // filled from filemap only if GetEVIOBlockRecords is called
 		void MapBlocks(bool print_ticker=true);
 		void MapEvents(BLOCKHEADER_t &bh, EVIOBlockRecord &br);
-		vector<EVIOBlockRecord>::iterator sparse_block_iter;
-		uint32_t sparse_event_idx;
+		void MapEvent(EVENTHEADER_t &eh, streampos pos, EVIOBlockRecord &br);
+		void CategorizeBlock(BLOCKHEADER_t &bh, EVIOBlockRecord &br);
+		void CategorizeEvent(EVENTHEADER_t &eh, EVIOEventRecord &er);
+		bool IsMappedEvent(uint32_t event_len, uint32_t header);
+		void SetLastEventInfo(const uint32_t *event, uint32_t len, bool swap);
+
+		// Random access (see SeekToEvent). phys_index holds event table
+		// indices of physics events sorted by event number and state_index
+		// those of BOR and EPICS events in file order. Seeks for
+		// read, readMapped, and readPrefetched are applied on their next
+		// call using seek_block and seek_nskip.
+		void BuildEventIndex(void);
+		void SeekToBlockEvent(uint64_t iblock, uint64_t ievent_in_block);
+		void FindStateEvents(uint64_t ievent_start, uint64_t ievent_end, vector<uint64_t> &ievents);
+		vector<uint64_t> phys_index;
+		vector<uint64_t> state_index;
+		uint64_t index_Nevents;
+		uint64_t seek_block;
+		uint64_t seek_nskip;
+		bool seek_pending_read;
+		bool seek_pending_mapped;
+		bool seek_pending_prefetch;
+		uint64_t range_first_block; // (see SetBlockRange)
+		uint64_t range_end_block;
+		uint64_t range_end_pos;     // file position of range_end_block in bytes
+		uint64_t sparse_block_idx;
+		uint64_t sparse_event_idx;
 		EVIOBlockRecord NB_block_record;
 		streampos NB_next_pos;
+		uint64_t stream_next_pos;   // file position of next block read by ReadBlock
+
+		// Map built while reading for SAVE_MAP_FILE (see AddToBuiltMap)
+		bool EndOfFile(void);
+		void MapBlockInMemory(const uint32_t *block, uint64_t pos, bool swap_needed);
+		void AddToBuiltMap(const EVIOBlockRecord &br);
+		bool building_map;
+		uint64_t building_map_next_pos; // file position the next block must have for the map to be complete
+
+		// Memory-mapped (zero-copy) reading. The mapping is owned by
+		// mm_region which is shared with every event handed out by
+		// readMapped so it stays valid until the last one is released.
+		bool OpenMapped(void);
+		shared_ptr<const void> mm_region;
+		const uint32_t *mm_buff;        // start of mapped file
+		const uint32_t *mm_end;         // word just past end of mapped file
+		const uint32_t *mm_next_block;  // start of next EVIO block header
+
+		// Cursor into the current in-memory block for readMapped and
+		// readPrefetched. mm_block_region owns the block's memory.
+		bool NextBlockEvent(const uint32_t* &event_ptr, uint32_t &event_len, shared_ptr<const void> &region);
+		void SkipBlockEvents(uint64_t nskip);
+		void SkipUnmappedEvents(void);
+		shared_ptr<const void> mm_block_region;
+		const uint32_t *mm_block_start; // start of current block header
+		const uint32_t *mm_next_event;  // start of next EVIO event in current block
+		const uint32_t *mm_block_end;   // word just past end of current block
+		uint64_t mm_block_pos;          // file position of current block in bytes
+		uint32_t mm_events_left;        // events remaining in current block
+		bool mm_swap_needed;            // swap flag for current block
+
+		// Asynchronous block prefetching for readPrefetched. Worker threads
+		// pread whole blocks into their own buffers and place them in
+		// pf_ready keyed by block index so they are consumed in file order.
+		class PrefetchBlock{
+			public:
+				uint64_t pos;                // file position in bytes
+				uint32_t len;                // block length in words
+				shared_ptr<uint32_t> data;   // entire block including header
+				uint32_t err_code;
+				string err_mess;
+		};
+		void PrefetchThread(void);
+		bool PrefetchLocateBlock(PrefetchBlock &pb);
+		int pf_fd;
+		int hint_fd;                      // used for posix_fadvise and by readEvent in kREAD_SPARSE mode (see SetReadMode)
+		vector<thread> pf_threads;
+		mutex pf_mutex;
+		condition_variable pf_cv_space;   // signaled when consumer frees a slot
+		condition_variable pf_cv_ready;   // signaled when a block is ready
+		map<uint64_t, PrefetchBlock> pf_ready;
+		uint64_t pf_next_idx;             // index of next block to be claimed by a worker
+		uint64_t pf_next_consume;         // index of next block readPrefetched will use
+		uint64_t pf_next_pos;             // file position of next block to be claimed
+		uint64_t pf_skip_events;          // events to skip in first block (set by SeekToEvent)
+		bool pf_quit;
+		bool pf_scan_done;                // true once a worker has reached EOF or an error
+		uint32_t pf_final_err_code;       // error that ended the stream (HDEVIO_OK until then)
+		string pf_final_err_mess;
 
 		void ClearErrorMessage(void){ err_mess.str(""); err_mess.clear();}
 		void SetErrorMessage(string mess){ ClearErrorMessage(); err_mess<<mess;}
@@ -270,11 +498,9 @@ class HDEVIO{
 		//---------------------------------
 		// swap_block
 		//---------------------------------
-		inline void swap_block(uint16_t *inbuff, uint16_t len, uint16_t *outbuff)
+		inline void swap_block(uint16_t *inbuff, uint32_t len, uint16_t *outbuff)
 		{
-			for(uint32_t i=0; i<len; i++, inbuff++, outbuff++){
-				*outbuff = swap16(*inbuff);
-			}
+			swap_block16(inbuff, outbuff, len);
 		}
 
 		//---------------------------------
@@ -282,9 +508,7 @@ class HDEVIO{
 		//---------------------------------
 		inline void swap_block(uint32_t *inbuff, uint32_t len, uint32_t *outbuff)
 		{
-			for(uint32_t i=0; i<len; i++, inbuff++, outbuff++){
-				*outbuff = swap32(*inbuff);
-			}
+			swap_block32(inbuff, outbuff, len);
 		}
 
 		//---------------------------------
@@ -292,9 +516,7 @@ class HDEVIO{
 		//---------------------------------
 		inline void swap_block(uint64_t *inbuff, uint64_t len, uint64_t *outbuff)
 		{
-			for(uint64_t i=0; i<len; i++, inbuff++, outbuff++){
-				*outbuff = swap64(*inbuff);
-			}
+			swap_block64(inbuff, outbuff, len);
 		}
 
 };
@@ -10,6 +10,9 @@
 #include <iomanip>
 
 #include <swap_bank.h>
+#include <window_samples.h>
+#include <module_words.h>
+#include <subtask_pool.h>
 #include <JExceptionDataFormat.h>
 #include <LinkAssociations.h>
 #include <JEventEVIOBuffer.h>
@@ -41,6 +44,26 @@ JEventEVIOBuffer::JEventEVIOBuffer(JApplication *aApplication):JEvent(aApplicati
 
 	buff_len            = 100;   // this will grow as needed
 	buff                = new uint32_t[buff_len];
+	mapped_buff         = NULL;
+	ibuff               = buff;
+
+	FIRST_EVENT_TO_PUBLISH = 0;
+	LAST_EVENT_TO_PUBLISH  = 0;
+	EVENTS_TO_PUBLISH      = NULL;
+	is_physics_event       = false;
+
+	PARSE_SUBTASKS          = 1;
+	PARSE_SUBTASK_MIN_WORDS = 0;
+	subtask_pool            = NULL;
+
+	SPECIALIZE_FIRMWARE = true;
+	firmware_borptrs    = NULL;
+
+	parse_mode          = kPARSE_RELEASE;
+	LAZY_PARSE          = false;
+	HIT_VIEWS           = false;
+	make_hit_views      = false;
+	HIT_COLUMNS         = false;
 
 	PARSE_F250          = true;
 	PARSE_F125          = true;
@@ -52,6 +75,7 @@ JEventEVIOBuffer::JEventEVIOBuffer(JApplication *aApplication):JEvent(aApplicati
 	PARSE_EVENTTAG      = true;
 	PARSE_TRIGGER       = true;
 	
+	LINK_CONFIG         = true;
 	LINK_TRIGGERTIME    = true;
 }
 
@@ -62,6 +86,7 @@ JEventEVIOBuffer::~JEventEVIOBuffer()
 {
 	if(buff) delete[] buff;
 	for(auto pe : parsed_event_pool) delete pe;
+	for(auto sub : subparsers) delete sub;
 }
 
 //---------------------------------
@@ -79,9 +104,44 @@ void JEventEVIOBuffer::Process(void)
 {
 	try {
 
-		if( jobtype & JOB_SWAP       ) swap_bank(buff, buff, swap32(buff[0])+1 );
+		// Physics events from a file written with the opposite byte
+		// order are parsed directly out of the buffer with every word
+		// byte-reversed as it is loaded (see EVIOSwappedWords). This
+		// avoids a separate pass over the whole event with swap_bank.
+		// Other events (BOR, EPICS, control) are rare and contain
+		// character data so those are still swapped first.
+		ibuff = mapped_buff ? (uint32_t*)mapped_buff:buff;
+		bool parse_swapped = false;
+		if( jobtype & JOB_SWAP ){
+			switch( swap32(ibuff[1])>>16 ){
+				case 0xFF50:
+				case 0xFF58:
+				case 0xFF70:
+				case 0xFF78:
+					parse_swapped = true;
+					break;
+				default:
+					{
+					// Events read in zero-copy mode live in a read-only
+					// mapping so swap them while copying into buff.
+					uint32_t len = swap32(ibuff[0])+1;
+					if( mapped_buff && (len > buff_len) ){
+						delete[] buff;
+						buff_len = len;
+						buff = new uint32_t[buff_len];
+					}
+					swap_bank(buff, ibuff, len);
+					ibuff = buff;
+					}
+			}
+		}
 
-		if( jobtype & JOB_FULL_PARSE ) MakeEvents();
+		if( jobtype & JOB_FULL_PARSE ){
+			if( parse_swapped )
+				MakeEventsInMode<EVIOSwappedWords>();
+			else
+				MakeEventsInMode<EVIONativeWords>();
+		}
 		
 		if( jobtype & JOB_ASSOCIATE  ) LinkAllAssociations();
 		
@@ -107,6 +167,20 @@ void JEventEVIOBuffer::Process(void)
 	}
 }
 
+//---------------------------------
+// SetROCIDsToParse
+//---------------------------------
+void JEventEVIOBuffer::SetROCIDsToParse(set<uint32_t> &rocids)
+{
+	/// Parse only the crates with the given rocids. An empty set
+	/// means parse all crates.
+
+	ROCIDS_TO_PARSE.clear();
+	if( rocids.empty() ) return;
+	ROCIDS_TO_PARSE.resize(0x1000, 0);
+	for(auto rocid : rocids) if( rocid < ROCIDS_TO_PARSE.size() ) ROCIDS_TO_PARSE[rocid] = 1;
+}
+
 //---------------------------------
 // Prune
 //---------------------------------
@@ -137,12 +211,100 @@ void JEventEVIOBuffer::Prune(void)
 	}
 }
 
+//---------------------------------
+// GetParseOptions
+//---------------------------------
+void JEventEVIOBuffer::GetParseOptions(ParseOptions &opts) const
+{
+	opts.VERBOSE             = VERBOSE;
+	opts.parse_mode          = parse_mode;
+	opts.MAX_EVENT_RECYCLES  = MAX_EVENT_RECYCLES;
+	opts.MAX_OBJECT_RECYCLES = MAX_OBJECT_RECYCLES;
+	opts.SPECIALIZE_FIRMWARE = SPECIALIZE_FIRMWARE;
+	opts.HIT_VIEWS           = HIT_VIEWS;
+	opts.HIT_COLUMNS         = HIT_COLUMNS;
+	opts.PARSE_F250          = PARSE_F250;
+	opts.PARSE_F125          = PARSE_F125;
+	opts.PARSE_F1TDC         = PARSE_F1TDC;
+	opts.PARSE_CAEN1290TDC   = PARSE_CAEN1290TDC;
+	opts.PARSE_CONFIG        = PARSE_CONFIG;
+	opts.PARSE_BOR           = PARSE_BOR;
+	opts.PARSE_EPICS         = PARSE_EPICS;
+	opts.PARSE_EVENTTAG      = PARSE_EVENTTAG;
+	opts.PARSE_TRIGGER       = PARSE_TRIGGER;
+	opts.LINK_TRIGGERTIME    = LINK_TRIGGERTIME;
+	opts.LINK_CONFIG         = LINK_CONFIG;
+}
+
+//---------------------------------
+// SetParseOptions
+//---------------------------------
+void JEventEVIOBuffer::SetParseOptions(const ParseOptions &opts)
+{
+	VERBOSE             = opts.VERBOSE;
+	parse_mode          = opts.parse_mode;
+	MAX_EVENT_RECYCLES  = opts.MAX_EVENT_RECYCLES;
+	MAX_OBJECT_RECYCLES = opts.MAX_OBJECT_RECYCLES;
+	SPECIALIZE_FIRMWARE = opts.SPECIALIZE_FIRMWARE;
+	HIT_VIEWS           = opts.HIT_VIEWS;
+	HIT_COLUMNS         = opts.HIT_COLUMNS;
+	PARSE_F250          = opts.PARSE_F250;
+	PARSE_F125          = opts.PARSE_F125;
+	PARSE_F1TDC         = opts.PARSE_F1TDC;
+	PARSE_CAEN1290TDC   = opts.PARSE_CAEN1290TDC;
+	PARSE_CONFIG        = opts.PARSE_CONFIG;
+	PARSE_BOR           = opts.PARSE_BOR;
+	PARSE_EPICS         = opts.PARSE_EPICS;
+	PARSE_EVENTTAG      = opts.PARSE_EVENTTAG;
+	PARSE_TRIGGER       = opts.PARSE_TRIGGER;
+	LINK_TRIGGERTIME    = opts.LINK_TRIGGERTIME;
+	LINK_CONFIG         = opts.LINK_CONFIG;
+}
+
+//---------------------------------
+// CopyParseOptions
+//---------------------------------
+void JEventEVIOBuffer::CopyParseOptions(const JEventEVIOBuffer *parent)
+{
+	/// Copy the options that control parsing from parent. This is
+	/// used for the helper objects that parse part of the parent's
+	/// data (see PrepareSubtaskEvents). Which crates to parse and the
+	/// firmware tables are handled by the callers since those may
+	/// change.
+
+	ParseOptions opts;
+	parent->GetParseOptions(opts);
+	SetParseOptions(opts);
+}
+
+//---------------------------------
+// MakeEventsInMode
+//---------------------------------
+template<class WORDS>
+void JEventEVIOBuffer::MakeEventsInMode(void)
+{
+	/// Call MakeEvents with the parse policy for parse_mode.
+
+	switch( parse_mode ){
+		case kPARSE_TRACE:
+			MakeEvents< EVIOParsePolicy<WORDS, TraceParse> >();
+			break;
+		case kPARSE_VALIDATE:
+			MakeEvents< EVIOParsePolicy<WORDS, ValidateParse> >();
+			break;
+		default:
+			MakeEvents< EVIOParsePolicy<WORDS, ReleaseParse> >();
+			break;
+	}
+}
+
 //---------------------------------
 // MakeEvents
 //---------------------------------
+template<class W>
 void JEventEVIOBuffer::MakeEvents(void)
 {
-	/// Make DParsedEvent objects from data currently in buff.
+	/// Make DParsedEvent objects from data currently in ibuff.
 	/// This will look at the begining of the EVIO event to see
 	/// how many L1 events are in it. It will then grab that many
 	/// DParsedEvent objects from this threads pool , or create
@@ -152,19 +314,18 @@ void JEventEVIOBuffer::MakeEvents(void)
 	
 	if(!current_parsed_events.empty()) throw JException("Attempting call to JEventEVIOBuffer::MakeEvents when current_parsed_events not empty!!", __FILE__, __LINE__);
 	
-	uint32_t *iptr = buff;
+	uint32_t *iptr = ibuff;
 	
 	uint32_t M = 1;
 	uint64_t event_num = 0;
 
 	iptr++;
 	uint32_t mask = 0xFF001000;
-	if( ((*iptr)&mask) == mask ){
+	is_physics_event = ( (W::get(iptr)&mask) == mask );
+	if( is_physics_event ){
 		// Physics event
-		M = *(iptr)&0xFF;
-		uint64_t eventnum_lo = iptr[4];
-		uint64_t eventnum_hi = iptr[5];
-		event_num = (eventnum_hi<<32) + (eventnum_lo);
+		M = W::get(iptr)&0xFF;
+		event_num = W::get64((uint64_t*)&iptr[4]);  // first value in built trigger bank's 64bit segment
 	}
 
 	// Try and get M DParsedEvent objects from this thread's pool.
@@ -195,13 +356,24 @@ void JEventEVIOBuffer::MakeEvents(void)
 		pe->copied_to_factories = false;
 		pe->event_status_bits   = 0;
 		pe->borptrs      = NULL; // may be set by either ParseBORbank or JEventSource_EVIOpp::GetEvent
+		pe->link_columns = (jobtype & JOB_ASSOCIATE) != 0;
+		pe->link_columns_config      = LINK_CONFIG;
+		pe->link_columns_triggertime = LINK_TRIGGERTIME;
 
 		pe->SetJApplication( GetJApplication() );
 		pe->SetEventNumber(pe->event_number);
 	}
 
-	// Parse data in buffer to create data objects
-	ParseBank();
+	// Pick up the BOR config if it has changed
+	if( mEventSource ){
+		DBORptrs *borptrs = ((JEventSource_EVIO*)mEventSource)->GetBOR();
+		if( borptrs != firmware_borptrs ) UpdateFirmwareTables(borptrs);
+	}
+
+	// Parse data in buffer to create data objects. Any module
+	// data left for later is held by the events from here on.
+	ParseBank<W>();
+	lazy_banks.reset();
 	
 	// Occasionally prune extra DParsedEvent objects as well as objects
 	// from the existing pools to reduce average memory usage. We do
@@ -224,6 +396,20 @@ void JEventEVIOBuffer::PublishEvents(void)
 	/// processors.
 	for(auto pe: current_parsed_events){
 
+		// Drop physics events outside of the range or list the
+		// user asked for. They go straight back to our pool.
+		if( is_physics_event ){
+			bool keep = true;
+			if( FIRST_EVENT_TO_PUBLISH && pe->event_number<FIRST_EVENT_TO_PUBLISH ) keep = false;
+			if( LAST_EVENT_TO_PUBLISH  && pe->event_number>LAST_EVENT_TO_PUBLISH  ) keep = false;
+			if( EVENTS_TO_PUBLISH && !EVENTS_TO_PUBLISH->count(pe->event_number) ) keep = false;
+			if( !keep ){
+				pe->ReleaseLazy();
+				pe->in_use = false;
+				continue;
+			}
+		}
+
 		// The BOR event is special. We need to keep a copy of the
 		// most recent DBORptrs object so all parsed events have
 		// access to it. If the pe already has a pointer, it means
@@ -247,7 +433,7 @@ void JEventEVIOBuffer::PublishEvents(void)
 		// Add custom deleter to the shared pointer so that it
 		// clears the "in_use" flag to make the event available for
 		// reuse in the pool. Also, decrement source's in-use counter.
-		std::shared_ptr<const JEvent> pesp(pe, [](DParsedEvent *pe){ pe->Release(); pe->in_use = false; } );
+		std::shared_ptr<const JEvent> pesp(pe, [](DParsedEvent *pe){ pe->Release(); pe->ReleaseLazy(); pe->in_use = false; } );
 
 		// Make a task to run the event processors on this event and
 		// place it in the queue. (See JFunctions.cc in JANA code)
@@ -271,15 +457,16 @@ void JEventEVIOBuffer::PublishEvents(void)
 //---------------------------------
 // ParseBank
 //---------------------------------
+template<class W>
 void JEventEVIOBuffer::ParseBank(void)
 {
 
-	uint32_t *iptr = buff;
-	uint32_t *iend = &buff[buff[0]+1];
+	uint32_t *iptr = ibuff;
+	uint32_t *iend = &ibuff[W::get(ibuff)+1];
 
 	while(iptr < iend){
-		uint32_t event_len  = iptr[0];
-		uint32_t event_head = iptr[1];
+		uint32_t event_len  = W::get(&iptr[0]);
+		uint32_t event_head = W::get(&iptr[1]);
 		uint32_t tag = (event_head >> 16) & 0xFFFF;
 
 // _DBG_ << "0x" << hex << (uint64_t)iptr << dec << ": event_len=" << event_len <<" ("<< swap32(event_len)<< ") tag=" << hex << tag << dec << _DBG_ENDL_;
@@ -296,7 +483,7 @@ void JEventEVIOBuffer::ParseBank(void)
 			case 0xFF58:
 			case 0xFF78: current_parsed_events.back()->sync_flag = true;
 			case 0xFF50:     
-			case 0xFF70:     ParsePhysicsBank(iptr, iend);    break;
+			case 0xFF70:     ParsePhysicsBank<W>(iptr, iend);    break;
 
 			default:
 				_DBG_ << "Unknown outer EVIO bank tag: " << hex << tag << dec << _DBG_ENDL_;
@@ -309,6 +496,7 @@ void JEventEVIOBuffer::ParseBank(void)
 //---------------------------------
 // ParseEventTagBank
 //---------------------------------
+template<class W>
 void JEventEVIOBuffer::ParseEventTagBank(uint32_t* &iptr, uint32_t *iend)
 {
 	// skip the bank header
@@ -318,14 +506,14 @@ void JEventEVIOBuffer::ParseEventTagBank(uint32_t* &iptr, uint32_t *iend)
 	iptr++; // data bank length
 	iptr++; // data bank header
 
-	uint64_t evt_status_lo     = *iptr++;
-	uint64_t evt_status_hi     = *iptr++;
-	uint64_t l3_status_lo      = *iptr++;
-	uint64_t l3_status_hi      = *iptr++;
+	uint64_t evt_status_lo     = W::get(iptr++);
+	uint64_t evt_status_hi     = W::get(iptr++);
+	uint64_t l3_status_lo      = W::get(iptr++);
+	uint64_t l3_status_hi      = W::get(iptr++);
 	uint64_t l3_decision       = 0;
-//	auto l3_decision           = (DL3Trigger::L3_decision_t)*iptr++;
-	uint32_t l3_algorithm      = *iptr++;
-	uint32_t mva_encoded       = *iptr++;
+//	auto l3_decision           = (DL3Trigger::L3_decision_t)W::get(iptr++);
+	uint32_t l3_algorithm      = W::get(iptr++);
+	uint32_t mva_encoded       = W::get(iptr++);
 	
 	uint64_t evt_status = evt_status_lo + (evt_status_hi<<32);
 	uint64_t l3_status  = l3_status_lo  + ( l3_status_hi<<32);
@@ -375,9 +563,8 @@ void JEventEVIOBuffer::ParseEPICSbank(uint32_t* &iptr, uint32_t *iend)
 			// timestamp bank
 			timestamp = *iptr;
 		}else if(tag == 0x62){
-			// EPICS data value
-			string nameval = (const char*)iptr;
-			pe->NEW_DEPICSvalue(timestamp, nameval);
+			// EPICS data value ("name=value" string)
+			pe->NEW_DEPICSvalue(timestamp, (const char*)iptr);
 		}else{
 			// Unknown tag. Bail
 			_DBG_ << "Unknown tag 0x" << hex << tag << dec << " in EPICS event!" <<_DBG_ENDL_;
@@ -536,6 +723,7 @@ void JEventEVIOBuffer::ParseBORbank(uint32_t* &iptr, uint32_t *iend)
 
 			// Extract certain derived values to fill in convenience members
 			if(f250conf    ) f250conf->FillDerived();
+			if(f125conf    ) f125conf->FillDerived();
 
 			// Store object for use in this and subsequent events
 			if(f250conf    ) borptrs->vDf250BORConfig.push_back(f250conf);
@@ -549,14 +737,38 @@ void JEventEVIOBuffer::ParseBORbank(uint32_t* &iptr, uint32_t *iend)
 		iptr = iend_crate; // ensure we're pointing past this crate
 	}
 	
-	// Sort the BOR config events now so we don't have to do it for every event
+	// Sort the BOR config events and make the lookup tables now so
+	// we don't have to do it for every event
 	borptrs->Sort();
+	borptrs->BuildLookupTables();
+
+}
 
+//---------------------------------
+// UpdateFirmwareTables
+//---------------------------------
+void JEventEVIOBuffer::UpdateFirmwareTables(DBORptrs *borptrs)
+{
+	/// Use the given BOR config from now on. If SPECIALIZE_FIRMWARE is
+	/// set the f250_firmware and f125_firmware tables are copied from
+	/// it. The entry for a crate is only set if all modules of that
+	/// type in it report the same firmware generation (see
+	/// DBORptrs::BuildLookupTables). Otherwise (or if borptrs is NULL)
+	/// the generic decoder is used for it.
+
+	firmware_borptrs = borptrs;
+	f250_firmware.clear();
+	f125_firmware.clear();
+	if( !borptrs || !SPECIALIZE_FIRMWARE ) return;
+
+	f250_firmware = borptrs->f250_firmware;
+	f125_firmware = borptrs->f125_firmware;
 }
 
 //---------------------------------
 // ParseTSscalerBank
 //---------------------------------
+template<class W>
 void JEventEVIOBuffer::ParseTSscalerBank(uint32_t* &iptr, uint32_t *iend)
 {
     uint32_t Nwords = ((uint64_t)iend - (uint64_t)iptr)/sizeof(uint32_t);
@@ -570,16 +782,16 @@ void JEventEVIOBuffer::ParseTSscalerBank(uint32_t* &iptr, uint32_t *iend)
 		// of events, the last should be the actual sync event.
 		DParsedEvent *pe = current_parsed_events.back();
 		DL1Info *s = pe->NEW_DL1Info();
-		s->nsync = *iptr++;
-		s->trig_number = *iptr++;
-		s->live_time = *iptr++;
-		s->busy_time = *iptr++;
-		s->live_inst = *iptr++;
-		s->unix_time = *iptr++;
-		for(uint32_t i=0; i<32; i++) s->gtp_sc.push_back  ( *iptr++ );
-		for(uint32_t i=0; i<16; i++) s->fp_sc.push_back   ( *iptr++ );
-		for(uint32_t i=0; i<32; i++) s->gtp_rate.push_back( *iptr++ );
-		for(uint32_t i=0; i<16; i++) s->fp_rate.push_back ( *iptr++ );
+		s->nsync = W::get(iptr++);
+		s->trig_number = W::get(iptr++);
+		s->live_time = W::get(iptr++);
+		s->busy_time = W::get(iptr++);
+		s->live_inst = W::get(iptr++);
+		s->unix_time = W::get(iptr++);
+		for(uint32_t i=0; i<32; i++) s->gtp_sc.push_back  ( W::get(iptr++) );
+		for(uint32_t i=0; i<16; i++) s->fp_sc.push_back   ( W::get(iptr++) );
+		for(uint32_t i=0; i<32; i++) s->gtp_rate.push_back( W::get(iptr++) );
+		for(uint32_t i=0; i<16; i++) s->fp_rate.push_back ( W::get(iptr++) );
     }
 
     iptr = iend;
@@ -588,6 +800,7 @@ void JEventEVIOBuffer::ParseTSscalerBank(uint32_t* &iptr, uint32_t *iend)
 //---------------------------------
 // Parsef250scalerBank
 //---------------------------------
+template<class W>
 void JEventEVIOBuffer::Parsef250scalerBank(uint32_t rocid, uint32_t* &iptr, uint32_t *iend)
 {
   
@@ -603,14 +816,14 @@ void JEventEVIOBuffer::Parsef250scalerBank(uint32_t rocid, uint32_t* &iptr, uint
     
     Df250Scaler  *sc = pe->NEW_Df250Scaler();
  
-    sc->nsync        =   *iptr++; 
-    sc->trig_number  =   *iptr++;
-    sc->version      =   *iptr++;
+    sc->nsync        =   W::get(iptr++); 
+    sc->trig_number  =   W::get(iptr++);
+    sc->version      =   W::get(iptr++);
     sc->crate        =    rocid;
     
     while(iptr < iend){
-      //      cout << "  " << *iptr << endl;
-      sc->fa250_sc.push_back(*iptr++);
+      //      cout << "  " << W::get(iptr) << endl;
+      sc->fa250_sc.push_back(W::get(iptr++));
     }
     
   }
@@ -645,7 +858,7 @@ void JEventEVIOBuffer::ParseControlEvent(uint32_t* &iptr, uint32_t *iend)
 		auto controlevent = pe->NEW_DCODAControlEvent();
 		controlevent->event_type = iptr[1]>>16;
 		controlevent->unix_time = t;
-		for(auto p = iptr; p!=iend; p++) controlevent->words.push_back(*p);
+		controlevent->words.assign(iptr, iend);
 	}
 
 	iptr = &iptr[(*iptr) + 1];
@@ -654,52 +867,175 @@ void JEventEVIOBuffer::ParseControlEvent(uint32_t* &iptr, uint32_t *iend)
 //---------------------------------
 // ParsePhysicsBank
 //---------------------------------
+template<class W>
 void JEventEVIOBuffer::ParsePhysicsBank(uint32_t* &iptr, uint32_t *iend)
 {
 
 	for(auto pe : current_parsed_events) pe->event_status_bits |= (1<<(uint64_t)kSTATUS_PHYSICS_EVENT);
 
-	uint32_t physics_event_len      = *iptr++;
+	uint32_t physics_event_len      = W::get(iptr++);
 	uint32_t *iend_physics_event    = &iptr[physics_event_len];
 	iptr++;
 
 	// Built Trigger Bank
-	uint32_t built_trigger_bank_len  = *iptr;
+	uint32_t built_trigger_bank_len  = W::get(iptr);
 	uint32_t *iend_built_trigger_bank = &iptr[built_trigger_bank_len+1];
-	ParseBuiltTriggerBank(iptr, iend_built_trigger_bank);
+	ParseBuiltTriggerBank<W>(iptr, iend_built_trigger_bank);
 	iptr = iend_built_trigger_bank;
 	
-	// Loop over Data banks
-	while( iptr < iend_physics_event ) {
+	// Data banks (one per ROC). When module data is left for later
+	// there isn't enough work here to be worth splitting up.
+	if( !LAZY_PARSE && subtask_pool && (PARSE_SUBTASKS>1) && (physics_event_len>=PARSE_SUBTASK_MIN_WORDS) ){
+		ParseDataBanksInSubtasks<W>(iptr, iend_physics_event);
+	}else{
+		ParseDataBankRange<W>(iptr, iend_physics_event);
+	}
+
+	iptr = iend_physics_event;
+}
+
+//---------------------------------
+// ParseDataBankRange
+//---------------------------------
+template<class W>
+void JEventEVIOBuffer::ParseDataBankRange(uint32_t *iptr, uint32_t *iend)
+{
+	/// Parse consecutive Data banks starting at iptr up to iend.
 
-		uint32_t data_bank_len = *iptr;
+	while( iptr < iend ) {
+
+		uint32_t data_bank_len = W::get(iptr);
 		uint32_t *iend_data_bank = &iptr[data_bank_len+1];
 
-		ParseDataBank(iptr, iend_data_bank);
+		ParseDataBank<W>(iptr, iend_data_bank);
 
 		iptr = iend_data_bank;
 	}
+}
 
-	iptr = iend_physics_event;
+//---------------------------------
+// ParseDataBanksInSubtasks
+//---------------------------------
+template<class W>
+void JEventEVIOBuffer::ParseDataBanksInSubtasks(uint32_t *istart, uint32_t *iend)
+{
+	/// Parse the Data banks from istart to iend using up to PARSE_SUBTASKS
+	/// concurrent subtasks run by subtask_pool. Only the bank headers are
+	/// read first to cut the banks into groups with roughly equal numbers
+	/// of words. The first group is parsed into current_parsed_events.
+	/// Each of the others is parsed by one of the subparsers into its own
+	/// DParsedEvent objects. These are merged into ours afterwards in
+	/// bank order so the result is the same as parsing serially.
+
+	// There is no point in making more groups than can run at once
+	uint32_t Nmax_groups = min(PARSE_SUBTASKS, subtask_pool->GetNthreads()+1);
+
+	// Find group boundaries. A bad length word ends the search and the
+	// rest goes into the last group where it will be dealt with the
+	// same way as in the serial case.
+	uint64_t Nwords_per_group = (uint64_t)(iend-istart)/Nmax_groups + 1;
+	subtask_bounds.clear();
+	subtask_bounds.push_back(istart);
+	for(uint32_t *iptr=istart; iptr<iend; ){
+		uint32_t data_bank_len = W::get(iptr);
+		if( (uint64_t)data_bank_len >= (uint64_t)(iend-iptr) ) break;
+		iptr = &iptr[data_bank_len+1];
+		if( (iptr<iend) && ((uint64_t)(iptr-subtask_bounds.back()) >= Nwords_per_group) ) subtask_bounds.push_back(iptr);
+	}
+	subtask_bounds.push_back(iend);
+	uint32_t Ngroups = subtask_bounds.size() - 1;
+	if( Ngroups < 2 ){
+		ParseDataBankRange<W>(istart, iend);
+		return;
+	}
+
+	// Give each extra group a subparser with its own set of events
+	while( subparsers.size() < Ngroups-1 ) subparsers.push_back( new JEventEVIOBuffer(GetJApplication()) );
+	for(uint32_t igroup=1; igroup<Ngroups; igroup++){
+		subparsers[igroup-1]->PrepareSubtaskEvents(this, Ngroups-igroup+1);
+	}
+
+	// Parse all groups in the pool. This thread takes part so the
+	// groups are parsed even if all of the pool's threads are busy.
+	// Run only returns (or throws) once all of them are done.
+	auto parse_group = [this](uint32_t igroup){
+		JEventEVIOBuffer *parser = igroup==0 ? this:subparsers[igroup-1];
+		parser->ParseDataBankRange<W>(subtask_bounds[igroup], subtask_bounds[igroup+1]);
+	};
+	subtask_pool->Run(Ngroups, parse_group);
+
+	// Merge in order of groups
+	for(uint32_t igroup=1; igroup<Ngroups; igroup++){
+		JEventEVIOBuffer *sub = subparsers[igroup-1];
+		auto it = sub->current_parsed_events.begin();
+		for(auto pe : current_parsed_events){
+			pe->Merge(*it);
+			(*it++)->in_use = false;
+		}
+		sub->current_parsed_events.clear();
+	}
+}
+
+//---------------------------------
+// PrepareSubtaskEvents
+//---------------------------------
+void JEventEVIOBuffer::PrepareSubtaskEvents(JEventEVIOBuffer *parent, uint32_t nshares)
+{
+	/// Set this object up as a subparser for parent (see
+	/// ParseDataBanksInSubtasks). This copies the parsing options
+	/// and fills current_parsed_events with one empty DParsedEvent
+	/// for each in the parent's list. Each of those is given a share
+	/// of the matching parent event's object pools.
+
+	CopyParseOptions(parent);
+	if( ROCIDS_TO_PARSE != parent->ROCIDS_TO_PARSE ) ROCIDS_TO_PARSE = parent->ROCIDS_TO_PARSE;
+	if( firmware_borptrs != parent->firmware_borptrs ){
+		firmware_borptrs = parent->firmware_borptrs;
+		f250_firmware    = parent->f250_firmware;
+		f125_firmware    = parent->f125_firmware;
+	}
+
+	if(++Nrecycled%MAX_EVENT_RECYCLES == 0) Prune();
+
+	uint32_t M = parent->current_parsed_events.size();
+	for(auto pe : parsed_event_pool){
+		if(pe->in_use) continue;
+		if( current_parsed_events.size() >= M ) break;
+		current_parsed_events.push_back(pe);
+	}
+	while( current_parsed_events.size() < M ){
+		DParsedEvent *pe = new DParsedEvent(MAX_OBJECT_RECYCLES);
+		current_parsed_events.push_back(pe);
+		parsed_event_pool.push_back(pe);
+	}
+
+	auto it = parent->current_parsed_events.begin();
+	for(auto pe : current_parsed_events){
+		pe->Clear();
+		pe->in_use            = true;
+		pe->event_status_bits = 0;
+		(*it++)->SharePools(pe, nshares);
+	}
 }
 
 //---------------------------------
 // ParseBuiltTriggerBank
 //---------------------------------
+template<class W>
 void JEventEVIOBuffer::ParseBuiltTriggerBank(uint32_t* &iptr, uint32_t *iend)
 {
 	if(!PARSE_TRIGGER) return;
 
 	iptr++; // advance past length word
 	uint32_t mask = 0xFF202000;
-	if( ((*iptr) & mask) != mask ){
+	if( (W::get(iptr) & mask) != mask ){
 		stringstream ss;
-		ss << "Bad header word in Built Trigger Bank: " << hex << *iptr;
+		ss << "Bad header word in Built Trigger Bank: " << hex << W::get(iptr);
 		throw JExceptionDataFormat(ss.str(), __FILE__, __LINE__);
 	}
 	
-	uint32_t tag     = (*iptr)>>16; // 0xFF2X
-	uint32_t Nrocs   = (*iptr++) & 0xFF;
+	uint32_t tag     = W::get(iptr)>>16; // 0xFF2X
+	uint32_t Nrocs   = (W::get(iptr++)) & 0xFF;
 	uint32_t Mevents = current_parsed_events.size();
 	
     // sanity check: 
@@ -711,46 +1047,45 @@ void JEventEVIOBuffer::ParseBuiltTriggerBank(uint32_t* &iptr, uint32_t *iend)
 
 	
     //-------- Common data (64bit)
-	uint32_t common_header64 = *iptr++;
+	uint32_t common_header64 = W::get(iptr++);
 	uint32_t common_header64_len = common_header64 & 0xFFFF;
 	uint64_t *iptr64 = (uint64_t*)iptr;
 	iptr = &iptr[common_header64_len];
 
 	// First event number
-   uint64_t first_event_num = *iptr64++;
+   uint64_t first_event_num = W::get64(iptr64++);
 
    // Hi and lo 32bit words in 64bit numbers seem to be
    // switched for events read from ET, but not read from
    // file. Not sure if this is in the swapping routine
 //   if(event_source->source_type==event_source->kETSource) first_event_num = (first_event_num>>32) | (first_event_num<<32);
 
-	// Average timestamps
+	// Average timestamps (read directly from the bank below)
    uint32_t Ntimestamps = (common_header64_len/2)-1;
    if(tag & 0x2) Ntimestamps--; // subtract 1 for run number/type word if present
-	vector<uint64_t> avg_timestamps;
-   for(uint32_t i=0; i<Ntimestamps; i++) avg_timestamps.push_back(*iptr64++);
+	uint64_t *avg_timestamps = iptr64;
+	iptr64 += Ntimestamps;
 
    // run number and run type
 	uint32_t run_number = 0;
 	uint32_t run_type   = 0;
    if(tag & 0x02){
-       run_number = (*iptr64) >> 32;
-       run_type   = (*iptr64) & 0xFFFFFFFF;
+       run_number = W::get64(iptr64) >> 32;
+       run_type   = W::get64(iptr64) & 0xFFFFFFFF;
 		 iptr64++;
    }
 
 	//-------- Common data (16bit)
-	uint32_t common_header16 = *iptr++;
+	uint32_t common_header16 = W::get(iptr++);
 	uint32_t common_header16_len = common_header16 & 0xFFFF;
 	uint16_t *iptr16 = (uint16_t*)iptr;
 	iptr = &iptr[common_header16_len];
 
-	vector<uint16_t> event_types;
-   for(uint32_t i=0; i<Mevents; i++) event_types.push_back(*iptr16++);
+	uint16_t *event_types = iptr16; // one per event (read directly below)
 	
 	//-------- ROC data (32bit)
 	for(uint32_t iroc=0; iroc<Nrocs; iroc++){
-		uint32_t common_header32 = *iptr++;
+		uint32_t common_header32 = W::get(iptr++);
 		uint32_t common_header32_len = common_header32 & 0xFFFF;
 		uint32_t rocid = common_header32 >> 24;
 
@@ -760,11 +1095,11 @@ void JEventEVIOBuffer::ParseBuiltTriggerBank(uint32_t* &iptr, uint32_t *iend)
 			DCODAROCInfo *codarocinfo = pe->NEW_DCODAROCInfo();
 			codarocinfo->rocid = rocid;
 
-			uint64_t ts_low  = *iptr++;
-			uint64_t ts_high = *iptr++;
+			uint64_t ts_low  = W::get(iptr++);
+			uint64_t ts_high = W::get(iptr++);
 			codarocinfo->timestamp = (ts_high<<32) + ts_low;
 			codarocinfo->misc.clear(); // could be recycled from previous event
-			for(uint32_t i=2; i<Nwords_per_event; i++) codarocinfo->misc.push_back(*iptr++);
+			for(uint32_t i=2; i<Nwords_per_event; i++) codarocinfo->misc.push_back(W::get(iptr++));
 			
 			if(iptr > iend){
 				throw JExceptionDataFormat("Bad data format in ParseBuiltTriggerBank!", __FILE__, __LINE__);
@@ -782,8 +1117,8 @@ void JEventEVIOBuffer::ParseBuiltTriggerBank(uint32_t* &iptr, uint32_t *iend)
 		codaeventinfo->run_number     = run_number;
 		codaeventinfo->run_type       = run_type;
 		codaeventinfo->event_number   = first_event_num + ievent;
-		codaeventinfo->event_type     = event_types.empty() ? 0:event_types[ievent];
-		codaeventinfo->avg_timestamp  = avg_timestamps.empty() ? 0:avg_timestamps[ievent];
+		codaeventinfo->event_type     = W::get16(&event_types[ievent]);
+		codaeventinfo->avg_timestamp  = ievent<Ntimestamps ? W::get64(&avg_timestamps[ievent]):0;
 		ievent++;
 	}
 }
@@ -791,40 +1126,46 @@ void JEventEVIOBuffer::ParseBuiltTriggerBank(uint32_t* &iptr, uint32_t *iend)
 //---------------------------------
 // ParseDataBank
 //---------------------------------
+template<class W>
 void JEventEVIOBuffer::ParseDataBank(uint32_t* &iptr, uint32_t *iend)
 {
 	// Physics Event's Data Bank header
 	iptr++; // advance past data bank length word
-	uint32_t rocid = ((*iptr)>>16) & 0xFFF;
+	uint32_t rocid = (W::get(iptr)>>16) & 0xFFF;
 	iptr++;
 	
+	// Crates not being parsed are skipped without looking at any
+	// more of their words. The caller moves iptr to the next bank.
 	if(!ROCIDS_TO_PARSE.empty()){
-		if(ROCIDS_TO_PARSE.find(rocid) == ROCIDS_TO_PARSE.end()) return;
+		if(!ROCIDS_TO_PARSE[rocid]) return;
 	}
 	
 	// Loop over Data Block Banks
 	while(iptr < iend){
 		
-		uint32_t data_block_bank_len     = *iptr++;
+		uint32_t data_block_bank_len     = W::get(iptr++);
 		uint32_t *iend_data_block_bank   = &iptr[data_block_bank_len];
-		uint32_t data_block_bank_header  = *iptr++;
+		uint32_t data_block_bank_header  = W::get(iptr++);
 		
 		// Not sure where this comes from, but it needs to be skipped if present
-		while( (*iptr==0xF800FAFA) && (iptr<iend) ) iptr++;
+		while( (W::get(iptr)==0xF800FAFA) && (iptr<iend) ) iptr++;
 		
 		uint32_t det_id = (data_block_bank_header>>16) & 0xFFF;
 		switch(det_id){
 
 			case 20:
-				ParseCAEN1190(rocid, iptr, iend_data_block_bank);
+				if( LAZY_PARSE && PARSE_CAEN1290TDC )
+					StashModuleData<W>(rocid, DLazyModuleData::kCAEN1290TDC, iptr, iend_data_block_bank);
+				else
+					ParseCAEN1190<W>(rocid, iptr, iend_data_block_bank);
 				break;
 
 			case 0x55:
-				ParseModuleConfiguration(rocid, iptr, iend_data_block_bank);
+				ParseModuleConfiguration<W>(rocid, iptr, iend_data_block_bank);
 				break;
 
 			case 0x56:
-				ParseEventTagBank(iptr, iend_data_block_bank);
+				ParseEventTagBank<W>(iptr, iend_data_block_bank);
 				break;
 
 			case 0:
@@ -833,7 +1174,10 @@ void JEventEVIOBuffer::ParseDataBank(uint32_t* &iptr, uint32_t *iend)
 			case 6:  // flash 250 module, MMD 2014/2/4
 			case 16: // flash 125 module (CDC), DL 2014/6/19
 			case 26: // F1 TDC module (BCAL), MMD 2014-07-31
-				ParseJLabModuleData(rocid, iptr, iend_data_block_bank);
+				if( LAZY_PARSE )
+					StashJLabModuleData<W>(rocid, iptr, iend_data_block_bank);
+				else
+					ParseJLabModuleData<W>(rocid, iptr, iend_data_block_bank);
 				break;
 
 			// These were implemented in the ROL for sync events
@@ -842,23 +1186,23 @@ void JEventEVIOBuffer::ParseDataBank(uint32_t* &iptr, uint32_t *iend)
 			// (the first "E" should really be a "1". We just check
 			// other 12 bits here.
 			case 0xE02:
-				ParseTSscalerBank(iptr, iend);
+				ParseTSscalerBank<W>(iptr, iend);
 				break;
 			case 0xE05:
-			  //				Parsef250scalerBank(iptr, iend);
+			  //				Parsef250scalerBank<W>(iptr, iend);
 				break;
 			case 0xE10:  // really wish Sascha would share when he does this stuff!
-			  Parsef250scalerBank(rocid, iptr, iend);
+			  Parsef250scalerBank<W>(rocid, iptr, iend);
 				break;
 
             // When we write out single events in the offline, we also can save some
             // higher level data objects to save disk space and speed up 
             // specialized processing (e.g. pi0 calibration)
             case 0xD01:
-                ParseDVertexBank(iptr, iend);
+                ParseDVertexBank<W>(iptr, iend);
                 break;
             case 0xD02:
-                ParseDEventRFBunchBank(iptr, iend);
+                ParseDEventRFBunchBank<W>(iptr, iend);
                 break;
 
 			case 5:
@@ -887,20 +1231,22 @@ void JEventEVIOBuffer::ParseDataBank(uint32_t* &iptr, uint32_t *iend)
 //----------------
 // ParseTIBank
 //----------------
+template<class W>
 void JEventEVIOBuffer::ParseTIBank(uint32_t rocid, uint32_t* &iptr, uint32_t* iend)
 {
-    while(iptr<iend && ((*iptr) & 0xF8000000) != 0x88000000) iptr++; // Skip to JLab block trailer
+    while(iptr<iend && (W::get(iptr) & 0xF8000000) != 0x88000000) iptr++; // Skip to JLab block trailer
     iptr++; // advance past JLab block trailer
-    while(iptr<iend && *iptr == 0xF8000000) iptr++; // skip filler words after block trailer
+    while(iptr<iend && W::get(iptr) == 0xF8000000) iptr++; // skip filler words after block trailer
     //iptr = iend;
 }
 
 //----------------
 // ParseCAEN1190
 //----------------
+template<class W>
 void JEventEVIOBuffer::ParseCAEN1190(uint32_t rocid, uint32_t* &iptr, uint32_t *iend)
 {
-	if(!PARSE_CAEN1290TDC){ iptr = &iptr[(*iptr) + 1]; return; }
+	if(!PARSE_CAEN1290TDC){ iptr = &iptr[W::get(iptr) + 1]; return; }
 
     /// Parse data from a CAEN 1190 or 1290 module
     /// (See ppg. 72-74 of V1290_REV15.pdf manual)
@@ -922,9 +1268,12 @@ void JEventEVIOBuffer::ParseCAEN1190(uint32_t rocid, uint32_t* &iptr, uint32_t *
     // and could roll over within an event block. This
     // means we need to keep track of the order we
     // encounter them in so it is maintained in the
-    // "events" container. The event_id order is kept
-    // in the "event_id_order" vector.
-	map<uint32_t, DParsedEvent*> events_by_event_id;
+    // "events" container. The event for each event_id
+    // seen so far is kept in caen_events_by_id (a member
+    // so it is not reallocated for every bank). There are
+    // only as many entries as events in the block so a
+    // linear search is used.
+	caen_events_by_id.clear();
 
 	auto pe_iter = current_parsed_events.begin();
 	DParsedEvent *pe = NULL;
@@ -933,76 +1282,76 @@ void JEventEVIOBuffer::ParseCAEN1190(uint32_t rocid, uint32_t* &iptr, uint32_t *
 
         // This word appears to be appended to the data.
         // Probably in the ROL. Ignore it if found.
-        if(*iptr == 0xd00dd00d) {
-            if(VERBOSE>7) cout << "         CAEN skipping 0xd00dd00d word" << endl;
+        if(W::get(iptr) == 0xd00dd00d) {
+            if(W::trace) cout << "         CAEN skipping 0xd00dd00d word" << endl;
             iptr++;
             continue;
         }
 
-        uint32_t type = (*iptr) >> 27;
+        uint32_t type = W::get(iptr) >> 27;
         uint32_t edge = 0; // 1=trailing, 0=leading
         uint32_t channel = 0;
         uint32_t tdc = 0;
         uint32_t error_flags = 0;
         switch(type){
             case 0b01000:  // Global Header
-                slot = (*iptr) & 0x1f;
-                event_count = ((*iptr)>>5) & 0xffffff;
-                if(VERBOSE>7) cout << "         CAEN TDC Global Header (slot=" << slot << " , event count=" << event_count << ")" << endl;
+                slot = W::get(iptr) & 0x1f;
+                event_count = (W::get(iptr)>>5) & 0xffffff;
+                if(W::trace) cout << "         CAEN TDC Global Header (slot=" << slot << " , event count=" << event_count << ")" << endl;
                 break;
             case 0b10000:  // Global Trailer
-                slot = (*iptr) & 0x1f;
-                word_count = ((*iptr)>>5) & 0x7ffff;
-                if(VERBOSE>7) cout << "         CAEN TDC Global Trailer (slot=" << slot << " , word count=" << word_count << ")" << endl;
+                slot = W::get(iptr) & 0x1f;
+                word_count = (W::get(iptr)>>5) & 0x7ffff;
+                if(W::trace) cout << "         CAEN TDC Global Trailer (slot=" << slot << " , word count=" << word_count << ")" << endl;
                 slot = event_count = word_count = trigger_time_tag = tdc_num = event_id = bunch_id = 0;
                 break;
             case 0b10001:  // Global Trigger Time Tag
-                trigger_time_tag = ((*iptr)>>5) & 0x7ffffff;
-                if(VERBOSE>7) cout << "         CAEN TDC Global Trigger Time Tag (tag=" << trigger_time_tag << ")" << endl;
+                trigger_time_tag = (W::get(iptr)>>5) & 0x7ffffff;
+                if(W::trace) cout << "         CAEN TDC Global Trigger Time Tag (tag=" << trigger_time_tag << ")" << endl;
                 break;
             case 0b00001:  // TDC Header
-                tdc_num = ((*iptr)>>24) & 0x03;
-                event_id = ((*iptr)>>12) & 0x0fff;
-                bunch_id = (*iptr) & 0x0fff;
-				if(events_by_event_id.find(event_id) == events_by_event_id.end()){
+                tdc_num = (W::get(iptr)>>24) & 0x03;
+                event_id = (W::get(iptr)>>12) & 0x0fff;
+                bunch_id = W::get(iptr) & 0x0fff;
+				pe = NULL;
+				for( auto &p : caen_events_by_id ) if( p.first == event_id ){ pe = p.second; break; }
+				if( pe == NULL ){
 					if(pe_iter == current_parsed_events.end()){
 						_DBG_ << "CAEN1290TDC parser sees more events than CODA header! (>" << current_parsed_events.size() << ")" << _DBG_ENDL_;
-						for( auto p : events_by_event_id) cout << "id=" << p.first << endl;
+						for( auto p : caen_events_by_id) cout << "id=" << p.first << endl;
 						iptr = iend;
 						throw JExceptionDataFormat("CAEN1290TDC parser sees more events than CODA header", __FILE__, __LINE__);
 					}
 					pe = *pe_iter++;
-					events_by_event_id[event_id] = pe;
-				}else{
-					pe = events_by_event_id[event_id];
-				}				
-                if(VERBOSE>7) cout << "         CAEN TDC TDC Header (tdc=" << tdc_num <<" , event id=" << event_id <<" , bunch id=" << bunch_id << ")" << endl;
+					caen_events_by_id.emplace_back(event_id, pe);
+				}
+                if(W::trace) cout << "         CAEN TDC TDC Header (tdc=" << tdc_num <<" , event id=" << event_id <<" , bunch id=" << bunch_id << ")" << endl;
                 break;
             case 0b00000:  // TDC Measurement
-                edge = ((*iptr)>>26) & 0x01;
-                channel = ((*iptr)>>21) & 0x1f;
-                tdc = ((*iptr)>>0) & 0x1fffff;
-                if(VERBOSE>7) cout << "         CAEN TDC TDC Measurement (" << (edge ? "trailing":"leading") << " , channel=" << channel << " , tdc=" << tdc << ")" << endl;
+                edge = (W::get(iptr)>>26) & 0x01;
+                channel = (W::get(iptr)>>21) & 0x1f;
+                tdc = (W::get(iptr)>>0) & 0x1fffff;
+                if(W::trace) cout << "         CAEN TDC TDC Measurement (" << (edge ? "trailing":"leading") << " , channel=" << channel << " , tdc=" << tdc << ")" << endl;
 
                 // Create DCAEN1290TDCHit object
                 if(pe) pe->NEW_DCAEN1290TDCHit(rocid, slot, channel, 0, edge, tdc_num, event_id, bunch_id, tdc);
                 break;
             case 0b00100:  // TDC Error
-                error_flags = (*iptr) & 0x7fff;
-                if(VERBOSE>7) cout << "         CAEN TDC TDC Error (err flags=0x" << hex << error_flags << dec << ")" << endl;
+                error_flags = W::get(iptr) & 0x7fff;
+                if(W::trace) cout << "         CAEN TDC TDC Error (err flags=0x" << hex << error_flags << dec << ")" << endl;
                 break;
             case 0b00011:  // TDC Trailer
-                tdc_num = ((*iptr)>>24) & 0x03;
-                event_id = ((*iptr)>>12) & 0x0fff;
-                word_count = ((*iptr)>>0) & 0x0fff;
-                if(VERBOSE>7) cout << "         CAEN TDC TDC Trailer (tdc=" << tdc_num <<" , event id=" << event_id <<" , word count=" << word_count << ")" << endl;
+                tdc_num = (W::get(iptr)>>24) & 0x03;
+                event_id = (W::get(iptr)>>12) & 0x0fff;
+                word_count = (W::get(iptr)>>0) & 0x0fff;
+                if(W::trace) cout << "         CAEN TDC TDC Trailer (tdc=" << tdc_num <<" , event id=" << event_id <<" , word count=" << word_count << ")" << endl;
                 tdc_num = event_id = bunch_id = 0;
                 break;
             case 0b11000:  // Filler Word
-                if(VERBOSE>7) cout << "         CAEN TDC Filler Word" << endl;
+                if(W::trace) cout << "         CAEN TDC Filler Word" << endl;
                 break;
             default:
-                cout << "Unknown datatype: 0x" << hex << type << " full word: "<< *iptr << dec << endl;
+                cout << "Unknown datatype: 0x" << hex << type << " full word: "<< W::get(iptr) << dec << endl;
 					 throw JExceptionDataFormat("Unknown data type for CAEN1190", __FILE__, __LINE__);
         }
 
@@ -1014,9 +1363,10 @@ void JEventEVIOBuffer::ParseCAEN1190(uint32_t rocid, uint32_t* &iptr, uint32_t *
 //----------------
 // ParseModuleConfiguration
 //----------------
+template<class W>
 void JEventEVIOBuffer::ParseModuleConfiguration(uint32_t rocid, uint32_t* &iptr, uint32_t *iend)
 {
-	if(!PARSE_CONFIG){ iptr = &iptr[(*iptr) + 1]; return; }
+	if(!PARSE_CONFIG){ iptr = &iptr[W::get(iptr) + 1]; return; }
 
     /// Parse a bank of module configuration data. These are configuration values
     /// programmed into the module at the beginning of the run that may be needed
@@ -1033,8 +1383,8 @@ void JEventEVIOBuffer::ParseModuleConfiguration(uint32_t rocid, uint32_t* &iptr,
 	/// as needed so each event has its own, indepenent set of config object.
 
     while(iptr < iend){
-        uint32_t slot_mask = (*iptr) & 0xFFFFFF;
-        uint32_t Nvals = ((*iptr) >> 24) & 0xFF;
+        uint32_t slot_mask = W::get(iptr) & 0xFFFFFF;
+        uint32_t Nvals = (W::get(iptr) >> 24) & 0xFF;
         iptr++;
 
 		// Events will be created in the first event (i.e. using its pool)
@@ -1054,8 +1404,8 @@ void JEventEVIOBuffer::ParseModuleConfiguration(uint32_t rocid, uint32_t* &iptr,
                 throw JExceptionDataFormat("Corrupt DAQ config. bank", __FILE__, __LINE__);
             }
 
-            daq_param_type ptype = (daq_param_type)((*iptr)>>16);
-            uint16_t val = (*iptr) & 0xFFFF;
+            daq_param_type ptype = (daq_param_type)(W::get(iptr)>>16);
+            uint16_t val = W::get(iptr) & 0xFFFF;
 
             if(VERBOSE>6) cout << "       DAQ parameter of type: 0x" << hex << ptype << dec << "  found with value: " << val << endl;
 
@@ -1150,40 +1500,41 @@ void JEventEVIOBuffer::ParseModuleConfiguration(uint32_t rocid, uint32_t* &iptr,
 //----------------
 // ParseJLabModuleData
 //----------------
+template<class W>
 void JEventEVIOBuffer::ParseJLabModuleData(uint32_t rocid, uint32_t* &iptr, uint32_t *iend)
 {
 	
 	while(iptr<iend){
 	
 		// Get module type from next word (bits 18-21)
-		uint32_t mod_id = ((*iptr) >> 18) & 0x000F;
+		uint32_t mod_id = (W::get(iptr) >> 18) & 0x000F;
 		MODULE_TYPE type = (MODULE_TYPE)mod_id;
-		//cout << "      rocid=" << rocid << "  Encountered module type: " << type << " (=" << DModuleType::GetModule(type).GetName() << ")  word=" << hex << (*iptr) << dec << endl;
+		//cout << "      rocid=" << rocid << "  Encountered module type: " << type << " (=" << DModuleType::GetModule(type).GetName() << ")  word=" << hex << W::get(iptr) << dec << endl;
 
         switch(type){
             case DModuleType::FADC250:
-                Parsef250Bank(rocid, iptr, iend);
+                Parsef250Bank<W>(rocid, iptr, iend);
                 break;
 
             case DModuleType::FADC125:
-                Parsef125Bank(rocid, iptr, iend);
+                Parsef125Bank<W>(rocid, iptr, iend);
                 break;
 
             case DModuleType::F1TDC32:
-                ParseF1TDCBank(rocid, iptr, iend);
+                ParseF1TDCBank<W>(rocid, iptr, iend);
                 break;
 
             case DModuleType::F1TDC48:
-                ParseF1TDCBank(rocid, iptr, iend);
+                ParseF1TDCBank<W>(rocid, iptr, iend);
                 break;
 
            case DModuleType::TID:
-               ParseTIBank(rocid, iptr, iend);    
+               ParseTIBank<W>(rocid, iptr, iend);    
                /*
                // Ignore this data and skip over it
-               while(iptr<iend && ((*iptr) & 0xF8000000) != 0x88000000) iptr++; // Skip to JLab block trailer
+               while(iptr<iend && (W::get(iptr) & 0xF8000000) != 0x88000000) iptr++; // Skip to JLab block trailer
                iptr++; // advance past JLab block trailer
-               while(iptr<iend && *iptr == 0xF8000000) iptr++; // skip filler words after block trailer
+               while(iptr<iend && W::get(iptr) == 0xF8000000) iptr++; // skip filler words after block trailer
                break;
                */
                break;
@@ -1192,9 +1543,9 @@ void JEventEVIOBuffer::ParseJLabModuleData(uint32_t rocid, uint32_t* &iptr, uint
             default:
                 jerr<<"Unknown module type ("<<mod_id<<") iptr=0x" << hex << iptr << dec << endl;
 
-                while(iptr<iend && ((*iptr) & 0xF8000000) != 0x88000000) iptr++; // Skip to JLab block trailer
+                while(iptr<iend && (W::get(iptr) & 0xF8000000) != 0x88000000) iptr++; // Skip to JLab block trailer
                 iptr++; // advance past JLab block trailer
-                while(iptr<iend && *iptr == 0xF8000000) iptr++; // skip filler words after block trailer
+                while(iptr<iend && W::get(iptr) == 0xF8000000) iptr++; // skip filler words after block trailer
                 throw JExceptionDataFormat("Unknown JLab module type", __FILE__, __LINE__);
                 break;
         }
@@ -1202,108 +1553,377 @@ void JEventEVIOBuffer::ParseJLabModuleData(uint32_t rocid, uint32_t* &iptr, uint
 
 }
 
+//----------------
+// StashJLabModuleData
+//----------------
+template<class W>
+void JEventEVIOBuffer::StashJLabModuleData(uint32_t rocid, uint32_t* &iptr, uint32_t *iend)
+{
+	/// Lazy version of ParseJLabModuleData. TI blocks are skipped the
+	/// same way. The words from the first f250, f125 or F1TDC block to
+	/// the end of the bank are kept for the decoder of that module type
+	/// since it is the one that would have parsed all of them.
+
+	while(iptr<iend){
+
+		uint32_t mod_id = (W::get(iptr) >> 18) & 0x000F;
+		MODULE_TYPE type = (MODULE_TYPE)mod_id;
+
+		uint32_t family = 0;
+		bool parse = false;
+		switch(type){
+			case DModuleType::FADC250:
+				family = DLazyModuleData::kF250;
+				parse  = PARSE_F250;
+				break;
+			case DModuleType::FADC125:
+				family = DLazyModuleData::kF125;
+				parse  = PARSE_F125;
+				break;
+			case DModuleType::F1TDC32:
+			case DModuleType::F1TDC48:
+				family = DLazyModuleData::kF1TDC;
+				parse  = PARSE_F1TDC;
+				break;
+			case DModuleType::TID:
+				ParseTIBank<W>(rocid, iptr, iend);
+				continue;
+			case DModuleType::UNKNOWN:
+			default:
+				jerr<<"Unknown module type ("<<mod_id<<") iptr=0x" << hex << iptr << dec << endl;
+				throw JExceptionDataFormat("Unknown JLab module type", __FILE__, __LINE__);
+		}
+
+		if( parse ) StashModuleData<W>(rocid, family, iptr, iend);
+		iptr = iend;
+	}
+}
+
+//----------------
+// StashModuleData
+//----------------
+template<class W>
+void JEventEVIOBuffer::StashModuleData(uint32_t rocid, uint32_t family, uint32_t *iptr, uint32_t *iend)
+{
+	/// Keep the words from iptr to iend in lazy_banks to be decoded
+	/// later by the decoder for family. lazy_banks is set up on the
+	/// first call for a block and handed to all of its events. Words
+	/// in host byte order are left where they are (see DLazyModuleBanks).
+
+	if( !lazy_banks ){
+
+		// Reuse one no event holds any more
+		for(auto &l : lazy_banks_pool){
+			if( l.use_count() == 1 ){
+				lazy_banks = l;
+				break;
+			}
+		}
+		if( !lazy_banks ){
+			lazy_banks = make_shared<DLazyModuleBanks>();
+			lazy_banks_pool.push_back(lazy_banks);
+		}
+
+		std::lock_guard<std::mutex> lck(lazy_banks->mtx);
+		lazy_banks->app       = GetJApplication();
+		lazy_banks->borptrs   = firmware_borptrs;
+		lazy_banks->associate = (jobtype & JOB_ASSOCIATE) != 0;
+		GetParseOptions(lazy_banks->options);
+		lazy_banks->pending   = 0;
+		lazy_banks->block     = NULL;
+		lazy_banks->region.reset();
+		lazy_banks->words.clear();
+		lazy_banks->spans.clear();
+		lazy_banks->events.clear();
+		for(auto pe : current_parsed_events){
+			lazy_banks->events.push_back(pe);
+			pe->lazy = lazy_banks;
+		}
+
+		// Hold on to the memory the event is in. If that is our own
+		// buff, it is handed over and we take the one the banks had
+		// from their last block (if any) for reading the next event.
+		if( !W::swapped ){
+			lazy_banks->block = ibuff;
+			if( mapped_buff ){
+				lazy_banks->region = mapped_region;
+			}else{
+				swap(buff,     lazy_banks->owned_buff);
+				swap(buff_len, lazy_banks->owned_buff_len);
+			}
+		}
+	}
+
+	DLazyModuleBanks::Span span;
+	span.rocid  = rocid;
+	span.family = family;
+	if( W::swapped ){
+		auto &words = lazy_banks->words;
+		span.begin  = words.size();
+		span.end    = span.begin + (iend - iptr);
+		words.resize(span.end);
+		swap_block32(iptr, &words[span.begin], iend - iptr);
+	}else{
+		span.begin  = iptr - ibuff;
+		span.end    = iend - ibuff;
+	}
+	lazy_banks->spans.push_back(span);
+	lazy_banks->pending |= family;
+}
+
+//----------------
+// DLazyModuleBanks::Decode
+//----------------
+void DLazyModuleBanks::Decode(uint32_t families)
+{
+	/// Decode the given families of module data into all events of
+	/// the block if not already done. This is called from the threads
+	/// processing the events so each thread has its own parser. Only
+	/// one thread at a time decodes data for a block. pending is only
+	/// cleared once the objects are made so a caller that sees its bit
+	/// cleared can use them without taking the lock.
+
+	std::lock_guard<std::mutex> lck(mtx);
+	families &= pending;
+	if( !families ) return;
+
+	static thread_local unique_ptr<JEventEVIOBuffer> parser;
+	if( !parser ) parser.reset( new JEventEVIOBuffer(app) );
+
+	try{
+		parser->DecodeLazyBanks(this, families);
+	}catch(...){
+		pending &= ~families; // don't try a bad bank again
+		throw;
+	}
+	pending &= ~families;
+}
+
+//----------------
+// DLazyModuleBanks::Detach
+//----------------
+void DLazyModuleBanks::Detach(DParsedEvent *pe)
+{
+	std::lock_guard<std::mutex> lck(mtx);
+	for(auto &e : events) if( e == pe ) e = NULL;
+}
+
+//----------------
+// DecodeLazyBanks
+//----------------
+void JEventEVIOBuffer::DecodeLazyBanks(DLazyModuleBanks *lazy, uint32_t families)
+{
+	/// Decode the given families of module data kept in lazy into its
+	/// events. Objects of this class used for this do nothing else
+	/// (see DLazyModuleBanks::Decode). Events of the block that were
+	/// already released are stood in for by scratch events from our
+	/// pool so the decoders see the same number of events.
+
+	SetParseOptions(lazy->options);
+	make_hit_views = HIT_VIEWS;
+	if( lazy->borptrs != firmware_borptrs ) UpdateFirmwareTables(lazy->borptrs);
+
+	current_parsed_events.clear();
+	uint32_t Nscratch = 0;
+	for(auto pe : lazy->events){
+		if( !pe ){
+			if( Nscratch >= parsed_event_pool.size() ) parsed_event_pool.push_back( new DParsedEvent(MAX_OBJECT_RECYCLES) );
+			pe = parsed_event_pool[Nscratch++];
+			pe->Clear();
+		}
+		current_parsed_events.push_back(pe);
+	}
+
+	switch( parse_mode ){
+		case kPARSE_TRACE:
+			DecodeLazySpans< EVIOParsePolicy<EVIONativeWords, TraceParse> >(lazy, families);
+			break;
+		case kPARSE_VALIDATE:
+			DecodeLazySpans< EVIOParsePolicy<EVIONativeWords, ValidateParse> >(lazy, families);
+			break;
+		default:
+			DecodeLazySpans< EVIOParsePolicy<EVIONativeWords, ReleaseParse> >(lazy, families);
+			break;
+	}
+	current_parsed_events.clear();
+
+	if( lazy->associate ){
+		for(auto pe : lazy->events) if( pe ) LinkAssociations(pe, families, false);
+	}
+}
+
+//----------------
+// DecodeLazySpans
+//----------------
+template<class W>
+void JEventEVIOBuffer::DecodeLazySpans(DLazyModuleBanks *lazy, uint32_t families)
+{
+	for(auto &span : lazy->spans){
+		if( !(span.family & families) ) continue;
+
+		uint32_t *iptr = lazy->Data() + span.begin;
+		uint32_t *iend = lazy->Data() + span.end;
+		if( span.family == DLazyModuleData::kCAEN1290TDC ){
+			ParseCAEN1190<W>(span.rocid, iptr, iend);
+		}else{
+			ParseJLabModuleData<W>(span.rocid, iptr, iend);
+		}
+	}
+}
+
 //----------------
 // Parsef250Bank
 //----------------
+template<class W>
 void JEventEVIOBuffer::Parsef250Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *iend)
 {
-	if(!PARSE_F250){ iptr = &iptr[(*iptr) + 1]; return; }
-
-	auto pe_iter = current_parsed_events.begin();
-	DParsedEvent *pe = NULL;
-	
-	uint32_t slot = 0;
-	uint32_t itrigger = -1;
+	if(!PARSE_F250){ iptr = &iptr[W::get(iptr) + 1]; return; }
+
+	ModuleDecodeState s;
+	s.pe_iter  = current_parsed_events.begin();
+	s.pe       = NULL;
+	s.slot     = 0;
+	s.itrigger = -1;
+
+	// Find the data-type-defining words up front (see module_words.h)
+	// so the words in between don't each need to be tested while
+	// decoding.
+	s.iptr      = iptr;
+	s.iend      = iend;
+	s.ibank     = iptr;
+	s.iblock    = NULL;
+	s.inext     = iptr;
+	s.k         = 0;
+	s.Ndefining = IndexModuleWords(iptr, iend, W::swapped, module_word_index);
+
+	// Use the decoder built for the firmware the BOR says this crate's
+	// modules have. If it stops early the generic one continues.
+	uint32_t generation = (rocid < f250_firmware.size()) ? f250_firmware[rocid]:0;
+	bool done = false;
+	if( generation == 1 ) done = Parsef250Words<W, V1FirmwareWords>(rocid, s);
+	if( generation == 2 ) done = Parsef250Words<W, V2FirmwareWords>(rocid, s);
+	if( !done ) Parsef250Words<W, AnyFirmwareWords>(rocid, s);
+
+    iptr = (s.inext>iend) ? s.inext:iend;
 
-    // Loop over data words
+    // Chop off filler words
     for(; iptr<iend; iptr++){
+        if((W::get(iptr)&0xf8000000) != 0xf8000000) break;
+    }
+}
 
-        // Skip all non-data-type-defining words at this
-        // level. When we do encounter one, the appropriate
-        // case block below should handle parsing all of
-        // the data continuation words and advance the iptr.
-        if(((*iptr>>31) & 0x1) == 0)continue;
-
-        uint32_t data_type = (*iptr>>27) & 0x0F;
+//----------------
+// Parsef250Words
+//----------------
+template<class W, class F>
+bool JEventEVIOBuffer::Parsef250Words(uint32_t rocid, ModuleDecodeState &s)
+{
+	/// Decode the words of an f250 bank from index entry s.k on.
+	/// Returns false if a word is found that firmware F does not
+	/// write. s is then left at that word so another decoder can
+	/// pick up from there.
+
+	uint32_t*     &iptr     = s.iptr;
+	DParsedEvent* &pe       = s.pe;
+	auto          &pe_iter  = s.pe_iter;
+	uint32_t      &slot     = s.slot;
+	uint32_t      &itrigger = s.itrigger;
+
+    // Loop over data-type-defining words. When we do encounter one,
+    // the appropriate case block below should handle parsing all of
+    // the data continuation words and advance the iptr. Any defining
+    // words it steps over are skipped.
+    for(; s.k<s.Ndefining; s.k++, s.inext=iptr+1){
+
+        uint32_t *iword = &s.ibank[ModuleWordOffset(module_word_index[s.k])];
+        if(iword < s.inext) continue;
+        iptr = iword;
+
+        uint32_t data_type = ModuleWordType(module_word_index[s.k]);
         switch(data_type){
             case 0: // Block Header
-                slot = (*iptr>>22) & 0x1F;
-                if(VERBOSE>7) cout << "      FADC250 Block Header: slot="<<slot<<" (0x"<<hex<<*iptr<<dec<<")"<<endl;
+                slot = (W::get(iptr)>>22) & 0x1F;
+                if(W::validate) s.iblock = iptr;
+                if(W::trace) cout << "      FADC250 Block Header: slot="<<slot<<" (0x"<<hex<<W::get(iptr)<<dec<<")"<<endl;
                 break;
             case 1: // Block Trailer
+                if(W::validate) ValidateBlockTrailer<W>(rocid, slot, s.iblock, iptr);
                 pe_iter = current_parsed_events.begin();
 				pe = NULL;
-                if(VERBOSE>7) cout << "      FADC250 Block Trailer"<<" (0x"<<hex<<*iptr<<dec<<")  iptr=0x"<<hex<<iptr<<dec<<endl;
+                if(W::trace) cout << "      FADC250 Block Trailer"<<" (0x"<<hex<<W::get(iptr)<<dec<<")  iptr=0x"<<hex<<iptr<<dec<<endl;
                 break;
             case 2: // Event Header
-                itrigger = (*iptr>>0) & 0x3FFFFF;
+                itrigger = (W::get(iptr)>>0) & 0x3FFFFF;
 				pe = *pe_iter++;
-                if(VERBOSE>7) cout << "      FADC250 Event Header: itrigger="<<itrigger<<", rocid="<<rocid<<", slot="<<slot<<")" <<" (0x"<<hex<<*iptr<<dec<<")" <<endl;
+                if(W::trace) cout << "      FADC250 Event Header: itrigger="<<itrigger<<", rocid="<<rocid<<", slot="<<slot<<")" <<" (0x"<<hex<<W::get(iptr)<<dec<<")" <<endl;
                 break;
             case 3: // Trigger Time
 				{
-					uint64_t t = ((*iptr)&0xFFFFFF)<<0;
-					if(VERBOSE>7) cout << "      FADC250 Trigger time low word="<<(((*iptr)&0xFFFFFF))<<" (0x"<<hex<<*iptr<<dec<<")"<<endl;
+					uint64_t t = (W::get(iptr)&0xFFFFFF)<<0;
+					if(W::trace) cout << "      FADC250 Trigger time low word="<<((W::get(iptr)&0xFFFFFF))<<" (0x"<<hex<<W::get(iptr)<<dec<<")"<<endl;
 					iptr++;
-					if(((*iptr>>31) & 0x1) == 0){
-						t += ((*iptr)&0xFFFFFF)<<24; // from word on the street: second trigger time word is optional!!??
-						if(VERBOSE>7) cout << "      FADC250 Trigger time high word="<<(((*iptr)&0xFFFFFF))<<" (0x"<<hex<<*iptr<<dec<<")  iptr=0x"<<hex<<iptr<<dec<<endl;
+					if(((W::get(iptr)>>31) & 0x1) == 0){
+						t += (W::get(iptr)&0xFFFFFF)<<24; // from word on the street: second trigger time word is optional!!??
+						if(W::trace) cout << "      FADC250 Trigger time high word="<<((W::get(iptr)&0xFFFFFF))<<" (0x"<<hex<<W::get(iptr)<<dec<<")  iptr=0x"<<hex<<iptr<<dec<<endl;
 					}else{
 						iptr--;
 					}
-					if(VERBOSE>7) cout << "      FADC250 Trigger Time: t="<<t<<endl;
+					if(W::trace) cout << "      FADC250 Trigger Time: t="<<t<<endl;
 					if(pe) pe->NEW_Df250TriggerTime(rocid, slot, itrigger, t);
 				}
                 break;
             case 4: // Window Raw Data
                 // iptr passed by reference and so will be updated automatically
-                if(VERBOSE>7) cout << "      FADC250 Window Raw Data"<<" (0x"<<hex<<*iptr<<dec<<")"<<endl;
-                if(pe) MakeDf250WindowRawData(pe, rocid, slot, itrigger, iptr);
+                if(W::trace) cout << "      FADC250 Window Raw Data"<<" (0x"<<hex<<W::get(iptr)<<dec<<")"<<endl;
+                if(pe) MakeDf250WindowRawData<W>(pe, rocid, slot, itrigger, iptr);
                 break;
             case 5: // Window Sum
 				{
-					uint32_t channel = (*iptr>>23) & 0x0F;
-					uint32_t sum = (*iptr>>0) & 0x3FFFFF;
-					uint32_t overflow = (*iptr>>22) & 0x1;
-					if(VERBOSE>7) cout << "      FADC250 Window Sum"<<" (0x"<<hex<<*iptr<<dec<<")"<<endl;
+					uint32_t channel = (W::get(iptr)>>23) & 0x0F;
+					uint32_t sum = (W::get(iptr)>>0) & 0x3FFFFF;
+					uint32_t overflow = (W::get(iptr)>>22) & 0x1;
+					if(W::trace) cout << "      FADC250 Window Sum"<<" (0x"<<hex<<W::get(iptr)<<dec<<")"<<endl;
 					if(pe) pe->NEW_Df250WindowSum(rocid, slot, channel, itrigger, sum, overflow);
 				}
                 break;				
             case 6: // Pulse Raw Data
 //                MakeDf250PulseRawData(objs, rocid, slot, itrigger, iptr);
-                if(VERBOSE>7) cout << "      FADC250 Pulse Raw Data"<<" (0x"<<hex<<*iptr<<dec<<")"<<endl;
+                if(W::trace) cout << "      FADC250 Pulse Raw Data"<<" (0x"<<hex<<W::get(iptr)<<dec<<")"<<endl;
                 break;
             case 7: // Pulse Integral
+				if( !F::v1 ) return false;
 				{
-					uint32_t channel = (*iptr>>23) & 0x0F;
-					uint32_t pulse_number = (*iptr>>21) & 0x03;
-					uint32_t quality_factor = (*iptr>>19) & 0x03;
-					uint32_t sum = (*iptr>>0) & 0x7FFFF;
+					uint32_t channel = (W::get(iptr)>>23) & 0x0F;
+					uint32_t pulse_number = (W::get(iptr)>>21) & 0x03;
+					uint32_t quality_factor = (W::get(iptr)>>19) & 0x03;
+					uint32_t sum = (W::get(iptr)>>0) & 0x7FFFF;
 					uint32_t nsamples_integral = 0;  // must be overwritten later in GetObjects with value from Df125Config value
 					uint32_t nsamples_pedestal = 1;  // The firmware returns an already divided pedestal
 					uint32_t pedestal = 0;  // This will be replaced by the one from Df250PulsePedestal in GetObjects
-					if(VERBOSE>7) cout << "      FADC250 Pulse Integral: chan="<<channel<<" pulse_number="<<pulse_number<<" sum="<<sum<<" (0x"<<hex<<*iptr<<dec<<")"<<endl;
+					if(W::trace) cout << "      FADC250 Pulse Integral: chan="<<channel<<" pulse_number="<<pulse_number<<" sum="<<sum<<" (0x"<<hex<<W::get(iptr)<<dec<<")"<<endl;
 					if(pe) pe->NEW_Df250PulseIntegral(rocid, slot, channel, itrigger, pulse_number, quality_factor, sum, pedestal, nsamples_integral, nsamples_pedestal);
 				}
                 break;
             case 8: // Pulse Time
+				if( !F::v1 ) return false;
 				{
-					uint32_t channel = (*iptr>>23) & 0x0F;
-					uint32_t pulse_number = (*iptr>>21) & 0x03;
-					uint32_t quality_factor = (*iptr>>19) & 0x03;
-					uint32_t pulse_time = (*iptr>>0) & 0x7FFFF;
-					if(VERBOSE>7) cout << "      FADC250 Pulse Time: chan="<<channel<<" pulse_number="<<pulse_number<<" pulse_time="<<pulse_time<<" (0x"<<hex<<*iptr<<dec<<")"<<endl;
+					uint32_t channel = (W::get(iptr)>>23) & 0x0F;
+					uint32_t pulse_number = (W::get(iptr)>>21) & 0x03;
+					uint32_t quality_factor = (W::get(iptr)>>19) & 0x03;
+					uint32_t pulse_time = (W::get(iptr)>>0) & 0x7FFFF;
+					if(W::trace) cout << "      FADC250 Pulse Time: chan="<<channel<<" pulse_number="<<pulse_number<<" pulse_time="<<pulse_time<<" (0x"<<hex<<W::get(iptr)<<dec<<")"<<endl;
 					if(pe) pe->NEW_Df250PulseTime(rocid, slot, channel, itrigger, pulse_number, quality_factor, pulse_time);
 				}
 				break;
             case 9: // Pulse Data (firmware instroduce in Fall 2016)
+				if( !F::v2 ) return false;
 				{
  					// from word 1
-					uint32_t event_number_within_block = (*iptr>>19) & 0xFF;
-					uint32_t channel                   = (*iptr>>15) & 0x0F;
-					bool     QF_pedestal               = (*iptr>>14) & 0x01;
-					uint32_t pedestal                  = (*iptr>>0 ) & 0x3FFF;
-					if(VERBOSE>7) cout << "      FADC250 Pulse Data (0x"<<hex<<*iptr<<dec<<") channel=" << channel << " pedestal="<<pedestal << " event within block=" << event_number_within_block <<endl;
+					uint32_t event_number_within_block = (W::get(iptr)>>19) & 0xFF;
+					uint32_t channel                   = (W::get(iptr)>>15) & 0x0F;
+					bool     QF_pedestal               = (W::get(iptr)>>14) & 0x01;
+					uint32_t pedestal                  = (W::get(iptr)>>0 ) & 0x3FFF;
+					if(W::trace) cout << "      FADC250 Pulse Data (0x"<<hex<<W::get(iptr)<<dec<<") channel=" << channel << " pedestal="<<pedestal << " event within block=" << event_number_within_block <<endl;
 					
 					// event_number_within_block=0 indicates error
 					if(event_number_within_block==0){
@@ -1311,6 +1931,8 @@ void JEventEVIOBuffer::Parsef250Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *
 						exit(-1);
 					}
 
+					uint32_t *iheader = iptr;
+
 					// Event headers may be supressed so determine event from hit data
 					if( (event_number_within_block > current_parsed_events.size()) ) throw JException("Bad f250 event number", __FILE__, __LINE__);
 					pe_iter = current_parsed_events.begin();
@@ -1320,31 +1942,34 @@ void JEventEVIOBuffer::Parsef250Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *
 					itrigger = event_number_within_block; // is this right?
 					uint32_t pulse_number = 0;
 					
-					while( (*++iptr>>31) == 0 ){
+					while( (W::get(++iptr)>>31) == 0 ){
 					
-						if( (*iptr>>30) != 0x01) throw JException("Bad f250 Pulse Data!", __FILE__, __LINE__);
+						if( W::validate && (iptr+1 >= s.iend) ) throw JExceptionDataFormat("f250 Pulse Data runs past end of bank!", __FILE__, __LINE__);
+						if( (W::get(iptr)>>30) != 0x01) throw JException("Bad f250 Pulse Data!", __FILE__, __LINE__);
  
 						// from word 2
-						uint32_t integral                  = (*iptr>>12) & 0x3FFFF;
-						bool     QF_NSA_beyond_PTW         = (*iptr>>11) & 0x01;
-						bool     QF_overflow               = (*iptr>>10) & 0x01;
-						bool     QF_underflow              = (*iptr>>9 ) & 0x01;
-						uint32_t nsamples_over_threshold   = (*iptr>>0 ) & 0x1FF;
-						if(VERBOSE>7) cout << "      FADC250 Pulse Data word 2(0x"<<hex<<*iptr<<dec<<")  integral="<<integral<<endl;
+						uint32_t integral                  = (W::get(iptr)>>12) & 0x3FFFF;
+						bool     QF_NSA_beyond_PTW         = (W::get(iptr)>>11) & 0x01;
+						bool     QF_overflow               = (W::get(iptr)>>10) & 0x01;
+						bool     QF_underflow              = (W::get(iptr)>>9 ) & 0x01;
+						uint32_t nsamples_over_threshold   = (W::get(iptr)>>0 ) & 0x1FF;
+						if(W::trace) cout << "      FADC250 Pulse Data word 2(0x"<<hex<<W::get(iptr)<<dec<<")  integral="<<integral<<endl;
 
 						iptr++;
-						if( (*iptr>>30) != 0x00) throw JException("Bad f250 Pulse Data!", __FILE__, __LINE__);
+						if( (W::get(iptr)>>30) != 0x00) throw JException("Bad f250 Pulse Data!", __FILE__, __LINE__);
  
 						// from word 3
-						uint32_t course_time               = (*iptr>>21) & 0x1FF;//< 4 ns/count
-						uint32_t fine_time                 = (*iptr>>15) & 0x3F;//< 0.0625 ns/count
-						uint32_t pulse_peak                = (*iptr>>3 ) & 0xFFF;
-						bool     QF_vpeak_beyond_NSA       = (*iptr>>2 ) & 0x01;
-						bool     QF_vpeak_not_found        = (*iptr>>1 ) & 0x01;
-						bool     QF_bad_pedestal           = (*iptr>>0 ) & 0x01;
-						if(VERBOSE>7) cout << "      FADC250 Pulse Data word 3(0x"<<hex<<*iptr<<dec<<")  course_time="<<course_time<<" fine_time="<<fine_time<<" pulse_peak="<<pulse_peak<<endl;
-
-						if( pe ) {
+						uint32_t course_time               = (W::get(iptr)>>21) & 0x1FF;//< 4 ns/count
+						uint32_t fine_time                 = (W::get(iptr)>>15) & 0x3F;//< 0.0625 ns/count
+						uint32_t pulse_peak                = (W::get(iptr)>>3 ) & 0xFFF;
+						bool     QF_vpeak_beyond_NSA       = (W::get(iptr)>>2 ) & 0x01;
+						bool     QF_vpeak_not_found        = (W::get(iptr)>>1 ) & 0x01;
+						bool     QF_bad_pedestal           = (W::get(iptr)>>0 ) & 0x01;
+						if(W::trace) cout << "      FADC250 Pulse Data word 3(0x"<<hex<<W::get(iptr)<<dec<<")  course_time="<<course_time<<" fine_time="<<fine_time<<" pulse_peak="<<pulse_peak<<endl;
+
+						if( pe && make_hit_views ){
+							pe->vDf250PulseDataView.emplace_back(rocid, slot, itrigger, iheader, iptr-1, pulse_number++);
+						}else if( pe ) {
 							pe->NEW_Df250PulseData(rocid, slot, channel, itrigger
 							, event_number_within_block
 							, QF_pedestal
@@ -1368,12 +1993,13 @@ void JEventEVIOBuffer::Parsef250Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *
 				}
                 break;
             case 10: // Pulse Pedestal
+				if( !F::v1 ) return false;
 				{
-					uint32_t channel = (*iptr>>23) & 0x0F;
-					uint32_t pulse_number = (*iptr>>21) & 0x03;
-					uint32_t pedestal = (*iptr>>12) & 0x1FF;
-					uint32_t pulse_peak = (*iptr>>0) & 0xFFF;
-					if(VERBOSE>7) cout << "      FADC250 Pulse Pedestal chan="<<channel<<" pulse_number="<<pulse_number<<" pedestal="<<pedestal<<" pulse_peak="<<pulse_peak<<" (0x"<<hex<<*iptr<<dec<<")"<<endl;
+					uint32_t channel = (W::get(iptr)>>23) & 0x0F;
+					uint32_t pulse_number = (W::get(iptr)>>21) & 0x03;
+					uint32_t pedestal = (W::get(iptr)>>12) & 0x1FF;
+					uint32_t pulse_peak = (W::get(iptr)>>0) & 0xFFF;
+					if(W::trace) cout << "      FADC250 Pulse Pedestal chan="<<channel<<" pulse_number="<<pulse_number<<" pedestal="<<pedestal<<" pulse_peak="<<pulse_peak<<" (0x"<<hex<<W::get(iptr)<<dec<<")"<<endl;
 					if(pe) pe->NEW_Df250PulsePedestal(rocid, slot, channel, itrigger, pulse_number, pedestal, pulse_peak);
 				}
                 break;
@@ -1384,134 +2010,166 @@ void JEventEVIOBuffer::Parsef250Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *
                 // different behavior for debug mode data as regular data.
             case 14: // Data not valid (empty module)
             case 15: // Filler (non-data) word
-            	if(VERBOSE>7) cout << "      FADC250 Event Trailer, Data not Valid, or Filler word ("<<data_type<<")"<<" (0x"<<hex<<*iptr<<dec<<")"<<endl;
+            	if(W::trace) cout << "      FADC250 Event Trailer, Data not Valid, or Filler word ("<<data_type<<")"<<" (0x"<<hex<<W::get(iptr)<<dec<<")"<<endl;
 					break;
 				default:
- 					if(VERBOSE>7) cout << "      FADC250 unknown data type ("<<data_type<<")"<<" (0x"<<hex<<*iptr<<dec<<")"<<endl;
+ 					if(W::trace) cout << "      FADC250 unknown data type ("<<data_type<<")"<<" (0x"<<hex<<W::get(iptr)<<dec<<")"<<endl;
 					throw JExceptionDataFormat("Unexpected word type in fADC125 block!", __FILE__, __LINE__);
         }
     }
-
-    // Chop off filler words
-    for(; iptr<iend; iptr++){
-        if(((*iptr)&0xf8000000) != 0xf8000000) break;
-    }
+	return true;
 }
 
 //----------------
 // MakeDf250WindowRawData
 //----------------
+template<class W>
 void JEventEVIOBuffer::MakeDf250WindowRawData(DParsedEvent *pe, uint32_t rocid, uint32_t slot, uint32_t itrigger, uint32_t* &iptr)
 {
-    uint32_t channel = (*iptr>>23) & 0x0F;
-    uint32_t window_width = (*iptr>>0) & 0x0FFF;
-
-    Df250WindowRawData *wrd = pe->NEW_Df250WindowRawData(rocid, slot, channel, itrigger);
-
-    for(uint32_t isample=0; isample<window_width; isample +=2){
-
-        // Advance to next word
-        iptr++;
-
-        // Make sure this is a data continuation word, if not, stop here
-        if(((*iptr>>31) & 0x1) != 0x0){
-            iptr--; // calling method expects us to point to last word in block
-            break;
-        }
+    uint32_t channel = (W::get(iptr)>>23) & 0x0F;
+    uint32_t window_width = (W::get(iptr)>>0) & 0x0FFF;
 
-        bool invalid_1 = (*iptr>>29) & 0x1;
-        bool invalid_2 = (*iptr>>13) & 0x1;
-        uint16_t sample_1 = 0;
-        uint16_t sample_2 = 0;
-        if(!invalid_1)sample_1 = (*iptr>>16) & 0x1FFF;
-        if(!invalid_2)sample_2 = (*iptr>>0) & 0x1FFF;
-
-        // Sample 1
-        wrd->samples.push_back(sample_1);
-        wrd->invalid_samples |= invalid_1;
-        wrd->overflow |= (sample_1>>12) & 0x1;
+    if( make_hit_views ){
+        pe->vDf250WindowRawDataView.emplace_back(rocid, slot, itrigger, iptr);
+        iptr += CountWindowSampleWords(&iptr[1], window_width, W::swapped);
+        return;
+    }
 
-        if(((isample+2) == window_width) && invalid_2)break; // skip last sample if flagged as invalid
+    Df250WindowRawData *wrd = pe->NEW_Df250WindowRawData(rocid, slot, channel, itrigger);
 
-        // Sample 2
-        wrd->samples.push_back(sample_2);
-        wrd->invalid_samples |= invalid_2;
-        wrd->overflow |= (sample_2>>12) & 0x1;
-    }
+    // Decode the sample words that follow (2 samples per word). This
+    // stops at the first word that is not a data continuation word.
+    // The calling method expects us to point to last word in block.
+    uint32_t Nwords = UnpackWindowSamples(&iptr[1], window_width, W::swapped, wrd->samples, wrd->invalid_samples, wrd->overflow);
+    iptr += Nwords;
 }
 
 //----------------
 // Parsef125Bank
 //----------------
+template<class W>
 void JEventEVIOBuffer::Parsef125Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *iend)
 {
-	if(!PARSE_F125){ iptr = &iptr[(*iptr) + 1]; return; }
-
-	auto pe_iter = current_parsed_events.begin();
-	DParsedEvent *pe = NULL;
-
-    uint32_t slot=0;
-    uint32_t itrigger = -1;
-    uint32_t last_itrigger = -2;
-    uint32_t last_pulse_time_channel=0;
-    uint32_t last_slot = -1;
-    uint32_t last_channel = -1;    
+	if(!PARSE_F125){ iptr = &iptr[W::get(iptr) + 1]; return; }
+
+	ModuleDecodeState s;
+	s.pe_iter  = current_parsed_events.begin();
+	s.pe       = NULL;
+	s.slot     = 0;
+	s.itrigger = -1;
+	s.last_itrigger = -2;
+	s.last_pulse_time_channel = 0;
+	s.last_slot    = -1;
+	s.last_channel = -1;
+
+	// Find the data-type-defining words up front (see module_words.h)
+	// so the words in between don't each need to be tested while
+	// decoding.
+	s.iptr      = iptr;
+	s.iend      = iend;
+	s.ibank     = iptr;
+	s.iblock    = NULL;
+	s.inext     = iptr;
+	s.k         = 0;
+	s.Ndefining = IndexModuleWords(iptr, iend, W::swapped, module_word_index);
+
+	// Use the decoder built for the firmware the BOR says this crate's
+	// modules have. If it stops early the generic one continues.
+	uint32_t generation = (rocid < f125_firmware.size()) ? f125_firmware[rocid]:0;
+	bool done = false;
+	if( generation == 1 ) done = Parsef125Words<W, V1FirmwareWords>(rocid, s);
+	if( generation == 2 ) done = Parsef125Words<W, V2FirmwareWords>(rocid, s);
+	if( !done ) Parsef125Words<W, AnyFirmwareWords>(rocid, s);
+
+    iptr = (s.inext>iend) ? s.inext:iend;
 
-    // Loop over data words
+    // Chop off filler words
     for(; iptr<iend; iptr++){
+        if((W::get(iptr)&0xf8000000) != 0xf8000000) break;
+    }
+}
 
-        // Skip all non-data-type-defining words at this
-        // level. When we do encounter one, the appropriate
-        // case block below should handle parsing all of
-        // the data continuation words and advance the iptr.
-        if(((*iptr>>31) & 0x1) == 0)continue;
-
-        uint32_t data_type = (*iptr>>27) & 0x0F;
+//----------------
+// Parsef125Words
+//----------------
+template<class W, class F>
+bool JEventEVIOBuffer::Parsef125Words(uint32_t rocid, ModuleDecodeState &s)
+{
+	/// Decode the words of an f125 bank from index entry s.k on.
+	/// Returns false if a word is found that firmware F does not
+	/// write. s is then left at that word so another decoder can
+	/// pick up from there.
+
+	uint32_t*     &iptr     = s.iptr;
+	uint32_t*      iend     = s.iend;
+	DParsedEvent* &pe       = s.pe;
+	auto          &pe_iter  = s.pe_iter;
+	uint32_t      &slot     = s.slot;
+	uint32_t      &itrigger = s.itrigger;
+	uint32_t      &last_itrigger = s.last_itrigger;
+	uint32_t      &last_pulse_time_channel = s.last_pulse_time_channel;
+	uint32_t      &last_slot    = s.last_slot;
+	uint32_t      &last_channel = s.last_channel;
+
+    // Loop over data-type-defining words. When we do encounter one,
+    // the appropriate case block below should handle parsing all of
+    // the data continuation words and advance the iptr. Any defining
+    // words it steps over are skipped.
+    for(; s.k<s.Ndefining; s.k++, s.inext=iptr+1){
+
+        uint32_t *iword = &s.ibank[ModuleWordOffset(module_word_index[s.k])];
+        if(iword < s.inext) continue;
+        iptr = iword;
+
+        uint32_t data_type = ModuleWordType(module_word_index[s.k]);
         switch(data_type){
             case 0: // Block Header
-                slot = (*iptr>>22) & 0x1F;
-                if(VERBOSE>7) cout << "      FADC125 Block Header: slot="<<slot<<endl;
+                slot = (W::get(iptr)>>22) & 0x1F;
+                if(W::validate) s.iblock = iptr;
+                if(W::trace) cout << "      FADC125 Block Header: slot="<<slot<<endl;
                 break;
             case 1: // Block Trailer
+				if(W::validate) ValidateBlockTrailer<W>(rocid, slot, s.iblock, iptr);
 				pe_iter = current_parsed_events.begin();
 				pe = NULL;
 				break;
             case 2: // Event Header
-                //slot_event_header = (*iptr>>22) & 0x1F;
-                itrigger = (*iptr>>0) & 0x3FFFFFF;
+                //slot_event_header = (W::get(iptr)>>22) & 0x1F;
+                itrigger = (W::get(iptr)>>0) & 0x3FFFFFF;
 				pe = *pe_iter++;
-                if(VERBOSE>7) cout << "      FADC125 Event Header: itrigger="<<itrigger<<" last_itrigger="<<last_itrigger<<", rocid="<<rocid<<", slot="<<slot <<endl;
+                if(W::trace) cout << "      FADC125 Event Header: itrigger="<<itrigger<<" last_itrigger="<<last_itrigger<<", rocid="<<rocid<<", slot="<<slot <<endl;
 				break;
             case 3: // Trigger Time
 				{
-					uint64_t t = ((*iptr)&0xFFFFFF)<<0;
+					uint64_t t = (W::get(iptr)&0xFFFFFF)<<0;
 					iptr++;
-					if(((*iptr>>31) & 0x1) == 0){
-						t += ((*iptr)&0xFFFFFF)<<24; // from word on the street: second trigger time word is optional!!??
+					if(((W::get(iptr)>>31) & 0x1) == 0){
+						t += (W::get(iptr)&0xFFFFFF)<<24; // from word on the street: second trigger time word is optional!!??
 					}else{
 						iptr--;
 					}
-					if(VERBOSE>7) cout << "      FADC125 Trigger Time (t="<<t<<")"<<endl;
+					if(W::trace) cout << "      FADC125 Trigger Time (t="<<t<<")"<<endl;
 					if(pe) pe->NEW_Df125TriggerTime(rocid, slot, itrigger, t);
 				}
                 break;
             case 4: // Window Raw Data
 					// iptr passed by reference and so will be updated automatically
-					if(VERBOSE>7) cout << "      FADC125 Window Raw Data"<<endl;
-					if(pe) MakeDf125WindowRawData(pe, rocid, slot, itrigger, iptr);
+					if(W::trace) cout << "      FADC125 Window Raw Data"<<endl;
+					if(pe) MakeDf125WindowRawData<W>(pe, rocid, slot, itrigger, iptr);
 					break;
 
             case 5: // CDC pulse data (new)  (GlueX-doc-2274-v8)
+				if( !F::v2 ) return false;
 				{
 					// Word 1:
-					uint32_t word1          = *iptr;
-					uint32_t channel        = (*iptr>>20) & 0x7F;
-					uint32_t pulse_number   = (*iptr>>15) & 0x1F;
-					uint32_t pulse_time     = (*iptr>>4 ) & 0x7FF;
-					uint32_t quality_factor = (*iptr>>3 ) & 0x1; //time QF bit
-					uint32_t overflow_count = (*iptr>>0 ) & 0x7;
-					if(VERBOSE>7){
-						cout << "      FADC125 CDC Pulse Data word1: " << hex << (*iptr) << dec << endl;
+					uint32_t word1          = W::get(iptr);
+					uint32_t channel        = (W::get(iptr)>>20) & 0x7F;
+					uint32_t pulse_number   = (W::get(iptr)>>15) & 0x1F;
+					uint32_t pulse_time     = (W::get(iptr)>>4 ) & 0x7FF;
+					uint32_t quality_factor = (W::get(iptr)>>3 ) & 0x1; //time QF bit
+					uint32_t overflow_count = (W::get(iptr)>>0 ) & 0x7;
+					if(W::trace){
+						cout << "      FADC125 CDC Pulse Data word1: " << hex << W::get(iptr) << dec << endl;
 						cout << "      FADC125 CDC Pulse Data (chan="<<channel<<" pulse="<<pulse_number<<" time="<<pulse_time<<" QF="<<quality_factor<<" OC="<<overflow_count<<")"<<endl;
 					}
 
@@ -1521,16 +2179,16 @@ void JEventEVIOBuffer::Parsef125Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *
 						jerr << " Truncated f125 CDC hit (block ends before continuation word!)" << endl;
 						continue;
 					}
-					if( ((*iptr>>31) & 0x1) != 0 ){
+					if( ((W::get(iptr)>>31) & 0x1) != 0 ){
 						jerr << " Truncated f125 CDC hit (missing continuation word!)" << endl;
 						continue;
 					}
-					uint32_t word2      = *iptr;
-					uint32_t pedestal   = (*iptr>>23) & 0xFF;
-					uint32_t sum        = (*iptr>>9 ) & 0x3FFF;
-					uint32_t pulse_peak = (*iptr>>0 ) & 0x1FF;
-					if(VERBOSE>7){
-						cout << "      FADC125 CDC Pulse Data word2: " << hex << (*iptr) << dec << endl;
+					uint32_t word2      = W::get(iptr);
+					uint32_t pedestal   = (W::get(iptr)>>23) & 0xFF;
+					uint32_t sum        = (W::get(iptr)>>9 ) & 0x3FFF;
+					uint32_t pulse_peak = (W::get(iptr)>>0 ) & 0x1FF;
+					if(W::trace){
+						cout << "      FADC125 CDC Pulse Data word2: " << hex << W::get(iptr) << dec << endl;
 						cout << "      FADC125 CDC Pulse Data (pedestal="<<pedestal<<" sum="<<sum<<" peak="<<pulse_peak<<")"<<endl;
 					}
 
@@ -1538,7 +2196,11 @@ void JEventEVIOBuffer::Parsef125Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *
 					uint32_t nsamples_integral = 0;  // must be overwritten later in GetObjects with value from Df125Config value
 					uint32_t nsamples_pedestal = 1;  // The firmware pedestal divided by 2^PBIT where PBIT is a config. parameter
 
-					if( pe ) {
+					if( pe && make_hit_views ){
+						pe->vDf125CDCPulseView.emplace_back(rocid, slot, itrigger, iptr-1);
+					}else if( pe && HIT_COLUMNS ){
+						pe->cDf125CDCPulse.push_back(rocid, slot, channel, itrigger, pulse_number, pulse_time, quality_factor, overflow_count, pedestal, sum, pulse_peak, word1, word2);
+					}else if( pe ) {
 						pe->NEW_Df125CDCPulse(rocid, slot, channel, itrigger
 									, pulse_number        // NPK
 									, pulse_time          // le_time
@@ -1557,16 +2219,17 @@ void JEventEVIOBuffer::Parsef125Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *
                 break;
 
             case 6: // FDC pulse data-integral (new)  (GlueX-doc-2274-v8)
+				if( !F::v2 ) return false;
 				{
 					// Word 1:
-					uint32_t word1          = *iptr;
-					uint32_t channel        = (*iptr>>20) & 0x7F;
-					uint32_t pulse_number   = (*iptr>>15) & 0x1F;
-					uint32_t pulse_time     = (*iptr>>4 ) & 0x7FF;
-					uint32_t quality_factor = (*iptr>>3 ) & 0x1; //time QF bit
-					uint32_t overflow_count = (*iptr>>0 ) & 0x7;
-					if(VERBOSE>7){
-						cout << "      FADC125 FDC Pulse Data(integral) word1: " << hex << (*iptr) << dec << endl;
+					uint32_t word1          = W::get(iptr);
+					uint32_t channel        = (W::get(iptr)>>20) & 0x7F;
+					uint32_t pulse_number   = (W::get(iptr)>>15) & 0x1F;
+					uint32_t pulse_time     = (W::get(iptr)>>4 ) & 0x7FF;
+					uint32_t quality_factor = (W::get(iptr)>>3 ) & 0x1; //time QF bit
+					uint32_t overflow_count = (W::get(iptr)>>0 ) & 0x7;
+					if(W::trace){
+						cout << "      FADC125 FDC Pulse Data(integral) word1: " << hex << W::get(iptr) << dec << endl;
 						cout << "      FADC125 FDC Pulse Data (chan="<<channel<<" pulse="<<pulse_number<<" time="<<pulse_time<<" QF="<<quality_factor<<" OC="<<overflow_count<<")"<<endl;
 					}
 
@@ -1576,17 +2239,17 @@ void JEventEVIOBuffer::Parsef125Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *
 						jerr << " Truncated f125 FDC hit (block ends before continuation word!)" << endl;
 						continue;
 					}
-					if( ((*iptr>>31) & 0x1) != 0 ){
+					if( ((W::get(iptr)>>31) & 0x1) != 0 ){
 						jerr << " Truncated f125 FDC hit (missing continuation word!)" << endl;
 						continue;
 					}
-					uint32_t word2      = *iptr;
+					uint32_t word2      = W::get(iptr);
 					uint32_t pulse_peak = 0;
-					uint32_t sum        = (*iptr>>19) & 0xFFF;
-					uint32_t peak_time  = (*iptr>>11) & 0xFF;
-					uint32_t pedestal   = (*iptr>>0 ) & 0x7FF;
-					if(VERBOSE>7){
-						cout << "      FADC125 FDC Pulse Data(integral) word2: " << hex << (*iptr) << dec << endl;
+					uint32_t sum        = (W::get(iptr)>>19) & 0xFFF;
+					uint32_t peak_time  = (W::get(iptr)>>11) & 0xFF;
+					uint32_t pedestal   = (W::get(iptr)>>0 ) & 0x7FF;
+					if(W::trace){
+						cout << "      FADC125 FDC Pulse Data(integral) word2: " << hex << W::get(iptr) << dec << endl;
 						cout << "      FADC125 FDC Pulse Data (integral="<<sum<<" time="<<peak_time<<" pedestal="<<pedestal<<")"<<endl;
 					}
 
@@ -1594,7 +2257,11 @@ void JEventEVIOBuffer::Parsef125Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *
 					uint32_t nsamples_integral = 0;  // must be overwritten later in GetObjects with value from Df125Config value
 					uint32_t nsamples_pedestal = 1;  // The firmware pedestal divided by 2^PBIT where PBIT is a config. parameter
 
-					if( pe ) {
+					if( pe && make_hit_views ){
+						pe->vDf125FDCPulseView.emplace_back(rocid, slot, itrigger, iptr-1);
+					}else if( pe && HIT_COLUMNS ){
+						pe->cDf125FDCPulse.push_back(rocid, slot, channel, itrigger, pulse_number, pulse_time, quality_factor, overflow_count, pedestal, sum, pulse_peak, peak_time, word1, word2);
+					}else if( pe ) {
 						pe->NEW_Df125FDCPulse(rocid, slot, channel, itrigger
 									, pulse_number        // NPK
 									, pulse_time          // le_time
@@ -1614,10 +2281,11 @@ void JEventEVIOBuffer::Parsef125Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *
                 break;
 
             case 7: // Pulse Integral
+				if( !F::v1 ) return false;
 				{
-					if(VERBOSE>7) cout << "      FADC125 Pulse Integral"<<endl;
-					uint32_t channel = (*iptr>>20) & 0x7F;
-					uint32_t sum = (*iptr>>0) & 0xFFFFF;
+					if(W::trace) cout << "      FADC125 Pulse Integral"<<endl;
+					uint32_t channel = (W::get(iptr)>>20) & 0x7F;
+					uint32_t sum = (W::get(iptr)>>0) & 0xFFFFF;
 					uint32_t quality_factor = 0;
 					uint32_t nsamples_integral = 0;  // must be overwritten later in GetObjects with value from Df125Config value
 					uint32_t nsamples_pedestal = 1;  // The firmware returns an already divided pedestal
@@ -1630,11 +2298,12 @@ void JEventEVIOBuffer::Parsef125Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *
 				}
                 break;
             case 8: // Pulse Time
+				if( !F::v1 ) return false;
 				{
-					if(VERBOSE>7) cout << "      FADC125 Pulse Time"<<endl;
-					uint32_t channel = (*iptr>>20) & 0x7F;
-					uint32_t pulse_number = (*iptr>>18) & 0x03;
-					uint32_t pulse_time = (*iptr>>0) & 0xFFFF;
+					if(W::trace) cout << "      FADC125 Pulse Time"<<endl;
+					uint32_t channel = (W::get(iptr)>>20) & 0x7F;
+					uint32_t pulse_number = (W::get(iptr)>>18) & 0x03;
+					uint32_t pulse_time = (W::get(iptr)>>0) & 0xFFFF;
 					uint32_t quality_factor = 0;
 					if( pe ) pe->NEW_Df125PulseTime(rocid, slot, channel, itrigger, pulse_number, quality_factor, pulse_time);
 					last_pulse_time_channel = channel;
@@ -1642,16 +2311,17 @@ void JEventEVIOBuffer::Parsef125Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *
                 break;
 
             case 9: // FDC pulse data-peak (new)  (GlueX-doc-2274-v8)
+				if( !F::v2 ) return false;
 				{
 					// Word 1:
-					uint32_t word1          = *iptr;
-					uint32_t channel        = (*iptr>>20) & 0x7F;
-					uint32_t pulse_number   = (*iptr>>15) & 0x1F;
-					uint32_t pulse_time     = (*iptr>>4 ) & 0x7FF;
-					uint32_t quality_factor = (*iptr>>3 ) & 0x1; //time QF bit
-					uint32_t overflow_count = (*iptr>>0 ) & 0x7;
-					if(VERBOSE>7){
-						cout << "      FADC125 FDC Pulse Data(peak) word1: " << hex << (*iptr) << dec << endl;
+					uint32_t word1          = W::get(iptr);
+					uint32_t channel        = (W::get(iptr)>>20) & 0x7F;
+					uint32_t pulse_number   = (W::get(iptr)>>15) & 0x1F;
+					uint32_t pulse_time     = (W::get(iptr)>>4 ) & 0x7FF;
+					uint32_t quality_factor = (W::get(iptr)>>3 ) & 0x1; //time QF bit
+					uint32_t overflow_count = (W::get(iptr)>>0 ) & 0x7;
+					if(W::trace){
+						cout << "      FADC125 FDC Pulse Data(peak) word1: " << hex << W::get(iptr) << dec << endl;
 						cout << "      FADC125 FDC Pulse Data (chan="<<channel<<" pulse="<<pulse_number<<" time="<<pulse_time<<" QF="<<quality_factor<<" OC="<<overflow_count<<")"<<endl;
 					}
 
@@ -1661,17 +2331,17 @@ void JEventEVIOBuffer::Parsef125Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *
 						jerr << " Truncated f125 FDC hit (block ends before continuation word!)" << endl;
 						continue;
 					}
-					if( ((*iptr>>31) & 0x1) != 0 ){
+					if( ((W::get(iptr)>>31) & 0x1) != 0 ){
 						jerr << " Truncated f125 FDC hit (missing continuation word!)" << endl;
 						continue;
 					}
-					uint32_t word2      = *iptr;
-					uint32_t pulse_peak = (*iptr>>19) & 0xFFF;
+					uint32_t word2      = W::get(iptr);
+					uint32_t pulse_peak = (W::get(iptr)>>19) & 0xFFF;
 					uint32_t sum        = 0;
-					uint32_t peak_time  = (*iptr>>11) & 0xFF;
-					uint32_t pedestal   = (*iptr>>0 ) & 0x7FF;
-					if(VERBOSE>7){
-						cout << "      FADC125 FDC Pulse Data(peak) word2: " << hex << (*iptr) << dec << endl;
+					uint32_t peak_time  = (W::get(iptr)>>11) & 0xFF;
+					uint32_t pedestal   = (W::get(iptr)>>0 ) & 0x7FF;
+					if(W::trace){
+						cout << "      FADC125 FDC Pulse Data(peak) word2: " << hex << W::get(iptr) << dec << endl;
 						cout << "      FADC125 FDC Pulse Data (integral="<<sum<<" time="<<peak_time<<" pedestal="<<pedestal<<")"<<endl;
 					}
 
@@ -1679,7 +2349,19 @@ void JEventEVIOBuffer::Parsef125Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *
 					uint32_t nsamples_integral = 0;  // must be overwritten later in GetObjects with value from Df125Config value
 					uint32_t nsamples_pedestal = 1;  // The firmware pedestal divided by 2^PBIT where PBIT is a config. parameter
 
-					if( pe ) {
+					if( pe && make_hit_views ){
+						// Same CDC/FDC split as below
+						if( rocid<30 )
+							pe->vDf125CDCPulseView.emplace_back(rocid, slot, itrigger, iptr-1);
+						else
+							pe->vDf125FDCPulseView.emplace_back(rocid, slot, itrigger, iptr-1);
+					}else if( pe && HIT_COLUMNS ){
+						// Same CDC/FDC split as below
+						if( rocid<30 )
+							pe->cDf125CDCPulse.push_back(rocid, slot, channel, itrigger, pulse_number, pulse_time, quality_factor, overflow_count, pedestal, sum, pulse_peak, word1, word2);
+						else
+							pe->cDf125FDCPulse.push_back(rocid, slot, channel, itrigger, pulse_number, pulse_time, quality_factor, overflow_count, pedestal, sum, pulse_peak, peak_time, word1, word2);
+					}else if( pe ) {
 					
 						// The following is a temporary fix. In late 2017 the CDC group started
 						// using data type 9 (i.e. FDC pulse peak). This caused many conflicts
@@ -1726,13 +2408,14 @@ void JEventEVIOBuffer::Parsef125Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *
                 break;
 
             case 10: // Pulse Pedestal (consistent with Beni's hand-edited version of Cody's document)
+				if( !F::v1 ) return false;
 				{
-					if(VERBOSE>7) cout << "      FADC125 Pulse Pedestal"<<endl;
-					//channel = (*iptr>>20) & 0x7F;
+					if(W::trace) cout << "      FADC125 Pulse Pedestal"<<endl;
+					//channel = (W::get(iptr)>>20) & 0x7F;
 					uint32_t channel = last_pulse_time_channel; // not enough bits to hold channel number so rely on proximity to Pulse Time in data stream (see "FADC125 dataformat 250 modes.docx")
-					uint32_t pulse_number = (*iptr>>21) & 0x03;
-					uint32_t pedestal = (*iptr>>12) & 0x1FF;
-					uint32_t pulse_peak = (*iptr>>0) & 0xFFF;
+					uint32_t pulse_number = (W::get(iptr)>>21) & 0x03;
+					uint32_t pedestal = (W::get(iptr)>>12) & 0x1FF;
+					uint32_t pulse_peak = (W::get(iptr)>>0) & 0xFFF;
 					uint32_t nsamples_pedestal = 1;  // The firmware returns an already divided pedestal
 					if( pe ) pe->NEW_Df125PulsePedestal(rocid, slot, channel, itrigger, pulse_number, pedestal, pulse_peak, nsamples_pedestal);
 				}
@@ -1741,66 +2424,79 @@ void JEventEVIOBuffer::Parsef125Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *
             case 13: // Event Trailer
             case 14: // Data not valid (empty module)
             case 15: // Filler (non-data) word
-                if(VERBOSE>7) cout << "      FADC125 ignored data type: " << data_type <<endl;
+                if(W::trace) cout << "      FADC125 ignored data type: " << data_type <<endl;
                 break;
 				default:
- 					if(VERBOSE>7) cout << "      FADC125 unknown data type ("<<data_type<<")"<<" (0x"<<hex<<*iptr<<dec<<")"<<endl;
+ 					if(W::trace) cout << "      FADC125 unknown data type ("<<data_type<<")"<<" (0x"<<hex<<W::get(iptr)<<dec<<")"<<endl;
 					throw JExceptionDataFormat("Unexpected word type in fADC125 block!", __FILE__, __LINE__);
 
         }
     }
-
-    // Chop off filler words
-    for(; iptr<iend; iptr++){
-        if(((*iptr)&0xf8000000) != 0xf8000000) break;
-    }
+	return true;
 }
 
 //----------------
 // MakeDf125WindowRawData
 //----------------
+template<class W>
 void JEventEVIOBuffer::MakeDf125WindowRawData(DParsedEvent *pe, uint32_t rocid, uint32_t slot, uint32_t itrigger, uint32_t* &iptr)
 {
-    uint32_t channel = (*iptr>>20) & 0x7F;
-    uint32_t window_width = (*iptr>>0) & 0x0FFF;
+    uint32_t channel = (W::get(iptr)>>20) & 0x7F;
+    uint32_t window_width = (W::get(iptr)>>0) & 0x0FFF;
+
+    if( make_hit_views ){
+        pe->vDf125WindowRawDataView.emplace_back(rocid, slot, itrigger, iptr);
+        uint32_t Nwords = CountWindowSampleWords(&iptr[1], window_width, W::swapped);
+        iptr += Nwords;
+        if( Nwords < (window_width+1)/2 ) iptr++;
+        return;
+    }
 
     Df125WindowRawData *wrd = pe->NEW_Df125WindowRawData(rocid, slot, channel, itrigger);
 
-    for(uint32_t isample=0; isample<window_width; isample +=2){
-
-        // Advance to next word
-        iptr++;
-
-        // Make sure this is a data continuation word, if not, stop here
-        if(((*iptr>>31) & 0x1) != 0x0)break;
-
-        bool invalid_1 = (*iptr>>29) & 0x1;
-        bool invalid_2 = (*iptr>>13) & 0x1;
-        uint16_t sample_1 = 0;
-        uint16_t sample_2 = 0;
-        if(!invalid_1)sample_1 = (*iptr>>16) & 0x1FFF;
-        if(!invalid_2)sample_2 = (*iptr>>0) & 0x1FFF;
-
-        // Sample 1
-        wrd->samples.push_back(sample_1);
-        wrd->invalid_samples |= invalid_1;
-        wrd->overflow |= (sample_1>>12) & 0x1;
+    // Decode the sample words that follow (2 samples per word). Unlike
+    // the f250 case, if a word that is not a data continuation word is
+    // found we are left pointing at it.
+    uint32_t Nwords = UnpackWindowSamples(&iptr[1], window_width, W::swapped, wrd->samples, wrd->invalid_samples, wrd->overflow);
+    iptr += Nwords;
+    if( Nwords < (window_width+1)/2 ) iptr++;
+}
 
-        if((isample+2) == window_width && invalid_2)break; // skip last sample if flagged as invalid
+//----------------
+// ValidateBlockTrailer
+//----------------
+template<class W>
+void JEventEVIOBuffer::ValidateBlockTrailer(uint32_t rocid, uint32_t slot, const uint32_t *iblock, const uint32_t *itrailer)
+{
+	/// Check a JLab module block trailer against the block header at
+	/// iblock. The trailer gives the slot (bits 22-26) and the number
+	/// of words in the block including the header and trailer (bits
+	/// 0-21). This is only done for parse modes with W::validate set.
+
+	uint32_t trailer_slot = (W::get(itrailer)>>22) & 0x1F;
+	uint32_t Nwords       = (W::get(itrailer)>> 0) & 0x3FFFFF;
+
+	if( iblock!=NULL && trailer_slot==slot && Nwords==(uint32_t)(itrailer - iblock + 1) ) return;
+
+	stringstream ss;
+	if( iblock == NULL ){
+		ss << "Block trailer without block header (rocid=" << rocid << " slot=" << trailer_slot << ")";
+	}else if( trailer_slot != slot ){
+		ss << "Block trailer slot " << trailer_slot << " does not match block header slot " << slot << " (rocid=" << rocid << ")";
+	}else{
+		ss << "Block trailer word count " << Nwords << " does not match block size " << (itrailer - iblock + 1) << " (rocid=" << rocid << " slot=" << slot << ")";
+	}
 
-        // Sample 2
-        wrd->samples.push_back(sample_2);
-        wrd->invalid_samples |= invalid_2;
-        wrd->overflow |= (sample_2>>12) & 0x1;
-    }
+	throw JExceptionDataFormat(ss.str(), __FILE__, __LINE__);
 }
 
 //----------------
 // ParseF1TDCBank
 //----------------
+template<class W>
 void JEventEVIOBuffer::ParseF1TDCBank(uint32_t rocid, uint32_t* &iptr, uint32_t *iend)
 {
-	if(!PARSE_F1TDC){ iptr = &iptr[(*iptr) + 1]; return; }
+	if(!PARSE_F1TDC){ iptr = &iptr[W::get(iptr) + 1]; return; }
 
 	uint32_t *istart = iptr;
 
@@ -1811,39 +2507,48 @@ void JEventEVIOBuffer::ParseF1TDCBank(uint32_t rocid, uint32_t* &iptr, uint32_t
 	uint32_t modtype = 0;
     uint32_t itrigger = -1;
 	uint32_t trig_time_f1header = 0;
+	uint32_t *iblock = NULL;
 
 	// Some early data had a marker word at just before the actual F1 data
-	if(*iptr == 0xf1daffff) iptr++;
-
-    // Loop over data words
-    for(; iptr<iend; iptr++){
-
-        // Skip all non-data-type-defining words at this
-        // level. When we do encounter one, the appropriate
-        // case block below should handle parsing all of
-        // the data continuation words and advance the iptr.
-        if(((*iptr>>31) & 0x1) == 0)continue;
-
- 		uint32_t data_type = (*iptr>>27) & 0x0F;
+	if(W::get(iptr) == 0xf1daffff) iptr++;
+
+    // Loop over data-type-defining words. These are found up front
+    // by IndexModuleWords so the words in between don't each need
+    // to be tested here. When we do encounter one, the appropriate
+    // case block below should handle parsing all of the data
+    // continuation words and advance the iptr. Any defining words
+    // it steps over are skipped.
+    uint32_t *ibank = iptr;
+    uint32_t *inext = iptr;
+    uint32_t Ndefining = IndexModuleWords(ibank, iend, W::swapped, module_word_index);
+    for(uint32_t k=0; k<Ndefining; k++, inext=iptr+1){
+
+        uint32_t *iword = &ibank[ModuleWordOffset(module_word_index[k])];
+        if(iword < inext) continue;
+        iptr = iword;
+
+ 		uint32_t data_type = ModuleWordType(module_word_index[k]);
         switch(data_type){
 			case 0: // Block Header
-				slot = (*iptr)>>22 & 0x001F;
-				modtype = (*iptr)>>18 & 0x000F;  // should match a DModuleType::type_id_t
-				if(VERBOSE>7) cout << "      F1 Block Header: slot=" << slot << " modtype=" << modtype << endl;
+				slot = W::get(iptr)>>22 & 0x001F;
+				modtype = W::get(iptr)>>18 & 0x000F;  // should match a DModuleType::type_id_t
+				if(W::validate) iblock = iptr;
+				if(W::trace) cout << "      F1 Block Header: slot=" << slot << " modtype=" << modtype << endl;
 				break;
 		
             case 1: // Block Trailer
+				if(W::validate) ValidateBlockTrailer<W>(rocid, slot, iblock, iptr);
 				pe_iter = current_parsed_events.begin();
 				pe = NULL;
-				if(VERBOSE>7) cout << "      F1 Block Trailer" << endl;
+				if(W::trace) cout << "      F1 Block Trailer" << endl;
                 break;
 
 			case 2: // Event Header
 				{
 					pe = *pe_iter++;
-					itrigger = (*iptr)>>0  & 0x0003FFFFF;
-					if(VERBOSE>7) {
-						uint32_t slot_event_header  = (*iptr)>>22 & 0x00000001F;
+					itrigger = W::get(iptr)>>0  & 0x0003FFFFF;
+					if(W::trace) {
+						uint32_t slot_event_header  = W::get(iptr)>>22 & 0x00000001F;
 						cout << "      F1 Event Header: slot=" << slot_event_header << " itrigger=" << itrigger << endl;
 					}
 				}
@@ -1851,38 +2556,45 @@ void JEventEVIOBuffer::ParseF1TDCBank(uint32_t rocid, uint32_t* &iptr, uint32_t
 
 			case 3: // Trigger time
 				{
-					uint64_t t = ((*iptr)&0xFFFFFF)<<0;
+					uint64_t t = (W::get(iptr)&0xFFFFFF)<<0;
 					iptr++;
-					if(((*iptr>>31) & 0x1) == 0){
-						t += ((*iptr)&0xFFFFFF)<<24; // from word on the street: second trigger time word is optional!!??
+					if(((W::get(iptr)>>31) & 0x1) == 0){
+						t += (W::get(iptr)&0xFFFFFF)<<24; // from word on the street: second trigger time word is optional!!??
 					}else{
 						iptr--;
 					}
-					if(VERBOSE>7) cout << "      F1TDC Trigger Time (t="<<t<<")"<<endl;
+					if(W::trace) cout << "      F1TDC Trigger Time (t="<<t<<")"<<endl;
 					if(pe) pe->NEW_DF1TDCTriggerTime(rocid, slot, itrigger, t);
 				}
 				break;
 			
 			case 8: // F1 Chip Header
-				trig_time_f1header    = ((*iptr)>> 7) & 0x1FF;
-				if(VERBOSE>7) {
-					uint32_t chip_f1header         = ((*iptr)>> 3) & 0x07;
-					uint32_t chan_on_chip_f1header = ((*iptr)>> 0) & 0x07;  // this is always 7 in real data!
-					uint32_t itrigger_f1header     = ((*iptr)>>16) & 0x3F;
+				trig_time_f1header    = (W::get(iptr)>> 7) & 0x1FF;
+				if(W::trace) {
+					uint32_t chip_f1header         = (W::get(iptr)>> 3) & 0x07;
+					uint32_t chan_on_chip_f1header = (W::get(iptr)>> 0) & 0x07;  // this is always 7 in real data!
+					uint32_t itrigger_f1header     = (W::get(iptr)>>16) & 0x3F;
 					cout << "      Found F1 header: chip=" << chip_f1header << " chan=" << chan_on_chip_f1header << " itrig=" << itrigger_f1header << " trig_time=" << trig_time_f1header << endl;
 				}
 				break;
 
 			case 7: // F1 Data
 				{
-					uint32_t chip         = (*iptr>>19) & 0x07;
-					uint32_t chan_on_chip = (*iptr>>16) & 0x07;
-					uint32_t time         = (*iptr>> 0) & 0xFFFF;
+					uint32_t chip         = (W::get(iptr)>>19) & 0x07;
+					uint32_t chan_on_chip = (W::get(iptr)>>16) & 0x07;
+					uint32_t time         = (W::get(iptr)>> 0) & 0xFFFF;
 					uint32_t channel      = F1TDC_channel(chip, chan_on_chip, modtype);
-					if(VERBOSE>7) cout << "      Found F1 data  : chip=" << chip << " chan=" << chan_on_chip  << " time=" << time << endl;
+					if(W::trace) cout << "      Found F1 data  : chip=" << chip << " chan=" << chan_on_chip  << " time=" << time << endl;
 					if(pe){
-						auto hit = pe->NEW_DF1TDCHit(rocid, slot, channel, itrigger, trig_time_f1header, time, *iptr, MODULE_TYPE(modtype));
-						if(hit->res_status==0){
+						bool res_status;
+						if( make_hit_views ){
+							pe->vDF1TDCHitView.emplace_back(rocid, slot, itrigger, trig_time_f1header, MODULE_TYPE(modtype), iptr);
+							res_status = (W::get(iptr)>>26) & 0x1;
+						}else{
+							auto hit = pe->NEW_DF1TDCHit(rocid, slot, channel, itrigger, trig_time_f1header, time, W::get(iptr), MODULE_TYPE(modtype));
+							res_status = hit->res_status;
+						}
+						if(res_status==0){
 							static uint32_t Nwarnings=0;
 							if(Nwarnings<10) jerr << "ERROR: F1 TDC chip \"unlocked\" flag set!" << ((++Nwarnings == 10) ? " -- last warning":"") << endl;
 						}
@@ -1891,7 +2603,7 @@ void JEventEVIOBuffer::ParseF1TDCBank(uint32_t rocid, uint32_t* &iptr, uint32_t
 				break;
 
 			case 15: // Filler word
-				if(VERBOSE>7) cout << "      F1 filler word" << endl;
+				if(W::trace) cout << "      F1 filler word" << endl;
 			case 14: // Data not valid (how to handle this?)
 				break;
 
@@ -1900,9 +2612,9 @@ void JEventEVIOBuffer::ParseF1TDCBank(uint32_t rocid, uint32_t* &iptr, uint32_t
 				cout.flush(); cerr.flush();
 				_DBG_<<"Unknown data word in F1TDC block. Dumping for debugging:" << _DBG_ENDL_;
 				for(const uint32_t *iiptr = istart; iiptr<iend; iiptr++){
-					_DBG_<<"0x"<<hex<<*iiptr<<dec;
+					_DBG_<<"0x"<<hex<<W::get(iiptr)<<dec;
 					if(iiptr == iptr)cerr<<"  <----";
-					switch( (*iiptr) & 0xF8000000 ){
+					switch( W::get(iiptr) & 0xF8000000 ){
 						case 0x80000000: cerr << "   F1 Block Header"; break;
 						case 0x90000000: cerr << "   F1 Event Header"; break;
 						case 0x98000000: cerr << "   F1 Trigger time"; break;
@@ -1920,14 +2632,16 @@ void JEventEVIOBuffer::ParseF1TDCBank(uint32_t rocid, uint32_t* &iptr, uint32_t
 				break;
 		}
 	}	
+	iptr = (inext>iend) ? inext:iend;
 
 	// Skip filler words
-	while(iptr<iend && (*iptr&0xF8000000)==0xF8000000)iptr++;
+	while(iptr<iend && (W::get(iptr)&0xF8000000)==0xF8000000)iptr++;
 }
 
 //----------------
 // ParseDEventRFBunchBank
 //----------------
+template<class W>
 void JEventEVIOBuffer::ParseDEventRFBunchBank(uint32_t* &iptr, uint32_t *iend)
 {
     uint32_t Nwords = ((uint64_t)iend - (uint64_t)iptr)/sizeof(uint32_t);
@@ -1939,15 +2653,15 @@ void JEventEVIOBuffer::ParseDEventRFBunchBank(uint32_t* &iptr, uint32_t *iend)
 		DParsedEvent *pe = current_parsed_events.back();
 		DEventRFBunch *the_rftime = pe->NEW_DEventRFBunch();
 
-        the_rftime->dTimeSource = static_cast<DetectorSystem_t>(*iptr++);
-        the_rftime->dNumParticleVotes = *iptr++;
+        the_rftime->dTimeSource = static_cast<DetectorSystem_t>(W::get(iptr++));
+        the_rftime->dNumParticleVotes = W::get(iptr++);
 
-        uint64_t in_word = *iptr++;    // 1st word, lo word;  2nd word, hi word
-        uint64_t in_word_hi = *iptr++;
+        uint64_t in_word = W::get(iptr++);    // 1st word, lo word;  2nd word, hi word
+        uint64_t in_word_hi = W::get(iptr++);
         in_word |= in_word_hi<<32;
         double rftime;
         memcpy(&rftime, &in_word, sizeof(double));
-        in_word = *iptr++;   in_word_hi = *iptr++;
+        in_word = W::get(iptr++);   in_word_hi = W::get(iptr++);
         in_word |= in_word_hi<<32;
         double rftime_var;
         memcpy(&rftime_var, &in_word, sizeof(double));
@@ -1961,6 +2675,7 @@ void JEventEVIOBuffer::ParseDEventRFBunchBank(uint32_t* &iptr, uint32_t *iend)
 //----------------
 // ParseDVertexBank
 //----------------
+template<class W>
 void JEventEVIOBuffer::ParseDVertexBank(uint32_t* &iptr, uint32_t *iend)
 {
     uint32_t Nwords = ((uint64_t)iend - (uint64_t)iptr)/sizeof(uint32_t);
@@ -1972,30 +2687,30 @@ void JEventEVIOBuffer::ParseDVertexBank(uint32_t* &iptr, uint32_t *iend)
 		DParsedEvent *pe = current_parsed_events.back();
 		DVertex *the_vertex = pe->NEW_DVertex();
 
-        uint64_t in_word = *iptr++;    // 1st word, lo word;  2nd word, hi word
-        uint64_t in_word_hi = *iptr++;
+        uint64_t in_word = W::get(iptr++);    // 1st word, lo word;  2nd word, hi word
+        uint64_t in_word_hi = W::get(iptr++);
         in_word |= in_word_hi<<32;
-        //uint64_t hi_word = *iptr++;
+        //uint64_t hi_word = W::get(iptr++);
         double vertex_x_pos;
         memcpy(&vertex_x_pos, &in_word, sizeof(double));
-        in_word = *iptr++;   in_word_hi = *iptr++;
+        in_word = W::get(iptr++);   in_word_hi = W::get(iptr++);
         in_word |= in_word_hi<<32;
         double vertex_y_pos;
         memcpy(&vertex_y_pos, &in_word, sizeof(double));
-        in_word = *iptr++;   in_word_hi = *iptr++;
+        in_word = W::get(iptr++);   in_word_hi = W::get(iptr++);
         in_word |= in_word_hi<<32;
         double vertex_z_pos;
         memcpy(&vertex_z_pos, &in_word, sizeof(double));
-        in_word = *iptr++;   in_word_hi = *iptr++;
+        in_word = W::get(iptr++);   in_word_hi = W::get(iptr++);
         in_word |= in_word_hi<<32;
         double vertex_t;
         memcpy(&vertex_t, &in_word, sizeof(double));
 
         DVector3 vertex_position(vertex_x_pos, vertex_y_pos, vertex_z_pos);
         the_vertex->dSpacetimeVertex = DLorentzVector(vertex_position, vertex_t);
-        the_vertex->dKinFitNDF = *iptr++;
+        the_vertex->dKinFitNDF = W::get(iptr++);
 
-        in_word = *iptr++;   in_word_hi = *iptr++;
+        in_word = W::get(iptr++);   in_word_hi = W::get(iptr++);
         in_word |= in_word_hi<<32;
         memcpy(&(the_vertex->dKinFitChiSq), &in_word, sizeof(double));
     }
@@ -2010,93 +2725,143 @@ void JEventEVIOBuffer::LinkAllAssociations(void)
 
 	/// Find objects that should be linked as "associated objects"
 	/// of one another and add to each other's list.
-	for( auto pe : current_parsed_events){
+	for( auto pe : current_parsed_events) LinkAssociations(pe, DLazyModuleData::kALL, true);
+}
+
+//----------------
+// LinkAssociations
+//----------------
+void JEventEVIOBuffer::LinkAssociations(DParsedEvent *pe, uint32_t families, bool sort_config)
+{
+	/// Sort and link the objects made by the given families of module
+	/// decoders (see DLazyModuleData). Config objects are only sorted if
+	/// sort_config is true. They are made with the event so are already
+	/// sorted when module data decoded later is linked to them, and may
+	/// be in use by another thread by then.
+
+	bool f250  = families & DLazyModuleData::kF250;
+	bool f125  = families & DLazyModuleData::kF125;
+	bool f1tdc = families & DLazyModuleData::kF1TDC;
+	bool caen  = families & DLazyModuleData::kCAEN1290TDC;
 
-		//----------------- Sort hit objects
+	//----------------- Sort hit objects
 
-		// fADC250 (n.b. Df250PulseData values overwritten in JEventSource_EVIOpp::LinkBORassociations)
+	// fADC250
+	if(f250){
 		if(pe->vDf250PulseData.size()>1    ) sort(pe->vDf250PulseData.begin(),     pe->vDf250PulseData.end(),     SortByPulseNumber<Df250PulseData> );
 		if(pe->vDf250PulseIntegral.size()>1) sort(pe->vDf250PulseIntegral.begin(), pe->vDf250PulseIntegral.end(), SortByPulseNumber<Df250PulseIntegral> );
 		if(pe->vDf250PulseTime.size()>1    ) sort(pe->vDf250PulseTime.begin(),     pe->vDf250PulseTime.end(),     SortByPulseNumber<Df250PulseTime>     );
 		if(pe->vDf250PulsePedestal.size()>1) sort(pe->vDf250PulsePedestal.begin(), pe->vDf250PulsePedestal.end(), SortByPulseNumber<Df250PulsePedestal> );
 		if(pe->vDf250WindowRawData.size()>1) sort(pe->vDf250WindowRawData.begin(), pe->vDf250WindowRawData.end(), SortByChannel<Df250WindowRawData>     );
+	}
 
-		// fADC125
+	// fADC125
+	if(f125){
 		if(pe->vDf125PulseIntegral.size()>1) sort(pe->vDf125PulseIntegral.begin(), pe->vDf125PulseIntegral.end(), SortByPulseNumber<Df125PulseIntegral> );
 		if(pe->vDf125CDCPulse.size()>1     ) sort(pe->vDf125CDCPulse.begin(),      pe->vDf125CDCPulse.end(),      SortByChannel<Df125CDCPulse>          );
 		if(pe->vDf125FDCPulse.size()>1     ) sort(pe->vDf125FDCPulse.begin(),      pe->vDf125FDCPulse.end(),      SortByChannel<Df125FDCPulse>          );
 		if(pe->vDf125PulseTime.size()>1    ) sort(pe->vDf125PulseTime.begin(),     pe->vDf125PulseTime.end(),     SortByPulseNumber<Df125PulseTime>     );
 		if(pe->vDf125PulsePedestal.size()>1) sort(pe->vDf125PulsePedestal.begin(), pe->vDf125PulsePedestal.end(), SortByPulseNumber<Df125PulsePedestal> );
 		if(pe->vDf125WindowRawData.size()>1) sort(pe->vDf125WindowRawData.begin(), pe->vDf125WindowRawData.end(), SortByChannel<Df125WindowRawData>     );
+	}
 
-		// F1TDC
+	// F1TDC
+	if(f1tdc){
 		if(pe->vDF1TDCHit.size()>1         ) sort(pe->vDF1TDCHit.begin(),          pe->vDF1TDCHit.end(),          SortByModule<DF1TDCHit>               );
+	}
 
-		// CAEN1290TDC
+	// CAEN1290TDC
+	if(caen){
 		if(pe->vDCAEN1290TDCHit.size()>1   ) sort(pe->vDCAEN1290TDCHit.begin(),    pe->vDCAEN1290TDCHit.end(),    SortByModule<DCAEN1290TDCHit>         );
+	}
 
 
-		//----------------- Link hit objects
+	//----------------- Link hit objects
 
-		// Connect Df250 pulse objects
+	// Connect Df250 pulse objects
+	if(f250){
 		LinkPulse(pe->vDf250PulseTime,     pe->vDf250PulseIntegral);
 		LinkPulsePedCopy(pe->vDf250PulsePedestal, pe->vDf250PulseIntegral);
+	}
 
-		// Connect Df125 pulse objects
+	// Connect Df125 pulse objects
+	if(f125){
 		LinkPulse(pe->vDf125PulseTime,     pe->vDf125PulseIntegral);
 		LinkPulsePedCopy(pe->vDf125PulsePedestal, pe->vDf125PulseIntegral);
+	}
 
-		// Connect Df250 window raw data objects
-		if(!pe->vDf250WindowRawData.empty()){
-			LinkConfig(pe->vDf250Config, pe->vDf250WindowRawData);
-			LinkModule(pe->vDf250TriggerTime, pe->vDf250WindowRawData);
-			LinkChannel(pe->vDf250WindowRawData, pe->vDf250PulseIntegral);
-			LinkChannel(pe->vDf250WindowRawData, pe->vDf250PulseTime);
-			LinkChannel(pe->vDf250WindowRawData, pe->vDf250PulsePedestal);
-			LinkChannel(pe->vDf250WindowRawData, pe->vDf250PulseData);
-		}
+	// Connect Df250 window raw data objects
+	if(f250 && !pe->vDf250WindowRawData.empty()){
+		LinkConfig(pe->vDf250Config, pe->vDf250WindowRawData);
+		LinkModule(pe->vDf250TriggerTime, pe->vDf250WindowRawData);
+		LinkChannel(pe->vDf250WindowRawData, pe->vDf250PulseIntegral);
+		LinkChannel(pe->vDf250WindowRawData, pe->vDf250PulseTime);
+		LinkChannel(pe->vDf250WindowRawData, pe->vDf250PulsePedestal);
+		LinkChannel(pe->vDf250WindowRawData, pe->vDf250PulseData);
+	}
 
-		// Connect Df125 window raw data objects
-		if(!pe->vDf125WindowRawData.empty()){
-			LinkConfig(pe->vDf125Config, pe->vDf125WindowRawData);
-			LinkModule(pe->vDf125TriggerTime, pe->vDf125WindowRawData);
-			LinkChannel(pe->vDf125WindowRawData, pe->vDf125PulseIntegral);
-			LinkChannel(pe->vDf125WindowRawData, pe->vDf125PulseTime);
-			LinkChannel(pe->vDf125WindowRawData, pe->vDf125PulsePedestal);
-			LinkChannel(pe->vDf125WindowRawData, pe->vDf125CDCPulse);
-			LinkChannel(pe->vDf125WindowRawData, pe->vDf125FDCPulse);
-		}
-		
-		//----------------- Optionally link config objects (on by default)
-		if(LINK_CONFIG){
+	// Connect Df125 window raw data objects
+	if(f125 && !pe->vDf125WindowRawData.empty()){
+		LinkConfig(pe->vDf125Config, pe->vDf125WindowRawData);
+		LinkModule(pe->vDf125TriggerTime, pe->vDf125WindowRawData);
+		LinkChannel(pe->vDf125WindowRawData, pe->vDf125PulseIntegral);
+		LinkChannel(pe->vDf125WindowRawData, pe->vDf125PulseTime);
+		LinkChannel(pe->vDf125WindowRawData, pe->vDf125PulsePedestal);
+		LinkChannel(pe->vDf125WindowRawData, pe->vDf125CDCPulse);
+		LinkChannel(pe->vDf125WindowRawData, pe->vDf125FDCPulse);
+	}
+	
+	//----------------- Optionally link config objects (on by default)
+	if(LINK_CONFIG){
+		if(sort_config){
 			if(pe->vDf250Config.size()>1       ) sort(pe->vDf250Config.begin(),        pe->vDf250Config.end(),        SortByROCID<Df250Config>              );
 			if(pe->vDf125Config.size()>1       ) sort(pe->vDf125Config.begin(),        pe->vDf125Config.end(),        SortByROCID<Df125Config>              );
 			if(pe->vDF1TDCConfig.size()>1      ) sort(pe->vDF1TDCConfig.begin(),       pe->vDF1TDCConfig.end(),       SortByROCID<DF1TDCConfig>             );
 			if(pe->vDCAEN1290TDCConfig.size()>1) sort(pe->vDCAEN1290TDCConfig.begin(), pe->vDCAEN1290TDCConfig.end(), SortByROCID<DCAEN1290TDCConfig>       );
+		}
 
+		if(f250){
 			LinkConfigSamplesCopy(pe->vDf250Config, pe->vDf250PulseIntegral);
 			LinkConfigSamplesCopy(pe->vDf250Config, pe->vDf250PulseData);
+		}
+		if(f125){
 			LinkConfigSamplesCopy(pe->vDf125Config, pe->vDf125PulseIntegral);
 			LinkConfigSamplesCopy(pe->vDf125Config, pe->vDf125CDCPulse);
 			LinkConfigSamplesCopy(pe->vDf125Config, pe->vDf125FDCPulse);
-			LinkConfig(pe->vDF1TDCConfig,           pe->vDF1TDCHit);
-			LinkConfig(pe->vDCAEN1290TDCConfig,     pe->vDCAEN1290TDCHit);
 		}
+		if(f1tdc) LinkConfig(pe->vDF1TDCConfig,           pe->vDF1TDCHit);
+		if(caen ) LinkConfig(pe->vDCAEN1290TDCConfig,     pe->vDCAEN1290TDCHit);
+
+		// BOR config of each hit's module, found in the BOR's lookup
+		// tables. This fills in the numbers of samples of hits no
+		// config bank gave them for.
+		if(firmware_borptrs){
+			if(f250){
+				firmware_borptrs->LinkSamplesCopy<Df250BORConfig>(pe->vDf250PulseData);
+			}
+			if(f125){
+				firmware_borptrs->LinkSamplesCopy<Df125BORConfig>(pe->vDf125CDCPulse);
+				firmware_borptrs->LinkSamplesCopy<Df125BORConfig>(pe->vDf125FDCPulse);
+			}
+		}
+	}
 
-		//----------------- Optionally link trigger time objects (off by default)
-		if(LINK_TRIGGERTIME){
-			if(pe->vDf250TriggerTime.size()>1  ) sort(pe->vDf250TriggerTime.begin(),   pe->vDf250TriggerTime.end(),   SortByModule<Df250TriggerTime>        );
-			if(pe->vDf125TriggerTime.size()>1  ) sort(pe->vDf125TriggerTime.begin(),   pe->vDf125TriggerTime.end(),   SortByModule<Df125TriggerTime>        );
-			if(pe->vDF1TDCTriggerTime.size()>1 ) sort(pe->vDF1TDCTriggerTime.begin(),  pe->vDF1TDCTriggerTime.end(),  SortByModule<DF1TDCTriggerTime>       );
+	//----------------- Optionally link trigger time objects (off by default)
+	if(LINK_TRIGGERTIME){
+		if(f250 && pe->vDf250TriggerTime.size()>1  ) sort(pe->vDf250TriggerTime.begin(),   pe->vDf250TriggerTime.end(),   SortByModule<Df250TriggerTime>        );
+		if(f125 && pe->vDf125TriggerTime.size()>1  ) sort(pe->vDf125TriggerTime.begin(),   pe->vDf125TriggerTime.end(),   SortByModule<Df125TriggerTime>        );
+		if(f1tdc && pe->vDF1TDCTriggerTime.size()>1) sort(pe->vDF1TDCTriggerTime.begin(),  pe->vDF1TDCTriggerTime.end(),  SortByModule<DF1TDCTriggerTime>       );
 
+		if(f250){
 			LinkModule(pe->vDf250TriggerTime,  pe->vDf250PulseIntegral);
+		}
+		if(f125){
 			LinkModule(pe->vDf125TriggerTime,  pe->vDf125PulseIntegral);
 			LinkModule(pe->vDf125TriggerTime,  pe->vDf125CDCPulse);
 			LinkModule(pe->vDf125TriggerTime,  pe->vDf125FDCPulse);
-			LinkModule(pe->vDF1TDCTriggerTime, pe->vDF1TDCHit);
 		}
+		if(f1tdc) LinkModule(pe->vDF1TDCTriggerTime, pe->vDF1TDCHit);
 	}
-
 }
 
 //----------------
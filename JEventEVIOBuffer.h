@@ -60,6 +60,9 @@
 #include <atomic>
 #include <list>
 #include <iterator>
+#include <memory>
+#include <mutex>
+#include <string.h>
 
 #include <JANA/JEvent.h>
 using namespace std;
@@ -69,6 +72,101 @@ using namespace std;
 #include <DAQ/DModuleType.h>
 #include <JQueue.h>
 
+// Word access policies for the templated parsers below. EVIONativeWords
+// is used when the buffer is already in host byte order (including events
+// that were run through swap_bank). EVIOSwappedWords reverses the bytes of
+// each value as it is loaded so physics events from a file with the other
+// byte order can be parsed without swapping the buffer first. All data in
+// physics events is 32bit except for the 16 and 64bit segments in the
+// built trigger bank, hence get16 and get64.
+struct EVIONativeWords{
+	static const bool swapped = false;
+	static inline uint32_t get(const uint32_t *p){ return *p; }
+	static inline uint16_t get16(const uint16_t *p){ return *p; }
+	static inline uint64_t get64(const uint64_t *p){ uint64_t v; memcpy(&v, p, sizeof(v)); return v; }
+};
+
+struct EVIOSwappedWords{
+	static const bool swapped = true;
+	static inline uint32_t get(const uint32_t *p){ return __builtin_bswap32(*p); }
+	static inline uint16_t get16(const uint16_t *p){ return __builtin_bswap16(*p); }
+	static inline uint64_t get64(const uint64_t *p){ uint64_t v; memcpy(&v, p, sizeof(v)); return __builtin_bswap64(v); }
+};
+
+// Parse mode policies. These are combined with one of the word access
+// policies above by EVIOParsePolicy to make the W template argument of
+// the parsers. ReleaseParse has no trace output and only the checks
+// needed to keep the parsers from running off the end of the data.
+// ValidateParse adds consistency checks of the module block structure
+// that throw a JExceptionDataFormat if they fail. TraceParse also
+// prints every decoded word. The mode is chosen at run time with
+// EVIO:PARSE_MODE but each is a separate instantiation so production
+// parsing doesn't pay for the others.
+struct ReleaseParse{
+	static const bool trace    = false;
+	static const bool validate = false;
+};
+
+struct ValidateParse{
+	static const bool trace    = false;
+	static const bool validate = true;
+};
+
+struct TraceParse{
+	static const bool trace    = true;
+	static const bool validate = true;
+};
+
+template<class WORDS, class MODE>
+struct EVIOParsePolicy:public WORDS, public MODE{};
+
+// Firmware policies for the f250 and f125 decoders. The original (v1)
+// firmware writes separate pulse integral, time and pedestal words
+// (types 7, 8 and 10). The newer (v2) firmware writes combined pulse
+// words instead (type 9 for the f250 and types 5, 6 and 9 for the f125).
+// If the BOR says all modules of a type in a crate run the same
+// firmware, the decoder instantiated for it is used. That one hands over
+// to the AnyFirmwareWords decoder if it finds a word it was not built
+// for so the result never depends on the BOR being right.
+struct AnyFirmwareWords{
+	static const bool v1 = true;
+	static const bool v2 = true;
+};
+
+struct V1FirmwareWords{
+	static const bool v1 = true;
+	static const bool v2 = false;
+};
+
+struct V2FirmwareWords{
+	static const bool v1 = false;
+	static const bool v2 = true;
+};
+
+// State of the f250/f125 decoder loop. This is kept in one place so a
+// decoder can stop part way through a bank and another continue it.
+struct ModuleDecodeState{
+	uint32_t *iptr;
+	uint32_t *iend;
+	uint32_t *ibank;
+	uint32_t *iblock;
+	uint32_t *inext;
+	uint32_t  Ndefining;
+	uint32_t  k;
+	vector<DParsedEvent*>::iterator pe_iter;
+	DParsedEvent *pe;
+	uint32_t slot;
+	uint32_t itrigger;
+	uint32_t last_itrigger;
+	uint32_t last_pulse_time_channel;
+	uint32_t last_slot;
+	uint32_t last_channel;
+};
+
+class JEventEVIOBuffer;
+class DLazyModuleBanks;
+class SubtaskPool;
+
 class JEventEVIOBuffer:public JEvent{
 	public:
 	
@@ -80,24 +178,60 @@ class JEventEVIOBuffer:public JEvent{
 			JOB_ASSOCIATE  = 0x8
 		};
 
+		enum PARSE_MODE{
+			kPARSE_RELEASE  = 0,
+			kPARSE_VALIDATE = 1,
+			kPARSE_TRACE    = 2
+		};
+
+		// Options that control how module data is parsed. These are the
+		// members of the same names below. A copy is kept with module
+		// data left for later (see DLazyModuleBanks).
+		struct ParseOptions{
+			int        VERBOSE;
+			PARSE_MODE parse_mode;
+			uint64_t   MAX_EVENT_RECYCLES;
+			uint64_t   MAX_OBJECT_RECYCLES;
+			bool       SPECIALIZE_FIRMWARE;
+			bool       HIT_VIEWS;
+			bool       HIT_COLUMNS;
+			bool       PARSE_F250;
+			bool       PARSE_F125;
+			bool       PARSE_F1TDC;
+			bool       PARSE_CAEN1290TDC;
+			bool       PARSE_CONFIG;
+			bool       PARSE_BOR;
+			bool       PARSE_EPICS;
+			bool       PARSE_EVENTTAG;
+			bool       PARSE_TRIGGER;
+			bool       LINK_TRIGGERTIME;
+			bool       LINK_CONFIG;
+		};
+
 		JEventEVIOBuffer(JApplication *aApplication);
 		virtual ~JEventEVIOBuffer();
 
 		void Process(void);
 
 		void SetMaxParsedEvents(uint32_t max) { MAX_PARSED_EVENTS = max; }
-		void SetROCIDsToParse(set<uint32_t> &rocids) { ROCIDS_TO_PARSE = rocids; }
+		void SetROCIDsToParse(set<uint32_t> &rocids);
 
 		// These are owned by JEventSource and
-		// are set in the constructor
+		// are set in the constructor. ROCIDS_TO_PARSE is indexed by
+		// rocid and is non-zero for crates that should be parsed. If
+		// it is empty, all crates are parsed.
 		uint32_t            MAX_PARSED_EVENTS;
-		set<uint32_t>       ROCIDS_TO_PARSE;
+		vector<uint8_t>     ROCIDS_TO_PARSE;
 	
 		// Pool of parsed events
 		vector<DParsedEvent*> parsed_event_pool;
 	
-		// List of parsed events we are currently filling
-		list<DParsedEvent*> current_parsed_events;
+		// List of parsed events we are currently filling. This is a
+		// vector so it keeps its memory when cleared for the next block.
+		vector<DParsedEvent*> current_parsed_events;
+
+		// Event for each CAEN TDC event_id seen while parsing a bank (see ParseCAEN1190)
+		vector< pair<uint32_t, DParsedEvent*> > caen_events_by_id;
 
 		// JQueue to place parsed events into
 		JQueue *mParsedQueue = nullptr;
@@ -116,6 +250,83 @@ class JEventEVIOBuffer:public JEvent{
 		uint32_t *buff;
 		streampos pos;
 
+		// When reading in zero-copy mode (EVIO:MMAP=1 or EVIO:ASYNC=1) the
+		// event is not copied into buff. Instead, mapped_buff points directly
+		// into the memory-mapped file or prefetched block and mapped_region
+		// keeps that memory alive until this object is returned to the pool.
+		// ibuff points to whichever one is actually being parsed.
+		const uint32_t *mapped_buff;
+		shared_ptr<const void> mapped_region;
+		uint32_t *ibuff;
+
+		// Physics events outside of this range or not in the list (if
+		// non-NULL) are dropped in PublishEvents. These are set by
+		// JEventSource_EVIO from EVIO:FIRST_EVENT, EVIO:LAST_EVENT,
+		// EVIO:SKIP, and EVIO:EVENT_LIST. A value of 0 means no limit.
+		uint64_t FIRST_EVENT_TO_PUBLISH;
+		uint64_t LAST_EVENT_TO_PUBLISH;
+		const set<uint64_t> *EVENTS_TO_PUBLISH;
+		bool is_physics_event;
+
+		// Physics events at least PARSE_SUBTASK_MIN_WORDS long have their
+		// ROC data banks split into up to PARSE_SUBTASKS groups that are
+		// parsed concurrently (see ParseDataBanksInSubtasks). These are set
+		// by JEventSource_EVIO from EVIO:PARSE_SUBTASKS and
+		// EVIO:PARSE_SUBTASK_MIN_WORDS. PARSE_SUBTASKS=1 disables this.
+		// The groups are run by the threads of subtask_pool, which is
+		// owned by the source and shared by all of its buffers. Events
+		// are parsed serially if it is NULL. subparsers holds one helper
+		// object per extra group. They are created as needed and keep
+		// their own DParsedEvent pools.
+		uint32_t PARSE_SUBTASKS;
+		uint32_t PARSE_SUBTASK_MIN_WORDS;
+		SubtaskPool *subtask_pool;
+		vector<JEventEVIOBuffer*> subparsers;
+		vector<uint32_t*> subtask_bounds;
+
+		// Index of data type defining words in the module bank currently
+		// being parsed (see module_words.h). Kept here so it can be reused.
+		vector<uint32_t> module_word_index;
+
+		// Firmware generation of the f250 and f125 modules in each crate
+		// (indexed by rocid) according to the BOR config in firmware_borptrs.
+		// 1=v1, 2=v2. Anything else means the generic decoder is used.
+		// SPECIALIZE_FIRMWARE is set by JEventSource_EVIO from
+		// EVIO:SPECIALIZE_FIRMWARE. The tables are left empty if it is not
+		// set. firmware_borptrs is always the source's latest BOR config
+		// since its config objects are also linked to the hits (see
+		// LinkAssociations). See UpdateFirmwareTables.
+		bool SPECIALIZE_FIRMWARE;
+		DBORptrs *firmware_borptrs;
+		vector<uint8_t> f250_firmware;
+		vector<uint8_t> f125_firmware;
+
+		// Set by JEventSource_EVIO from EVIO:PARSE_MODE
+		PARSE_MODE parse_mode;
+
+		// If LAZY_PARSE is set (EVIO:LAZY_PARSE) the f250, f125, F1TDC
+		// and CAEN1290TDC banks are not decoded when the events are made.
+		// They are kept in lazy_banks, which is shared by the events,
+		// and decoded when one of their types is first asked for.
+		// lazy_banks_pool holds all we have made. One is reused once
+		// all of the events of its block have let go of it.
+		bool LAZY_PARSE;
+		shared_ptr<DLazyModuleBanks> lazy_banks;
+		vector< shared_ptr<DLazyModuleBanks> > lazy_banks_pool;
+
+		// If HIT_VIEWS is set (EVIO:HIT_VIEWS) the views in DAQ/DHitViews.h
+		// are made instead of the high volume hit objects. Views point to
+		// the data words so this needs the data kept by lazy_banks. The
+		// decoders check make_hit_views which is only set for objects
+		// decoding lazy_banks (see DecodeLazyBanks).
+		bool HIT_VIEWS;
+		bool make_hit_views;
+
+		// If HIT_COLUMNS is set (EVIO:HIT_COLUMNS) the f125 decoder fills
+		// the columns in DAQ/DHitColumns.h instead of making Df125CDCPulse
+		// and Df125FDCPulse objects. Views take precedence if both are set.
+		bool HIT_COLUMNS;
+
 		bool  PARSE_F250;
 		bool  PARSE_F125;
 		bool  PARSE_F1TDC;
@@ -130,33 +341,50 @@ class JEventEVIOBuffer:public JEvent{
 		bool  LINK_CONFIG;
 	
 		void Prune(void);
-		void MakeEvents(void);
+		void GetParseOptions(ParseOptions &opts) const;
+		void SetParseOptions(const ParseOptions &opts);
+		void CopyParseOptions(const JEventEVIOBuffer *parent);
+		template<class WORDS> void MakeEventsInMode(void);
+		template<class W> void MakeEvents(void);
 		void PublishEvents(void);
-		void ParseBank(void);
+		template<class W> void ParseBank(void);
 	
-		void      ParseEventTagBank(uint32_t* &iptr, uint32_t *iend);
-		void         ParseEPICSbank(uint32_t* &iptr, uint32_t *iend);
-		void           ParseBORbank(uint32_t* &iptr, uint32_t *iend);
-		void      ParseTSscalerBank(uint32_t* &iptr, uint32_t *iend);
-		void    Parsef250scalerBank(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
-		void      ParseControlEvent(uint32_t* &iptr, uint32_t *iend);
-		void       ParsePhysicsBank(uint32_t* &iptr, uint32_t *iend);
-		void  ParseBuiltTriggerBank(uint32_t* &iptr, uint32_t *iend);
-		void          ParseDataBank(uint32_t* &iptr, uint32_t *iend);
-		void       ParseDVertexBank(uint32_t* &iptr, uint32_t *iend);
-		void ParseDEventRFBunchBank(uint32_t* &iptr, uint32_t *iend);
-
-		void        ParseJLabModuleData(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
-		void                ParseTIBank(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
-		void              ParseCAEN1190(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
-		void   ParseModuleConfiguration(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
-		void              Parsef250Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
-		void     MakeDf250WindowRawData(DParsedEvent *pe, uint32_t rocid, uint32_t slot, uint32_t itrigger, uint32_t* &iptr);
-		void              Parsef125Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
-		void     MakeDf125WindowRawData(DParsedEvent *pe, uint32_t rocid, uint32_t slot, uint32_t itrigger, uint32_t* &iptr);
-		void             ParseF1TDCBank(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
+		template<class W> void      ParseEventTagBank(uint32_t* &iptr, uint32_t *iend);
+		                  void         ParseEPICSbank(uint32_t* &iptr, uint32_t *iend);
+		                  void           ParseBORbank(uint32_t* &iptr, uint32_t *iend);
+		template<class W> void      ParseTSscalerBank(uint32_t* &iptr, uint32_t *iend);
+		template<class W> void    Parsef250scalerBank(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
+		                  void      ParseControlEvent(uint32_t* &iptr, uint32_t *iend);
+		template<class W> void       ParsePhysicsBank(uint32_t* &iptr, uint32_t *iend);
+		template<class W> void  ParseBuiltTriggerBank(uint32_t* &iptr, uint32_t *iend);
+		template<class W> void     ParseDataBankRange(uint32_t *iptr, uint32_t *iend);
+		template<class W> void ParseDataBanksInSubtasks(uint32_t *istart, uint32_t *iend);
+		                  void    PrepareSubtaskEvents(JEventEVIOBuffer *parent, uint32_t nshares);
+		template<class W> void          ParseDataBank(uint32_t* &iptr, uint32_t *iend);
+		template<class W> void       ParseDVertexBank(uint32_t* &iptr, uint32_t *iend);
+		template<class W> void ParseDEventRFBunchBank(uint32_t* &iptr, uint32_t *iend);
+
+		template<class W> void    StashJLabModuleData(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
+		template<class W> void        StashModuleData(uint32_t rocid, uint32_t family, uint32_t *iptr, uint32_t *iend);
+		                  void        DecodeLazyBanks(DLazyModuleBanks *lazy, uint32_t families);
+		template<class W> void        DecodeLazySpans(DLazyModuleBanks *lazy, uint32_t families);
+
+		template<class W> void        ParseJLabModuleData(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
+		template<class W> void                ParseTIBank(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
+		template<class W> void              ParseCAEN1190(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
+		template<class W> void   ParseModuleConfiguration(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
+		                  void   UpdateFirmwareTables(DBORptrs *borptrs);
+		template<class W> void              Parsef250Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
+		template<class W, class F> bool    Parsef250Words(uint32_t rocid, ModuleDecodeState &s);
+		template<class W> void     MakeDf250WindowRawData(DParsedEvent *pe, uint32_t rocid, uint32_t slot, uint32_t itrigger, uint32_t* &iptr);
+		template<class W> void              Parsef125Bank(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
+		template<class W, class F> bool    Parsef125Words(uint32_t rocid, ModuleDecodeState &s);
+		template<class W> void     MakeDf125WindowRawData(DParsedEvent *pe, uint32_t rocid, uint32_t slot, uint32_t itrigger, uint32_t* &iptr);
+		template<class W> void             ParseF1TDCBank(uint32_t rocid, uint32_t* &iptr, uint32_t *iend);
+		template<class W> void       ValidateBlockTrailer(uint32_t rocid, uint32_t slot, const uint32_t *iblock, const uint32_t *itrailer);
 
 		void LinkAllAssociations(void);
+		void LinkAssociations(DParsedEvent *pe, uint32_t families, bool sort_config);
 
 		inline uint32_t F1TDC_channel(uint32_t chip, uint32_t chan_on_chip, int modtype);
 
@@ -164,6 +392,52 @@ class JEventEVIOBuffer:public JEvent{
 
 };
 
+// Module banks of a block of events kept for decoding later (see
+// EVIO:LAZY_PARSE). The buffer the events came from is recycled as
+// soon as they are published so this holds on to the data itself.
+// Words in host byte order are not copied. block then points to the
+// EVIO event and either region keeps the memory mapping it is in
+// alive or owned_buff is the array it was read into, taken over from
+// the buffer. Words in the other byte order are swapped into words.
+// Each span is the part of a ROC's data block bank (as offsets from
+// the start of the data) that one decoder would have parsed. events
+// are the events of the block in order. An event that was released
+// is replaced by NULL and gets a scratch event when decoding. The
+// parsing options are copied here too so decoding never looks at the
+// buffer. These are recycled by the buffer that made them (see
+// JEventEVIOBuffer::StashModuleData).
+class DLazyModuleBanks:public DLazyModuleData{
+	public:
+
+		struct Span{
+			uint32_t rocid;
+			uint32_t family;
+			uint32_t begin;
+			uint32_t end;
+		};
+
+		DLazyModuleBanks():app(NULL),borptrs(NULL),associate(false),block(NULL),owned_buff(NULL),owned_buff_len(0){}
+		virtual ~DLazyModuleBanks(){ if(owned_buff) delete[] owned_buff; }
+
+		void Decode(uint32_t families);
+		void Detach(DParsedEvent *pe);
+
+		uint32_t* Data(void){ return block ? block:words.data(); }
+
+		JApplication *app;                     // for the parsers made to decode this
+		JEventEVIOBuffer::ParseOptions options;
+		DBORptrs *borptrs;                     // for the firmware tables
+		bool associate;                        // link associated objects after decoding
+		uint32_t *block;                       // data in host byte order (NULL if in words)
+		shared_ptr<const void> region;
+		uint32_t *owned_buff;
+		uint32_t owned_buff_len;
+		vector<uint32_t> words;
+		vector<Span> spans;
+		vector<DParsedEvent*> events;
+		std::mutex mtx;
+};
+
 //----------------
 // F1TDC_channel
 //----------------
@@ -8,6 +8,9 @@
 #include <memory>
 #include <utility>
 #include <string>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
 
 #include <JApplication.h>
 #include <JANA/JEventSourceGeneratorT.h>
@@ -15,6 +18,7 @@
 #include "JEventSource_EVIO.h"
 #include "JEventEVIOBuffer.h"
 #include "JEventProcessorTest.h"
+#include "subtask_pool.h"
 
 //-------------------------------------------------------------------------
 // Plugin glue
@@ -34,6 +38,57 @@ void InitPlugin(JApplication *app){
 JEventSource_EVIO::JEventSource_EVIO(std::string source_name, JApplication *app):JEventSource(source_name, app)
 {
 	gPARMS->SetDefaultParameter("EVIO:VERBOSE", VERBOSE, "Set verbosity level for processing and debugging statements while parsing. 0=no debugging messages. 10=all messages");
+	gPARMS->SetDefaultParameter("EVIO:READ_MODE", READ_MODE, "How to read the input file: stream (large buffered reads, best for Lustre), event (one block at a time), sparse (seek to each event using file map), mmap (zero-copy from memory mapped file, best for local disk), async (zero-copy from blocks read ahead by dedicated threads, best for network filesystems), or auto (choose based on filesystem type and file size)");
+	gPARMS->SetDefaultParameter("EVIO:MMAP", USE_MMAP, "Same as EVIO:READ_MODE=mmap (deprecated)");
+	gPARMS->SetDefaultParameter("EVIO:ASYNC", USE_ASYNC, "Same as EVIO:READ_MODE=async (deprecated)");
+	gPARMS->SetDefaultParameter("EVIO:PREFETCH_THREADS", PREFETCH_THREADS, "Number of threads used to read blocks when EVIO:ASYNC=1");
+	gPARMS->SetDefaultParameter("EVIO:PREFETCH_DEPTH", PREFETCH_DEPTH, "Max. number of EVIO blocks being read or waiting to be parsed when EVIO:ASYNC=1");
+	gPARMS->SetDefaultParameter("EVIO:SAVE_MAP", SAVE_MAP, "Build a map of the input file while reading it (with any EVIO:READ_MODE) and save it at the end so later passes can use it. If the file has to be mapped before reading (sparse mode, seeks, several readers) the map is saved right away. Set to 1 to write it next to the input file as FILE.bmap or give a file name (ending in .map for text format). Ignored if a map file already exists.");
+	gPARMS->SetDefaultParameter("EVIO:FIRST_EVENT", FIRST_EVENT, "Event number of first event to process. The file is mapped and the reader jumps directly to the block containing it. 0=start of file");
+	gPARMS->SetDefaultParameter("EVIO:LAST_EVENT", LAST_EVENT, "Event number of last event to process. Reading stops once an event beyond this is seen. 0=end of file");
+	gPARMS->SetDefaultParameter("EVIO:SKIP", SKIP_EVENTS, "Number of physics events to skip before processing (counted from EVIO:FIRST_EVENT if given). Skipped events are not read.");
+	gPARMS->SetDefaultParameter("EVIO:NREADERS", NREADERS, "Number of threads reading the input file. If >1, the file is mapped and split into chunks of EVIO:READER_DEPTH events that are read in parallel. The events are still passed on in file order.");
+	gPARMS->SetDefaultParameter("EVIO:READER_DEPTH", READER_DEPTH, "Max. number of EVIO events each reader thread may hold waiting to be processed when EVIO:NREADERS>1. This is also the size of the chunks the file is split into for the readers");
+	gPARMS->SetDefaultParameter("EVIO:MAKE_SHARDS", MAKE_SHARDS, "If >0, split the input file into this many pieces that can be processed by separate jobs (see EVIO:SHARD), write their descriptors to EVIO:SHARD_FILE and exit without processing any events.");
+	gPARMS->SetDefaultParameter("EVIO:SHARD", SHARD, "Process only this piece of the input file as given in EVIO:SHARD_FILE (made with EVIO:MAKE_SHARDS). The BOR event preceding it is read first. -1=whole file");
+	gPARMS->SetDefaultParameter("EVIO:SHARD_FILE", SHARD_FILE, "Name of shard descriptor file used by EVIO:MAKE_SHARDS and EVIO:SHARD. Default is the input file name with \".shards\" appended");
+	gPARMS->SetDefaultParameter("EVIO:SHARD_MANIFEST", SHARD_MANIFEST, "Name of file to write list of events handled when EVIO:SHARD is used. Default is the input file name with \".shardN.manifest\" appended");
+	gPARMS->SetDefaultParameter("EVIO:PARSE_SUBTASKS", PARSE_SUBTASKS, "Max. number of concurrent subtasks used to parse the ROC data banks of one large EVIO event. This reduces the time to parse big blocks of entangled events. The subtasks are run by PARSE_SUBTASKS-1 threads (no more than the number of cores less one) that are started once and shared by all events. 1=parse each event in a single task");
+	gPARMS->SetDefaultParameter("EVIO:PARSE_SUBTASK_MIN_WORDS", PARSE_SUBTASK_MIN_WORDS, "Min. size of physics event (in 32bit words) that will be split into subtasks when EVIO:PARSE_SUBTASKS>1");
+	gPARMS->SetDefaultParameter("EVIO:SPECIALIZE_FIRMWARE", SPECIALIZE_FIRMWARE, "Decode f250 and f125 data with parsers built for the firmware version given for each crate in the BOR event. Data not matching the BOR is still decoded correctly, just more slowly. 0=always use the generic parsers");
+	gPARMS->SetDefaultParameter("EVIO:PARSE_MODE", PARSE_MODE, "Parser variant to use: release (no debugging output, fastest), validate (extra consistency checks of module data that stop processing if they fail) or trace (validate plus printing of every decoded word)");
+	gPARMS->SetDefaultParameter("EVIO:LAZY_PARSE", LAZY_PARSE, "Leave f250, f125, F1TDC and CAEN1290TDC data undecoded until one of the types made from it is first asked for (see DParsedEvent::Get). Good for jobs that only look at a few detectors. 0=decode everything up front");
+	gPARMS->SetDefaultParameter("EVIO:HIT_VIEWS", HIT_VIEWS, "Make light-weight views that decode values from the data words when asked (see DAQ/DHitViews.h) instead of Df250PulseData, Df125CDCPulse, Df125FDCPulse, DF1TDCHit and window raw data objects. Implies EVIO:LAZY_PARSE=1");
+	gPARMS->SetDefaultParameter("EVIO:HIT_COLUMNS", HIT_COLUMNS, "Store f125 CDC and FDC pulse hits in columns (see DAQ/DHitColumns.h and DParsedEvent::GetColumns). The Df125CDCPulse and Df125FDCPulse objects are then only made when first asked for");
+	gPARMS->SetDefaultParameter("EVIO:ROCIDS_TO_PARSE", ROCIDS_TO_PARSE, "Comma separated list of rocids of crates to parse. Data from others is skipped. Empty=parse all crates (see also EVIO:SYSTEMS_TO_PARSE)");
+	gPARMS->SetDefaultParameter("EVIO:SYSTEMS_TO_PARSE", SYSTEMS_TO_PARSE, "Comma separated list of detector systems (e.g. FCAL,BCAL,TAGH) whose crates should be parsed. Needs EVIO:ROC_SYSTEM_MAP. Crates not in the map are always parsed. Empty=parse all crates");
+	gPARMS->SetDefaultParameter("EVIO:ROC_SYSTEM_MAP", ROC_SYSTEM_MAP, "Name of file giving the detector system of each crate for EVIO:SYSTEMS_TO_PARSE. Each line holds a rocid and a system name (e.g. \"31 FCAL\")");
+	gPARMS->SetDefaultParameter("EVIO:EVENT_LIST", EVENT_LIST, "Process only these event numbers. Either a comma separated list or the name of a file containing event numbers separated by white space or commas.");
+
+	if( PARSE_MODE == "validate" ){
+		mParseMode = JEventEVIOBuffer::kPARSE_VALIDATE;
+	}else if( PARSE_MODE == "trace" ){
+		mParseMode = JEventEVIOBuffer::kPARSE_TRACE;
+	}else if( PARSE_MODE != "release" ){
+		jout << "Unknown EVIO:PARSE_MODE \"" << PARSE_MODE << "\". Using release." << endl;
+	}
+
+	// Views point into the module data kept for lazy parsing
+	if( HIT_VIEWS && !LAZY_PARSE ){
+		jout << "EVIO:HIT_VIEWS is set so turning on EVIO:LAZY_PARSE" << endl;
+		LAZY_PARSE = true;
+	}
+
+	// The subtasks of all buffers are run by one set of threads made
+	// here so none are started while parsing. The thread parsing the
+	// event runs one group itself so PARSE_SUBTASKS-1 are needed, but
+	// not more than there are other cores for.
+	if( PARSE_SUBTASKS > 1 ){
+		uint32_t Ncores = thread::hardware_concurrency();
+		uint32_t Nthreads = PARSE_SUBTASKS - 1;
+		if( Ncores>1 && Nthreads>Ncores-1 ) Nthreads = Ncores - 1;
+		mSubtaskPool = new SubtaskPool(Nthreads);
+	}
 
 
 	// Tell JANA how many times to call GetEvent in a row while it has the lock.
@@ -58,10 +113,20 @@ JEventSource_EVIO::JEventSource_EVIO(std::string source_name, JApplication *app)
 //-----------------------------------
 JEventSource_EVIO::~JEventSource_EVIO()
 {
+	StopShards();
+	if( mHaveShard ) WriteManifest();
+	for( auto shard : mShards ){
+		for( auto p : shard->queue ) delete p;
+		delete shard->hdevio;
+		delete shard;
+	}
+	mShards.clear();
+
 	std::lock_guard<std::mutex> lck(buff_pool_recycled_mutex);
 	for( auto p : buff_pool ) delete p;
 	for( auto p : buff_pool_recycled ) delete p;
 	if( hdevio ) delete hdevio;
+	if( mSubtaskPool ) delete mSubtaskPool;
 }
 
 //-----------------------------------
@@ -76,6 +141,386 @@ void JEventSource_EVIO::Open(void)
 		cerr << hdevio->err_mess.str() << endl;
 		throw JException("Failed to open EVIO file: " + this->mName, __FILE__, __LINE__); // throw exception indicating error
 	}
+	hdevio->PREFETCH_NTHREADS = PREFETCH_THREADS;
+	hdevio->PREFETCH_DEPTH    = PREFETCH_DEPTH;
+	mReadMode = HDEVIO::ReadModeFromString(READ_MODE);
+	if( mReadMode==HDEVIO::kREAD_AUTO && READ_MODE!="auto" ) jout << "Unknown EVIO:READ_MODE \"" << READ_MODE << "\". Using auto." << endl;
+	if( USE_MMAP  ) mReadMode = HDEVIO::kREAD_MMAP;
+	if( USE_ASYNC ) mReadMode = HDEVIO::kREAD_ASYNC;
+	hdevio->SetReadMode(mReadMode);
+	mReadMode = hdevio->read_mode; // (in case it was auto)
+	if( SAVE_MAP == "1" ){
+		hdevio->SAVE_MAP_FILE = this->mName + ".bmap";
+	}else if( SAVE_MAP != "0" ){
+		hdevio->SAVE_MAP_FILE = SAVE_MAP;
+	}
+
+	// Write shard descriptors only
+	if( SHARD_FILE.empty() ) SHARD_FILE = this->mName + ".shards";
+	if( MAKE_SHARDS>0 ){
+		hdevio->WriteShardFile(SHARD_FILE, MAKE_SHARDS);
+		mNoMoreEvents = true;
+		return;
+	}
+
+	// Crates to parse
+	ReadROCsToParse();
+
+	// Random access. Translate EVIO:SKIP into an event number so that
+	// all options are handled by seeking to the first event we want.
+	ReadEventList();
+	mFirstEventToProcess = FIRST_EVENT;
+	if( SKIP_EVENTS>0 ){
+		mFirstEventToProcess = hdevio->FindEventNumber(FIRST_EVENT, SKIP_EVENTS);
+		if( mFirstEventToProcess==0 ){
+			jout << "No events left in " << this->mName << " after skipping " << SKIP_EVENTS << endl;
+			mNoMoreEvents = true;
+		}
+	}
+	mNextListEvent = mEventList.lower_bound(mFirstEventToProcess);
+	mNeedSeek = (mFirstEventToProcess>0) || !mEventList.empty();
+
+	// Process only one piece of the file
+	if( SHARD>=0 ){
+		if( FIRST_EVENT>0 || LAST_EVENT>0 || SKIP_EVENTS>0 || !mEventList.empty() ){
+			throw JException("EVIO:SHARD may not be used with EVIO:FIRST_EVENT, EVIO:LAST_EVENT, EVIO:SKIP, or EVIO:EVENT_LIST", __FILE__, __LINE__);
+		}
+		vector<uint64_t> state_events;
+		if( !hdevio->ReadShardFile(SHARD_FILE, SHARD, mShardInfo) || !hdevio->SetShard(mShardInfo, &state_events) ){
+			cerr << hdevio->err_mess.str() << endl;
+			throw JException("Unable to set up EVIO shard for " + this->mName, __FILE__, __LINE__);
+		}
+		mStateEvents.assign(state_events.begin(), state_events.end());
+		mHaveShard = true;
+		if( mReadMode == HDEVIO::kREAD_STREAM ){
+			mReadMode = HDEVIO::kREAD_EVENT; // read() does not support block ranges
+			hdevio->SetReadMode(mReadMode);
+		}
+		if( SHARD_MANIFEST.empty() ) SHARD_MANIFEST = this->mName + ".shard" + std::to_string(SHARD) + ".manifest";
+		jout << "Processing EVIO shard " << SHARD << " of " << mShardInfo.Nshards << " (blocks " << mShardInfo.first_block << "-" << mShardInfo.end_block << ", events " << mShardInfo.first_event << "-" << mShardInfo.last_event << ")" << endl;
+	}
+
+	if( NREADERS>1 ) OpenShards();
+}
+
+//-----------------------------------
+// OpenShards
+//-----------------------------------
+void JEventSource_EVIO::OpenShards(void)
+{
+	/// Split the file into chunks of about READER_DEPTH events
+	/// and deal them out to NREADERS readers in turn, then start a
+	/// reader thread for each. With every reader holding at most
+	/// READER_DEPTH events, they all keep busy on neighbouring chunks
+	/// while GetShardedEvent takes the events in file order. All
+	/// readers share the file map of the main hdevio object.
+
+	if( FIRST_EVENT>0 || LAST_EVENT>0 || SKIP_EVENTS>0 || !mEventList.empty() ){
+		jout << "EVIO:NREADERS>1 may not be used with EVIO:FIRST_EVENT, EVIO:LAST_EVENT, EVIO:SKIP, or EVIO:EVENT_LIST. Using 1 reader." << endl;
+		return;
+	}
+
+	auto &filemap = hdevio->GetFileMap(); // maps file if needed
+	if( filemap.Nblocks == 0 ) return;
+	if( mReadMode == HDEVIO::kREAD_STREAM ) mReadMode = HDEVIO::kREAD_EVENT; // read() does not support block ranges
+
+	// Only split this job's piece of the file if EVIO:SHARD was given
+	uint64_t first_block = mHaveShard ? mShardInfo.first_block:0;
+	uint64_t end_block   = mHaveShard ? std::min(mShardInfo.end_block, filemap.Nblocks):filemap.Nblocks;
+	uint64_t Nchunk_events = std::max(READER_DEPTH, 1u);
+	vector<std::pair<uint64_t,uint64_t> > chunks;
+	for(uint64_t iblock=first_block; iblock<end_block; ){
+		uint64_t jblock = iblock + 1;
+		while( jblock<end_block && filemap.block_event_start[jblock]-filemap.block_event_start[iblock]<Nchunk_events ) jblock++;
+		chunks.push_back( std::make_pair(iblock, jblock) );
+		iblock = jblock;
+	}
+
+	for(uint32_t i=0; i<NREADERS; i++){
+		auto shard = new ReaderShard();
+		shard->hdevio = new HDEVIO( this->mName, false, VERBOSE );
+		if( ! shard->hdevio->is_open ){
+			cerr << shard->hdevio->err_mess.str() << endl;
+			delete shard->hdevio;
+			delete shard;
+			throw JException("Failed to open EVIO file: " + this->mName, __FILE__, __LINE__);
+		}
+		shard->hdevio->PREFETCH_NTHREADS = PREFETCH_THREADS;
+		shard->hdevio->PREFETCH_DEPTH    = PREFETCH_DEPTH;
+		shard->hdevio->ShareFileMap( *hdevio );
+		shard->hdevio->SetReadMode( mReadMode );
+		for(size_t ichunk=i; ichunk<chunks.size(); ichunk+=NREADERS) shard->chunks.push_back(chunks[ichunk]);
+		mShards.push_back(shard);
+	}
+	if(VERBOSE>0) jout << "EVIO readers: " << NREADERS << " reading " << chunks.size() << " chunks of blocks " << first_block << "-" << end_block << endl;
+
+	// The reader threads are not started until the BOR/EPICS events
+	// for EVIO:SHARD have been replayed by GetEvent. Those are read on
+	// the calling thread using buff_pool without taking buff_pool_mutex.
+	if( mStateEvents.empty() ) StartShards();
+}
+
+//-----------------------------------
+// StartShards
+//-----------------------------------
+void JEventSource_EVIO::StartShards(void)
+{
+	mShardsQuit = false;
+	mShardsStarted = true;
+	for( auto shard : mShards ){
+		shard->done = false;
+		shard->err_code = HDEVIO::HDEVIO_OK;
+		shard->err_mess = "";
+		shard->ichunk = 0;
+		if( !NextShardChunk(shard) ){
+			shard->done = true;
+			shard->err_code = HDEVIO::HDEVIO_EOF;
+			continue;
+		}
+		shard->thr = std::thread( &JEventSource_EVIO::ShardThread, this, shard );
+	}
+}
+
+//-----------------------------------
+// NextShardChunk
+//-----------------------------------
+bool JEventSource_EVIO::NextShardChunk(ReaderShard *shard)
+{
+	/// Set the reader of shard to read its next chunk of blocks.
+	/// Returns false if it has none left.
+
+	if( shard->ichunk >= shard->chunks.size() ) return false;
+	auto &chunk = shard->chunks[shard->ichunk++];
+	shard->hdevio->SetBlockRange(chunk.first, chunk.second);
+
+	std::lock_guard<std::mutex> lck(mShardMutex);
+	shard->next_istreamorder = shard->hdevio->GetFileMap().block_event_start[chunk.first];
+	return true;
+}
+
+//-----------------------------------
+// StopShards
+//-----------------------------------
+void JEventSource_EVIO::StopShards(void)
+{
+	/// Stop and join all reader threads. Buffers already queued
+	/// are returned to the pool.
+
+	{
+		std::lock_guard<std::mutex> lck(mShardMutex);
+		mShardsQuit = true;
+	}
+	for( auto shard : mShards ) shard->cv_space.notify_all();
+	for( auto shard : mShards ){
+		if( shard->thr.joinable() ) shard->thr.join();
+		for( auto p : shard->queue ) ReturnJEventEVIOBufferToPool(p);
+		shard->queue.clear();
+	}
+	mShardsStarted = false;
+}
+
+//-----------------------------------
+// ShardThread
+//-----------------------------------
+void JEventSource_EVIO::ShardThread(ReaderShard *shard)
+{
+	/// Read all events of the chunks of one shard into its queue,
+	/// waiting whenever the queue holds READER_DEPTH events.
+
+	while( true ){
+		{
+			std::unique_lock<std::mutex> lck(mShardMutex);
+			shard->cv_space.wait(lck, [this,shard]{ return mShardsQuit || shard->queue.size()<READER_DEPTH; });
+			if( mShardsQuit ) return;
+		}
+
+		JEventEVIOBuffer *jevent = nullptr;
+		{
+			std::lock_guard<std::mutex> lck(buff_pool_mutex);
+			jevent = GetJEventEVIOBufferFromPool();
+		}
+
+		bool isgood = ReadBuffer(shard->hdevio, jevent);
+		while( !isgood && shard->hdevio->err_code==HDEVIO::HDEVIO_EOF && NextShardChunk(shard) ){
+			isgood = ReadBuffer(shard->hdevio, jevent);
+		}
+		if( isgood ){
+			uint32_t myjobtype = JEventEVIOBuffer::JOB_FULL_PARSE;
+			if(shard->hdevio->swap_needed) myjobtype |= JEventEVIOBuffer::JOB_SWAP;
+			jevent->jobtype = (JEventEVIOBuffer::JOBTYPE)myjobtype;
+			if( mHaveShard ) AddToManifest(shard->hdevio, shard->manifest_ranges, shard->Nevio_events, shard->Nl1_events);
+		}else{
+			ReturnJEventEVIOBufferToPool(jevent);
+		}
+
+		{
+			std::lock_guard<std::mutex> lck(mShardMutex);
+			if( isgood ){
+				jevent->istreamorder = shard->next_istreamorder++;
+				shard->queue.push_back(jevent);
+			}else{
+				shard->done     = true;
+				shard->err_code = shard->hdevio->err_code;
+				shard->err_mess = shard->hdevio->err_mess.str();
+			}
+		}
+		mShardCVReady.notify_one();
+		
+		if( !isgood ) return;
+	}
+}
+
+//-----------------------------------
+// GetShardedEvent
+//-----------------------------------
+std::shared_ptr<const JEvent> JEventSource_EVIO::GetShardedEvent(void)
+{
+	/// Take the next buffer read by one of the reader threads in
+	/// file order. Each queue is in file order so the next buffer is
+	/// the one with the lowest istreamorder at the front of a queue.
+	/// It is only taken once no reader with an empty queue can still
+	/// give a lower one. The queues together act as the reorder window.
+
+	JEventEVIOBuffer *jevent = nullptr;
+	ReaderShard *shard = nullptr;
+	{
+		std::unique_lock<std::mutex> lck(mShardMutex);
+		while( true ){
+			ReaderShard *next = nullptr;
+			uint64_t next_istreamorder = UINT64_MAX;
+			for( auto s : mShards ){
+				if( s->queue.empty() && s->done ) continue;
+				uint64_t i = s->queue.empty() ? s->next_istreamorder:s->queue.front()->istreamorder;
+				if( i<next_istreamorder || (i==next_istreamorder && !s->queue.empty()) ){
+					next = s;
+					next_istreamorder = i;
+				}
+			}
+			if( next==nullptr ) break; // all done
+			if( !next->queue.empty() ){
+				shard = next;
+				break;
+			}
+			mShardCVReady.wait(lck);
+		}
+		if( shard ){
+			jevent = shard->queue.front();
+			shard->queue.pop_front();
+		}
+	}
+
+	if( shard ){
+		shard->cv_space.notify_one();
+		return std::shared_ptr<JEvent>( (JEvent*)jevent, [this,jevent](JEvent*){ this->ReturnJEventEVIOBufferToPool(jevent); } );
+	}
+
+	// All readers have finished
+	for( auto s : mShards ){
+		if( s->err_code != HDEVIO::HDEVIO_EOF ){
+			cout << s->err_mess << endl;
+			japp->SetExitCode(s->err_code);
+			throw JEventSource::RETURN_STATUS::kERROR;
+		}
+	}
+
+	mReachedEnd = true;
+	if(LOOP_FOREVER && NEVENTS_PROCESSED>=1){
+		StopShards();
+		for( auto s : mShards ) s->hdevio->rewind();
+		StartShards();
+		throw JEventSource::RETURN_STATUS::kTRY_AGAIN;
+	}
+
+	throw JEventSource::RETURN_STATUS::kNO_MORE_EVENTS;
+}
+
+//-----------------------------------
+// ReadROCsToParse
+//-----------------------------------
+void JEventSource_EVIO::ReadROCsToParse(void)
+{
+	/// Fill mROCIDsToParse from EVIO:ROCIDS_TO_PARSE and
+	/// EVIO:SYSTEMS_TO_PARSE. It is indexed by rocid and is left
+	/// empty if all crates should be parsed. If both are given, a
+	/// crate must pass both. For the systems, the crates are found
+	/// from the EVIO:ROC_SYSTEM_MAP file. Any crate not in that file
+	/// (or not assigned a known system) is kept since it may hold
+	/// something other than detector hits.
+
+	mROCIDsToParse.clear();
+	if( ROCIDS_TO_PARSE.empty() && SYSTEMS_TO_PARSE.empty() ) return;
+
+	// Start with the listed crates or all of them
+	mROCIDsToParse.resize(0x1000, ROCIDS_TO_PARSE.empty() ? 1:0);
+	std::string s = ROCIDS_TO_PARSE;
+	std::replace(s.begin(), s.end(), ',', ' ');
+	std::stringstream ss(s);
+	uint32_t rocid;
+	while( ss >> rocid ) if( rocid < mROCIDsToParse.size() ) mROCIDsToParse[rocid] = 1;
+
+	// Drop crates of detector systems not asked for
+	if( !SYSTEMS_TO_PARSE.empty() ){
+
+		s = SYSTEMS_TO_PARSE;
+		std::replace(s.begin(), s.end(), ',', ' ');
+		std::stringstream sss(s);
+		std::string name;
+		uint32_t systems = 0;
+		while( sss >> name ){
+			DetectorSystem_t sys = NameToSystem(name.c_str());
+			if( sys == SYS_NULL ) jerr << "Unknown detector system \"" << name << "\" in EVIO:SYSTEMS_TO_PARSE. Ignoring." << endl;
+			systems |= sys;
+		}
+
+		std::map<uint32_t, DetectorSystem_t> rocid_systems;
+		if( ROC_SYSTEM_MAP.empty() || !ReadROCSystemMap(ROC_SYSTEM_MAP, rocid_systems) ){
+			throw JException("EVIO:SYSTEMS_TO_PARSE requires a readable EVIO:ROC_SYSTEM_MAP file (got \"" + ROC_SYSTEM_MAP + "\")", __FILE__, __LINE__);
+		}
+
+		for(auto p : rocid_systems){
+			if( p.first >= mROCIDsToParse.size() ) continue;
+			if( p.second == SYS_NULL ) continue;
+			if( !(p.second & systems) ) mROCIDsToParse[p.first] = 0;
+		}
+	}
+
+	if(VERBOSE>0){
+		uint32_t Nparse = 0;
+		for(auto k : mROCIDsToParse) Nparse += k;
+		jout << "Parsing data from " << Nparse << " of " << mROCIDsToParse.size() << " possible rocids (EVIO:ROCIDS_TO_PARSE, EVIO:SYSTEMS_TO_PARSE)" << endl;
+	}
+}
+
+//-----------------------------------
+// ReadEventList
+//-----------------------------------
+void JEventSource_EVIO::ReadEventList(void)
+{
+	/// Fill mEventList from EVIO:EVENT_LIST. If it names a file that
+	/// can be opened then the event numbers are read from it. Otherwise
+	/// it is treated as a comma separated list of event numbers.
+
+	mEventList.clear();
+	if( EVENT_LIST.empty() ) return;
+
+	std::stringstream ss;
+	std::ifstream ifs(EVENT_LIST);
+	if( ifs.is_open() ){
+		ss << ifs.rdbuf();
+	}else{
+		ss << EVENT_LIST;
+	}
+
+	std::string s;
+	while( ss >> s ){
+		std::replace(s.begin(), s.end(), ',', ' ');
+		std::stringstream sss(s);
+		uint64_t evtnum;
+		while( sss >> evtnum ) mEventList.insert(evtnum);
+	}
+
+	if( mEventList.empty() ) throw JException("No event numbers found in EVIO:EVENT_LIST: " + EVENT_LIST, __FILE__, __LINE__);
+	if(VERBOSE>0) jout << "Processing " << mEventList.size() << " events from EVIO:EVENT_LIST" << endl;
 }
 
 //-----------------------------------
@@ -87,6 +532,34 @@ std::shared_ptr<const JEvent> JEventSource_EVIO::GetEvent(void)
 	// no need to worry about locks.
 	mNcallsGetEvent++;
 
+	if( !mShards.empty() && mStateEvents.empty() ){
+		if( !mShardsStarted ) StartShards();
+		return GetShardedEvent();
+	}
+
+	if( mNoMoreEvents ) throw JEventSource::RETURN_STATUS::kNO_MORE_EVENTS;
+
+	// Jump directly to the next event the user asked for if needed.
+	// This is done before any buffer is taken from the pool.
+	if( mNeedSeek ){
+		mNeedSeek = false;
+		uint64_t target = mFirstEventToProcess;
+		if( !mEventList.empty() ){
+			if( mNextListEvent==mEventList.end() ) throw JEventSource::RETURN_STATUS::kNO_MORE_EVENTS;
+			target = *mNextListEvent;
+		}
+		vector<uint64_t> state_events;
+		if( !hdevio->SeekToEvent(target, &state_events) ){
+			jout << hdevio->err_mess.str() << endl;
+			throw JEventSource::RETURN_STATUS::kNO_MORE_EVENTS;
+		}
+
+		// The BOR and EPICS events jumped over are read first so
+		// the run state is correct for the target event.
+		mStateEvents.assign(state_events.begin(), state_events.end());
+		if(VERBOSE>0) jout << "Jumped to event " << target << " (" << mStateEvents.size() << " BOR/EPICS events to replay)" << endl;
+	}
+
 	// Get JEventEVIOBuffer from pool. The JEventEVIOBuffer object has
 	// its own buffer that we will read the EVIO event into, growing it
 	// if needed to hold the entire buffer. 
@@ -95,20 +568,54 @@ std::shared_ptr<const JEvent> JEventSource_EVIO::GetEvent(void)
 	uint32_t  &buff_len      = jevent->buff_len;
 
 	bool allow_swap = false;
-
-	hdevio->readNoFileBuff(buff, buff_len, allow_swap);
-//	evioworker->pos = hdevio->last_event_pos;
-	if(hdevio->err_code == HDEVIO::HDEVIO_USER_BUFFER_TOO_SMALL){
-		delete[] buff;
-		buff_len = hdevio->last_event_len;
-		buff = new uint32_t[buff_len];
-		hdevio->readNoFileBuff(buff, buff_len, allow_swap);
+	bool is_state_event = !mStateEvents.empty();
+
+	if( is_state_event ){
+		// Read state event skipped over by the last seek
+		if( !hdevio->readEvent(mStateEvents.front(), buff, buff_len, allow_swap) ){
+			if(hdevio->err_code == HDEVIO::HDEVIO_USER_BUFFER_TOO_SMALL){
+				delete[] buff;
+				buff_len = hdevio->last_event_len;
+				buff = new uint32_t[buff_len];
+				hdevio->readEvent(mStateEvents.front(), buff, buff_len, allow_swap);
+			}
+		}
+		mStateEvents.pop_front();
+	}else{
+		ReadBuffer(hdevio, jevent);
 	}
 
 	// Check if read was successful
 	if( hdevio->err_code==HDEVIO::HDEVIO_OK ){
 		// HDEVIO_OK
 
+		// Stop once we are past the last event the user asked for
+		if( hdevio->last_event_type==HDEVIO::kBT_PHYSICS ){
+			bool past_last = (LAST_EVENT>0) && (hdevio->last_first_event>LAST_EVENT);
+			if( !mEventList.empty() ){
+				while( mNextListEvent!=mEventList.end() && *mNextListEvent<=hdevio->last_last_event ) mNextListEvent++;
+				if( mNextListEvent==mEventList.end() ){
+					mNoMoreEvents = true; // (this event may still have some we want)
+				}else if( *mNextListEvent > hdevio->last_last_event + kEventListSeekGap ){
+					mNeedSeek = true; // next event is far away so jump to it rather than read through
+				}
+			}
+			if( past_last ){
+				ReturnJEventEVIOBufferToPool(jevent);
+				throw JEventSource::RETURN_STATUS::kNO_MORE_EVENTS;
+			}
+		}
+		if( mHaveShard ){
+			if( is_state_event ){
+				mManifestNstate++;
+			}else{
+				AddToManifest(hdevio, mManifestRanges, mManifestNevio, mManifestNl1);
+			}
+		}
+		jevent->FIRST_EVENT_TO_PUBLISH = mFirstEventToProcess;
+		jevent->LAST_EVENT_TO_PUBLISH  = LAST_EVENT;
+		jevent->EVENTS_TO_PUBLISH      = mEventList.empty() ? nullptr:&mEventList;
+
 		// Fill in some info. on what to do in JEventEVIOBuffer::Process
 		uint32_t myjobtype = JEventEVIOBuffer::JOB_FULL_PARSE;
 		if(hdevio->swap_needed) myjobtype |= JEventEVIOBuffer::JOB_SWAP;
@@ -128,11 +635,15 @@ std::shared_ptr<const JEvent> JEventSource_EVIO::GetEvent(void)
 		if(LOOP_FOREVER && NEVENTS_PROCESSED>=1){
 			if(hdevio){
 				hdevio->rewind();
+				mStateEvents.clear();
+				mNextListEvent = mEventList.lower_bound(mFirstEventToProcess);
+				mNeedSeek = (mFirstEventToProcess>0) || !mEventList.empty();
 				throw JEventSource::RETURN_STATUS::kTRY_AGAIN;
 			}
 		}
 		cout << hdevio->err_mess.str() << endl;
 		if( hdevio->err_code == HDEVIO::HDEVIO_EOF ){
+			mReachedEnd = true;
 			throw JEventSource::RETURN_STATUS::kNO_MORE_EVENTS;
 		}
 
@@ -141,6 +652,123 @@ std::shared_ptr<const JEvent> JEventSource_EVIO::GetEvent(void)
 	}
 }
 
+//-----------------------------------
+// AddToManifest
+//-----------------------------------
+void JEventSource_EVIO::AddToManifest(HDEVIO *h, std::vector<std::pair<uint64_t,uint64_t> > &ranges, uint64_t &Nevio, uint64_t &Nl1)
+{
+	/// Record the event just read by h as handled. Consecutive
+	/// L1 event numbers are merged into a single range.
+
+	Nevio++;
+	if( h->last_event_type != HDEVIO::kBT_PHYSICS ) return;
+
+	Nl1 += h->last_last_event - h->last_first_event + 1;
+	if( !ranges.empty() && ranges.back().second+1 == h->last_first_event ){
+		ranges.back().second = h->last_last_event;
+	}else{
+		ranges.push_back( std::make_pair(h->last_first_event, h->last_last_event) );
+	}
+}
+
+//-----------------------------------
+// WriteManifest
+//-----------------------------------
+void JEventSource_EVIO::WriteManifest(void)
+{
+	/// Write the list of events handled by this job when processing
+	/// a single shard (EVIO:SHARD). The L1 event numbers are written
+	/// as sorted, non-overlapping ranges so manifests from all shards
+	/// of a file can easily be merged and checked for gaps or overlaps.
+
+	auto ranges = mManifestRanges;
+	uint64_t Nevio = mManifestNevio;
+	uint64_t Nl1 = mManifestNl1;
+	for( auto shard : mShards ){
+		ranges.insert(ranges.end(), shard->manifest_ranges.begin(), shard->manifest_ranges.end());
+		Nevio += shard->Nevio_events;
+		Nl1 += shard->Nl1_events;
+	}
+	std::sort(ranges.begin(), ranges.end());
+	std::vector<std::pair<uint64_t,uint64_t> > merged;
+	for( auto &r : ranges ){
+		if( !merged.empty() && r.first<=merged.back().second+1 ){
+			merged.back().second = std::max(merged.back().second, r.second);
+		}else{
+			merged.push_back(r);
+		}
+	}
+
+	std::ofstream ofs(SHARD_MANIFEST);
+	if( !ofs.is_open() ){
+		jerr << "Unable to open \"" << SHARD_MANIFEST << "\" for writing!" << endl;
+		return;
+	}
+	ofs << "# HDEVIO shard manifest" << endl;
+	ofs << "file: " << this->mName << endl;
+	ofs << "shard: " << mShardInfo.index << endl;
+	ofs << "Nshards: " << mShardInfo.Nshards << endl;
+	ofs << "blocks: " << mShardInfo.first_block << " " << mShardInfo.end_block << endl;
+	ofs << "bytes: " << mShardInfo.first_pos << " " << mShardInfo.end_pos << endl;
+	ofs << "complete: " << (mReachedEnd ? 1:0) << endl;
+	ofs << "evio_events: " << Nevio << endl;
+	ofs << "l1_events: " << Nl1 << endl;
+	ofs << "state_events_preloaded: " << mManifestNstate << endl;
+	ofs << "ranges: " << merged.size() << endl;
+	for( auto &r : merged ) ofs << r.first << " " << r.second << endl;
+	ofs.close();
+
+	jout << "Wrote EVIO shard manifest to: " << SHARD_MANIFEST << endl;
+}
+
+//-----------------------------------
+// ReadBuffer
+//-----------------------------------
+bool JEventSource_EVIO::ReadBuffer(HDEVIO *h, JEventEVIOBuffer *jevent)
+{
+	/// Read the next EVIO event from h into jevent using the
+	/// method selected by the EVIO:READ_MODE parameter.
+	/// Returns true if successful. Otherwise, the error is in h.
+
+	uint32_t* &buff          = jevent->buff;
+	uint32_t  &buff_len      = jevent->buff_len;
+
+	bool allow_swap = false;
+	uint32_t event_len = 0;
+
+	for(int itry=0; itry<2; itry++){
+		switch( mReadMode ){
+			case HDEVIO::kREAD_ASYNC:
+				// Zero-copy: jevent will point directly into a block read by one
+				// of the prefetch threads and hold it until returned to the pool.
+				h->readPrefetched(jevent->mapped_buff, event_len, jevent->mapped_region);
+				break;
+			case HDEVIO::kREAD_MMAP:
+				// Zero-copy: jevent will point directly into the file mapping
+				// and hold a reference to it until it is returned to the pool.
+				h->readMapped(jevent->mapped_buff, event_len, jevent->mapped_region);
+				break;
+			case HDEVIO::kREAD_STREAM:
+				h->read(buff, buff_len, allow_swap);
+				break;
+			case HDEVIO::kREAD_SPARSE:
+				h->readSparse(buff, buff_len, allow_swap);
+				break;
+			default:
+				h->readNoFileBuff(buff, buff_len, allow_swap);
+		}
+//		evioworker->pos = h->last_event_pos;
+
+		// Grow buffer and try again if needed
+		if(h->err_code != HDEVIO::HDEVIO_USER_BUFFER_TOO_SMALL) break;
+		delete[] buff;
+		buff_len = h->last_event_len;
+		buff = new uint32_t[buff_len];
+	}
+
+	return h->err_code==HDEVIO::HDEVIO_OK;
+}
+
 //-----------------------------------
 // GetProcessEventTask
 //-----------------------------------
@@ -175,8 +803,11 @@ std::shared_ptr<JTaskBase> JEventSource_EVIO::GetProcessEventTask(std::shared_pt
 JEventEVIOBuffer* JEventSource_EVIO::GetJEventEVIOBufferFromPool(void)
 {
 	// n.b. this is called only from GetEvent which JANA guarantees
-	// will only be called by one thread at a time. No need for a lock
-	// while accessing buff_pool. Multiple threads may call ReturnBufferToPool
+	// will only be called by one thread at a time, or from the reader
+	// threads (EVIO:NREADERS>1) which hold buff_pool_mutex. GetEvent
+	// only calls it before the reader threads are started (see
+	// OpenShards) so the two never overlap. No need
+	// for a lock here while accessing buff_pool. Multiple threads may call ReturnBufferToPool
 	// though so we do need to use a lock if we need to access buff_pool_recycled.
 
 	// Check if buff_pool is empty. If it is, swap everything from
@@ -202,6 +833,16 @@ JEventEVIOBuffer* JEventSource_EVIO::GetJEventEVIOBufferFromPool(void)
 		// event source.
 		evt->mParsedQueue = mEventQueue;
 
+		evt->PARSE_SUBTASKS          = PARSE_SUBTASKS;
+		evt->PARSE_SUBTASK_MIN_WORDS = PARSE_SUBTASK_MIN_WORDS;
+		evt->subtask_pool            = mSubtaskPool;
+		evt->SPECIALIZE_FIRMWARE     = SPECIALIZE_FIRMWARE;
+		evt->parse_mode              = mParseMode;
+		evt->LAZY_PARSE              = LAZY_PARSE;
+		evt->HIT_VIEWS               = HIT_VIEWS;
+		evt->HIT_COLUMNS             = HIT_COLUMNS;
+		evt->ROCIDS_TO_PARSE         = mROCIDsToParse;
+
 	}else{
 		evt = buff_pool.front();
 		buff_pool.pop_front();
@@ -220,6 +861,11 @@ void JEventSource_EVIO::ReturnJEventEVIOBufferToPool( JEventEVIOBuffer *evt )
 	// be called from GetEvent if there was a problem reading the event
 	// and the attempt was aborted.
 
+	// Drop any reference to a memory-mapped region so the mapping
+	// can be released once no in-flight buffers point into it.
+	evt->mapped_buff = NULL;
+	evt->mapped_region.reset();
+
 	std::lock_guard<std::mutex> lck(buff_pool_recycled_mutex);
 
 	evt->Release();
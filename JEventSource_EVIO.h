@@ -72,6 +72,9 @@
 #include <cstdint>
 #include <mutex>
 #include <deque>
+#include <set>
+#include <thread>
+#include <condition_variable>
 
 #include <JANA/JApplication.h>
 #include <JANA/JEventSource.h>
@@ -80,6 +83,7 @@
 #include <JEventEVIOBuffer.h>
 #include <HDEVIO.h>
 #include <DAQ/DBORptrs.h>
+#include <GlueX.h>
 
 
 
@@ -111,17 +115,112 @@ class  JEventSource_EVIO: public JEventSource{
 	protected:
 		int                VERBOSE = 0;
 		bool          LOOP_FOREVER = false;
+		std::string      READ_MODE = "auto";
+		bool              USE_MMAP = false;
+		bool             USE_ASYNC = false;
+		uint32_t  PREFETCH_THREADS = 2;
+		uint32_t    PREFETCH_DEPTH = 16;
+		std::string       SAVE_MAP = "0";
+		uint64_t       FIRST_EVENT = 0;
+		uint64_t        LAST_EVENT = 0;
+		uint64_t       SKIP_EVENTS = 0;
+		std::string     EVENT_LIST = "";
+		uint32_t          NREADERS = 1;
+		uint32_t      READER_DEPTH = 32;
+		uint32_t    PARSE_SUBTASKS = 1;
+		uint32_t PARSE_SUBTASK_MIN_WORDS = 50000;
+		bool   SPECIALIZE_FIRMWARE = true;
+		std::string     PARSE_MODE = "release";
+		bool            LAZY_PARSE = false;
+		bool             HIT_VIEWS = false;
+		bool           HIT_COLUMNS = false;
+		std::string ROCIDS_TO_PARSE = "";
+		std::string SYSTEMS_TO_PARSE = "";
+		std::string ROC_SYSTEM_MAP = "";
+		uint32_t       MAKE_SHARDS = 0;
+		int32_t              SHARD = -1;
+		std::string     SHARD_FILE = "";
+		std::string SHARD_MANIFEST = "";
 		uint64_t NEVENTS_PROCESSED = 0;
 		uint64_t      istreamorder = 0;
 	
 		HDEVIO *hdevio = nullptr;
+		SubtaskPool *mSubtaskPool = nullptr; // (see EVIO:PARSE_SUBTASKS)
 		std::deque< JEventEVIOBuffer* > buff_pool;
 		std::deque< JEventEVIOBuffer* > buff_pool_recycled;
 		std::mutex buff_pool_recycled_mutex;
 	
 		JEventEVIOBuffer* GetJEventEVIOBufferFromPool(void);
 		void ReturnJEventEVIOBufferToPool( JEventEVIOBuffer *jeventeviobuffer );
+		bool ReadBuffer(HDEVIO *h, JEventEVIOBuffer *jevent);
+		HDEVIO::READMODE mReadMode = HDEVIO::kREAD_EVENT;
+		JEventEVIOBuffer::PARSE_MODE mParseMode = JEventEVIOBuffer::kPARSE_RELEASE;
+
+		// Sharded reading (EVIO:NREADERS>1). The file is split into
+		// chunks of about READER_DEPTH events that are dealt out to
+		// the readers in turn. Each reader is a dedicated thread with
+		// its own HDEVIO object that reads its chunks in file order into
+		// its own queue. istreamorder is the index of the EVIO event in
+		// the file map (which lists the same events every read mode
+		// returns) so it is the same as when reading with a single
+		// reader. GetShardedEvent merges the queues on it so events
+		// leave the source in file order.
+		class ReaderShard{
+			public:
+				HDEVIO *hdevio = nullptr;
+				std::thread thr;
+				std::deque<JEventEVIOBuffer*> queue;
+				std::condition_variable cv_space;
+				std::vector<std::pair<uint64_t,uint64_t> > chunks; // block ranges read in turn
+				uint32_t ichunk = 0;
+				uint64_t next_istreamorder = 0; // lowest istreamorder this reader can still give
+				bool done = false;
+				uint32_t err_code = HDEVIO::HDEVIO_OK;
+				std::string err_mess;
+				std::vector<std::pair<uint64_t,uint64_t> > manifest_ranges; // (see EVIO:SHARD)
+				uint64_t Nevio_events = 0;
+				uint64_t Nl1_events = 0;
+		};
+		std::vector<ReaderShard*> mShards;
+		std::mutex mShardMutex;          // guards all shard queues and flags
+		std::condition_variable mShardCVReady;
+		std::mutex buff_pool_mutex;      // guards buff_pool when used by shard threads
+		bool mShardsQuit = false;
+		bool mShardsStarted = false;     // threads are started once mStateEvents is empty
+
+		void OpenShards(void);
+		void StartShards(void);
+		void StopShards(void);
+		void ShardThread(ReaderShard *shard);
+		bool NextShardChunk(ReaderShard *shard);
+		std::shared_ptr<const JEvent> GetShardedEvent(void);
+
+		// Processing of one piece of a file by this job (EVIO:SHARD). The
+		// events handled are recorded and written to a manifest at the end.
+		HDEVIO::ShardInfo mShardInfo;
+		bool mHaveShard = false;
+		bool mReachedEnd = false;
+		std::vector<std::pair<uint64_t,uint64_t> > mManifestRanges;
+		uint64_t mManifestNevio = 0;
+		uint64_t mManifestNl1 = 0;
+		uint64_t mManifestNstate = 0;
+		static void AddToManifest(HDEVIO *h, std::vector<std::pair<uint64_t,uint64_t> > &ranges, uint64_t &Nevio, uint64_t &Nl1);
+		void WriteManifest(void);
 	
+		// Random access (see EVIO:FIRST_EVENT, EVIO:SKIP, EVIO:EVENT_LIST).
+		// When the next event in the list is more than kEventListSeekGap
+		// events ahead we seek to it instead of reading through.
+		static const uint64_t kEventListSeekGap = 1000;
+		std::set<uint64_t> mEventList;
+		std::set<uint64_t>::iterator mNextListEvent;
+		uint64_t mFirstEventToProcess = 0;
+		bool mNeedSeek = false;
+		std::deque<uint64_t> mStateEvents; // BOR/EPICS events to read before continuing after a seek
+		bool mNoMoreEvents = false;
+		void ReadEventList(void);
+		std::vector<uint8_t> mROCIDsToParse; // indexed by rocid. empty=parse all
+		void ReadROCsToParse(void);
+
 		JQueue *mParsedQueue = nullptr;
 		DBORptrs *last_DBORptrs = nullptr;
 		vector<std::shared_ptr<DBORptrs> > mBORptrs;
@@ -0,0 +1,179 @@
+//
+//    File: epics_channels.cc
+//
+// The names are kept in chunks of kChunkSize strings that are never
+// moved or freed so a name can be read without a lock once its id is
+// known. Ids are found by name with an open addressing hash table of
+// id+1 values (0 marks an empty slot). Only Intern adding a new name
+// takes the lock. It fills in the name before publishing its id in
+// the hash table and replaces the hash table with one twice the size
+// (filled in before it is published) when it gets half full. Old hash
+// tables are kept since other threads may still be reading them. A
+// reader that misses a name just added falls back to the locked path.
+//
+
+#include <epics_channels.h>
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+using namespace std;
+
+namespace{
+
+const uint32_t kChunkBits = 10;
+const uint32_t kChunkSize = 1<<kChunkBits;
+const uint32_t kMaxChunks = 4096;
+const uint32_t kNotFound  = 0xFFFFFFFF;
+
+class IdTable{
+	public:
+		IdTable(uint32_t size):mask(size-1),slots(new atomic<uint32_t>[size]){ for(uint32_t i=0; i<size; i++) slots[i].store(0, memory_order_relaxed); }
+		~IdTable(){ delete[] slots; }
+
+		uint32_t          mask;   // size-1 (size is a power of 2)
+		atomic<uint32_t> *slots;  // id+1 or 0
+};
+
+class ChannelTable{
+	public:
+		ChannelTable():Nnames(0){
+			for(uint32_t i=0; i<kMaxChunks; i++) chunks[i].store(NULL, memory_order_relaxed);
+			ids.store(new IdTable(1024), memory_order_relaxed);
+		}
+
+		mutex             mtx;                // only taken to add a name
+		atomic<string*>   chunks[kMaxChunks];
+		atomic<uint32_t>  Nnames;
+		atomic<IdTable*>  ids;
+		vector<IdTable*>  old_ids;            // guarded by mtx
+};
+
+//---------------------------------
+// GetTable
+//---------------------------------
+ChannelTable& GetTable(void)
+{
+	static ChannelTable table;
+	return table;
+}
+
+//---------------------------------
+// Hash
+//---------------------------------
+uint32_t Hash(const char *name, size_t len)
+{
+	// 32 bit FNV-1a
+	uint32_t h = 2166136261u;
+	for(size_t i=0; i<len; i++){
+		h ^= (uint8_t)name[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+//---------------------------------
+// NameOf
+//---------------------------------
+const string& NameOf(ChannelTable &table, uint32_t id)
+{
+	return table.chunks[id>>kChunkBits].load(memory_order_acquire)[id&(kChunkSize-1)];
+}
+
+//---------------------------------
+// Find
+//---------------------------------
+uint32_t Find(ChannelTable &table, const IdTable *ids, const char *name, size_t len, uint32_t h)
+{
+	for(uint32_t i=h&ids->mask; ; i=(i+1)&ids->mask){
+		uint32_t v = ids->slots[i].load(memory_order_acquire);
+		if( v == 0 ) return kNotFound;
+		const string &s = NameOf(table, v-1);
+		if( s.size()==len && s.compare(0, len, name, len)==0 ) return v-1;
+	}
+}
+
+//---------------------------------
+// Insert
+//---------------------------------
+void Insert(IdTable *ids, uint32_t id, uint32_t h)
+{
+	uint32_t i = h&ids->mask;
+	while( ids->slots[i].load(memory_order_relaxed) != 0 ) i = (i+1)&ids->mask;
+	ids->slots[i].store(id+1, memory_order_release);
+}
+
+} // namespace
+
+//---------------------------------
+// Intern
+//---------------------------------
+uint32_t EPICSChannelTable::Intern(const char *name, size_t len)
+{
+	/// Return the id of the given channel name, adding it to the
+	/// table if this is the first time it is seen. This only takes
+	/// a lock (and may allocate) when the name is new.
+
+	ChannelTable &table = GetTable();
+	uint32_t h = Hash(name, len);
+
+	uint32_t id = Find(table, table.ids.load(memory_order_acquire), name, len, h);
+	if( id != kNotFound ) return id;
+
+	lock_guard<mutex> lck(table.mtx);
+
+	// Someone may have added it since we looked
+	IdTable *ids = table.ids.load(memory_order_relaxed);
+	id = Find(table, ids, name, len, h);
+	if( id != kNotFound ) return id;
+
+	id = table.Nnames.load(memory_order_relaxed);
+	uint32_t ichunk = id>>kChunkBits;
+	if( ichunk >= kMaxChunks ) throw length_error("EPICSChannelTable: too many channel names");
+	string *chunk = table.chunks[ichunk].load(memory_order_relaxed);
+	if( !chunk ){
+		chunk = new string[kChunkSize];
+		table.chunks[ichunk].store(chunk, memory_order_release);
+	}
+	chunk[id&(kChunkSize-1)].assign(name, len);
+
+	// Keep the hash table at most half full
+	if( 2*(id+1) > ids->mask+1 ){
+		IdTable *bigger = new IdTable(2*(ids->mask+1));
+		for(uint32_t i=0; i<id; i++){
+			const string &s = NameOf(table, i);
+			Insert(bigger, i, Hash(s.data(), s.size()));
+		}
+		table.old_ids.push_back(ids);
+		ids = bigger;
+		table.ids.store(ids, memory_order_release);
+	}
+
+	Insert(ids, id, h);
+	table.Nnames.store(id+1, memory_order_release);
+
+	return id;
+}
+
+//---------------------------------
+// Name
+//---------------------------------
+const string& EPICSChannelTable::Name(uint32_t id)
+{
+	/// Return the channel name for the given id. The id must have
+	/// come from Intern.
+
+	ChannelTable &table = GetTable();
+	if( id >= table.Nnames.load(memory_order_acquire) ) throw out_of_range("EPICSChannelTable: unknown channel id");
+
+	return NameOf(table, id);
+}
+
+//---------------------------------
+// size
+//---------------------------------
+uint32_t EPICSChannelTable::size(void)
+{
+	return GetTable().Nnames.load(memory_order_acquire);
+}
@@ -0,0 +1,36 @@
+//
+//    File: epics_channels.h
+//
+// Process-wide table of EPICS channel names. Each name seen in an
+// EPICS event is stored once and given a small integer id which is
+// what DEPICSvalue objects carry. The same name always gets the same
+// id for the life of the process so code monitoring a few channels
+// can look up their ids once and compare integers afterwards:
+//
+//    static const uint32_t id = EPICSChannelTable::Intern("IBCAD00CRCUR6");
+//    for(auto v : epics_values) if( v->id == id ) ...
+//
+// Names are never removed so references returned by Name stay valid.
+// All methods are safe to call from any thread. Only Intern of a name
+// not seen before takes a lock. Looking up a known name or the name of
+// an id does not lock or allocate (see epics_channels.cc).
+//
+
+#ifndef _epics_channels_
+#define _epics_channels_
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+class EPICSChannelTable{
+	public:
+		static uint32_t Intern(const char *name, size_t len);
+		static uint32_t Intern(const std::string &name){ return Intern(name.data(), name.size()); }
+		static uint32_t Intern(const char *name){ return Intern(name, strlen(name)); }
+
+		static const std::string& Name(uint32_t id);
+		static uint32_t size(void);
+};
+
+#endif // _epics_channels_
@@ -0,0 +1,117 @@
+//
+//    File: module_words.cc
+//
+
+#include <module_words.h>
+
+#include <stdlib.h>
+
+#include <string>
+using namespace std;
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define MODULE_WORDS_X86 1
+#include <immintrin.h>
+#endif
+
+//---------------------------------
+// index_scalar
+//---------------------------------
+static uint32_t index_scalar(const uint32_t *in, uint32_t Nwords, bool swapped, uint32_t *index)
+{
+	/// Every word's entry is written but the output position only
+	/// advances for defining words. This avoids a data dependent
+	/// branch. index must have room for one entry past the last.
+
+	uint32_t N = 0;
+	for(uint32_t i=0; i<Nwords; i++){
+		uint32_t w = swapped ? __builtin_bswap32(in[i]):in[i];
+		index[N] = (i<<4) | ((w>>27) & 0xF);
+		N += w>>31;
+	}
+
+	return N;
+}
+
+#ifdef MODULE_WORDS_X86
+
+// For each 8 bit mask of defining words in a group of 8, the lane
+// indices of those words packed to the front. Filled on first use.
+alignas(32) static uint32_t kLeftPack[256][8];
+
+//---------------------------------
+// FillLeftPack
+//---------------------------------
+static void FillLeftPack(void)
+{
+	for(uint32_t m=0; m<256; m++){
+		uint32_t n = 0;
+		for(uint32_t i=0; i<8; i++) if( m & (1<<i) ) kLeftPack[m][n++] = i;
+		while(n<8) kLeftPack[m][n++] = 0;
+	}
+}
+
+#define BSWAP32_MASK 3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12
+alignas(32) static const uint8_t kBswap32[32] = {BSWAP32_MASK, BSWAP32_MASK};
+
+//---------------------------------
+// index_avx2
+//---------------------------------
+__attribute__((target("avx2,popcnt")))
+static uint32_t index_avx2(const uint32_t *in, uint32_t Nwords, bool swapped, uint32_t *index)
+{
+	/// Make entries for 8 words at a time. The sign bits give a mask
+	/// of the defining words whose entries are then packed to the
+	/// front with a permute and stored. index must have room for 8
+	/// entries past the last.
+
+	__m256i bswap    = _mm256_load_si256((const __m256i*)kBswap32);
+	__m256i lane     = _mm256_setr_epi32(0,1,2,3,4,5,6,7);
+	__m256i type_msk = _mm256_set1_epi32(0xF);
+
+	uint32_t N = 0;
+	uint32_t i = 0;
+	for(; i+8<=Nwords; i+=8){
+		__m256i w = _mm256_loadu_si256((const __m256i*)&in[i]);
+		if( swapped ) w = _mm256_shuffle_epi8(w, bswap);
+		uint32_t m = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(w));
+		if( m == 0 ) continue;
+
+		__m256i offsets = _mm256_slli_epi32(_mm256_add_epi32(_mm256_set1_epi32(i), lane), 4);
+		__m256i types   = _mm256_and_si256(_mm256_srli_epi32(w, 27), type_msk);
+		__m256i entries = _mm256_or_si256(offsets, types);
+		__m256i perm    = _mm256_load_si256((const __m256i*)kLeftPack[m]);
+		_mm256_storeu_si256((__m256i*)&index[N], _mm256_permutevar8x32_epi32(entries, perm));
+		N += __builtin_popcount(m);
+	}
+
+	// Last few words
+	uint32_t Ntail = index_scalar(&in[i], Nwords-i, swapped, &index[N]);
+	for(uint32_t j=0; j<Ntail; j++) index[N+j] += i<<4;
+
+	return N + Ntail;
+}
+
+#endif // MODULE_WORDS_X86
+
+//---------------------------------
+// GetIndexModuleWordsKernel
+//---------------------------------
+index_module_words_t GetIndexModuleWordsKernel(void)
+{
+	/// Return the AVX2 kernel if the CPU supports it, the scalar
+	/// one otherwise (or if HDEVIO_INDEX_KERNEL=scalar is set).
+
+	const char *force = getenv("HDEVIO_INDEX_KERNEL");
+	if( force && string(force)=="scalar" ) return index_scalar;
+
+#ifdef MODULE_WORDS_X86
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt") ){
+		FillLeftPack();
+		return index_avx2;
+	}
+#endif // MODULE_WORDS_X86
+
+	return index_scalar;
+}
@@ -0,0 +1,51 @@
+//
+//    File: module_words.h
+//
+// Pre-pass used by the JLab module decoders (f250, f125, F1TDC).
+// Data from these modules consists of "data type defining" words
+// (bit 31 set, type in bits 27-30) each followed by zero or more
+// continuation words (bit 31 clear). Rather than testing every word
+// in the decoder's main loop, IndexModuleWords finds all of the
+// defining words of a bank in one pass and records their offsets and
+// types in a compact index. An AVX2 kernel is used if the CPU
+// supports it. Otherwise (or if the environment variable
+// HDEVIO_INDEX_KERNEL=scalar is set) a branch-free scalar loop is
+// used.
+//
+
+#ifndef _module_words_
+#define _module_words_
+
+#include <stdint.h>
+#include <vector>
+
+// Each index entry holds the offset of the word from the start of the
+// bank in the upper 28 bits and its data type in the lower 4 bits.
+typedef uint32_t (*index_module_words_t)(const uint32_t *in, uint32_t Nwords, bool swapped, uint32_t *index);
+
+index_module_words_t GetIndexModuleWordsKernel(void);
+
+inline uint32_t ModuleWordOffset(uint32_t entry){ return entry>>4; }
+inline uint32_t ModuleWordType(uint32_t entry){ return entry&0xF; }
+
+//---------------------------------
+// IndexModuleWords
+//---------------------------------
+inline uint32_t IndexModuleWords(const uint32_t *in, const uint32_t *iend, bool swapped, std::vector<uint32_t> &index)
+{
+	/// Fill index with an entry for each data type defining word from
+	/// in up to iend. The words are byte swapped first if swapped is
+	/// true. Returns the number of entries (index may be larger since
+	/// it is reused and the kernel needs some room to write past the
+	/// last entry).
+
+	static const index_module_words_t kernel = GetIndexModuleWordsKernel();
+
+	if( iend <= in ) return 0;
+	uint32_t Nwords = iend - in;
+	if( index.size() < Nwords+8 ) index.resize(Nwords+8);
+
+	return kernel(in, Nwords, swapped, index.data());
+}
+
+#endif // _module_words_
@@ -0,0 +1,116 @@
+//
+//    File: subtask_pool.cc
+//
+
+#include <subtask_pool.h>
+
+#include <algorithm>
+using namespace std;
+
+//---------------------------------
+// SubtaskPool    (Constructor)
+//---------------------------------
+SubtaskPool::SubtaskPool(uint32_t Nthreads)
+{
+	done = false;
+	jobs.reserve(64);
+	for(uint32_t i=0; i<Nthreads; i++) workers.push_back( thread(&SubtaskPool::WorkerThread, this) );
+}
+
+//---------------------------------
+// ~SubtaskPool    (Destructor)
+//---------------------------------
+SubtaskPool::~SubtaskPool()
+{
+	{
+		lock_guard<mutex> lck(mtx);
+		done = true;
+	}
+	work_cv.notify_all();
+	for(auto &t : workers) t.join();
+}
+
+//---------------------------------
+// RunJob
+//---------------------------------
+void SubtaskPool::RunJob(uint32_t Ntasks, task_t task, void *arg)
+{
+	/// Run task(arg, i) for i=0..Ntasks-1 using this thread and any
+	/// idle workers. See the comments at the top of subtask_pool.h.
+
+	if( Ntasks == 0 ) return;
+
+	Job job;
+	job.task   = task;
+	job.arg    = arg;
+	job.Ntasks = Ntasks;
+	job.next   = 0;
+	job.Ndone  = 0;
+
+	if( Ntasks>1 && !workers.empty() ){
+		{
+			lock_guard<mutex> lck(mtx);
+			jobs.push_back(&job);
+		}
+		work_cv.notify_all();
+	}
+
+	// Work on our own job until all of its subtasks are taken
+	while(true){
+		uint32_t itask = job.next++;
+		if( itask >= Ntasks ) break;
+		RunSubtask(&job, itask);
+	}
+
+	// Make sure no worker can take it any more and wait for those
+	// that already did
+	unique_lock<mutex> lck(mtx);
+	auto it = find(jobs.begin(), jobs.end(), &job);
+	if( it != jobs.end() ) jobs.erase(it);
+	done_cv.wait(lck, [&job](){ return job.Ndone >= job.Ntasks; });
+	lck.unlock();
+
+	if( job.eptr ) rethrow_exception(job.eptr);
+}
+
+//---------------------------------
+// RunSubtask
+//---------------------------------
+void SubtaskPool::RunSubtask(Job *job, uint32_t itask)
+{
+	exception_ptr eptr;
+	try{
+		job->task(job->arg, itask);
+	}catch(...){
+		eptr = current_exception();
+	}
+
+	lock_guard<mutex> lck(mtx);
+	if( eptr && !job->eptr ) job->eptr = eptr;
+	if( ++job->Ndone >= job->Ntasks ) done_cv.notify_all();
+}
+
+//---------------------------------
+// WorkerThread
+//---------------------------------
+void SubtaskPool::WorkerThread(void)
+{
+	unique_lock<mutex> lck(mtx);
+	while(true){
+		work_cv.wait(lck, [this](){ return done || !jobs.empty(); });
+		if( done ) return;
+
+		// Take the next subtask of the oldest job. Jobs are removed
+		// once all of their subtasks have been taken.
+		Job *job = jobs.front();
+		uint32_t itask = job->next++;
+		if( itask >= job->Ntasks ){
+			jobs.erase(jobs.begin());
+			continue;
+		}
+
+		lck.unlock();
+		RunSubtask(job, itask);
+		lck.lock();
+	}
+}
@@ -0,0 +1,74 @@
+//
+//    File: subtask_pool.h
+//
+// A fixed set of worker threads that run the subtasks of a job
+// (see JEventEVIOBuffer::ParseDataBanksInSubtasks). The threads are
+// started once when the pool is made and live until it is deleted
+// so no threads are created while events are being parsed. One pool
+// is shared by all of the JEventEVIOBuffer objects of a source.
+//
+// Run(N, task) calls task(i) for i=0..N-1 and returns once all of
+// them are done. The calling thread takes subtasks from its own job
+// along with any idle workers. It never waits for workers that are
+// busy with another job so a job always finishes even if every
+// worker is busy. The first exception thrown by a subtask is passed
+// on by Run after all of them have finished.
+//
+
+#ifndef _subtask_pool_
+#define _subtask_pool_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class SubtaskPool{
+	public:
+
+		SubtaskPool(uint32_t Nthreads);
+		virtual ~SubtaskPool();
+
+		uint32_t GetNthreads(void) const { return workers.size(); }
+
+		template<class F>
+		void Run(uint32_t Ntasks, F &task){ RunJob(Ntasks, &CallTask<F>, &task); }
+
+	protected:
+
+		typedef void (*task_t)(void *arg, uint32_t itask);
+
+		class Job{
+			public:
+				task_t   task;
+				void    *arg;
+				uint32_t Ntasks;
+				std::atomic<uint32_t> next;  // index of next subtask to be taken
+				uint32_t Ndone;              // guarded by mtx
+				std::exception_ptr eptr;     // guarded by mtx
+		};
+
+		template<class F>
+		static void CallTask(void *arg, uint32_t itask){ (*(F*)arg)(itask); }
+
+		void RunJob(uint32_t Ntasks, task_t task, void *arg);
+		void RunSubtask(Job *job, uint32_t itask);
+		void WorkerThread(void);
+
+		std::mutex mtx;
+		std::condition_variable work_cv;  // workers wait here for jobs
+		std::condition_variable done_cv;  // callers wait here for their jobs to finish
+		std::vector<Job*> jobs;           // jobs with subtasks not yet taken
+		std::vector<std::thread> workers;
+		bool done;
+
+	private:
+		SubtaskPool(const SubtaskPool&);
+		SubtaskPool& operator=(const SubtaskPool&);
+};
+
+#endif // _subtask_pool_
@@ -1,197 +1,278 @@
 
+
 #include <swap_bank.h>
 
 #include <string.h>
 
 #include <iostream>
 #include <sstream>
+#include <future>
+#include <thread>
+#include <vector>
 using namespace std;
 
 #include <JANA/JException.h>
 
+// Types of structures that can appear in an EVIO container
+enum{
+	kSWAP_BANK,
+	kSWAP_SEGMENT,
+	kSWAP_TAGSEGMENT
+};
+
+// One level of the container stack used by swap_structures
+struct SwapFrame{
+	uint32_t end;   // index one past last word of container
+	uint32_t kind;  // kind of structures the container holds
+};
+
 //---------------------------------
-// swap_bank
+// swap_data
 //---------------------------------
-uint32_t swap_bank(uint32_t *outbuff, uint32_t *inbuff, uint32_t len)
+static inline bool swap_data(uint32_t *outbuff, const uint32_t *inbuff, uint32_t type, uint32_t Nwords)
 {
-	/// Swap an EVIO bank. If the bank contains data, it is automatically
-	/// swapped according to it's type. If the bank is a container of other
-	/// containers, then this repeatedly calls the swapper methods for the
-	/// appropriate container type (bank, tagsegment, segment). This means
-	/// that this method will be recursive in the cases where it is a bank
-	/// of banks.
-
-	if(len < 2) throw JException("Attempt to swap bank with len<2", __FILE__, __LINE__);
-	
-	// Swap length and header words
-	swap_block(inbuff, 2, outbuff);
-	uint32_t bank_len = outbuff[0];
-	if((bank_len+1) > len){
-		stringstream ss;
-		ss << "WARNING: Bank length word exceeds valid words in buffer (" << bank_len+1 << " > " << len << ")";
-		throw JException(ss.str(), __FILE__, __LINE__);
-	}
-	if( bank_len < 1 ){
-		throw JException("EVIO bank length word is zero in swap_bank!", __FILE__, __LINE__);
-	}
-	
-	uint32_t type = (outbuff[1]>>8) & 0xFF;
-	uint32_t Nwords = bank_len - 1;
-	uint32_t Nswapped = 2;
+	/// Swap (or copy) Nwords of leaf data according to the EVIO data
+	/// type. Returns false if type is not a data type.
+
 	switch(type){
 		case 0x0a:  // 64 bit unsigned int
 		case 0x08:  // 64 bit double
 		case 0x09:  // 64 bit signed int
-			swap_block((uint64_t*)&inbuff[2], Nwords/2, (uint64_t*)&outbuff[2]);
-			Nswapped += Nwords;
-			break;
+			swap_block((const uint64_t*)inbuff, Nwords/2, (uint64_t*)outbuff);
+			if( (Nwords&0x1) && (inbuff!=outbuff) ) outbuff[Nwords-1] = inbuff[Nwords-1];
+			return true;
 		case 0x01:  // 32 bit unsigned int
 		case 0x02:  // 32 bit float
 		case 0x0b:  // 32 bit signed int
-			swap_block(&inbuff[2], Nwords, &outbuff[2]);
-			Nswapped += Nwords;
-			break;
+			swap_block(inbuff, Nwords, outbuff);
+			return true;
 		case 0x05:  // 16 bit unsigned int
 		case 0x04:  // 16 bit signed int
-			swap_block((uint16_t*)&inbuff[2], Nwords*2, (uint16_t*)&outbuff[2]);
-			Nswapped += Nwords;
-			break;
+			swap_block((const uint16_t*)inbuff, Nwords*2, (uint16_t*)outbuff);
+			return true;
 		case 0x00:  // 32 bit unknown (not swapped)
+		case 0x03:  // 8 bit character string
 		case 0x07:  // 8 bit unsigned int
 		case 0x06:  // 8 bit signed int
-			if( inbuff!=outbuff ) memcpy((uint8_t*)&outbuff[2], (uint8_t*)&inbuff[2], Nwords*sizeof(uint32_t));
-			Nswapped += Nwords;
-			break;
-		case 0x0c:
-			while(Nswapped < (Nwords+2)){
-				uint32_t N = swap_tagsegment(&outbuff[Nswapped], &inbuff[Nswapped], (Nwords+2)-Nswapped);
-				if(N == 0) return Nswapped;
-				Nswapped += N;
+			if( inbuff!=outbuff ) memcpy(outbuff, inbuff, Nwords*sizeof(uint32_t));
+			return true;
+	}
+
+	return false;
+}
+
+//---------------------------------
+// swap_structures
+//---------------------------------
+static uint32_t swap_structures(uint32_t *outbuff, const uint32_t *inbuff, uint32_t istart, uint32_t iend, uint32_t kind, int &err_code, string &err_mess)
+{
+	/// Swap the consecutive structures of the given kind (bank, segment
+	/// or tagsegment) occupying words istart to iend-1. Headers are
+	/// swapped first so their lengths and types can be read from
+	/// outbuff. Leaf data is swapped directly from inbuff into outbuff
+	/// in a single pass. Containers are followed using an explicit
+	/// stack rather than recursion. inbuff and outbuff may be the same.
+	///
+	/// Returns the index of the first word not swapped. This is iend
+	/// if everything went OK. Otherwise, err_code and err_mess are set.
+
+	SwapFrame stack[SWAP_BANK_MAX_DEPTH];
+	int depth = 0;
+	stack[0].end  = iend;
+	stack[0].kind = kind;
+
+	uint32_t i = istart;
+	while(depth >= 0){
+		SwapFrame &f = stack[depth];
+		if(i >= f.end){
+			depth--;
+			continue;
+		}
+
+		uint32_t avail = f.end - i;
+		uint32_t Nheader;
+		uint32_t Nwords;
+		uint32_t type;
+		if(f.kind == kSWAP_BANK){
+			if(avail < 2){
+				stringstream ss;
+				ss << "WARNING: Bank header truncated (" << avail << " words left in container)";
+				err_mess = ss.str();
+				err_code = SWAP_BANK_TRUNCATED;
+				return i;
 			}
-			break;
-		case 0x0d:
-		case 0x20:
-			while(Nswapped < (Nwords+2)){
-				uint32_t N = swap_segment(&outbuff[Nswapped], &inbuff[Nswapped], (Nwords+2)-Nswapped);
-				if(N == 0) return Nswapped;
-				Nswapped += N;
+			outbuff[i  ] = swap32(inbuff[i  ]);
+			outbuff[i+1] = swap32(inbuff[i+1]);
+			uint32_t bank_len = outbuff[i];
+			if( (bank_len < 1) || (bank_len > avail-1) ){
+				stringstream ss;
+				ss << "WARNING: Bank length word exceeds valid words in buffer (" << (uint64_t)bank_len+1 << " > " << avail << ")";
+				err_mess = ss.str();
+				err_code = SWAP_BANK_TRUNCATED;
+				return i;
 			}
-			break;
-		case 0x0e:
-		case 0x10:
-			while(Nswapped < (Nwords+2)){
-				uint32_t N = swap_bank(&outbuff[Nswapped], &inbuff[Nswapped], (Nwords+2)-Nswapped);
-				if(N == 0) return Nswapped;
-				Nswapped += N;
+			Nheader = 2;
+			Nwords  = bank_len - 1;
+			type    = (outbuff[i+1]>>8) & 0x3F;
+		}else{
+			outbuff[i] = swap32(inbuff[i]);
+			Nheader = 1;
+			Nwords  = outbuff[i] & 0xFFFF;
+			type    = (outbuff[i]>>16) & (f.kind==kSWAP_SEGMENT ? 0x3F:0x0F);
+			if( Nwords > avail-1 ){
+				stringstream ss;
+				ss << "WARNING: Segment length word exceeds valid words in buffer (" << Nwords+1 << " > " << avail << ")";
+				err_mess = ss.str();
+				err_code = SWAP_BANK_TRUNCATED;
+				return i;
 			}
-			break;
-		default:
-			stringstream ss;
-			ss << "WARNING: unknown bank type (0x" << hex << type << dec << ")";
-			throw JException(ss.str(), __FILE__, __LINE__);
+		}
+
+		uint32_t idata = i + Nheader;
+		uint32_t inext = idata + Nwords;
+		uint32_t child_kind;
+		switch(type){
+			case 0x0c:
+				child_kind = kSWAP_TAGSEGMENT;
+				break;
+			case 0x0d:
+			case 0x20:
+				child_kind = kSWAP_SEGMENT;
+				break;
+			case 0x0e:
+			case 0x10:
+				child_kind = kSWAP_BANK;
+				break;
+			default:
+				if( !swap_data(&outbuff[idata], &inbuff[idata], type, Nwords) ){
+					stringstream ss;
+					ss << "WARNING: unknown bank type (0x" << hex << type << dec << ")";
+					err_mess = ss.str();
+					err_code = SWAP_BANK_UNKNOWN_TYPE;
+					return i;
+				}
+				i = inext;
+				continue;
+		}
 
-			break;
+		// Container: descend into it
+		if( depth+1 >= SWAP_BANK_MAX_DEPTH ){
+			stringstream ss;
+			ss << "WARNING: EVIO containers nested more than " << SWAP_BANK_MAX_DEPTH << " deep";
+			err_mess = ss.str();
+			err_code = SWAP_BANK_TOO_DEEP;
+			return i;
+		}
+		depth++;
+		stack[depth].end  = inext;
+		stack[depth].kind = child_kind;
+		i = idata;
 	}
 
-	return Nswapped;
+	return i;
 }
 
 //---------------------------------
-// swap_tagsegment
+// swap_bank
 //---------------------------------
-uint32_t swap_tagsegment(uint32_t *outbuff, uint32_t *inbuff, uint32_t len)
+uint32_t swap_bank(uint32_t *outbuff, const uint32_t *inbuff, uint32_t len, int &err_code, string &err_mess, uint32_t parallel_min_words, uint32_t Nthreads)
 {
-	/// Swap an EVIO tagsegment. 
-
-	if(len < 1) throw JException("Attempt to swap segment with len<1");
-	
-	// Swap header/length word
-	swap_block(inbuff, 1, outbuff);
-	uint32_t bank_len = outbuff[0] & 0xFFFF;
-	if((bank_len) > len){
+	/// Swap an EVIO bank from inbuff into outbuff. Every header is
+	/// swapped and any data is swapped according to its type while
+	/// being copied so the event is only passed over once. inbuff and
+	/// outbuff may be the same for an in-place swap.
+	///
+	/// If the bank is a bank of banks at least parallel_min_words
+	/// long, its child banks (the ROC banks of a physics event) are
+	/// divided among Nthreads threads (the number of hardware threads
+	/// if 0). Set parallel_min_words to 0 to always swap in the
+	/// calling thread.
+	///
+	/// Returns the number of words swapped. This will be less than
+	/// the bank length if an error occurred, in which case err_code
+	/// and err_mess are set.
+
+	err_code = SWAP_BANK_OK;
+	err_mess.clear();
+
+	if(len < 2){
+		err_mess = "Attempt to swap bank with len<2";
+		err_code = SWAP_BANK_TRUNCATED;
+		return 0;
+	}
+
+	// Length and type are read without touching outbuff so the
+	// serial walker below can still swap the header in place.
+	uint32_t bank_len = swap32(inbuff[0]);
+	if( (bank_len < 1) || (bank_len > len-1) ){
 		stringstream ss;
-		ss << "Segment length word exceeds valid words in buffer (" << bank_len << " > " << len << ")";
-		throw JException(ss.str(), __FILE__, __LINE__);
+		ss << "WARNING: Bank length word exceeds valid words in buffer (" << (uint64_t)bank_len+1 << " > " << len << ")";
+		err_mess = ss.str();
+		err_code = SWAP_BANK_TRUNCATED;
+		return 0;
 	}
-	
-	uint32_t type = (outbuff[0]>>16) & 0x0F;
-	uint32_t Nwords = bank_len;
-	uint32_t Nswapped = 1;
-	switch(type){
-		case 0x0a:  // 64 bit unsigned int
-		case 0x08:  // 64 bit double
-		case 0x09:  // 64 bit signed int
-			swap_block((uint64_t*)&inbuff[1], Nwords/2, (uint64_t*)&outbuff[1]);
-			Nswapped += Nwords;
-			break;
-		case 0x01:  // 32 bit unsigned int
-		case 0x02:  // 32 bit float
-		case 0x0b:  // 32 bit signed int
-			swap_block(&inbuff[1], Nwords, &outbuff[1]);
-			Nswapped += Nwords;
-			break;
-		case 0x05:  // 16 bit unsigned int
-		case 0x04:  // 16 bit signed int
-			swap_block((uint16_t*)&inbuff[1], Nwords*2, (uint16_t*)&outbuff[1]);
-			Nswapped += Nwords;
-			break;
-		case 0x00:  // 32 bit unknown (not swapped)
-		case 0x07:  // 8 bit unsigned int
-		case 0x06:  // 8 bit signed int
-			if( inbuff!=outbuff ) memcpy((uint8_t*)&outbuff[1], (uint8_t*)&inbuff[1], Nwords*sizeof(uint32_t));
-			Nswapped += Nwords;
-			break;
+	uint32_t iend = bank_len + 1;
+	uint32_t type = (swap32(inbuff[1])>>8) & 0x3F;
+
+	if( Nthreads == 0 ) Nthreads = thread::hardware_concurrency();
+	bool parallel = (parallel_min_words>0) && (iend>=parallel_min_words) && (Nthreads>1);
+	if( parallel && (type==0x0e || type==0x10) ){
+
+		// Find child bank boundaries from their (swapped) length words
+		// and cut them into roughly equal sized chunks. If a length
+		// word is bad, the remainder goes into the last chunk where
+		// the walker will find and report it.
+		uint32_t chunk_words = (iend - 2)/Nthreads + 1;
+		vector<uint32_t> boundaries(1, 2);
+		for(uint32_t i=2; i<iend; ){
+			uint32_t child_len = swap32(inbuff[i]);
+			if( (child_len < 1) || (child_len > iend-i-1) ) break;
+			i += child_len + 1;
+			if( (i - boundaries.back()) >= chunk_words ) boundaries.push_back(i);
+		}
+		if( boundaries.back() != iend ) boundaries.push_back(iend);
+
+		if( boundaries.size() > 2 ){
+			outbuff[0] = swap32(inbuff[0]);
+			outbuff[1] = swap32(inbuff[1]);
+
+			uint32_t Nchunks = boundaries.size() - 1;
+			vector<int>    codes(Nchunks, SWAP_BANK_OK);
+			vector<string> messes(Nchunks);
+			vector<future<uint32_t> > futs;
+			for(uint32_t ichunk=1; ichunk<Nchunks; ichunk++){
+				futs.push_back(async(launch::async, swap_structures, outbuff, inbuff, boundaries[ichunk], boundaries[ichunk+1], (uint32_t)kSWAP_BANK, ref(codes[ichunk]), ref(messes[ichunk])));
+			}
+			vector<uint32_t> ilast(1, swap_structures(outbuff, inbuff, boundaries[0], boundaries[1], kSWAP_BANK, codes[0], messes[0]));
+			for(auto &f : futs) ilast.push_back(f.get());
+
+			// Report the first chunk with an error
+			for(uint32_t ichunk=0; ichunk<Nchunks; ichunk++){
+				if(codes[ichunk] != SWAP_BANK_OK){
+					err_code = codes[ichunk];
+					err_mess = messes[ichunk];
+					return ilast[ichunk];
+				}
+			}
+			return iend;
+		}
 	}
 
-	return Nswapped;
+	return swap_structures(outbuff, inbuff, 0, iend, kSWAP_BANK, err_code, err_mess);
 }
 
 //---------------------------------
-// swap_segment
+// swap_bank
 //---------------------------------
-uint32_t swap_segment(uint32_t *outbuff, uint32_t *inbuff, uint32_t len)
+uint32_t swap_bank(uint32_t *outbuff, const uint32_t *inbuff, uint32_t len)
 {
-	/// Swap an EVIO segment. 
-
-	if(len < 1) throw JException("Attempt to swap segment with len<1");
-	
-	// Swap header/length word
-	swap_block(inbuff, 1, outbuff);
-	uint32_t bank_len = outbuff[0] & 0xFFFF;
-	if((bank_len) > len){
-		stringstream ss;
-		ss << "Segment length word exceeds valid words in buffer (" << bank_len << " > " << len << ")";
-		throw JException(ss.str(), __FILE__, __LINE__);
-	}
-	
-	uint32_t type = (outbuff[0]>>16) & 0x3F;
-	uint32_t Nwords = bank_len;
-	uint32_t Nswapped = 1;
-	switch(type){
-		case 0x0a:  // 64 bit unsigned int
-		case 0x08:  // 64 bit double
-		case 0x09:  // 64 bit signed int
-			swap_block((uint64_t*)&inbuff[1], Nwords/2, (uint64_t*)&outbuff[1]);
-			Nswapped += Nwords;
-			break;
-		case 0x01:  // 32 bit unsigned int
-		case 0x02:  // 32 bit float
-		case 0x0b:  // 32 bit signed int
-			swap_block(&inbuff[1], Nwords, &outbuff[1]);
-			Nswapped += Nwords;
-			break;
-		case 0x05:  // 16 bit unsigned int
-		case 0x04:  // 16 bit signed int
-			swap_block((uint16_t*)&inbuff[1], Nwords*2, (uint16_t*)&outbuff[1]);
-			Nswapped += Nwords;
-			break;
-		case 0x00:  // 32 bit unknown (not swapped)
-		case 0x07:  // 8 bit unsigned int
-		case 0x06:  // 8 bit signed int
-			if( inbuff!=outbuff ) memcpy((uint8_t*)&outbuff[1], (uint8_t*)&inbuff[1], Nwords*sizeof(uint32_t));
-			Nswapped += Nwords;
-			break;
-	}
+	/// Swap an EVIO bank, throwing a JException if it can't be done.
+	/// See the version above for details.
+
+	int err_code;
+	string err_mess;
+	uint32_t Nswapped = swap_bank(outbuff, inbuff, len, err_code, err_mess);
+	if(err_code != SWAP_BANK_OK) throw JException(err_mess, __FILE__, __LINE__);
 
 	return Nswapped;
 }
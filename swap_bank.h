@@ -1,13 +1,18 @@
+// This contains code for byte swapping EVIO banks. It is used
+// both by HDEVIO and by JEventEVIOBuffer so there is only one
+// implementation of the bank walker. The core routine reports
+// errors through a code and message so HDEVIO can fold them into
+// its own error flag/message system. The 3 argument swap_bank
+// throws a JException instead.
 
+#ifndef _swap_bank_
+#define _swap_bank_
 
-// This contains code for byte swapping EVIO banks. The code
-// is mostly copied from HDEVIO, but modified to just print
-// any errors rather than use the error flag/message system
-// built into HDEVIO. It can therefore be used outside of
-// HDEVIO.
+#include <stdint.h>
 
+#include <string>
 
-#include <stdint.h>
+#include <swap_block.h>
 
 #undef swap64
 #undef swap32
@@ -34,38 +39,47 @@
 //---------------------------------------
 
 
-uint32_t swap_bank(uint32_t *outbuff, uint32_t *inbuff, uint32_t len);
-uint32_t swap_tagsegment(uint32_t *outbuff, uint32_t *inbuff, uint32_t len);
-uint32_t swap_segment(uint32_t *outbuff, uint32_t *inbuff, uint32_t len);
+// Events at least this many words long have their top-level banks
+// (one per ROC for physics events) swapped by several threads.
+// Below this the thread start-up costs more than it saves.
+#define SWAP_BANK_PARALLEL_MIN_WORDS (1<<22)
+
+// Maximum depth of nested containers the bank walker will follow
+#define SWAP_BANK_MAX_DEPTH 64
+
+enum{
+	SWAP_BANK_OK = 0,
+	SWAP_BANK_TRUNCATED,
+	SWAP_BANK_UNKNOWN_TYPE,
+	SWAP_BANK_TOO_DEEP
+};
+
+uint32_t swap_bank(uint32_t *outbuff, const uint32_t *inbuff, uint32_t len, int &err_code, std::string &err_mess, uint32_t parallel_min_words=SWAP_BANK_PARALLEL_MIN_WORDS, uint32_t Nthreads=0);
+uint32_t swap_bank(uint32_t *outbuff, const uint32_t *inbuff, uint32_t len);
 
 
 //---------------------------------
 // swap_block
 //---------------------------------
-inline void swap_block(uint16_t *inbuff, uint16_t len, uint16_t *outbuff)
+inline void swap_block(const uint16_t *inbuff, uint32_t len, uint16_t *outbuff)
 {
-	for(uint32_t i=0; i<len; i++, inbuff++, outbuff++){
-		*outbuff = swap16(*inbuff);
-	}
+	swap_block16(inbuff, outbuff, len);
 }
 
 //---------------------------------
 // swap_block
 //---------------------------------
-inline void swap_block(uint32_t *inbuff, uint32_t len, uint32_t *outbuff)
+inline void swap_block(const uint32_t *inbuff, uint32_t len, uint32_t *outbuff)
 {
-	for(uint32_t i=0; i<len; i++, inbuff++, outbuff++){
-		*outbuff = swap32(*inbuff);
-	}
+	swap_block32(inbuff, outbuff, len);
 }
 
 //---------------------------------
 // swap_block
 //---------------------------------
-inline void swap_block(uint64_t *inbuff, uint64_t len, uint64_t *outbuff)
+inline void swap_block(const uint64_t *inbuff, uint64_t len, uint64_t *outbuff)
 {
-	for(uint32_t i=0; i<len; i++, inbuff++, outbuff++){
-		*outbuff = swap64(*inbuff);
-	}
+	swap_block64(inbuff, outbuff, len);
 }
 
+#endif // _swap_bank_
@@ -0,0 +1,200 @@
+//
+//    File: swap_block.cc
+//
+
+#include <swap_block.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+using namespace std;
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SWAP_BLOCK_X86 1
+#include <immintrin.h>
+#endif
+
+// Byte permutations that reverse each 2, 4, or 8 byte word. These
+// are 64 bytes long so the same table can be loaded as an SSE, AVX2
+// or AVX-512 register. (pshufb only permutes within 128-bit lanes
+// so every 16 bytes repeat.)
+#define SWAP_MASK16 1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14
+#define SWAP_MASK32 3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12
+#define SWAP_MASK64 7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8
+alignas(64) static const uint8_t kSwapMask16[64] = {SWAP_MASK16, SWAP_MASK16, SWAP_MASK16, SWAP_MASK16};
+alignas(64) static const uint8_t kSwapMask32[64] = {SWAP_MASK32, SWAP_MASK32, SWAP_MASK32, SWAP_MASK32};
+alignas(64) static const uint8_t kSwapMask64[64] = {SWAP_MASK64, SWAP_MASK64, SWAP_MASK64, SWAP_MASK64};
+
+//---------------------------------
+// swap_tail
+//---------------------------------
+template<typename T>
+static inline void swap_tail(const uint8_t *in, uint8_t *out, size_t nbytes)
+{
+	/// Scalar swap of whatever is left after the vector loop. memcpy
+	/// is used so the buffers need not be aligned to sizeof(T).
+	for(size_t i=0; i+sizeof(T)<=nbytes; i+=sizeof(T)){
+		T v;
+		memcpy(&v, &in[i], sizeof(T));
+		switch(sizeof(T)){
+			case 2: v = (T)__builtin_bswap16((uint16_t)v); break;
+			case 4: v = (T)__builtin_bswap32((uint32_t)v); break;
+			case 8: v = (T)__builtin_bswap64((uint64_t)v); break;
+		}
+		memcpy(&out[i], &v, sizeof(T));
+	}
+}
+
+//---------------------------------
+// swap_scalar
+//---------------------------------
+template<typename T>
+static void swap_scalar(const void *inbuff, void *outbuff, size_t nbytes)
+{
+	swap_tail<T>((const uint8_t*)inbuff, (uint8_t*)outbuff, nbytes);
+}
+
+#ifdef SWAP_BLOCK_X86
+
+//---------------------------------
+// swap_ssse3
+//---------------------------------
+template<typename T>
+__attribute__((target("ssse3")))
+static void swap_ssse3(const void *inbuff, void *outbuff, size_t nbytes)
+{
+	const uint8_t *mask = sizeof(T)==2 ? kSwapMask16:(sizeof(T)==4 ? kSwapMask32:kSwapMask64);
+	const uint8_t *in  = (const uint8_t*)inbuff;
+	uint8_t       *out = (uint8_t*)outbuff;
+	__m128i m = _mm_load_si128((const __m128i*)mask);
+
+	size_t i = 0;
+	for(; i+64<=nbytes; i+=64){
+		__m128i a = _mm_loadu_si128((const __m128i*)&in[i+ 0]);
+		__m128i b = _mm_loadu_si128((const __m128i*)&in[i+16]);
+		__m128i c = _mm_loadu_si128((const __m128i*)&in[i+32]);
+		__m128i d = _mm_loadu_si128((const __m128i*)&in[i+48]);
+		_mm_storeu_si128((__m128i*)&out[i+ 0], _mm_shuffle_epi8(a, m));
+		_mm_storeu_si128((__m128i*)&out[i+16], _mm_shuffle_epi8(b, m));
+		_mm_storeu_si128((__m128i*)&out[i+32], _mm_shuffle_epi8(c, m));
+		_mm_storeu_si128((__m128i*)&out[i+48], _mm_shuffle_epi8(d, m));
+	}
+	for(; i+16<=nbytes; i+=16){
+		__m128i a = _mm_loadu_si128((const __m128i*)&in[i]);
+		_mm_storeu_si128((__m128i*)&out[i], _mm_shuffle_epi8(a, m));
+	}
+	swap_tail<T>(&in[i], &out[i], nbytes-i);
+}
+
+//---------------------------------
+// swap_avx2
+//---------------------------------
+template<typename T>
+__attribute__((target("avx2")))
+static void swap_avx2(const void *inbuff, void *outbuff, size_t nbytes)
+{
+	const uint8_t *mask = sizeof(T)==2 ? kSwapMask16:(sizeof(T)==4 ? kSwapMask32:kSwapMask64);
+	const uint8_t *in  = (const uint8_t*)inbuff;
+	uint8_t       *out = (uint8_t*)outbuff;
+	__m256i m = _mm256_load_si256((const __m256i*)mask);
+
+	size_t i = 0;
+	for(; i+128<=nbytes; i+=128){
+		__m256i a = _mm256_loadu_si256((const __m256i*)&in[i+ 0]);
+		__m256i b = _mm256_loadu_si256((const __m256i*)&in[i+32]);
+		__m256i c = _mm256_loadu_si256((const __m256i*)&in[i+64]);
+		__m256i d = _mm256_loadu_si256((const __m256i*)&in[i+96]);
+		_mm256_storeu_si256((__m256i*)&out[i+ 0], _mm256_shuffle_epi8(a, m));
+		_mm256_storeu_si256((__m256i*)&out[i+32], _mm256_shuffle_epi8(b, m));
+		_mm256_storeu_si256((__m256i*)&out[i+64], _mm256_shuffle_epi8(c, m));
+		_mm256_storeu_si256((__m256i*)&out[i+96], _mm256_shuffle_epi8(d, m));
+	}
+	for(; i+32<=nbytes; i+=32){
+		__m256i a = _mm256_loadu_si256((const __m256i*)&in[i]);
+		_mm256_storeu_si256((__m256i*)&out[i], _mm256_shuffle_epi8(a, m));
+	}
+	swap_tail<T>(&in[i], &out[i], nbytes-i);
+}
+
+//---------------------------------
+// swap_avx512
+//---------------------------------
+template<typename T>
+__attribute__((target("avx512f,avx512bw")))
+static void swap_avx512(const void *inbuff, void *outbuff, size_t nbytes)
+{
+	const uint8_t *mask = sizeof(T)==2 ? kSwapMask16:(sizeof(T)==4 ? kSwapMask32:kSwapMask64);
+	const uint8_t *in  = (const uint8_t*)inbuff;
+	uint8_t       *out = (uint8_t*)outbuff;
+	__m512i m = _mm512_load_si512((const void*)mask);
+
+	size_t i = 0;
+	for(; i+128<=nbytes; i+=128){
+		__m512i a = _mm512_loadu_si512((const void*)&in[i+ 0]);
+		__m512i b = _mm512_loadu_si512((const void*)&in[i+64]);
+		_mm512_storeu_si512((void*)&out[i+ 0], _mm512_shuffle_epi8(a, m));
+		_mm512_storeu_si512((void*)&out[i+64], _mm512_shuffle_epi8(b, m));
+	}
+	for(; i+64<=nbytes; i+=64){
+		__m512i a = _mm512_loadu_si512((const void*)&in[i]);
+		_mm512_storeu_si512((void*)&out[i], _mm512_shuffle_epi8(a, m));
+	}
+	swap_tail<T>(&in[i], &out[i], nbytes-i);
+}
+
+#endif // SWAP_BLOCK_X86
+
+//---------------------------------
+// SelectSwapKernels
+//---------------------------------
+static SwapKernels SelectSwapKernels(void)
+{
+	/// Pick the widest kernel set the CPU supports. The environment
+	/// variable HDEVIO_SWAP_KERNEL can be set to "scalar", "ssse3",
+	/// "avx2" or "avx512" to force a lower one (e.g. to compare
+	/// rates). Requests for something the CPU can't do are ignored.
+
+	SwapKernels k = {swap_scalar<uint16_t>, swap_scalar<uint32_t>, swap_scalar<uint64_t>, "scalar"};
+
+	const char *force = getenv("HDEVIO_SWAP_KERNEL");
+	string req = force ? force:"";
+
+#ifdef SWAP_BLOCK_X86
+	__builtin_cpu_init();
+	SwapKernels ssse3  = {swap_ssse3<uint16_t>,  swap_ssse3<uint32_t>,  swap_ssse3<uint64_t>,  "ssse3"};
+	SwapKernels avx2   = {swap_avx2<uint16_t>,   swap_avx2<uint32_t>,   swap_avx2<uint64_t>,   "avx2"};
+	SwapKernels avx512 = {swap_avx512<uint16_t>, swap_avx512<uint32_t>, swap_avx512<uint64_t>, "avx512"};
+	bool has_ssse3  = __builtin_cpu_supports("ssse3");
+	bool has_avx2   = __builtin_cpu_supports("avx2");
+	bool has_avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+
+	if(req == "scalar") return k;
+	if(req == "ssse3"  && has_ssse3 ) return ssse3;
+	if(req == "avx2"   && has_avx2  ) return avx2;
+	if(req == "avx512" && has_avx512) return avx512;
+
+	if(has_avx512)
+		k = avx512;
+	else if(has_avx2)
+		k = avx2;
+	else if(has_ssse3)
+		k = ssse3;
+#endif // SWAP_BLOCK_X86
+
+	if(!req.empty() && req!=k.name){
+		cerr << "HDEVIO_SWAP_KERNEL=" << req << " not available on this CPU. Using " << k.name << endl;
+	}
+
+	return k;
+}
+
+//---------------------------------
+// GetSwapKernels
+//---------------------------------
+const SwapKernels& GetSwapKernels(void)
+{
+	/// Return the kernel table, selecting it on the first call.
+	static const SwapKernels kernels = SelectSwapKernels();
+	return kernels;
+}
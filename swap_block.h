@@ -0,0 +1,77 @@
+//
+//    File: swap_block.h
+//
+// Bulk byte swapping kernels used by HDEVIO and swap_bank. The
+// vectorized kernels (SSSE3, AVX2, AVX-512BW) are compiled with
+// per-function target attributes so the plugin itself can still be
+// built for a generic x86_64. Which one is used is decided once, the
+// first time any of them is needed, by checking what the CPU
+// supports. A plain scalar loop is used on other architectures
+// or if none of the vector instruction sets are available.
+//
+
+#ifndef _swap_block_
+#define _swap_block_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Blocks shorter than this many words are swapped inline since
+// the call through the kernel table would cost more than it saves.
+#define SWAP_BLOCK_MIN_KERNEL_WORDS 16
+
+typedef void (*swap_kernel_t)(const void *inbuff, void *outbuff, size_t nbytes);
+
+struct SwapKernels{
+	swap_kernel_t swap16;
+	swap_kernel_t swap32;
+	swap_kernel_t swap64;
+	const char *name;
+};
+
+const SwapKernels& GetSwapKernels(void);
+
+//---------------------------------
+// swap_block16
+//---------------------------------
+inline void swap_block16(const uint16_t *inbuff, uint16_t *outbuff, size_t len)
+{
+	/// Byte swap len 16-bit words from inbuff into outbuff. The
+	/// buffers may be the same (in-place swap), but must not otherwise
+	/// overlap.
+	if(len < SWAP_BLOCK_MIN_KERNEL_WORDS){
+		for(size_t i=0; i<len; i++) outbuff[i] = __builtin_bswap16(inbuff[i]);
+		return;
+	}
+	GetSwapKernels().swap16(inbuff, outbuff, len*sizeof(uint16_t));
+}
+
+//---------------------------------
+// swap_block32
+//---------------------------------
+inline void swap_block32(const uint32_t *inbuff, uint32_t *outbuff, size_t len)
+{
+	/// Byte swap len 32-bit words from inbuff into outbuff. See
+	/// swap_block16 for restrictions on the buffers.
+	if(len < SWAP_BLOCK_MIN_KERNEL_WORDS){
+		for(size_t i=0; i<len; i++) outbuff[i] = __builtin_bswap32(inbuff[i]);
+		return;
+	}
+	GetSwapKernels().swap32(inbuff, outbuff, len*sizeof(uint32_t));
+}
+
+//---------------------------------
+// swap_block64
+//---------------------------------
+inline void swap_block64(const uint64_t *inbuff, uint64_t *outbuff, size_t len)
+{
+	/// Byte swap len 64-bit words from inbuff into outbuff. See
+	/// swap_block16 for restrictions on the buffers.
+	if(len < SWAP_BLOCK_MIN_KERNEL_WORDS){
+		for(size_t i=0; i<len; i++) outbuff[i] = __builtin_bswap64(inbuff[i]);
+		return;
+	}
+	GetSwapKernels().swap64(inbuff, outbuff, len*sizeof(uint64_t));
+}
+
+#endif // _swap_block_
@@ -0,0 +1,319 @@
+//
+//    File: bench_mapper.cc
+//
+// Compares HDEVIO::MapBlocks, which reads the file sequentially in
+// MAP_BUFFER_SIZE chunks, with the original mapper, which did a seekg
+// and a small read for every block header and every event header. The
+// original is reproduced below (MapWithSeeks) with the same access
+// pattern so the two can be timed on the same file. Both maps must be
+// identical or this exits with a non-zero status.
+//
+// The file is also read through with each of the stream, event, mmap
+// and async readers with SAVE_MAP_FILE set. The map each one builds
+// while reading and saves at the end must match as well.
+//
+// With no arguments a synthetic file is written in both byte orders
+// and each is mapped. A real EVIO file may be given instead:
+//
+//    bench_mapper [file.evio]
+//
+// See README.md for how to build it.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <HDEVIO.h>
+
+// One row per event in the order they appear in the file
+struct MapRow{
+	uint64_t block_pos;
+	uint32_t block_len;
+	uint64_t event_pos;
+	uint32_t event_len;
+	uint32_t event_header;
+	uint64_t first_event;
+	uint64_t last_event;
+
+	bool operator!=(const MapRow &r) const {
+		return block_pos!=r.block_pos || block_len!=r.block_len || event_pos!=r.event_pos
+			|| event_len!=r.event_len || event_header!=r.event_header
+			|| first_event!=r.first_event || last_event!=r.last_event;
+	}
+};
+
+//---------------------------------
+// WriteSyntheticFile
+//---------------------------------
+static void WriteSyntheticFile(string fname, uint64_t nbytes, bool swap)
+{
+	/// Write an EVIO file of roughly nbytes made of blocks of small
+	/// physics events with an occasional EPICS event. The events are
+	/// short so the cost of finding the headers dominates.
+
+	FILE *f = fopen(fname.c_str(), "wb");
+	if(!f){
+		cerr << "Unable to open \"" << fname << "\" for writing!" << endl;
+		exit(-1);
+	}
+
+	uint64_t event_number = 1;
+	uint32_t block_number = 1;
+	uint64_t nwritten = 0;
+	vector<uint32_t> block;
+	while(nwritten < nbytes){
+		block.assign(8, 0);
+		uint32_t Nevents = 1 + (block_number%5);
+		for(uint32_t i=0; i<Nevents; i++){
+			if( (block_number%7)==3 && i==0 ){
+				uint32_t epics[] = {4, 0x00601001, 2, 0x00620101, block_number};
+				block.insert(block.end(), epics, epics+5);
+				continue;
+			}
+			uint32_t M = 40;
+			uint32_t n = 7 + (block_number*13+i)%40;
+			size_t istart = block.size();
+			block.push_back(n-1);                    // event length
+			block.push_back(0xFF501000 | M);         // physics event header
+			block.push_back(n-3);                    // built trigger bank length
+			block.push_back(0xFF210100 | M);         // built trigger bank header
+			block.push_back(0x00000000);             // segment header
+			block.push_back(event_number>>32);       // first event (high word)
+			block.push_back(event_number&0xFFFFFFFF);// first event (low word)
+			while(block.size()-istart < n) block.push_back(block.size()*7);
+			event_number += M;
+		}
+		block[0] = block.size();
+		block[1] = block_number++;
+		block[2] = 8;
+		block[3] = Nevents;
+		block[5] = 4;
+		block[7] = 0xc0da0100;
+		if(swap) for(auto &w : block) w = __builtin_bswap32(w);
+		fwrite(block.data(), sizeof(uint32_t), block.size(), f);
+		nwritten += block.size()*sizeof(uint32_t);
+	}
+
+	uint32_t last_block[] = {8, block_number, 8, 0, 0, 4|0x200, 0, 0xc0da0100};
+	if(swap) for(auto &w : last_block) w = __builtin_bswap32(w);
+	fwrite(last_block, sizeof(uint32_t), 8, f);
+	fclose(f);
+}
+
+//---------------------------------
+// MapWithSeeks
+//---------------------------------
+static void MapWithSeeks(string fname, vector<MapRow> &rows)
+{
+	/// The mapper as it was before it read the file sequentially. A
+	/// seekg/read pair is done for every block header and every event
+	/// header. Only the values compared with the new map are kept.
+
+	rows.clear();
+	ifstream ifs(fname.c_str());
+
+	HDEVIO::BLOCKHEADER_t bh;
+	while(ifs.good()){
+		streampos block_pos = ifs.tellg();
+		ifs.read((char*)&bh, sizeof(bh));
+		if(!ifs.good()) break;
+
+		bool swap_needed = (bh.magic==0x0001dac0);
+		if(!swap_needed && bh.magic!=0xc0da0100) break;
+		if(swap_needed) for(uint32_t *p=(uint32_t*)&bh; p<(uint32_t*)(&bh+1); p++) *p = __builtin_bswap32(*p);
+
+		// Events
+		streampos pos = block_pos + (streampos)(8<<2);
+		HDEVIO::EVENTHEADER_t myeh;
+		for(uint32_t i=0; i<bh.eventcnt; i++){
+			HDEVIO::EVENTHEADER_t *eh = (HDEVIO::EVENTHEADER_t*)&bh.event_len;
+			if(i!=0){
+				eh = &myeh;
+				ifs.seekg(pos, ios_base::beg);
+				ifs.read((char*)eh, sizeof(HDEVIO::EVENTHEADER_t));
+				if(!ifs.good()) break;
+				if(swap_needed) for(uint32_t *p=(uint32_t*)eh; p<(uint32_t*)(eh+1); p++) *p = __builtin_bswap32(*p);
+			}
+
+			MapRow r;
+			r.block_pos    = block_pos;
+			r.block_len    = bh.length;
+			r.event_pos    = pos;
+			r.event_len    = eh->event_len + 1;
+			r.event_header = eh->header;
+			r.first_event  = 0;
+			r.last_event   = 0;
+			uint32_t tag = eh->header>>16;
+			if( tag==0xFF50 || tag==0xFF51 || tag==0xFF70 ){
+				r.first_event  = eh->physics.first_event_lo;
+				r.first_event += ((uint64_t)eh->physics.first_event_hi)<<32;
+				r.last_event   = r.first_event + (uint64_t)(eh->header&0xFF) - 1;
+			}
+			rows.push_back(r);
+
+			pos += (streampos)((eh->event_len+1)<<2);
+		}
+
+		ifs.clear();
+		ifs.seekg(block_pos + (streampos)(bh.length<<2), ios_base::beg);
+	}
+}
+
+//---------------------------------
+// MapRows
+//---------------------------------
+static void MapRows(const HDEVIO::EVIOFileMap &m, vector<MapRow> &rows)
+{
+	rows.clear();
+	for(uint64_t iblock=0; iblock<m.Nblocks; iblock++){
+		for(uint64_t i=m.block_event_start[iblock]; i<m.block_event_start[iblock+1]; i++){
+			MapRow r;
+			r.block_pos    = m.block_pos[iblock];
+			r.block_len    = m.block_len[iblock];
+			r.event_pos    = m.event_pos[i];
+			r.event_len    = m.event_len[i];
+			r.event_header = m.event_header[i];
+			r.first_event  = m.event_first_event[i];
+			r.last_event   = m.event_last_event[i];
+			rows.push_back(r);
+		}
+	}
+}
+
+//---------------------------------
+// MapWithHDEVIO
+//---------------------------------
+static void MapWithHDEVIO(string fname, vector<MapRow> &rows)
+{
+	HDEVIO hdevio(fname, false, 0);
+
+	// GetFileMap prints a ticker to cout so send that nowhere
+	streambuf *cout_buf = cout.rdbuf(NULL);
+	auto &m = hdevio.GetFileMap();
+	cout.rdbuf(cout_buf);
+	cout.clear();
+
+	MapRows(m, rows);
+}
+
+//---------------------------------
+// MapWhileReading
+//---------------------------------
+static bool MapWhileReading(string fname, HDEVIO::READMODE mode, vector<MapRow> &rows)
+{
+	/// Read the whole file with the reader used for mode and
+	/// SAVE_MAP_FILE set, then fill rows from the map it saved.
+	/// Returns false if the file could not be read through or no
+	/// map was saved.
+
+	string map_fname = fname + ".bmap";
+	unlink(map_fname.c_str());
+	rows.clear();
+
+	HDEVIO hdevio(fname, false, 0);
+	hdevio.SetReadMode(mode);
+	hdevio.SAVE_MAP_FILE = map_fname;
+
+	// SaveFileMap prints to cout so send that nowhere
+	streambuf *cout_buf = cout.rdbuf(NULL);
+	vector<uint32_t> buff(1000000);
+	const uint32_t *event_ptr;
+	uint32_t event_len;
+	shared_ptr<const void> region;
+	bool isgood = true;
+	while(isgood){
+		switch(mode){
+			case HDEVIO::kREAD_STREAM: isgood = hdevio.read(buff.data(), buff.size());                  break;
+			case HDEVIO::kREAD_MMAP:   isgood = hdevio.readMapped(event_ptr, event_len, region);       break;
+			case HDEVIO::kREAD_ASYNC:  isgood = hdevio.readPrefetched(event_ptr, event_len, region);   break;
+			default:                   isgood = hdevio.readNoFileBuff(buff.data(), buff.size());        break;
+		}
+	}
+	cout.rdbuf(cout_buf);
+	cout.clear();
+	if( hdevio.err_code != HDEVIO::HDEVIO_EOF ) return false;
+
+	HDEVIO::EVIOFileMap m;
+	string err;
+	ifstream ifs(fname.c_str(), ios::ate);
+	bool saved = m.ReadBinary(map_fname, ifs.tellg(), true, err);
+	if(saved) MapRows(m, rows);
+	unlink(map_fname.c_str());
+
+	return saved;
+}
+
+//---------------------------------
+// Time
+//---------------------------------
+static double Time(void (*mapper)(string, vector<MapRow>&), string fname, vector<MapRow> &rows)
+{
+	/// Return the best of a few runs in seconds
+	double best = 1.0E9;
+	for(int i=0; i<3; i++){
+		auto t0 = chrono::steady_clock::now();
+		mapper(fname, rows);
+		double dt = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+		if(dt < best) best = dt;
+	}
+	return best;
+}
+
+//---------------------------------
+// Compare
+//---------------------------------
+static bool Compare(string fname)
+{
+	vector<MapRow> old_rows, new_rows;
+	double t_old = Time(MapWithSeeks,  fname, old_rows);
+	double t_new = Time(MapWithHDEVIO, fname, new_rows);
+
+	bool same = old_rows.size()==new_rows.size();
+	for(size_t i=0; same && i<old_rows.size(); i++) same = !(old_rows[i]!=new_rows[i]);
+
+	ifstream ifs(fname.c_str(), ios::ate);
+	double MB = ifs.tellg()/1.0E6;
+	printf("%s: %.1f MB, %zu events\n", fname.c_str(), MB, new_rows.size());
+	printf("   seek per header : %7.3f s (%7.1f MB/s)\n", t_old, MB/t_old);
+	printf("   sequential      : %7.3f s (%7.1f MB/s)\n", t_new, MB/t_new);
+	printf("   maps %s\n", same ? "identical":"DIFFER");
+
+	// Maps built while reading (EVIO:SAVE_MAP)
+	HDEVIO::READMODE modes[] = {HDEVIO::kREAD_STREAM, HDEVIO::kREAD_EVENT, HDEVIO::kREAD_MMAP, HDEVIO::kREAD_ASYNC};
+	for(auto mode : modes){
+		vector<MapRow> read_rows;
+		bool ok = MapWhileReading(fname, mode, read_rows) && read_rows.size()==new_rows.size();
+		for(size_t i=0; ok && i<new_rows.size(); i++) ok = !(new_rows[i]!=read_rows[i]);
+		printf("   map saved by %-6s reader %s\n", HDEVIO::ReadModeName(mode).c_str(), ok ? "identical":"DIFFER");
+		same &= ok;
+	}
+
+	return same;
+}
+
+//---------------------------------
+// main
+//---------------------------------
+int main(int narg, char *argv[])
+{
+	if(narg>1) return Compare(argv[1]) ? 0:1;
+
+	bool ok = true;
+	for(int swap=0; swap<2; swap++){
+		string fname = string("bench_mapper_") + (swap ? "swapped":"native") + ".evio";
+		WriteSyntheticFile(fname, 32*1024*1024, swap);
+		ok &= Compare(fname);
+		unlink(fname.c_str());
+	}
+
+	return ok ? 0:1;
+}
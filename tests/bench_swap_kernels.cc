@@ -0,0 +1,173 @@
+//
+//    File: bench_swap_kernels.cc
+//
+// Checks the byte swap kernels in swap_block.cc against a plain
+// byte-reversing loop and measures their rates. The kernel set is
+// picked once per process (see GetSwapKernels) so a child process is
+// forked for each of scalar, ssse3, avx2 and avx512 with
+// HDEVIO_SWAP_KERNEL set. Kernels the CPU can't run are skipped.
+//
+// Each kernel is checked for 16, 32 and 64 bit words with random
+// lengths and byte alignments of both buffers, in place and out of
+// place. Bytes outside of the output range must not be touched. The
+// rates are then measured for a cache resident block and for one
+// much larger than the caches. This exits with a non-zero status if
+// any kernel gives a different result than the reference loop.
+//
+// See README.md for how to build it.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <swap_block.h>
+
+//---------------------------------
+// SwapReference
+//---------------------------------
+static void SwapReference(const uint8_t *in, uint8_t *out, size_t nbytes, size_t wordsize)
+{
+	/// Reverse the bytes of each word one byte at a time. This works
+	/// on bytes so unaligned buffers are fine.
+	vector<uint8_t> tmp(in, in+nbytes);
+	for(size_t i=0; i<nbytes; i+=wordsize){
+		for(size_t j=0; j<wordsize; j++) out[i+j] = tmp[i+wordsize-1-j];
+	}
+}
+
+//---------------------------------
+// Kernel
+//---------------------------------
+static swap_kernel_t Kernel(size_t wordsize)
+{
+	const SwapKernels &k = GetSwapKernels();
+	if(wordsize==2) return k.swap16;
+	if(wordsize==4) return k.swap32;
+	return k.swap64;
+}
+
+//---------------------------------
+// Check
+//---------------------------------
+static uint64_t Check(size_t wordsize, uint32_t Ntrials)
+{
+	/// Return the number of trials where the kernel and the reference
+	/// loop did not give the same bytes.
+
+	static const size_t kGuard = 64; // bytes on either side of the output that must not change
+	swap_kernel_t swap = Kernel(wordsize);
+	uint64_t Nbad = 0;
+	vector<uint8_t> in, out, expected;
+	for(uint32_t itrial=0; itrial<Ntrials; itrial++){
+		size_t nwords = rand()%(itrial<Ntrials/2 ? 80:2000);
+		size_t nbytes = nwords*wordsize;
+		size_t in_off  = rand()%64;
+		size_t out_off = rand()%64;
+		bool in_place  = rand()%2;
+
+		in.resize(in_off + nbytes + kGuard);
+		out.resize(kGuard + out_off + nbytes + kGuard);
+		for(auto &b : in ) b = rand();
+		for(auto &b : out) b = rand();
+		expected = out;
+
+		uint8_t *pout = &out[kGuard + out_off];
+		uint8_t *pexp = &expected[kGuard + out_off];
+		if(in_place){
+			memcpy(pout, &in[in_off], nbytes);
+			memcpy(pexp, &in[in_off], nbytes);
+			SwapReference(pexp, pexp, nbytes, wordsize);
+			swap(pout, pout, nbytes);
+		}else{
+			SwapReference(&in[in_off], pexp, nbytes, wordsize);
+			swap(&in[in_off], pout, nbytes);
+		}
+
+		if(out != expected){
+			if(Nbad<3) printf("   mismatch: %zu bit words, %zu words, offsets %zu/%zu, %s\n", 8*wordsize, nwords, in_off, out_off, in_place ? "in place":"out of place");
+			Nbad++;
+		}
+	}
+
+	return Nbad;
+}
+
+//---------------------------------
+// Rate
+//---------------------------------
+static double Rate(size_t wordsize, size_t nbytes)
+{
+	/// Return the best rate seen in GB/s for swapping nbytes out of
+	/// place. The buffer is swapped enough times to move about 1GB.
+
+	swap_kernel_t swap = Kernel(wordsize);
+	vector<uint8_t> in(nbytes), out(nbytes);
+	for(auto &b : in) b = rand();
+
+	size_t Nreps = 1 + (1UL<<30)/nbytes;
+	double best = 0.0;
+	for(int i=0; i<3; i++){
+		auto t0 = chrono::steady_clock::now();
+		for(size_t irep=0; irep<Nreps; irep++) swap(in.data(), out.data(), nbytes);
+		double dt = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+		double rate = (double)Nreps*nbytes/dt/1.0E9;
+		if(rate > best) best = rate;
+	}
+
+	return best;
+}
+
+//---------------------------------
+// RunKernel
+//---------------------------------
+static int RunKernel(const char *name)
+{
+	/// Run in a child process. Returns 0 if all checks passed.
+
+	setenv("HDEVIO_SWAP_KERNEL", name, 1);
+	if(string(GetSwapKernels().name) != name){
+		printf("%-7s not supported on this CPU\n", name);
+		return 0;
+	}
+
+	srand(1);
+	uint64_t Nbad = 0;
+	for(size_t wordsize=2; wordsize<=8; wordsize*=2) Nbad += Check(wordsize, 20000);
+
+	printf("%-7s %s   GB/s (16/32/64 bit) 256kB:", name, Nbad ? "FAILED":"ok    ");
+	for(size_t wordsize=2; wordsize<=8; wordsize*=2) printf(" %5.1f", Rate(wordsize, 256*1024));
+	printf("   64MB:");
+	for(size_t wordsize=2; wordsize<=8; wordsize*=2) printf(" %5.1f", Rate(wordsize, 64*1024*1024));
+	printf("\n");
+
+	return Nbad ? 1:0;
+}
+
+//---------------------------------
+// main
+//---------------------------------
+int main(int narg, char *argv[])
+{
+	const char *kernels[] = {"scalar", "ssse3", "avx2", "avx512"};
+
+	int status = 0;
+	for(auto name : kernels){
+		fflush(stdout);
+		pid_t pid = fork();
+		if(pid == 0) exit( RunKernel(name) );
+		int child_status = 0;
+		waitpid(pid, &child_status, 0);
+		if( !WIFEXITED(child_status) || WEXITSTATUS(child_status)!=0 ) status = 1;
+	}
+
+	return status;
+}
@@ -0,0 +1,262 @@
+//
+//    File: bench_window_samples.cc
+//
+// Compares UnpackWindowSamples (window_samples.h) with the loop the
+// f250 and f125 Window Raw Data parsers used before it, which decoded
+// one sample word at a time and pushed each sample onto the vector.
+// The original is reproduced below (UnpackOld) for both modules and
+// both byte orders. The kernel is picked once per process (see
+// GetUnpackSamplesKernel) so a child process is forked for the AVX2
+// kernel and for the scalar one (HDEVIO_UNPACK_KERNEL=scalar).
+//
+// Random windows of 0-259 samples are checked with random "not valid"
+// and overflow flags, words with bit 31 set before the end of the
+// window and an invalid last sample. The samples, the invalid and
+// overflow flags and the number of words used must all agree. Both
+// versions are then timed on windows of 50-200 samples. This exits
+// with a non-zero status if any window gives a different result.
+//
+// See README.md for how to build it.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <window_samples.h>
+
+// What the parsers keep from a window
+struct WindowResult{
+	vector<uint16_t> samples;
+	bool invalid;
+	bool overflow;
+	uint32_t Nwords;  // words the parser's pointer advances past the header
+
+	void Clear(void){ samples.clear(); invalid=false; overflow=false; Nwords=0; }
+
+	bool operator!=(const WindowResult &r) const {
+		return samples!=r.samples || invalid!=r.invalid || overflow!=r.overflow || Nwords!=r.Nwords;
+	}
+};
+
+//---------------------------------
+// Word
+//---------------------------------
+template<bool SWAPPED>
+static inline uint32_t Word(const uint32_t *iptr)
+{
+	return SWAPPED ? __builtin_bswap32(*iptr):*iptr;
+}
+
+//---------------------------------
+// UnpackOld
+//---------------------------------
+template<bool SWAPPED, bool F125>
+static void UnpackOld(const uint32_t *iptr, uint32_t window_width, WindowResult &r)
+{
+	/// The sample loop as it was in the f250 and f125 Window Raw Data
+	/// parsers. iptr points to the header word. The f250 version backs
+	/// up one word when it finds bit 31 set and the f125 one does not.
+
+	const uint32_t *istart = iptr;
+	for(uint32_t isample=0; isample<window_width; isample +=2){
+
+		// Advance to next word
+		iptr++;
+
+		// Make sure this is a data continuation word, if not, stop here
+		if(((Word<SWAPPED>(iptr)>>31) & 0x1) != 0x0){
+			if(!F125) iptr--;
+			break;
+		}
+
+		bool invalid_1 = (Word<SWAPPED>(iptr)>>29) & 0x1;
+		bool invalid_2 = (Word<SWAPPED>(iptr)>>13) & 0x1;
+		uint16_t sample_1 = 0;
+		uint16_t sample_2 = 0;
+		if(!invalid_1)sample_1 = (Word<SWAPPED>(iptr)>>16) & 0x1FFF;
+		if(!invalid_2)sample_2 = (Word<SWAPPED>(iptr)>>0) & 0x1FFF;
+
+		// Sample 1
+		r.samples.push_back(sample_1);
+		r.invalid = r.invalid || invalid_1;
+		r.overflow = r.overflow || (((sample_1>>12) & 0x1) != 0x0);
+
+		if(((isample+2) == window_width) && invalid_2)break; // skip last sample if flagged as invalid
+
+		// Sample 2
+		r.samples.push_back(sample_2);
+		r.invalid = r.invalid || invalid_2;
+		r.overflow = r.overflow || (((sample_2>>12) & 0x1) != 0x0);
+	}
+	r.Nwords = iptr - istart;
+}
+
+//---------------------------------
+// UnpackNew
+//---------------------------------
+template<bool SWAPPED, bool F125>
+static void UnpackNew(const uint32_t *iptr, uint32_t window_width, WindowResult &r)
+{
+	/// As the parsers now call it. The f125 parser steps over the word
+	/// with bit 31 set if the samples stopped early.
+
+	r.Nwords = UnpackWindowSamples(&iptr[1], window_width, SWAPPED, r.samples, r.invalid, r.overflow);
+	if( F125 && r.Nwords<(window_width+1)/2 ) r.Nwords++;
+}
+
+//---------------------------------
+// MakeWindow
+//---------------------------------
+static void MakeWindow(uint32_t window_width, uint32_t mode, vector<uint32_t> &words)
+{
+	/// Fill words with a Window Raw Data header followed by its sample
+	/// words and a few words of the next hit. The bits of mode turn on
+	/// random flags (1), overflows (2), "not valid" samples (4), an
+	/// early bit 31 (8) and an invalid last sample (16).
+
+	words.clear();
+	words.push_back(0xA0000000 | window_width);
+	uint32_t Nwords = (window_width+1)/2;
+	for(uint32_t i=0; i<Nwords; i++){
+		uint32_t w = rand() & 0x0FFF0FFF;
+		if(mode & 1) w = rand() & 0x7FFF7FFF;
+		if( (mode & 2) && (rand()%4)==0  ) w |= 0x10001000 & rand();
+		if( (mode & 4) && (rand()%30)==0 ) w |= 0x20002000 & rand();
+		words.push_back(w);
+	}
+	if( (mode & 8)  && Nwords>0 ) words[1 + rand()%Nwords] |= 0x80000000;
+	if( (mode & 16) && Nwords>0 ) words[Nwords] |= 0x2000;
+
+	// Next hit and filler words
+	words.push_back(0x88000000);
+	for(int i=0; i<8; i++) words.push_back(0xF8000000);
+}
+
+//---------------------------------
+// Check
+//---------------------------------
+template<bool SWAPPED, bool F125>
+static uint64_t Check(uint32_t Ntrials)
+{
+	/// Return the number of windows where the two versions did not
+	/// agree.
+
+	uint64_t Nbad = 0;
+	vector<uint32_t> words;
+	WindowResult r_old, r_new;
+	for(uint32_t itrial=0; itrial<Ntrials; itrial++){
+		uint32_t window_width = rand()%260;
+		MakeWindow(window_width, rand()%32, words);
+		if(SWAPPED) for(auto &w : words) w = __builtin_bswap32(w);
+
+		r_old.Clear();
+		r_new.Clear();
+		UnpackOld<SWAPPED, F125>(words.data(), window_width, r_old);
+		UnpackNew<SWAPPED, F125>(words.data(), window_width, r_new);
+
+		if(r_old != r_new){
+			if(Nbad<3) printf("   mismatch: %s %s, window width %u: %zu/%zu samples, invalid %d/%d, overflow %d/%d, %u/%u words\n", F125 ? "f125":"f250", SWAPPED ? "swapped":"native", window_width, r_old.samples.size(), r_new.samples.size(), r_old.invalid, r_new.invalid, r_old.overflow, r_new.overflow, r_old.Nwords, r_new.Nwords);
+			Nbad++;
+		}
+	}
+
+	return Nbad;
+}
+
+//---------------------------------
+// Rate
+//---------------------------------
+static double Rate(void (*unpack)(const uint32_t*, uint32_t, WindowResult&), const vector<vector<uint32_t> > &windows, const vector<uint32_t> &widths)
+{
+	/// Return the best rate seen in millions of samples per second
+	/// for unpacking all of the windows several times.
+
+	WindowResult r;
+	double best = 0.0;
+	for(int i=0; i<3; i++){
+		uint64_t Nsamples = 0;
+		auto t0 = chrono::steady_clock::now();
+		for(int irep=0; irep<20; irep++){
+			for(size_t iwindow=0; iwindow<windows.size(); iwindow++){
+				r.Clear();
+				unpack(windows[iwindow].data(), widths[iwindow], r);
+				Nsamples += r.samples.size();
+			}
+		}
+		double dt = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+		double rate = Nsamples/dt/1.0E6;
+		if(rate > best) best = rate;
+	}
+
+	return best;
+}
+
+//---------------------------------
+// RunKernel
+//---------------------------------
+static int RunKernel(const char *name)
+{
+	/// Run in a child process. Returns 0 if all checks passed.
+
+	setenv("HDEVIO_UNPACK_KERNEL", "scalar", 1);
+	unpack_samples_t scalar = GetUnpackSamplesKernel();
+	if( string(name) != "scalar" ){
+		unsetenv("HDEVIO_UNPACK_KERNEL");
+		if( GetUnpackSamplesKernel() == scalar ){
+			printf("%-7s not supported on this CPU\n", name);
+			return 0;
+		}
+	}
+
+	srand(1);
+	uint64_t Nbad = 0;
+	Nbad += Check<false, false>(200000);
+	Nbad += Check<true,  false>(200000);
+	Nbad += Check<false, true >(200000);
+	Nbad += Check<true,  true >(200000);
+
+	// Windows of 50-200 samples with some overflows
+	vector<vector<uint32_t> > windows(20000);
+	vector<uint32_t> widths(windows.size());
+	for(size_t i=0; i<windows.size(); i++){
+		widths[i] = 50 + rand()%151;
+		MakeWindow(widths[i], 2, windows[i]);
+	}
+	vector<vector<uint32_t> > swapped_windows = windows;
+	for(auto &v : swapped_windows) for(auto &w : v) w = __builtin_bswap32(w);
+
+	printf("%-7s %s   Msamples/s (native/swapped)", name, Nbad ? "FAILED":"ok    ");
+	printf("   old: %6.1f %6.1f", Rate(UnpackOld<false, false>, windows, widths), Rate(UnpackOld<true, false>, swapped_windows, widths));
+	printf("   new: %6.1f %6.1f", Rate(UnpackNew<false, false>, windows, widths), Rate(UnpackNew<true, false>, swapped_windows, widths));
+	printf("\n");
+
+	return Nbad ? 1:0;
+}
+
+//---------------------------------
+// main
+//---------------------------------
+int main(int narg, char *argv[])
+{
+	const char *kernels[] = {"scalar", "avx2"};
+
+	int status = 0;
+	for(auto name : kernels){
+		fflush(stdout);
+		pid_t pid = fork();
+		if(pid == 0) exit( RunKernel(name) );
+		int child_status = 0;
+		waitpid(pid, &child_status, 0);
+		if( !WIFEXITED(child_status) || WEXITSTATUS(child_status)!=0 ) status = 1;
+	}
+
+	return status;
+}
@@ -0,0 +1,233 @@
+//
+//    File: check_allocations.cc
+//
+// Checks that parsing events does not use the heap once the pools of
+// events and objects have been filled. The global operator new and
+// new[] are replaced here with versions that count calls. Each mode
+// below parses and links a set of synthetic events (see
+// evio_event_gen.h) several times over with a buffer set up the way
+// JEventSource_EVIO does for some combination of options:
+//
+//    default      the default options (objects, linking everything)
+//    HIT_COLUMNS  f125 pulses in columns, read back as columns and objects
+//    LAZY_PARSE   module data decoded when the objects are read back
+//    HIT_VIEWS    LAZY_PARSE with the views read back
+//    SUBTASKS     every event split into subtasks run by a SubtaskPool
+//    BOR          a BOR event ahead of the physics events of each pass
+//    EPICS        EPICS events in between the physics events
+//
+// The first passes of each mode are a warm-up during which the pools,
+// the vectors of the recycled objects and the parser's own buffers
+// grow to the size they need. This takes longer with subtasks since
+// each one is only given a share of the pools. This exits with a
+// non-zero status if there is any allocation after that in any mode.
+// The BOR events themselves are not counted: the config objects made
+// for each one are kept by the source for all of the events that
+// follow it (see JEventSource_EVIO::SetBOR). Picking up the firmware
+// tables of a new BOR is counted.
+//
+// See README.md for how to build it.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+#include <vector>
+using namespace std;
+
+#include <subtask_pool.h>
+
+#include "evio_event_gen.h"
+#include "parse_words.h"
+
+static atomic<uint64_t> Nallocations(0);
+static atomic<bool>     count_allocations(false);
+
+//---------------------------------
+// operator new
+//---------------------------------
+void* operator new(size_t n)
+{
+	if(count_allocations) Nallocations++;
+	void *p = malloc(n ? n:1);
+	if(!p) throw bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t n)
+{
+	if(count_allocations) Nallocations++;
+	void *p = malloc(n ? n:1);
+	if(!p) throw bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+// A set of events and the byte order of each
+class TestBlocks{
+	public:
+		vector<vector<uint32_t> > blocks;
+		vector<bool>              swapped;
+
+		void Add(const vector<uint32_t> &words, bool s){ blocks.push_back(words); swapped.push_back(s); }
+};
+
+//---------------------------------
+// ReadObjects
+//---------------------------------
+static void ReadObjects(const DParsedEvent *pe)
+{
+	/// Get the objects of the types whose module data may be left for
+	/// later so it is decoded (EVIO:LAZY_PARSE) or made from the columns
+	/// (EVIO:HIT_COLUMNS).
+	pe->Get<Df250PulseData>();
+	pe->Get<Df250WindowRawData>();
+	pe->Get<Df125CDCPulse>();
+	pe->Get<Df125FDCPulse>();
+	pe->Get<Df125WindowRawData>();
+	pe->Get<DF1TDCHit>();
+	pe->Get<DCAEN1290TDCHit>();
+}
+
+//---------------------------------
+// ReadColumns
+//---------------------------------
+static void ReadColumns(const DParsedEvent *pe)
+{
+	pe->GetColumns<Df125CDCPulseColumns>();
+	pe->GetColumns<Df125FDCPulseColumns>();
+	ReadObjects(pe);
+}
+
+//---------------------------------
+// ReadViews
+//---------------------------------
+static void ReadViews(const DParsedEvent *pe)
+{
+	pe->GetViews<Df250PulseDataView>();
+	pe->GetViews<Df250WindowRawDataView>();
+	pe->GetViews<Df125CDCPulseView>();
+	pe->GetViews<Df125FDCPulseView>();
+	pe->GetViews<Df125WindowRawDataView>();
+	pe->GetViews<DF1TDCHitView>();
+}
+
+//---------------------------------
+// CountAllocations
+//---------------------------------
+static bool CountAllocations(const char *mode, JEventEVIOBuffer *b, const TestBlocks &t, void (*read)(const DParsedEvent*)=NULL, uint32_t Nwarmup=3)
+{
+	/// Parse all of the blocks with b Nwarmup+3 times over and return
+	/// true if there were no allocations after the warm-up passes.
+	/// read is called for each parsed event before it is released.
+	/// b is deleted.
+
+	const uint32_t Npasses = Nwarmup + 3;
+
+	b->MAX_EVENT_RECYCLES  = 1000000;
+	b->MAX_OBJECT_RECYCLES = 1000000;
+
+	DBORptrs *borptrs = NULL;
+	uint64_t Nafter_warmup = 0;
+	for(uint32_t ipass=0; ipass<Npasses; ipass++){
+		uint64_t Nbefore = Nallocations;
+		count_allocations = true;
+		for(uint32_t iblock=0; iblock<t.blocks.size(); iblock++){
+			bool is_bor = !t.swapped[iblock] && (t.blocks[iblock][1]>>16)==0x0070;
+			if( is_bor ) count_allocations = false;
+			ParseWords(*b, t.blocks[iblock], t.swapped[iblock]);
+			if( is_bor ){
+				// Take the config objects over the way the source does
+				DParsedEvent *pe = b->current_parsed_events.front();
+				delete borptrs;
+				borptrs = pe->borptrs;
+				pe->borptrs = NULL;
+				count_allocations = true;
+				b->UpdateFirmwareTables(borptrs);
+			}
+			if( read ) for(auto pe : b->current_parsed_events) read(pe);
+			ReleaseEvents(*b);
+		}
+		count_allocations = false;
+
+		uint64_t N = Nallocations - Nbefore;
+		if( N || ipass==Npasses-1 ) printf("%-12s pass %u: %6lu allocations%s\n", mode, ipass, N, ipass<Nwarmup ? " (warm-up)":"");
+		if( ipass >= Nwarmup ) Nafter_warmup += N;
+	}
+
+	delete b;
+	delete borptrs;
+
+	if( Nafter_warmup ) printf("FAILED: %s: the parser allocated memory after the warm-up\n", mode);
+
+	return Nafter_warmup == 0;
+}
+
+//---------------------------------
+// main
+//---------------------------------
+int main(int narg, char *argv[])
+{
+	// Make all of the events up front so only the parser is counted
+	vector<vector<uint32_t> > blocks;
+	MakePhysicsBlocks(blocks, 300, kALTERNATE_ORDER);
+	TestBlocks physics;
+	for(uint32_t iblock=0; iblock<blocks.size(); iblock++) physics.Add(blocks[iblock], IsSwappedBlock(kALTERNATE_ORDER, iblock));
+
+	TestBlocks bor;
+	EVIOEventWords ev;
+	MakeBOREvent(ev, 2);
+	bor.Add(ev.words, false);
+	for(uint32_t iblock=0; iblock<blocks.size(); iblock++) bor.Add(blocks[iblock], IsSwappedBlock(kALTERNATE_ORDER, iblock));
+
+	TestBlocks epics;
+	for(uint32_t iblock=0; iblock<blocks.size(); iblock++){
+		if( iblock%10 == 0 ){
+			EVIOEventWords ev;
+			MakeEPICSEvent(ev, 1500000000+iblock);
+			epics.Add(ev.words, false);
+		}
+		epics.Add(blocks[iblock], IsSwappedBlock(kALTERNATE_ORDER, iblock));
+	}
+
+	// The pool's threads are started before anything is counted just
+	// as the source starts them before reading any events
+	SubtaskPool pool(3);
+
+	bool ok = true;
+
+	ok &= CountAllocations("default", MakeBuffer(), physics);
+
+	JEventEVIOBuffer *b = MakeBuffer();
+	b->HIT_COLUMNS = true;
+	ok &= CountAllocations("HIT_COLUMNS", b, physics, ReadColumns);
+
+	b = MakeBuffer();
+	b->LAZY_PARSE = true;
+	ok &= CountAllocations("LAZY_PARSE", b, physics, ReadObjects);
+
+	b = MakeBuffer();
+	b->LAZY_PARSE = true;
+	b->HIT_VIEWS  = true;
+	ok &= CountAllocations("HIT_VIEWS", b, physics, ReadViews);
+
+	b = MakeBuffer();
+	b->subtask_pool            = &pool;
+	b->PARSE_SUBTASKS          = pool.GetNthreads() + 1;
+	b->PARSE_SUBTASK_MIN_WORDS = 0;
+	ok &= CountAllocations("SUBTASKS", b, physics, NULL, 8);
+
+	ok &= CountAllocations("BOR", MakeBuffer(), bor);
+	ok &= CountAllocations("EPICS", MakeBuffer(), epics);
+
+	printf("%s\n", ok ? "ok":"FAILED: the parser allocated memory after the warm-up");
+
+	return ok ? 0:1;
+}
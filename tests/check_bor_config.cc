@@ -0,0 +1,135 @@
+//
+//    File: check_bor_config.cc
+//
+// Checks the BOR config lookup tables of DBORptrs and their use when
+// linking hits. A synthetic BOR event (see evio_event_gen.h) is parsed
+// and every module it describes must be found by DBORptrs::Get, with
+// the firmware generation tables set for its crates. Config objects
+// with a rocid or slot out of range must be left out of the tables
+// rather than making them huge or landing on another module's entry.
+// Physics events parsed after the BOR, without their config banks,
+// must have the numbers of samples of the f250 and f125 pulses filled
+// in from the BOR, also for f125 pulses made from columns
+// (EVIO:HIT_COLUMNS). This exits with a non-zero status if anything
+// fails.
+//
+// See README.md for how to build it.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+using namespace std;
+
+#include "evio_event_gen.h"
+#include "parse_words.h"
+
+static uint32_t Nbad = 0;
+
+//---------------------------------
+// Check
+//---------------------------------
+static void Check(bool ok, const char *what)
+{
+	if( ok ) return;
+	if( Nbad++ < 10 ) printf("   FAILED: %s\n", what);
+}
+
+//---------------------------------
+// CheckSamples
+//---------------------------------
+template<class C, class T>
+static void CheckSamples(const DBORptrs *borptrs, const vector<T*> &hits, const char *what)
+{
+	for(auto hit : hits){
+		const C *conf = borptrs->Get<C>(hit->rocid, hit->slot);
+		Check(conf!=NULL, what);
+		if( !conf ) continue;
+		Check(hit->nsamples_integral==conf->NSA+conf->NSB && hit->nsamples_pedestal==conf->NPED, what);
+	}
+}
+
+//---------------------------------
+// main
+//---------------------------------
+int main(int narg, char *argv[])
+{
+	// Parse a BOR event and take its config the way the source does
+	EVIOEventWords bor;
+	MakeBOREvent(bor, 2);
+	JEventEVIOBuffer *b = MakeBuffer();
+	ParseWords(*b, bor.words, false);
+	DBORptrs *borptrs = b->current_parsed_events.front()->borptrs;
+	b->current_parsed_events.front()->borptrs = NULL;
+	ReleaseEvents(*b);
+	Check(borptrs!=NULL, "no DBORptrs made for the BOR event");
+	if( !borptrs ) return 1;
+
+	// Every module is in the tables
+	for(uint32_t slot=0; slot<DBORptrs::kNslots; slot++){
+		const Df250BORConfig *f250 = borptrs->Get<Df250BORConfig>(11, slot);
+		const Df125BORConfig *f125 = borptrs->Get<Df125BORConfig>(25, slot);
+		const DF1TDCBORConfig *f1  = borptrs->Get<DF1TDCBORConfig>(51, slot);
+		Check( (slot>=3 && slot<6) == (f250!=NULL), "f250 module lookup");
+		Check( (slot>=3 && slot<5) == (f125!=NULL), "f125 module lookup");
+		Check( (slot>=3 && slot<5) == (f1  !=NULL), "F1TDC module lookup");
+		if( f250 ) Check(f250->rocid==11 && f250->slot==slot && f250->NSA==20 && f250->NSB==3 && f250->NPED==4, "f250 config values");
+		if( f125 ) Check(f125->rocid==25 && f125->slot==slot && f125->NSA==60 && f125->NSB==0 && f125->NPED==8, "f125 config values");
+	}
+	Check(borptrs->Get<DCAEN1290TDCBORConfig>(51, 9)!=NULL, "CAEN1290 module lookup");
+	Check(borptrs->Get<Df250BORConfig>(25, 3)==NULL, "f250 lookup in the f125 crate");
+	Check(borptrs->Get<Df250BORConfig>(11, 1000)==NULL, "f250 lookup with a bad slot");
+	Check(borptrs->Get<Df250BORConfig>(0x7FFFFFFF, 3)==NULL, "f250 lookup with a bad rocid");
+	Check(borptrs->f250_firmware.size()>11 && borptrs->f250_firmware[11]==2, "f250 firmware table");
+	Check(borptrs->f125_firmware.size()>25 && borptrs->f125_firmware[25]==2, "f125 firmware table");
+
+	// Config objects out of range are left out
+	{
+		DBORptrs bad;
+		uint32_t rocids[] = {7, 7, 0x40000000, 0x12345};
+		uint32_t slots[]  = {4, 99, 3, 3};
+		for(uint32_t i=0; i<4; i++){
+			Df250BORConfig *c = new Df250BORConfig;
+			c->rocid         = rocids[i];
+			c->slot          = slots[i];
+			c->adc_status[0] = 0x0C0D;
+			bad.vDf250BORConfig.push_back(c);
+		}
+		bad.Sort();
+		bad.BuildLookupTables();
+		Check(bad.Get<Df250BORConfig>(7, 4)==bad.vDf250BORConfig[0], "good module next to bad ones");
+		Check(bad.Get<Df250BORConfig>(0, 3)==NULL, "bad rocid wrapped onto another module");
+		Check(bad.Get<Df250BORConfig>(0x12345, 3)==NULL, "module with a bad rocid in the table");
+		Check(bad.GetTable((const Df250BORConfig*)NULL).size()==8*DBORptrs::kNslots, "table made bigger by bad modules");
+		Check(bad.f250_firmware.size()==8, "firmware table made bigger by bad modules");
+	}
+
+	// Hits get the numbers of samples from the BOR when there are no
+	// config banks to give them
+	vector<vector<uint32_t> > blocks;
+	MakePhysicsBlocks(blocks, 50, kALTERNATE_ORDER);
+	for(uint32_t icolumns=0; icolumns<2; icolumns++){
+		b->PARSE_CONFIG = false;
+		b->HIT_COLUMNS  = icolumns==1;
+		b->UpdateFirmwareTables(borptrs);
+		for(uint32_t iblock=0; iblock<blocks.size(); iblock++){
+			ParseWords(*b, blocks[iblock], IsSwappedBlock(kALTERNATE_ORDER, iblock));
+			for(auto pe : b->current_parsed_events){
+				pe->borptrs = borptrs; // set by JEventEVIOBuffer::PublishEvents
+				CheckSamples<Df250BORConfig>(borptrs, pe->Get<Df250PulseData>(), "f250 pulse samples from the BOR");
+				CheckSamples<Df125BORConfig>(borptrs, pe->Get<Df125CDCPulse>(),  "f125 CDC pulse samples from the BOR");
+				CheckSamples<Df125BORConfig>(borptrs, pe->Get<Df125FDCPulse>(),  "f125 FDC pulse samples from the BOR");
+				pe->borptrs = NULL;
+			}
+			ReleaseEvents(*b);
+		}
+	}
+
+	delete b;
+	delete borptrs;
+
+	printf("%s\n", Nbad ? "FAILED":"ok");
+
+	return Nbad ? 1:0;
+}
@@ -0,0 +1,74 @@
+//
+//    File: check_epics_channels.cc
+//
+// Checks EPICSChannelTable (epics_channels.h) when it is used from
+// several threads at once. Each thread interns the same set of
+// channel names, each starting at a different place in the list, so
+// new names are being added (and the hash table replaced as it grows)
+// while the other threads look names up. Every thread must get the
+// same id for a name, Name must give the name back for every id and
+// there must be exactly one id per name. This exits with a non-zero
+// status if anything fails.
+//
+// See README.md for how to build it.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include <epics_channels.h>
+
+//---------------------------------
+// main
+//---------------------------------
+int main(int narg, char *argv[])
+{
+	const uint32_t Nthreads = 4;
+	const uint32_t Nnames   = 20000;
+
+	vector<string> names;
+	for(uint32_t i=0; i<Nnames; i++){
+		char str[64];
+		snprintf(str, sizeof(str), "HALLD:test:channel%u.VAL", i*7919%100003);
+		names.push_back(str);
+	}
+
+	vector<vector<uint32_t> > ids(Nthreads, vector<uint32_t>(Nnames));
+	vector<thread> threads;
+	for(uint32_t ithread=0; ithread<Nthreads; ithread++){
+		threads.push_back( thread([&, ithread](){
+			for(uint32_t pass=0; pass<2; pass++){
+				for(uint32_t j=0; j<Nnames; j++){
+					uint32_t i = (j + ithread*Nnames/Nthreads)%Nnames;
+					uint32_t id = EPICSChannelTable::Intern(names[i]);
+					if( pass == 0 ) ids[ithread][i] = id;
+					else if( id != ids[ithread][i] ) ids[ithread][i] = 0xFFFFFFFF;
+					EPICSChannelTable::Name(id);
+				}
+			}
+		}) );
+	}
+	for(auto &t : threads) t.join();
+
+	uint32_t Nbad = 0;
+	for(uint32_t i=0; i<Nnames; i++){
+		uint32_t id = ids[0][i];
+		for(uint32_t ithread=1; ithread<Nthreads; ithread++) if( ids[ithread][i] != id ) Nbad++;
+		if( id >= EPICSChannelTable::size() || EPICSChannelTable::Name(id) != names[i] ){
+			if( Nbad++ < 5 ) printf("   id %u is not \"%s\"\n", id, names[i].c_str());
+		}
+	}
+	if( EPICSChannelTable::size() != Nnames ){
+		printf("   %u ids for %u names\n", EPICSChannelTable::size(), Nnames);
+		Nbad++;
+	}
+
+	printf("%u threads, %u names: %s\n", Nthreads, Nnames, Nbad ? "FAILED":"ok");
+
+	return Nbad ? 1:0;
+}
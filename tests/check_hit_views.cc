@@ -0,0 +1,165 @@
+//
+//    File: check_hit_views.cc
+//
+// Checks that the hit views made with EVIO:HIT_VIEWS (DAQ/DHitViews.h)
+// and the f125 pulse columns filled with EVIO:HIT_COLUMNS
+// (DAQ/DHitColumns.h) give the same values as the objects the parser
+// makes without them. Synthetic physics events (see evio_event_gen.h)
+// with f250, f125 and F1TDC hits are parsed by one buffer making
+// objects, by one with LAZY_PARSE and HIT_VIEWS set and by one with
+// HIT_COLUMNS set. The columns are compared both as read from their
+// arrays and as the objects DParsedEvent::Get makes from them. A
+// second LAZY_PARSE buffer keeps each block's events until it has
+// read the next block so their views are only decoded after the
+// memory the block was read into has been handed on. This is done
+// for both byte orders and for the generic and the firmware specific
+// module decoders.
+//
+// Each event's hits are compared as sorted lists of values (see
+// event_lines.h). This exits with a non-zero status if any event
+// differs.
+//
+// See README.md for how to build it.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "evio_event_gen.h"
+#include "event_lines.h"
+
+//---------------------------------
+// ColumnLines
+//---------------------------------
+static void ColumnLines(const DParsedEvent *pe, vector<string> &lines)
+{
+	/// Read the f125 pulses straight from the column arrays without
+	/// making the objects.
+	NonColumnObjectLines(pe, lines);
+	auto &cdc = pe->GetColumns<Df125CDCPulseColumns>();
+	for(size_t i=0; i<cdc.size(); i++) lines.push_back(Line("f125CDCPulse", {cdc.rocid[i], cdc.slot[i], cdc.channel[i], cdc.itrigger[i], cdc.NPK[i], cdc.le_time[i], cdc.time_quality_bit[i], cdc.overflow_count[i], cdc.pedestal[i], cdc.integral[i], cdc.first_max_amp[i], cdc.word1[i], cdc.word2[i]}));
+	auto &fdc = pe->GetColumns<Df125FDCPulseColumns>();
+	for(size_t i=0; i<fdc.size(); i++) lines.push_back(Line("f125FDCPulse", {fdc.rocid[i], fdc.slot[i], fdc.channel[i], fdc.itrigger[i], fdc.NPK[i], fdc.le_time[i], fdc.time_quality_bit[i], fdc.overflow_count[i], fdc.pedestal[i], fdc.integral[i], fdc.peak_amp[i], fdc.peak_time[i], fdc.word1[i], fdc.word2[i]}));
+}
+
+//---------------------------------
+// ViewLines
+//---------------------------------
+static void ViewLines(const DParsedEvent *pe, vector<string> &lines)
+{
+	vector<uint16_t> samples;
+	bool invalid, overflow;
+	for(auto &p : pe->GetViews<Df250PulseDataView>()) lines.push_back(Line("f250PulseData", {p.rocid, p.slot, p.channel(), p.itrigger, p.event_within_block(), p.QF_pedestal(), p.pedestal(), p.integral(), p.QF_NSA_beyond_PTW(), p.QF_overflow(), p.QF_underflow(), p.nsamples_over_threshold(), p.course_time(), p.fine_time(), p.pulse_peak(), p.QF_vpeak_beyond_NSA(), p.QF_vpeak_not_found(), p.QF_bad_pedestal(), p.pulse_number}));
+	for(auto &p : pe->GetViews<Df250WindowRawDataView>()){
+		p.GetSamples(samples, invalid, overflow);
+		lines.push_back(Line("f250WindowRawData", {p.rocid, p.slot, p.channel(), p.itrigger, invalid, overflow}, &samples));
+	}
+	for(auto &p : pe->GetViews<Df125CDCPulseView>()) lines.push_back(Line("f125CDCPulse", {p.rocid, p.slot, p.channel(), p.itrigger, p.NPK(), p.le_time(), p.time_quality_bit(), p.overflow_count(), p.pedestal(), p.integral(), p.first_max_amp(), p.word1(), p.word2()}));
+	for(auto &p : pe->GetViews<Df125FDCPulseView>()) lines.push_back(Line("f125FDCPulse", {p.rocid, p.slot, p.channel(), p.itrigger, p.NPK(), p.le_time(), p.time_quality_bit(), p.overflow_count(), p.pedestal(), p.integral(), p.peak_amp(), p.peak_time(), p.word1(), p.word2()}));
+	for(auto &p : pe->GetViews<Df125WindowRawDataView>()){
+		p.GetSamples(samples, invalid, overflow);
+		lines.push_back(Line("f125WindowRawData", {p.rocid, p.slot, p.channel(), p.itrigger, invalid, overflow}, &samples));
+	}
+	for(auto &p : pe->GetViews<DF1TDCHitView>()) lines.push_back(Line("F1TDCHit", {p.rocid, p.slot, p.channel(), p.itrigger, p.trig_time, p.time(), p.data_word(), p.res_status(), p.output_fifo_overflow_status(), p.hit_fifo_overflow_status()}));
+}
+
+//---------------------------------
+// ParseAndHold
+//---------------------------------
+static void ParseAndHold(JEventEVIOBuffer &b, const vector<uint32_t> &words, bool swapped, vector<DParsedEvent*> &held)
+{
+	/// Parse the words with b but keep the events instead of releasing
+	/// them. With LAZY_PARSE their module data is then only decoded
+	/// after b has gone on to the next block.
+	ParseWords(b, words, swapped);
+	held = b.current_parsed_events;
+	b.current_parsed_events.clear();
+}
+
+//---------------------------------
+// LinesAndRelease
+//---------------------------------
+static void LinesAndRelease(vector<DParsedEvent*> &held, void (*lines_of)(const DParsedEvent*, vector<string>&), EventLines &events)
+{
+	events.clear();
+	for(auto pe : held){
+		events.emplace_back();
+		lines_of(pe, events.back());
+		sort(events.back().begin(), events.back().end());
+		pe->ReleaseLazy();
+		pe->in_use = false;
+	}
+	held.clear();
+}
+
+//---------------------------------
+// main
+//---------------------------------
+int main(int narg, char *argv[])
+{
+	uint32_t Nbad = 0;
+	for(uint8_t generation=0; generation<=2; generation+=2){
+		for(int swapped=0; swapped<2; swapped++){
+			JEventEVIOBuffer *b_objects = MakeBuffer(generation);
+			JEventEVIOBuffer *b_views   = MakeBuffer(generation);
+			JEventEVIOBuffer *b_columns = MakeBuffer(generation);
+			JEventEVIOBuffer *b_held    = MakeBuffer(generation);
+			b_views->LAZY_PARSE    = true;
+			b_views->HIT_VIEWS     = true;
+			b_columns->HIT_COLUMNS = true;
+			b_held->LAZY_PARSE     = true;
+			b_held->HIT_VIEWS      = true;
+
+			vector<vector<uint32_t> > blocks;
+			MakePhysicsBlocks(blocks, 200, swapped ? kSWAPPED_ORDER:kHOST_ORDER);
+
+			EventLines objects, views, columns, materialized, held_objects, held_views;
+			vector<DParsedEvent*> held;
+			uint64_t Nevents = 0;
+			uint64_t Nhits = 0;
+			uint32_t Nbad_views = 0;
+			uint32_t Nbad_columns = 0;
+			uint32_t Nbad_materialized = 0;
+			uint32_t Nbad_held = 0;
+			for(auto &words : blocks){
+
+				Parse(*b_objects, words, swapped, ObjectLines, objects);
+				Parse(*b_views,   words, swapped, ViewLines,   views);
+				Parse(*b_columns, words, swapped, ColumnLines, columns);
+				Parse(*b_columns, words, swapped, ObjectLines, materialized);
+				Nbad_views        += Compare("views",        objects, views);
+				Nbad_columns      += Compare("columns",      objects, columns);
+				Nbad_materialized += Compare("materialized", objects, materialized);
+
+				// Views of the last block's events read only now that
+				// b_held has read this block
+				vector<DParsedEvent*> last_held = held;
+				ParseAndHold(*b_held, words, swapped, held);
+				LinesAndRelease(last_held, ViewLines, held_views);
+				Nbad_held += Compare("held views", held_objects, held_views);
+				held_objects = objects;
+
+				Nevents += objects.size();
+				for(auto &lines : objects) Nhits += lines.size();
+			}
+
+			LinesAndRelease(held, ViewLines, held_views);
+			Nbad_held += Compare("held views", held_objects, held_views);
+
+			printf("%s, firmware generation %d: %6lu events %8lu hits   views %-6s  held views %-6s  columns %-6s  materialized %s\n", swapped ? "swapped":"native ", generation, Nevents, Nhits, Nbad_views ? "DIFFER":"ok", Nbad_held ? "DIFFER":"ok", Nbad_columns ? "DIFFER":"ok", Nbad_materialized ? "DIFFER":"ok");
+			Nbad += Nbad_views + Nbad_held + Nbad_columns + Nbad_materialized;
+
+			delete b_objects;
+			delete b_views;
+			delete b_columns;
+			delete b_held;
+		}
+	}
+
+	return Nbad ? 1:0;
+}
@@ -0,0 +1,110 @@
+//
+//    File: check_subtasks.cc
+//
+// Checks that parsing the ROC data banks of an event in subtasks
+// (EVIO:PARSE_SUBTASKS, see JEventEVIOBuffer::ParseDataBanksInSubtasks)
+// gives the same events as parsing them serially. Synthetic physics
+// events (see evio_event_gen.h) in both byte orders are parsed by a
+// buffer with subtasks turned off and then by several buffers at
+// once, each in its own thread, that share one SubtaskPool and split
+// every event. The hits of each event and the number of objects of
+// every type must match. This exits with a non-zero status if any
+// event differs.
+//
+// See README.md for how to build it.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include <subtask_pool.h>
+
+#include "evio_event_gen.h"
+#include "event_lines.h"
+
+//---------------------------------
+// AllLines
+//---------------------------------
+static void AllLines(const DParsedEvent *pe, vector<string> &lines)
+{
+	/// The hits plus the number of objects of each type the events
+	/// hold so anything dropped or duplicated when merging the subtasks
+	/// shows up.
+	ObjectLines(pe, lines);
+	#define typecount(A) lines.push_back(Line(#A, {pe->Get<A>().size()}));
+	typecount(Df250Config)
+	typecount(Df250TriggerTime)
+	typecount(Df125Config)
+	typecount(Df125TriggerTime)
+	typecount(DF1TDCConfig)
+	typecount(DF1TDCTriggerTime)
+	typecount(DCAEN1290TDCHit)
+	typecount(DCODAEventInfo)
+	typecount(DCODAROCInfo)
+	#undef typecount
+}
+
+//---------------------------------
+// MakeSubtaskBuffer
+//---------------------------------
+static JEventEVIOBuffer* MakeSubtaskBuffer(SubtaskPool *pool)
+{
+	/// A buffer that splits every event into as many subtasks as pool
+	/// can run at once
+	JEventEVIOBuffer *b = MakeBuffer();
+	b->subtask_pool            = pool;
+	b->PARSE_SUBTASKS          = pool->GetNthreads() + 1;
+	b->PARSE_SUBTASK_MIN_WORDS = 0;
+	return b;
+}
+
+//---------------------------------
+// main
+//---------------------------------
+int main(int narg, char *argv[])
+{
+	const uint32_t Nparsers = 3;
+
+	// Make the events and the serially parsed results up front
+	vector<vector<uint32_t> > blocks;
+	MakePhysicsBlocks(blocks, 300, kALTERNATE_ORDER);
+	vector<EventLines> serial(blocks.size());
+	JEventEVIOBuffer *b_serial = MakeBuffer();
+	uint64_t Nevents = 0;
+	for(uint32_t iblock=0; iblock<blocks.size(); iblock++){
+		Parse(*b_serial, blocks[iblock], IsSwappedBlock(kALTERNATE_ORDER, iblock), AllLines, serial[iblock]);
+		Nevents += serial[iblock].size();
+	}
+	delete b_serial;
+
+	// Parse them all again in each of several threads at once so the
+	// pool has jobs from more than one buffer to deal with
+	SubtaskPool pool(3);
+	atomic<uint32_t> Nbad(0);
+	atomic<uint32_t> Nsplit(0);
+	vector<thread> threads;
+	for(uint32_t iparser=0; iparser<Nparsers; iparser++){
+		threads.push_back( thread([&](){
+			JEventEVIOBuffer *b = MakeSubtaskBuffer(&pool);
+			EventLines events;
+			for(uint32_t iblock=0; iblock<blocks.size(); iblock++){
+				Parse(*b, blocks[iblock], IsSwappedBlock(kALTERNATE_ORDER, iblock), AllLines, events);
+				Nbad += Compare("subtasks", serial[iblock], events);
+			}
+			if( !b->subparsers.empty() ) Nsplit++;
+			delete b;
+		}) );
+	}
+	for(auto &t : threads) t.join();
+
+	printf("%u parsers, %u pool threads: %6lu events   %s\n", Nparsers, pool.GetNthreads(), Nevents, Nbad ? "DIFFER":"ok");
+	if( Nsplit != Nparsers ) printf("FAILED: events were not split into subtasks\n");
+
+	return (Nbad || Nsplit!=Nparsers) ? 1:0;
+}
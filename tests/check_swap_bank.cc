@@ -0,0 +1,371 @@
+//
+//    File: check_swap_bank.cc
+//
+// Round trip check of the EVIO bank walker in swap_bank.cc. Random
+// events are built in native byte order out of banks, segments and
+// tagsegments nested inside each other, with leaf data of every EVIO
+// data type. While building, how each word has to be swapped is
+// recorded so the opposite byte order can be made independently of
+// swap_bank. swap_bank must turn that back into the original exactly:
+//
+//   - out of place and in place
+//   - in the calling thread and split among 4 threads (parallel_min_words
+//     small enough that every event takes the parallel path, even on a
+//     machine with a single hardware thread)
+//
+// Hand made events then check that truncated structures, unknown data
+// types (in banks and in segments) and containers nested more than
+// SWAP_BANK_MAX_DEPTH deep are reported with the right error code.
+// This exits with a non-zero status if anything fails.
+//
+// See README.md for how to build it.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <swap_bank.h>
+
+// Kinds of EVIO structure
+enum{
+	kBANK,
+	kSEGMENT,
+	kTAGSEGMENT
+};
+
+//---------------------------------
+// EventBuilder
+//---------------------------------
+class EventBuilder{
+	public:
+
+		vector<uint32_t> words; // event in native byte order
+		vector<char>     how;   // how each word is swapped: '4' 32bit, '2' 2x16bit, '8'/'9' 64bit pair, 'c' copied
+
+		//----------------
+		// Open
+		//----------------
+		size_t Open(uint32_t kind, uint32_t type, uint32_t tag=1){
+			/// Start a structure. Its length is filled in by Close.
+			size_t istart = words.size();
+			if(kind == kBANK){
+				Add(0);
+				Add(tag<<16 | type<<8 | 0);
+			}else if(kind == kSEGMENT){
+				Add(tag<<24 | type<<16);
+			}else{
+				Add(tag<<20 | type<<16);
+			}
+			kinds.push_back(kind);
+			return istart;
+		}
+
+		//----------------
+		// Close
+		//----------------
+		void Close(size_t istart){
+			uint32_t kind = kinds.back();
+			kinds.pop_back();
+			uint32_t len = words.size() - istart - 1;
+			if(kind == kBANK)
+				words[istart] = len;
+			else
+				words[istart] |= len;
+		}
+
+		//----------------
+		// Data
+		//----------------
+		void Data(uint32_t type, uint32_t Nwords){
+			/// Add Nwords of random leaf data of the given type
+			for(uint32_t i=0; i<Nwords; i++){
+				char h = 'c';
+				switch(type){
+					case 0x01: case 0x02: case 0x0b: h = '4'; break;
+					case 0x04: case 0x05:            h = '2'; break;
+					case 0x08: case 0x09: case 0x0a:
+						if( (Nwords&0x1) && (i==Nwords-1) ) h = 'c'; // odd word is copied
+						else h = (i&0x1) ? '9':'8';
+						break;
+				}
+				Add(rand(), h);
+			}
+		}
+
+		//----------------
+		// Swapped
+		//----------------
+		vector<uint32_t> Swapped(void) const {
+			/// Return the event in the opposite byte order
+			vector<uint32_t> s(words.size());
+			for(size_t i=0; i<words.size(); i++){
+				uint32_t w = words[i];
+				switch(how[i]){
+					case '4': s[i] = __builtin_bswap32(w); break;
+					case '2': s[i] = (uint32_t)__builtin_bswap16(w&0xFFFF) | (uint32_t)__builtin_bswap16(w>>16)<<16; break;
+					case 'c': s[i] = w; break;
+					case '8':{
+						uint64_t v = __builtin_bswap64( (uint64_t)w | (uint64_t)words[i+1]<<32 );
+						s[i]   = (uint32_t)v;
+						s[i+1] = (uint32_t)(v>>32);
+						i++;
+						break;
+					}
+				}
+			}
+			return s;
+		}
+
+	protected:
+		vector<uint32_t> kinds; // kinds of the open structures
+
+		void Add(uint32_t w, char h='4'){ words.push_back(w); how.push_back(h); }
+};
+
+static const uint32_t kDataTypes[] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b};
+static const uint32_t kContainerTypes[] = {0x0c, 0x0d, 0x0e, 0x10, 0x20};
+
+//---------------------------------
+// ChildKind
+//---------------------------------
+static uint32_t ChildKind(uint32_t type)
+{
+	if(type == 0x0c) return kTAGSEGMENT;
+	if(type == 0x0d || type == 0x20) return kSEGMENT;
+	return kBANK;
+}
+
+//---------------------------------
+// AddRandomStructure
+//---------------------------------
+static void AddRandomStructure(EventBuilder &b, uint32_t kind, uint32_t depth)
+{
+	/// Add a structure of the given kind that is either a container of
+	/// a few more random structures or holds random leaf data. Segment
+	/// and tagsegment lengths are only 16 bits so everything is kept
+	/// small. Tagsegment types are only 4 bits so they can't hold
+	/// 0x10 or 0x20.
+
+	bool container = (depth < 6) && (rand()%3 == 0);
+	uint32_t type;
+	if(container){
+		do{
+			type = kContainerTypes[rand()%5];
+		}while( kind==kTAGSEGMENT && type>0x0f );
+	}else{
+		type = kDataTypes[rand()%12];
+	}
+
+	size_t istart = b.Open(kind, type, 1 + rand()%200);
+	if(container){
+		uint32_t Nchildren = rand()%5;
+		for(uint32_t i=0; i<Nchildren; i++) AddRandomStructure(b, ChildKind(type), depth+1);
+	}else{
+		b.Data(type, rand()%(rand()%8 ? 20:600));
+	}
+	b.Close(istart);
+}
+
+//---------------------------------
+// MakeRandomEvent
+//---------------------------------
+static void MakeRandomEvent(EventBuilder &b)
+{
+	/// Top level bank of banks (like a physics event) holding several
+	/// child banks so the parallel path has something to split.
+	size_t istart = b.Open(kBANK, rand()%2 ? 0x0e:0x10, 0xFF50);
+	uint32_t Nchildren = 1 + rand()%12;
+	for(uint32_t i=0; i<Nchildren; i++) AddRandomStructure(b, kBANK, 1);
+	b.Close(istart);
+}
+
+//---------------------------------
+// Swap
+//---------------------------------
+static bool Swap(const vector<uint32_t> &in, const vector<uint32_t> &expected, bool in_place, uint32_t parallel_min_words, int expected_code, uint32_t ierror=0)
+{
+	/// Swap in and check the error code and, if no error is expected,
+	/// that the result is expected. If an error is expected, swap_bank
+	/// must return the index of the structure it was found in (ierror).
+
+	vector<uint32_t> out(in.size(), 0xDEADBEEF);
+	if(in_place) out = in;
+	int err_code = -1;
+	string err_mess;
+	uint32_t Nswapped = swap_bank(out.data(), in_place ? out.data():in.data(), in.size(), err_code, err_mess, parallel_min_words, 4);
+
+	if(err_code != expected_code){
+		printf("   error code %d (\"%s\") when %d was expected\n", err_code, err_mess.c_str(), expected_code);
+		return false;
+	}
+	if(expected_code != SWAP_BANK_OK){
+		if(Nswapped != ierror) printf("   error reported at word %u instead of %u\n", Nswapped, ierror);
+		return Nswapped == ierror;
+	}
+
+	return (Nswapped == in.size()) && (out == expected);
+}
+
+//---------------------------------
+// SwapAllWays
+//---------------------------------
+static bool SwapAllWays(const EventBuilder &b, int expected_code, uint32_t ierror=0)
+{
+	/// Serial and parallel, each in and out of place
+	vector<uint32_t> in = b.Swapped();
+	bool ok = true;
+	for(int in_place=0; in_place<2; in_place++){
+		ok &= Swap(in, b.words, in_place, 0, expected_code, ierror);
+		ok &= Swap(in, b.words, in_place, 1, expected_code, ierror);
+	}
+	return ok;
+}
+
+//---------------------------------
+// AddLeafBanks
+//---------------------------------
+static void AddLeafBanks(EventBuilder &b, uint32_t N)
+{
+	/// Add N good banks of 32 bit data. These are put around the bad
+	/// structure in the error checks so the parallel path splits the
+	/// event and the error is found by one of the other threads.
+	for(uint32_t i=0; i<N; i++){
+		size_t istart = b.Open(kBANK, 0x01);
+		b.Data(0x01, 10);
+		b.Close(istart);
+	}
+}
+
+//---------------------------------
+// Report
+//---------------------------------
+static bool Report(const char *what, bool ok)
+{
+	printf("%-58s %s\n", what, ok ? "ok":"FAILED");
+	return ok;
+}
+
+//---------------------------------
+// main
+//---------------------------------
+int main(int narg, char *argv[])
+{
+	srand(narg>1 ? atoi(argv[1]):1);
+	bool all_ok = true;
+
+	// Random round trips
+	uint32_t Nbad = 0;
+	uint64_t Nwords = 0;
+	for(int i=0; i<20000; i++){
+		EventBuilder b;
+		MakeRandomEvent(b);
+		Nwords += b.words.size();
+		if( !SwapAllWays(b, SWAP_BANK_OK) ) Nbad++;
+	}
+	printf("random events: 20000 (%.1f Mwords), %u bad\n", Nwords/1.0E6, Nbad);
+	all_ok &= Report("random nested events round trip", Nbad==0);
+
+	// Events too short for their own length word
+	{
+		EventBuilder b;
+		MakeRandomEvent(b);
+		vector<uint32_t> in = b.Swapped();
+		bool ok = true;
+		for(size_t len : {(size_t)0, (size_t)1, in.size()-1}){
+			vector<uint32_t> v(in.begin(), in.begin()+len);
+			ok &= Swap(v, v, false, 0, SWAP_BANK_TRUNCATED);
+			ok &= Swap(v, v, false, 1, SWAP_BANK_TRUNCATED);
+		}
+		all_ok &= Report("truncated event", ok);
+	}
+
+	// Child bank longer than its parent. This has to be the last
+	// child or it would just take words from the next one.
+	{
+		EventBuilder b;
+		size_t itop = b.Open(kBANK, 0x0e);
+		AddLeafBanks(b, 3);
+		size_t ichild = b.Open(kBANK, 0x01);
+		b.Data(0x01, 10);
+		b.Close(ichild);
+		b.Close(itop);
+		b.words[ichild] += 5;
+		all_ok &= Report("truncated bank inside bank", SwapAllWays(b, SWAP_BANK_TRUNCATED, ichild));
+	}
+
+	// Segment longer than its parent
+	{
+		EventBuilder b;
+		size_t itop = b.Open(kBANK, 0x0e);
+		AddLeafBanks(b, 3);
+		size_t ibank = b.Open(kBANK, 0x20);
+		size_t iseg = b.Open(kSEGMENT, 0x01);
+		b.Data(0x01, 10);
+		b.Close(iseg);
+		b.Close(ibank);
+		b.Close(itop);
+		b.words[iseg] += 5;
+		all_ok &= Report("truncated segment inside bank", SwapAllWays(b, SWAP_BANK_TRUNCATED, iseg));
+	}
+
+	// Unknown data type in a bank
+	{
+		EventBuilder b;
+		size_t itop = b.Open(kBANK, 0x0e);
+		AddLeafBanks(b, 2);
+		size_t ichild = b.Open(kBANK, 0x30);
+		b.Data(0x01, 10);
+		b.Close(ichild);
+		AddLeafBanks(b, 1);
+		b.Close(itop);
+		all_ok &= Report("unknown type in bank", SwapAllWays(b, SWAP_BANK_UNKNOWN_TYPE, ichild));
+	}
+
+	// Unknown data type in a segment inside a tagsegment container
+	{
+		EventBuilder b;
+		size_t itop = b.Open(kBANK, 0x0e);
+		AddLeafBanks(b, 2);
+		size_t ibank = b.Open(kBANK, 0x0c);
+		size_t itag = b.Open(kTAGSEGMENT, 0x0d);
+		size_t iseg = b.Open(kSEGMENT, 0x30);
+		b.Data(0x01, 10);
+		b.Close(iseg);
+		b.Close(itag);
+		b.Close(ibank);
+		AddLeafBanks(b, 1);
+		b.Close(itop);
+		all_ok &= Report("unknown type in segment", SwapAllWays(b, SWAP_BANK_UNKNOWN_TYPE, iseg));
+	}
+
+	// Containers nested as deep as allowed and one level deeper. The
+	// top level bank is the first container.
+	for(uint32_t Ncontainers : {SWAP_BANK_MAX_DEPTH-1, SWAP_BANK_MAX_DEPTH}){
+		EventBuilder b;
+		vector<size_t> open;
+		for(uint32_t i=0; i<Ncontainers; i++){
+			uint32_t kind = (i%3==0) ? kBANK : (i%3==1 ? kSEGMENT:kTAGSEGMENT);
+			uint32_t next = ((i+1)%3==0) ? 0x0e : ((i+1)%3==1 ? 0x0d:0x0c);
+			open.push_back( b.Open(kind, next) );
+		}
+		uint32_t kind = (Ncontainers%3==0) ? kBANK : (Ncontainers%3==1 ? kSEGMENT:kTAGSEGMENT);
+		size_t ileaf = b.Open(kind, 0x01);
+		b.Data(0x01, 4);
+		b.Close(ileaf);
+		uint32_t ideepest = open.back();
+		while(!open.empty()){
+			b.Close(open.back());
+			open.pop_back();
+		}
+		bool too_deep = Ncontainers >= SWAP_BANK_MAX_DEPTH;
+		string what = to_string(Ncontainers) + " nested containers " + (too_deep ? "(too deep)":"(allowed)");
+		all_ok &= Report(what.c_str(), SwapAllWays(b, too_deep ? SWAP_BANK_TOO_DEEP:SWAP_BANK_OK, ideepest));
+	}
+
+	return all_ok ? 0:1;
+}
@@ -0,0 +1,109 @@
+//
+//    File: event_lines.h
+//
+// Turns the hits of parsed events into sorted lists of text lines
+// so the checks in this directory can compare the output of the
+// parser run in different ways. Each line holds a type name and
+// the values of one hit. The objects are sorted when the
+// associations are linked while views and columns stay in the
+// order they were decoded so the lines of each event are sorted
+// before they are compared.
+//
+
+#ifndef _event_lines_
+#define _event_lines_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "parse_words.h"
+
+typedef std::vector<std::vector<std::string> > EventLines; // sorted hit values for each parsed event
+
+//---------------------------------
+// Line
+//---------------------------------
+inline std::string Line(const char *type, std::initializer_list<uint64_t> values, const std::vector<uint16_t> *samples=NULL)
+{
+	std::stringstream ss;
+	ss << type;
+	for(auto v : values) ss << " " << v;
+	if(samples) for(auto s : *samples) ss << " " << s;
+	return ss.str();
+}
+
+//---------------------------------
+// NonColumnObjectLines
+//---------------------------------
+inline void NonColumnObjectLines(const DParsedEvent *pe, std::vector<std::string> &lines)
+{
+	/// Objects of the types that are never stored in columns
+	for(auto p : pe->Get<Df250PulseData>()) lines.push_back(Line("f250PulseData", {p->rocid, p->slot, p->channel, p->itrigger, p->event_within_block, p->QF_pedestal, p->pedestal, p->integral, p->QF_NSA_beyond_PTW, p->QF_overflow, p->QF_underflow, p->nsamples_over_threshold, p->course_time, p->fine_time, p->pulse_peak, p->QF_vpeak_beyond_NSA, p->QF_vpeak_not_found, p->QF_bad_pedestal, p->pulse_number}));
+	for(auto p : pe->Get<Df250WindowRawData>()) lines.push_back(Line("f250WindowRawData", {p->rocid, p->slot, p->channel, p->itrigger, p->invalid_samples, p->overflow}, &p->samples));
+	for(auto p : pe->Get<Df125WindowRawData>()) lines.push_back(Line("f125WindowRawData", {p->rocid, p->slot, p->channel, p->itrigger, p->invalid_samples, p->overflow}, &p->samples));
+	for(auto p : pe->Get<DF1TDCHit>()) lines.push_back(Line("F1TDCHit", {p->rocid, p->slot, p->channel, p->itrigger, p->trig_time, p->time, p->data_word, p->res_status, p->output_fifo_overflow_status, p->hit_fifo_overflow_status}));
+}
+
+//---------------------------------
+// ObjectLines
+//---------------------------------
+inline void ObjectLines(const DParsedEvent *pe, std::vector<std::string> &lines)
+{
+	NonColumnObjectLines(pe, lines);
+	for(auto p : pe->Get<Df125CDCPulse>()) lines.push_back(Line("f125CDCPulse", {p->rocid, p->slot, p->channel, p->itrigger, p->NPK, p->le_time, p->time_quality_bit, p->overflow_count, p->pedestal, p->integral, p->first_max_amp, p->word1, p->word2}));
+	for(auto p : pe->Get<Df125FDCPulse>()) lines.push_back(Line("f125FDCPulse", {p->rocid, p->slot, p->channel, p->itrigger, p->NPK, p->le_time, p->time_quality_bit, p->overflow_count, p->pedestal, p->integral, p->peak_amp, p->peak_time, p->word1, p->word2}));
+}
+
+//---------------------------------
+// Parse
+//---------------------------------
+inline void Parse(JEventEVIOBuffer &b, const std::vector<uint32_t> &words, bool swapped, void (*lines_of)(const DParsedEvent*, std::vector<std::string>&), EventLines &events)
+{
+	/// Parse the words with b and fill events with the sorted hit
+	/// values of each parsed event.
+
+	ParseWords(b, words, swapped);
+	events.clear();
+	for(auto pe : b.current_parsed_events){
+		events.emplace_back();
+		lines_of(pe, events.back());
+		std::sort(events.back().begin(), events.back().end());
+	}
+	ReleaseEvents(b);
+}
+
+//---------------------------------
+// Compare
+//---------------------------------
+inline uint32_t Compare(const char *what, const EventLines &expected, const EventLines &found)
+{
+	/// Return the number of events that differ, printing the first
+	/// difference of the first few.
+
+	static uint32_t Nprinted = 0;
+	uint32_t Nbad = 0;
+	if( expected.size() != found.size() ){
+		if(Nprinted++ < 5) printf("   %s: %zu events instead of %zu\n", what, found.size(), expected.size());
+		return 1;
+	}
+	for(size_t iev=0; iev<expected.size(); iev++){
+		if( expected[iev] == found[iev] ) continue;
+		Nbad++;
+		if(Nprinted++ >= 5) continue;
+		printf("   %s: event %zu differs (%zu hits, expected %zu)\n", what, iev, found[iev].size(), expected[iev].size());
+		for(size_t i=0; i<expected[iev].size() && i<found[iev].size(); i++){
+			if( expected[iev][i] == found[iev][i] ) continue;
+			printf("      expected: %s\n      found:    %s\n", expected[iev][i].c_str(), found[iev][i].c_str());
+			break;
+		}
+	}
+	return Nbad;
+}
+
+#endif // _event_lines_
@@ -0,0 +1,350 @@
+//
+//    File: evio_event_gen.h
+//
+// Builds synthetic GlueX physics events for the checks in this
+// directory that run the parser. An event has a built trigger bank
+// and three ROCs: one of f250s (with a config bank), one of f125s
+// and one with F1TDCs and a CAEN1290 TDC. The modules write pulse
+// data, Window Raw Data and TDC hits with random values. The words
+// are built in host byte order and Swapped() gives the same event as
+// it would be written by a machine of the other byte order.
+// MakePhysicsBlocks makes a whole set of them in either byte order.
+// MakeEPICSEvent and MakeBOREvent make the other two kinds of event
+// the parser handles. Those are only parsed in host byte order so
+// they are not meant to be swapped.
+//
+
+#ifndef _evio_event_gen_
+#define _evio_event_gen_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include <DAQ/bor_roc.h>
+
+//----------------
+// EVIOEventWords
+//----------------
+class EVIOEventWords{
+	public:
+		std::vector<uint32_t> words;
+		std::vector<char>     how;  // how each word swaps: '4', '2' (two 16 bit), '8' (64 bit) or 'c' (second half of 64 bit)
+
+		void Put(uint32_t w, char h='4'){ words.push_back(w); how.push_back(h); }
+		void Put64(uint64_t w){ Put((uint32_t)w, '8'); Put((uint32_t)(w>>32), 'c'); }
+
+		// Reserve a length word for a bank and set it once the bank is complete
+		size_t Open(void){ Put(0); return words.size()-1; }
+		void Close(size_t ilen){ words[ilen] = words.size() - ilen - 1; }
+
+		std::vector<uint32_t> Swapped(void) const {
+			std::vector<uint32_t> s(words.size());
+			for(size_t i=0; i<words.size(); i++){
+				uint32_t w = words[i];
+				switch(how[i]){
+					case '2':
+						s[i] = (uint32_t)__builtin_bswap16(w&0xFFFF) | ((uint32_t)__builtin_bswap16(w>>16))<<16;
+						break;
+					case '8':
+						{
+							uint64_t w64 = __builtin_bswap64( (uint64_t)w | ((uint64_t)words[i+1])<<32 );
+							s[i]   = (uint32_t)w64;
+							s[i+1] = (uint32_t)(w64>>32);
+							i++;
+						}
+						break;
+					default:
+						s[i] = __builtin_bswap32(w);
+				}
+			}
+			return s;
+		}
+};
+
+//---------------------------------
+// Random
+//---------------------------------
+inline uint32_t Random(uint32_t n)
+{
+	return (uint32_t)(rand()%n);
+}
+
+//---------------------------------
+// MakePhysicsEvent
+//---------------------------------
+inline void MakePhysicsEvent(EVIOEventWords &ev, uint32_t M, uint64_t first_event, bool window_raw_data=true)
+{
+	/// Append a physics event with M L1 triggers to ev.
+
+	size_t iev = ev.Open();
+	ev.Put(0xFF50u<<16 | 0x10<<8 | M);
+
+	// Built trigger bank
+	uint32_t rocids[3] = {11, 25, 51};
+	uint32_t Nrocs = 3;
+	size_t itrg = ev.Open();
+	ev.Put(0xFF23u<<16 | 0x20<<8 | Nrocs);
+	ev.Put(0xFFu<<24 | 0x0a<<16 | 2*(M+2));   // 64 bit segment: first event, timestamps, run info
+	ev.Put64(first_event);
+	for(uint32_t i=0; i<M; i++) ev.Put64(0x123456789ull*(i+1) + Random(1000));
+	ev.Put64((uint64_t)31000<<32 | 7);
+	ev.Put(0xFFu<<24 | 0x05<<16 | (M+1)/2);   // 16 bit segment: event types
+	for(uint32_t i=0; i<(M+1)/2; i++) ev.Put(Random(65536) | ((2*i+1<M) ? Random(65536)<<16:0), '2');
+	for(uint32_t iroc=0; iroc<Nrocs; iroc++){ // 32 bit segment for each ROC
+		ev.Put(rocids[iroc]<<24 | 0x01<<16 | 3*M);
+		for(uint32_t i=0; i<3*M; i++) ev.Put(Random(0xFFFFFFFF));
+	}
+	ev.Close(itrg);
+
+	// f250 ROC
+	size_t iroc = ev.Open();
+	ev.Put(rocids[0]<<16 | 0x0e<<8 | M);
+	size_t icfg = ev.Open();
+	ev.Put(0x55u<<16 | 0x01<<8 | 0);
+	ev.Put(0x3u<<24 | 0x000C0);
+	ev.Put(0x0501u<<16 | 20);
+	ev.Put(0x0502u<<16 | 5);
+	ev.Put(0x0504u<<16 | 4);
+	ev.Close(icfg);
+	size_t idata = ev.Open();
+	ev.Put(6u<<16 | 0x01<<8 | M);
+	for(uint32_t slot=3; slot<6; slot++){
+		size_t iblock = ev.words.size();
+		ev.Put(0x80000000 | slot<<22 | 1<<18 | M);             // block header
+		for(uint32_t itrigger=1; itrigger<=M; itrigger++){
+			ev.Put(0x90000000 | slot<<22 | itrigger);          // event header
+			ev.Put(0x98000000 | Random(0xFFFFFF));             // trigger time
+			ev.Put(Random(0xFFFFFF));
+			for(uint32_t ihit=0; ihit<1+Random(4); ihit++){
+				ev.Put(0xC8000000 | itrigger<<19 | Random(16)<<15 | Random(0x3FFF)); // pulse data
+				for(uint32_t ipulse=0; ipulse<1+Random(2); ipulse++){
+					ev.Put(0x40000000 | Random(0x3FFFFFFF));
+					ev.Put(Random(0x3FFFFFFF));
+				}
+			}
+			if( window_raw_data && Random(2) ){
+				uint32_t width = 2*(4+Random(50)) - Random(2);
+				ev.Put(0xA0000000 | Random(16)<<23 | width);
+				for(uint32_t isample=0; isample<width; isample+=2) ev.Put(Random(0x7FFFFFFF) & 0x3FFF3FFF);
+			}
+		}
+		ev.Put(0x88000000 | slot<<22 | (uint32_t)(ev.words.size()-iblock+1)); // block trailer
+	}
+	while(ev.words.size()%4) ev.Put(0xF8000000);             // filler
+	ev.Close(idata);
+	ev.Close(iroc);
+
+	// f125 ROC
+	iroc = ev.Open();
+	ev.Put(rocids[1]<<16 | 0x0e<<8 | M);
+	idata = ev.Open();
+	ev.Put(16u<<16 | 0x01<<8 | M);
+	for(uint32_t slot=3; slot<5; slot++){
+		size_t iblock = ev.words.size();
+		ev.Put(0x80000000 | slot<<22 | 2<<18 | M);
+		for(uint32_t itrigger=1; itrigger<=M; itrigger++){
+			ev.Put(0x90000000 | slot<<22 | itrigger);
+			ev.Put(0x98000000 | Random(0xFFFFFF));
+			ev.Put(Random(0xFFFFFF));
+			for(uint32_t ihit=0; ihit<Random(5); ihit++){
+				uint32_t types[3] = {5, 6, 9};                   // CDC pulse, FDC pulse integral or peak
+				uint32_t type = types[Random(3)];
+				ev.Put(0x80000000 | type<<27 | Random(0x7FFFFFF));
+				ev.Put(Random(0x7FFFFFFF));
+			}
+			if( window_raw_data && Random(2) ){
+				uint32_t width = 2*(4+Random(30));
+				ev.Put(0xA0000000 | Random(72)<<20 | width);
+				for(uint32_t isample=0; isample<width; isample+=2) ev.Put(Random(0x7FFFFFFF) & 0x1FFF1FFF);
+			}
+		}
+		ev.Put(0x88000000 | slot<<22 | (uint32_t)(ev.words.size()-iblock+1));
+	}
+	ev.Close(idata);
+	ev.Close(iroc);
+
+	// F1TDC and CAEN1290 ROC
+	iroc = ev.Open();
+	ev.Put(rocids[2]<<16 | 0x0e<<8 | M);
+	idata = ev.Open();
+	ev.Put(26u<<16 | 0x01<<8 | M);
+	for(uint32_t slot=3; slot<5; slot++){
+		size_t iblock = ev.words.size();
+		ev.Put(0x80000000 | slot<<22 | 3<<18 | M);
+		for(uint32_t itrigger=1; itrigger<=M; itrigger++){
+			ev.Put(0x90000000 | slot<<22 | itrigger);
+			ev.Put(0x98000000 | Random(0xFFFFFF));
+			ev.Put(Random(0xFFFFFF));
+			ev.Put(0xC0000000 | Random(0x7FFFFFF));             // F1 header
+			for(uint32_t ihit=0; ihit<Random(6); ihit++) ev.Put(0xB8000000 | 1<<26 | Random(0x3FFFFFF)); // hit (chip locked)
+		}
+		ev.Put(0x88000000 | slot<<22 | (uint32_t)(ev.words.size()-iblock+1));
+	}
+	ev.Close(idata);
+	idata = ev.Open();
+	ev.Put(20u<<16 | 0x01<<8 | M);
+	ev.Put(0x40000000 | 7<<5 | 9);                           // global header (slot 9)
+	for(uint32_t itrigger=1; itrigger<=M; itrigger++){
+		ev.Put(0x08000000 | itrigger<<12 | Random(0xFFF));     // TDC header
+		for(uint32_t ihit=0; ihit<Random(4); ihit++) ev.Put(Random(0x7FFFFFF));
+		ev.Put(0x18000000 | itrigger<<12 | 3);                 // TDC trailer
+	}
+	ev.Put(0x80000000 | 9);                                  // global trailer
+	ev.Close(idata);
+	ev.Close(iroc);
+
+	ev.Close(iev);
+}
+
+//---------------------------------
+// MakeEPICSEvent
+//---------------------------------
+inline void MakeEPICSEvent(EVIOEventWords &ev, uint32_t timestamp)
+{
+	/// Append an EPICS event with a timestamp and a few "name=value"
+	/// strings to ev. The values are random and one of them is too
+	/// long to fit in a std::string without allocating.
+
+	const char *names[] = {"IBCAD00CRCUR6", "HALLD:p", "RESET:i:GasPanelBarPress1", "hd:radiator:motor.RBV", "HD:coda:daq:run_comment"};
+	const uint32_t Nnames = sizeof(names)/sizeof(names[0]);
+
+	size_t iev = ev.Open();
+	ev.Put(0x0060u<<16 | 0x20<<8 | 0);
+	ev.Put(0x61u<<24 | 0x01<<16 | 1);                         // timestamp segment
+	ev.Put(timestamp);
+	for(uint32_t i=0; i<Nnames; i++){
+		char str[256];
+		if( i == Nnames-1 ){
+			snprintf(str, sizeof(str), "%s=cosmics with the magnet at %u A and the radiator retracted", names[i], 1000+Random(400));
+		}else{
+			snprintf(str, sizeof(str), "%s=%u.%03u", names[i], Random(100000), Random(1000));
+		}
+		uint32_t Nwords = strlen(str)/4 + 1;                     // at least one NUL at the end
+		ev.Put(0x62u<<24 | 0x03<<16 | Nwords);                   // string segment
+		std::vector<uint32_t> w(Nwords, 0);
+		memcpy(w.data(), str, strlen(str));
+		for(auto x : w) ev.Put(x);
+	}
+	ev.Close(iev);
+}
+
+//---------------------------------
+// MakeBOREvent
+//---------------------------------
+inline void MakeBOREvent(EVIOEventWords &ev, uint32_t generation)
+{
+	/// Append a BOR event with the config of the modules MakePhysicsEvent
+	/// writes data for to ev. The f250s and f125s report the given
+	/// firmware generation (1 or 2, see Df250BORConfig::FirmwareGeneration).
+	/// Each module bank is the struct from DAQ/bor_roc.h as written by
+	/// the ROC (see JEventEVIOBuffer::ParseBORbank).
+
+	const uint32_t kFADC250 = 1, kFADC125 = 2, kF1TDC32 = 3, kCAEN1290 = 19; // DModuleType
+
+	size_t iev = ev.Open();
+	ev.Put(0x700e01);
+
+	// f250 crate
+	size_t icrate = ev.Open();
+	ev.Put(0x71u<<16 | 0x01<<8 | 11);
+	for(uint32_t slot=3; slot<6; slot++){
+		f250config c;
+		memset(&c, 0, sizeof(c));
+		c.rocid         = 11;
+		c.slot          = slot;
+		c.adc_status[0] = generation==2 ? 0x0C0D:0x0A09;
+		c.adc_ptw       = 100;
+		c.adc_nsb       = 3;
+		c.adc_nsa       = 20;
+		c.config7       = 3<<10 | 1000;
+		const uint32_t *w = (const uint32_t*)&c;
+		ev.Put(slot<<25 | kFADC250<<20 | (uint32_t)(sizeof(c)/4));
+		for(uint32_t i=0; i<sizeof(c)/4; i++) ev.Put(w[i]);
+	}
+	ev.Close(icrate);
+
+	// f125 crate
+	icrate = ev.Open();
+	ev.Put(0x71u<<16 | 0x01<<8 | 25);
+	for(uint32_t slot=3; slot<5; slot++){
+		f125config c;
+		memset(&c, 0, sizeof(c));
+		c.rocid = 25;
+		c.slot  = slot;
+		for(uint32_t i=0; i<12; i++){
+			c.fe[i].version = generation==2 ? 0x10103:0x0F01;
+			c.fe[i].nw      = 80;
+			c.fe[i].pl      = 1000;
+			c.fe[i].ie      = 4<<12 | 60;                        // PG=4, IE=60
+			c.fe[i].ped_sf  = 8<<8 | 16;                         // NP2=8, NP=16
+		}
+		const uint32_t *w = (const uint32_t*)&c;
+		ev.Put(slot<<25 | kFADC125<<20 | (uint32_t)(sizeof(c)/4));
+		for(uint32_t i=0; i<sizeof(c)/4; i++) ev.Put(w[i]);
+	}
+	ev.Close(icrate);
+
+	// F1TDC and CAEN1290 crate
+	icrate = ev.Open();
+	ev.Put(0x71u<<16 | 0x01<<8 | 51);
+	for(uint32_t slot=3; slot<5; slot++){
+		F1TDCconfig c;
+		memset(&c, 0, sizeof(c));
+		c.rocid  = 51;
+		c.slot   = slot;
+		c.nchips = 8;
+		const uint32_t *w = (const uint32_t*)&c;
+		ev.Put(slot<<25 | kF1TDC32<<20 | (uint32_t)(sizeof(c)/4));
+		for(uint32_t i=0; i<sizeof(c)/4; i++) ev.Put(w[i]);
+	}
+	caen1190config c;
+	memset(&c, 0, sizeof(c));
+	c.rocid = 51;
+	c.slot  = 9;
+	const uint32_t *w = (const uint32_t*)&c;
+	ev.Put(9u<<25 | kCAEN1290<<20 | (uint32_t)(sizeof(c)/4));
+	for(uint32_t i=0; i<sizeof(c)/4; i++) ev.Put(w[i]);
+	ev.Close(icrate);
+
+	ev.Close(iev);
+}
+
+// Byte order of the blocks made by MakePhysicsBlocks
+enum EVIOBlockOrder{
+	kHOST_ORDER,
+	kSWAPPED_ORDER,
+	kALTERNATE_ORDER  // every other block (odd ones) swapped
+};
+
+//---------------------------------
+// IsSwappedBlock
+//---------------------------------
+inline bool IsSwappedBlock(EVIOBlockOrder order, uint32_t iblock)
+{
+	return (order==kSWAPPED_ORDER) || (order==kALTERNATE_ORDER && (iblock%2));
+}
+
+//---------------------------------
+// MakePhysicsBlocks
+//---------------------------------
+inline void MakePhysicsBlocks(std::vector<std::vector<uint32_t> > &blocks, uint32_t Nblocks, EVIOBlockOrder order, bool window_raw_data=true)
+{
+	/// Fill blocks with Nblocks physics events of 1-40 L1 triggers
+	/// each, numbered as if they followed one another in a file. The
+	/// random number sequence is restarted so every call with the same
+	/// arguments makes the same events.
+
+	srand(1);
+	blocks.clear();
+	for(uint32_t iblock=0; iblock<Nblocks; iblock++){
+		EVIOEventWords ev;
+		MakePhysicsEvent(ev, 1+Random(40), 1000+iblock*100, window_raw_data);
+		blocks.push_back( IsSwappedBlock(order, iblock) ? ev.Swapped():ev.words );
+	}
+}
+
+#endif // _evio_event_gen_
@@ -0,0 +1,58 @@
+//
+//    File: parse_words.cc
+//
+// See parse_words.h
+//
+
+#include <string.h>
+
+#include "../JEventEVIOBuffer.cc"
+#include "parse_words.h"
+
+template void JEventEVIOBuffer::MakeEventsInMode<EVIONativeWords>();
+template void JEventEVIOBuffer::MakeEventsInMode<EVIOSwappedWords>();
+
+//---------------------------------
+// MakeBuffer
+//---------------------------------
+JEventEVIOBuffer* MakeBuffer(uint8_t generation)
+{
+	JEventEVIOBuffer *b = new JEventEVIOBuffer(NULL);
+	b->VERBOSE = 0;
+	b->jobtype = JEventEVIOBuffer::JOB_ASSOCIATE;
+	b->f250_firmware.assign(256, generation);
+	b->f125_firmware.assign(256, generation);
+	return b;
+}
+
+//---------------------------------
+// ParseWords
+//---------------------------------
+void ParseWords(JEventEVIOBuffer &b, const vector<uint32_t> &words, bool swapped)
+{
+	if( b.buff_len < words.size() ){
+		delete[] b.buff;
+		b.buff_len = words.size();
+		b.buff = new uint32_t[b.buff_len];
+	}
+	memcpy(b.buff, words.data(), words.size()*sizeof(uint32_t));
+	b.ibuff = b.buff;
+
+	if(swapped)
+		b.MakeEventsInMode<EVIOSwappedWords>();
+	else
+		b.MakeEventsInMode<EVIONativeWords>();
+	b.LinkAllAssociations();
+}
+
+//---------------------------------
+// ReleaseEvents
+//---------------------------------
+void ReleaseEvents(JEventEVIOBuffer &b)
+{
+	for(auto pe : b.current_parsed_events){
+		pe->ReleaseLazy();
+		pe->in_use = false;
+	}
+	b.current_parsed_events.clear();
+}
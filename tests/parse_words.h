@@ -0,0 +1,35 @@
+//
+//    File: parse_words.h
+//
+// Runs the parser of a JEventEVIOBuffer on a block of words outside
+// of a JANA event source for the checks in this directory. The
+// MakeEventsInMode templates are only instantiated inside
+// JEventEVIOBuffer.cc so parse_words.cc compiles that file along
+// with the explicit instantiations. It must be linked in place of
+// ../JEventEVIOBuffer.cc.
+//
+
+#ifndef _parse_words_
+#define _parse_words_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <JEventEVIOBuffer.h>
+
+// Make a buffer set up the way JEventSource_EVIO sets them up, with
+// the default parsing options and linking of associated objects. The
+// f250 and f125 decoders for firmware generation (1 or 2) are used for
+// all crates. 0 means the generic ones.
+JEventEVIOBuffer* MakeBuffer(uint8_t generation=0);
+
+// Parse words (one or more EVIO events) into b.current_parsed_events
+// and link the associations. swapped is true if the words are in the
+// other byte order.
+void ParseWords(JEventEVIOBuffer &b, const std::vector<uint32_t> &words, bool swapped);
+
+// Give the parsed events back to b's pool so they are reused
+void ReleaseEvents(JEventEVIOBuffer &b);
+
+#endif // _parse_words_
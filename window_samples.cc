@@ -0,0 +1,122 @@
+//
+//    File: window_samples.cc
+//
+
+#include <window_samples.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+using namespace std;
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define WINDOW_SAMPLES_X86 1
+#include <immintrin.h>
+#endif
+
+//---------------------------------
+// unpack_scalar
+//---------------------------------
+static uint32_t unpack_scalar(const uint32_t *in, uint32_t maxwords, bool swapped, uint16_t *samples, bool &invalid, bool &overflow)
+{
+	uint32_t flags = 0;
+	uint32_t i = 0;
+	for(; i<maxwords; i++){
+		uint32_t w = swapped ? __builtin_bswap32(in[i]):in[i];
+		if( w & 0x80000000 ) break;
+
+		// Zero any sample whose "not valid" bit is set
+		uint32_t valid = ~(((w>>13) & 0x00010001)*0x1FFF);
+		w &= valid;
+		samples[2*i  ] = (w>>16) & 0x1FFF;
+		samples[2*i+1] = (w>> 0) & 0x1FFF;
+		flags |= w & 0x30003000;
+	}
+	if( flags & 0x20002000 ) invalid  = true;
+	if( flags & 0x10001000 ) overflow = true;
+
+	return i;
+}
+
+#ifdef WINDOW_SAMPLES_X86
+
+// Byte permutations that exchange the 16-bit halves of each 32-bit
+// word. This puts the first sample (upper half) in the lower 16-bit
+// lane so a plain store writes samples in order. The second version
+// also reverses the byte order of each word.
+#define ROT16_NATIVE  2,3,0,1,6,7,4,5,10,11,8,9,14,15,12,13
+#define ROT16_SWAPPED 1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14
+alignas(32) static const uint8_t kRot16Native[32]  = {ROT16_NATIVE,  ROT16_NATIVE};
+alignas(32) static const uint8_t kRot16Swapped[32] = {ROT16_SWAPPED, ROT16_SWAPPED};
+
+//---------------------------------
+// unpack_avx2
+//---------------------------------
+__attribute__((target("avx2")))
+static uint32_t unpack_avx2(const uint32_t *in, uint32_t maxwords, bool swapped, uint16_t *samples, bool &invalid, bool &overflow)
+{
+	/// Decode 8 words (16 samples) per iteration. After the byte
+	/// permutation each 16-bit lane holds one sample with its "not
+	/// valid" flag in bit 13. The flag of the first sample's lane
+	/// also has the word's bit 31 in bit 15 which is picked out with
+	/// movemask to find the end of the samples.
+
+	__m256i rot       = _mm256_load_si256((const __m256i*)(swapped ? kRot16Swapped:kRot16Native));
+	__m256i mask_data = _mm256_set1_epi16(0x1FFF);
+	__m256i mask_inv  = _mm256_set1_epi16(0x2000);
+	__m256i mask_ovf  = _mm256_set1_epi16(0x1000);
+	__m256i zero      = _mm256_setzero_si256();
+	__m256i inv_acc   = zero;
+	__m256i ovf_acc   = zero;
+
+	uint32_t i = 0;
+	for(; i+8<=maxwords; i+=8){
+		__m256i x     = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)&in[i]), rot);
+		__m256i inv   = _mm256_and_si256(x, mask_inv);
+		__m256i valid = _mm256_cmpeq_epi16(inv, zero);
+		__m256i s     = _mm256_and_si256(_mm256_and_si256(x, mask_data), valid);
+		_mm256_storeu_si256((__m256i*)&samples[2*i], s);
+
+		uint32_t stop = (uint32_t)_mm256_movemask_epi8(x) & 0x22222222;
+		if( stop ){
+			// Only count flags from words before the one with bit 31 set
+			uint32_t Nvalid = __builtin_ctz(stop)/4;
+			__m256i lanes = _mm256_cmpgt_epi32(_mm256_set1_epi32(Nvalid), _mm256_setr_epi32(0,1,2,3,4,5,6,7));
+			inv_acc = _mm256_or_si256(inv_acc, _mm256_and_si256(inv, lanes));
+			ovf_acc = _mm256_or_si256(ovf_acc, _mm256_and_si256(_mm256_and_si256(s, mask_ovf), lanes));
+			i += Nvalid;
+			if( !_mm256_testz_si256(inv_acc, inv_acc) ) invalid  = true;
+			if( !_mm256_testz_si256(ovf_acc, ovf_acc) ) overflow = true;
+			return i;
+		}
+		inv_acc = _mm256_or_si256(inv_acc, inv);
+		ovf_acc = _mm256_or_si256(ovf_acc, _mm256_and_si256(s, mask_ovf));
+	}
+	if( !_mm256_testz_si256(inv_acc, inv_acc) ) invalid  = true;
+	if( !_mm256_testz_si256(ovf_acc, ovf_acc) ) overflow = true;
+
+	// Last few words
+	return i + unpack_scalar(&in[i], maxwords-i, swapped, &samples[2*i], invalid, overflow);
+}
+
+#endif // WINDOW_SAMPLES_X86
+
+//---------------------------------
+// GetUnpackSamplesKernel
+//---------------------------------
+unpack_samples_t GetUnpackSamplesKernel(void)
+{
+	/// Return the AVX2 kernel if the CPU supports it, the scalar
+	/// one otherwise (or if HDEVIO_UNPACK_KERNEL=scalar is set).
+
+	const char *force = getenv("HDEVIO_UNPACK_KERNEL");
+	if( force && string(force)=="scalar" ) return unpack_scalar;
+
+#ifdef WINDOW_SAMPLES_X86
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports("avx2") ) return unpack_avx2;
+#endif // WINDOW_SAMPLES_X86
+
+	return unpack_scalar;
+}
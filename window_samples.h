@@ -0,0 +1,92 @@
+//
+//    File: window_samples.h
+//
+// Unpacking of the sample words that follow a Window Raw Data
+// header from the f250 and f125 flash ADCs. Each word holds two
+// 13-bit samples (bits 16-28 and 0-12) with a "not valid" flag
+// above each (bits 29 and 13). Bit 31 is clear for these words so
+// the first word with it set marks the end of the samples. The
+// AVX2 kernel is compiled with a target attribute and is only used
+// if the CPU supports it. Otherwise a scalar loop is used. The
+// environment variable HDEVIO_UNPACK_KERNEL=scalar can be used to
+// force the scalar version for comparisons.
+//
+
+#ifndef _window_samples_
+#define _window_samples_
+
+#include <stdint.h>
+#include <vector>
+
+// Decode up to maxwords sample words from in into 2 samples per
+// word, stopping at the first word with bit 31 set. Words are
+// byte swapped first if swapped is true. Samples flagged as not
+// valid are set to zero. invalid and overflow are set if any of the
+// decoded samples had the "not valid" flag or bit 12 set. Returns
+// the number of words decoded.
+typedef uint32_t (*unpack_samples_t)(const uint32_t *in, uint32_t maxwords, bool swapped, uint16_t *samples, bool &invalid, bool &overflow);
+
+unpack_samples_t GetUnpackSamplesKernel(void);
+
+//---------------------------------
+// UnpackWindowSamples
+//---------------------------------
+inline uint32_t UnpackWindowSamples(const uint32_t *in, uint32_t window_width, bool swapped, std::vector<uint16_t> &samples, bool &invalid, bool &overflow)
+{
+	/// Fill samples from the words following a Window Raw Data header
+	/// (in points to the first one). The samples vector is sized once
+	/// up front and trimmed at the end. This reproduces the original
+	/// one-sample-at-a-time loop exactly, including dropping the second
+	/// sample of the last word if it is flagged as invalid and the
+	/// window width is even. Returns the number of words used.
+
+	static const unpack_samples_t unpack = GetUnpackSamplesKernel();
+
+	uint32_t maxwords = (window_width+1)/2;
+	samples.resize(2*maxwords);
+	bool my_invalid  = false;
+	bool my_overflow = false;
+	uint32_t Nwords = unpack(in, maxwords, swapped, samples.data(), my_invalid, my_overflow);
+	uint32_t Nsamples = 2*Nwords;
+
+	if( (Nwords==maxwords) && (Nwords>0) && ((window_width&0x1)==0) ){
+		uint32_t last = swapped ? __builtin_bswap32(in[Nwords-1]):in[Nwords-1];
+		if( (last>>13) & 0x1 ){
+			// Last sample is dropped so should not count as invalid.
+			// This is rare so just redo the flag from the words.
+			Nsamples--;
+			my_invalid = (last>>29) & 0x1;
+			for(uint32_t i=0; i+1<Nwords; i++){
+				uint32_t w = swapped ? __builtin_bswap32(in[i]):in[i];
+				if( w & 0x20002000 ) my_invalid = true;
+			}
+		}
+	}
+
+	samples.resize(Nsamples);
+	invalid  |= my_invalid;
+	overflow |= my_overflow;
+
+	return Nwords;
+}
+
+//---------------------------------
+// CountWindowSampleWords
+//---------------------------------
+inline uint32_t CountWindowSampleWords(const uint32_t *in, uint32_t window_width, bool swapped)
+{
+	/// Return the number of words UnpackWindowSamples would use
+	/// without decoding them. This is for when the samples are
+	/// decoded later from the words (see DAQ/DHitViews.h).
+
+	uint32_t maxwords = (window_width+1)/2;
+	uint32_t Nwords = 0;
+	for(; Nwords<maxwords; Nwords++){
+		uint32_t w = swapped ? __builtin_bswap32(in[Nwords]):in[Nwords];
+		if( w & 0x80000000 ) break;
+	}
+
+	return Nwords;
+}
+
+#endif // _window_samples_